@@ -30,6 +30,57 @@ class TestIntersect(IntegrationTest, unittest.TestCase):
             expected_file = self.inputFiles(expected)[0]
             self.assertFilesEqual(expected_file, output_file)
 
+    def test_index_b(self):
+        data = {
+            "--exact-allele --output-both": "expected-exact-allele-both.bed",
+            "--exact-pos": "expected-exact-pos.bed",
+            "--output-both": "expected-noargs-both.bed",
+            "": "expected-noargs.bed",
+        }
+
+        for args, expected in data.items():
+            output_file = self.tempFile("output.bed")
+
+            params = [ "intersect", "--index-b", args, "-o", output_file ]
+            params.extend(self.inputFiles("a.bed", "b.bed"))
+
+            rv, err = self.execute(params)
+            self.assertEqual(0, rv)
+            self.assertEqual('', err)
+            expected_file = self.inputFiles(expected)[0]
+            self.assertFilesEqual(expected_file, output_file)
+
+    def test_index_b_unsorted(self):
+        # neither input needs to be sorted, and output is in the order of a
+        output_file = self.tempFile("output.bed")
+        params = [ "intersect", "--index-b", "-o", output_file ]
+        a, b = self.inputFiles("sort/unsorted0.bed", "sort/unsorted0.bed.gz")
+        params.extend([a, b])
+        rv, err = self.execute(params)
+        self.assertEqual(0, rv)
+        self.assertEqual('', err)
+        self.assertFilesEqual(a, output_file)
+
+    def test_multiple_b(self):
+        # each record in a is reported once, with its number of hits in each
+        # file b
+        data = {
+            "": "expected-multiple-b.bed",
+            "--index-b": "expected-multiple-b.bed",
+            "--exact-allele": "expected-multiple-b-exact-allele.bed",
+            "--exact-allele --index-b": "expected-multiple-b-exact-allele.bed",
+        }
+
+        for args, expected in data.items():
+            output_file = self.tempFile("output.bed")
+            params = [ "intersect", args, "-o", output_file ]
+            params.extend(self.inputFiles("a.bed", "b.bed", "a-regions.bed"))
+            rv, err = self.execute(params)
+            self.assertEqual(0, rv)
+            self.assertEqual('', err)
+            expected_file = self.inputFiles(expected)[0]
+            self.assertFilesEqual(expected_file, output_file)
+
     def test_adjacent_insertions(self):
         output_file = self.tempFile("output.bed")
         params = [
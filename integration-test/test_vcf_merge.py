@@ -48,6 +48,83 @@ class TestVcfMerge(IntegrationTest, unittest.TestCase):
         self.assertTrue('NOTHOME' in err)
         self.assertFilesEqual(expected_file, output_file, filter_regex="##fileDate=")
 
+    def index_merge_inputs(self):
+        input_files = []
+        for i, path in enumerate(sorted(self.inputFiles("vcf-merge/merge-[0-9].vcf"))):
+            indexed_file = self.tempFile("input-%d.vcf.gz" % i)
+            rv, err = self.execute(["sort", "--index", "tbi", "-o", indexed_file, path])
+            self.assertEqual(0, rv)
+            input_files.append(indexed_file)
+        return input_files
+
+    def test_vcf_merge_parallel(self):
+        merge_strategy_file = self.tempFile("strategy.ms")
+        open(merge_strategy_file, "w").write(
+            "info.CALLER=uniq-concat\n" +
+            "info.NOTHOME=uniq-concat\n"
+        )
+
+        input_files = self.index_merge_inputs()
+
+        expected_file = self.inputFiles("vcf-merge/merged.vcf")[0]
+        output_file = self.tempFile("output.vcf")
+
+        params = [ "vcf-merge", "--parallel", "--threads", "2",
+            "-M", merge_strategy_file, "-o", output_file ]
+        params.extend(input_files)
+        rv, err = self.execute(params)
+        self.assertEqual(0, rv)
+        self.assertFilesEqual(expected_file, output_file, filter_regex="##fileDate=")
+
+    def test_vcf_merge_parallel_stats(self):
+        input_files = self.index_merge_inputs()
+
+        params = [ "vcf-merge", "--print-stats", "-o", self.tempFile("serial.vcf") ]
+        rv, expected_err = self.execute(params + input_files)
+        self.assertEqual(0, rv)
+        self.assertTrue(expected_err)
+
+        # one block of stats for the whole merge, not one per sequence
+        params = [ "vcf-merge", "--print-stats", "--parallel", "--threads", "2",
+            "-o", self.tempFile("parallel.vcf") ]
+        rv, err = self.execute(params + input_files)
+        self.assertEqual(0, rv)
+        self.assertEqual(expected_err, err)
+
+    def test_vcf_merge_max_open_files(self):
+        input_files = sorted(self.inputFiles("vcf-merge/merge-[0-9].vcf"))
+        input_files += self.inputFiles("vcf-merge/sorting/merge-1.vcf")
+        dup_files = sorted(self.inputFiles("vcf-merge/merge-samples-[12].vcf"))
+
+        params = [ "vcf-merge", "-s",
+            "-D", "%s=-A" %dup_files[0],
+            "-D", "%s=-B" %dup_files[1]
+        ] + input_files
+
+        expected_file = self.tempFile("expected.vcf")
+        rv, err = self.execute(params + ["-o", expected_file])
+        self.assertEqual(0, rv)
+
+        # 5 inputs take three passes to get down to 2
+        output_file = self.tempFile("output.vcf")
+        rv, err = self.execute(params +
+            ["--max-open-files", "2", "-o", output_file])
+        self.assertEqual(0, rv)
+        self.assertFilesEqual(expected_file, output_file, filter_regex="##fileDate=")
+
+    def test_vcf_merge_same_locus_order(self):
+        # records at the same locus come out in input order, with or
+        # without intermediate passes
+        input_files = sorted(self.inputFiles("vcf-merge/same-locus/merge-[0-9].vcf"))
+        expected_file = self.inputFiles("vcf-merge/same-locus/expected.vcf")[0]
+
+        for extra in [[], ["--max-open-files", "2"]]:
+            output_file = self.tempFile("output.vcf")
+            params = [ "vcf-merge", "-o", output_file ] + extra + input_files
+            rv, err = self.execute(params)
+            self.assertEqual(0, rv)
+            self.assertFilesEqual(expected_file, output_file, filter_regex="##fileDate=")
+
     def test_vcf_merge_samples_consensus_60(self):
         merge_strategy_file = self.tempFile("strategy.ms")
         open(merge_strategy_file, "w").write("info.CALLER=uniq-concat\n")
@@ -83,6 +83,7 @@ void JoinX::exec(int argc, char** argv) {
     auto& cmd = found->second;
     cmd->parseCommandLine(argc - 1, &argv[1]);
     cmd->exec();
+    cmd->closeStreams();
 }
 
 void JoinX::registerSubCommand(std::shared_ptr<CommandBase> app) {
@@ -6,6 +6,7 @@
 #include "fileformats/vcf/CustomValue.hpp"
 #include "fileformats/vcf/Entry.hpp"
 #include "fileformats/vcf/Header.hpp"
+#include "fileformats/ValuePool.hpp"
 
 #include <map>
 #include <string>
@@ -21,6 +22,7 @@ class SimpleVcfAnnotator {
 public:
     typedef std::unique_ptr<Vcf::Entry> EntryPtr;
     typedef std::vector<EntryPtr> EntryPtrVector;
+    typedef ValuePool<Vcf::Entry> PoolType;
 
     typedef std::vector<Vcf::Entry> HitsType;
     typedef HitsType::const_iterator BestIter;
@@ -33,11 +35,13 @@ public:
             , bool copyIdents
             , InfoFieldMapping const& infoMap
             , Vcf::Header const& header
+            , PoolType* pool = 0
             )
         : _out(out)
         , _copyIdents(copyIdents)
         , _infoMap(infoMap)
         , _header(header)
+        , _pool(pool)
     {
     }
 
@@ -85,10 +89,10 @@ public:
             rv.setNumAlts(e.alt().size());
             // TODO: make this more efficient instead of using intermediate strings
             // TODO: assert that v is of type flag or number=1
-            auto const* existingValue = v.getAny(0);
-            if (existingValue) {
+            auto existingValue = v.getAny(0);
+            if (existingValue.which() != 0) {
                 for (auto i = altMatches.begin(); i != altMatches.end(); ++i) {
-                    rv.set(i->first, *existingValue);
+                    rv.set(i->first, existingValue);
                 }
             } 
             e.setInfo(txl.newType->id(), rv);
@@ -97,7 +101,7 @@ public:
             std::unique_ptr<Vcf::CustomValue> newValue;
             if (v.type().tiedToAlleles()) {
                 newValue = std::make_unique<Vcf::CustomValue>(&v.type());
-                auto const& raw = v.getRaw();
+                auto raw = v.getRaw();
                 std::vector<Vcf::CustomValue::ValueType> newVec;
                 std::size_t offset = 0;
 
@@ -136,13 +140,26 @@ public:
                 inputs.push_back(std::move(*i));
             }
             else {
-                annos.push_back(std::move(**i));
+                annos.emplace_back();
+                annos.back().swap(**i);
             }
         }
 
         for (auto i = inputs.begin(); i  != inputs.end(); ++i) {
             (*this)(**i, annos);
         }
+
+        // hand the entries (and the buffers they own) back to be read into.
+        // the annotation entries are the ones still in entries.
+        if (_pool) {
+            auto anno = annos.begin();
+            for (auto i = entries.begin(); i != entries.end(); ++i) {
+                if (*i)
+                    (*i)->swap(*anno++);
+            }
+            _pool->release(entries);
+            _pool->release(inputs);
+        }
     }
 
     void operator()(Vcf::Entry const& a, HitsType const& b) {
@@ -176,6 +193,7 @@ protected:
     bool _copyIdents;
     InfoFieldMapping const& _infoMap;
     Vcf::Header const& _header;
+    PoolType* _pool;
 };
 
 template<typename OutputType, typename ...Xs>
@@ -184,7 +202,8 @@ SimpleVcfAnnotator<OutputType> makeSimpleVcfAnnotator(
         , bool copyIdents
         , std::map<std::string, InfoTranslation> const& infoMap
         , Vcf::Header const& header
+        , ValuePool<Vcf::Entry>* pool = 0
         )
 {
-    return SimpleVcfAnnotator<OutputType>(out, copyIdents, infoMap, header);
+    return SimpleVcfAnnotator<OutputType>(out, copyIdents, infoMap, header, pool);
 }
@@ -0,0 +1,39 @@
+#include "Arena.hpp"
+
+#include <cstdint>
+
+Arena::Arena(std::size_t blockSize)
+    : _blockSize(blockSize > 0 ? blockSize : 1)
+    , _pos(0)
+    , _end(0)
+    , _capacity(0)
+{
+}
+
+void* Arena::allocate(std::size_t size, std::size_t alignment) {
+    std::size_t pad = -reinterpret_cast<std::uintptr_t>(_pos) & (alignment - 1);
+    if (!_pos || std::size_t(_end - _pos) < size + pad) {
+        // blocks come from new[], which is suitably aligned for anything
+        addBlock(size);
+        pad = 0;
+    }
+
+    char* rv = _pos + pad;
+    _pos = rv + size;
+    return rv;
+}
+
+void Arena::addBlock(std::size_t minSize) {
+    // oversized requests get a block of their own
+    std::size_t size = minSize > _blockSize ? minSize : _blockSize;
+    _blocks.emplace_back(new char[size]);
+    _pos = _blocks.back().get();
+    _end = _pos + size;
+    _capacity += size;
+}
+
+void Arena::reset() {
+    _blocks.clear();
+    _pos = _end = 0;
+    _capacity = 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// A bump allocator handing out memory from a list of large blocks.
+//
+// Allocations are never freed individually: reset() releases every block
+// at once. Objects created in the arena are not destroyed by it, so owners
+// of objects with non-trivial destructors must call them before reset().
+class Arena : public boost::noncopyable {
+public:
+    enum { DEFAULT_BLOCK_SIZE = 1 << 20 };
+
+    explicit Arena(std::size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+    void* allocate(std::size_t size,
+        std::size_t alignment = alignof(std::max_align_t));
+
+    // Construct a T in the arena
+    template<typename T, typename... Args>
+    T* create(Args&&... args);
+
+    // Release all blocks
+    void reset();
+
+    // The total size of the blocks currently held
+    std::size_t capacity() const;
+
+private:
+    void addBlock(std::size_t minSize);
+
+private:
+    std::size_t _blockSize;
+    std::vector<std::unique_ptr<char[]>> _blocks;
+    char* _pos;
+    char* _end;
+    std::size_t _capacity;
+};
+
+template<typename T, typename... Args>
+inline T* Arena::create(Args&&... args) {
+    void* p = allocate(sizeof(T), alignof(T));
+    return new (p) T(std::forward<Args>(args)...);
+}
+
+inline std::size_t Arena::capacity() const {
+    return _capacity;
+}
@@ -10,6 +10,12 @@ struct DefaultCoordinateView : CoordinateViewBaseTag {
         return x.chrom();
     }
 
+    // only for types that carry a SequenceDictionary id
+    template<typename T>
+    auto chromId(T const& x) const -> decltype(x.chromId()) {
+        return x.chromId();
+    }
+
     template<typename T>
     auto start(T const& x) const -> decltype(x.start()) {
         return x.start();
@@ -27,6 +33,12 @@ struct UnpaddedCoordinateView : CoordinateViewBaseTag {
         return x.chrom();
     }
 
+    // only for types that carry a SequenceDictionary id
+    template<typename T>
+    auto chromId(T const& x) const -> decltype(x.chromId()) {
+        return x.chromId();
+    }
+
     template<typename T>
     auto start(T const& x) const -> decltype(x.startWithoutPadding()) {
         return x.startWithoutPadding();
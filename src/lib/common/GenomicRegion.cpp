@@ -0,0 +1,72 @@
+#include "GenomicRegion.hpp"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+using boost::format;
+
+int64_t const GenomicRegion::MAX_POSITION = std::numeric_limits<int64_t>::max();
+
+namespace {
+    // Parse a position that may contain commas (e.g., 1,000,000)
+    bool parsePosition(std::string::const_iterator beg,
+            std::string::const_iterator end, int64_t& pos)
+    {
+        if (beg == end) {
+            return false;
+        }
+
+        pos = 0;
+        for (; beg != end; ++beg) {
+            if (*beg == ',') {
+                continue;
+            }
+            if (!isdigit(*beg) || pos > (GenomicRegion::MAX_POSITION - 9) / 10) {
+                return false;
+            }
+            pos = pos * 10 + (*beg - '0');
+        }
+        return true;
+    }
+}
+
+GenomicRegion GenomicRegion::fromString(std::string const& s) {
+    if (s.empty()) {
+        throw std::runtime_error("Empty region string");
+    }
+
+    // sequence names may themselves contain ':' (e.g., HLA alleles), so
+    // only split on the last one and only if what follows is a range.
+    std::string::size_type colon = s.find_last_of(':');
+    if (colon == std::string::npos || colon == 0) {
+        return GenomicRegion(s, 0, MAX_POSITION);
+    }
+
+    auto rangeBeg = s.begin() + colon + 1;
+    auto dash = std::find(rangeBeg, s.end(), '-');
+
+    int64_t start;
+    int64_t stop = MAX_POSITION;
+    if (!parsePosition(rangeBeg, dash, start)
+        || (dash != s.end() && !parsePosition(dash + 1, s.end(), stop)))
+    {
+        return GenomicRegion(s, 0, MAX_POSITION);
+    }
+
+    if (start < 1 || stop < start) {
+        throw std::runtime_error(str(format("Invalid region '%1%'") % s));
+    }
+
+    return GenomicRegion(s.substr(0, colon), start - 1, stop);
+}
+
+std::ostream& operator<<(std::ostream& s, GenomicRegion const& r) {
+    s << r.chrom << ":" << r.begin + 1;
+    if (r.end != GenomicRegion::MAX_POSITION) {
+        s << "-" << r.end;
+    }
+    return s;
+}
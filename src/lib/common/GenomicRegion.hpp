@@ -0,0 +1,44 @@
+#pragma once
+
+#include "common/cstdint.hpp"
+
+#include <limits>
+#include <ostream>
+#include <string>
+#include <utility>
+
+// A region of a named sequence. Coordinates are 0-based and half open.
+struct GenomicRegion {
+    std::string chrom;
+    int64_t begin;
+    int64_t end;
+
+    static int64_t const MAX_POSITION;
+
+    GenomicRegion()
+        : begin(0)
+        , end(0)
+    {}
+
+    GenomicRegion(std::string chrom, int64_t begin, int64_t end)
+        : chrom(std::move(chrom))
+        , begin(begin)
+        , end(end)
+    {}
+
+    // Parse a region given as chr, chr:start, or chr:start-end, where start
+    // and end are 1-based and inclusive (as for samtools and tabix).
+    // Positions may contain commas. Throws std::runtime_error on invalid
+    // input.
+    static GenomicRegion fromString(std::string const& s);
+
+    bool overlaps(std::string const& c, int64_t b, int64_t e) const {
+        return chrom == c && b < end && e > begin;
+    }
+
+    bool operator==(GenomicRegion const& rhs) const {
+        return chrom == rhs.chrom && begin == rhs.begin && end == rhs.end;
+    }
+};
+
+std::ostream& operator<<(std::ostream& s, GenomicRegion const& r);
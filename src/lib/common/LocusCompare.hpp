@@ -2,6 +2,7 @@
 
 #include "RelOps.hpp"
 #include "CoordinateView.hpp"
+#include "SequenceDictionary.hpp"
 
 #include <boost/tti/has_type.hpp>
 #include <boost/utility/declval.hpp>
@@ -19,6 +20,23 @@ namespace {
     struct StartOnly;
 }
 
+namespace detail {
+    // Values that carry a sequence id are ordered by the dictionary, which
+    // is just an integer compare. Anything else falls back to strverscmp on
+    // the names.
+    template<typename CoordView, typename TX, typename TY>
+    auto compareChrom(CoordView const& cv, TX const& x, TY const& y, int)
+        -> decltype(cv.chromId(x), cv.chromId(y), int())
+    {
+        return SequenceDictionary::instance().compare(cv.chromId(x), cv.chromId(y));
+    }
+
+    template<typename CoordView, typename TX, typename TY>
+    int compareChrom(CoordView const& cv, TX const& x, TY const& y, long) {
+        return strverscmp(cv.chrom(x).c_str(), cv.chrom(y).c_str());
+    }
+}
+
 template<
           typename CoordView = DefaultCoordinateView
         , typename Method = StartAndStop
@@ -43,7 +61,7 @@ struct LocusCompare<
     template<typename ValueType>
     typename std::enable_if<!std::is_pointer<ValueType>::value, int>::type
     operator()(ValueType const& x, ValueType const& y) const {
-        int chr = strverscmp(cv.chrom(x).c_str(), cv.chrom(y).c_str());
+        int chr = detail::compareChrom(cv, x, y, 0);
         if (chr != 0)
             return chr;
 
@@ -82,7 +100,7 @@ struct LocusCompare<
     template<typename ValueType>
     typename std::enable_if<!std::is_pointer<ValueType>::value, int>::type
     operator()(ValueType const& x, ValueType const& y) const {
-        int chr = strverscmp(cv.chrom(x).c_str(), cv.chrom(y).c_str());
+        int chr = detail::compareChrom(cv, x, y, 0);
         if (chr != 0)
             return chr;
 
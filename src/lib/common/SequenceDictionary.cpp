@@ -0,0 +1,172 @@
+#include "SequenceDictionary.hpp"
+
+#include <boost/format.hpp>
+#include <boost/functional/hash.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using boost::format;
+using namespace std;
+
+namespace {
+    // gap left between the keys of neighbouring names when keys are
+    // (re)assigned
+    uint64_t const KEY_GAP = uint64_t(1) << 32;
+    uint64_t const FIRST_KEY = uint64_t(1) << 63;
+
+    struct ViewHash {
+        size_t operator()(StringView const& x) const {
+            return boost::hash_range(x.begin(), x.end());
+        }
+    };
+
+    struct ViewEqual {
+        bool operator()(StringView const& x, string const& y) const {
+            return x == y;
+        }
+    };
+
+    // Most records are followed by others on the same sequence, so each
+    // thread remembers the last name it looked up.
+    struct LastId {
+        SequenceDictionary const* dict;
+        uint32_t id;
+    };
+
+    thread_local LastId lastId = {0, 0};
+}
+
+SequenceDictionary& SequenceDictionary::instance() {
+    static SequenceDictionary dict;
+    return dict;
+}
+
+SequenceDictionary::SequenceDictionary()
+    : _size(0)
+    , _version(0)
+{
+    for (size_t i = 0; i < MAX_CHUNKS; ++i)
+        _chunks[i].store(0, memory_order_relaxed);
+
+    lock_guard<mutex> lock(_mutex);
+    add(StringView(""));
+}
+
+SequenceDictionary::~SequenceDictionary() {
+    for (size_t i = 0; i < MAX_CHUNKS; ++i)
+        delete[] _chunks[i].load(memory_order_relaxed);
+}
+
+size_t SequenceDictionary::size() const {
+    return _size.load(memory_order_acquire);
+}
+
+uint32_t SequenceDictionary::id(StringView const& name) {
+    LastId& last = lastId;
+    if (last.dict == this && last.id < size() && name == this->name(last.id))
+        return last.id;
+
+    lock_guard<mutex> lock(_mutex);
+    auto found = _ids.find(name, ViewHash(), ViewEqual());
+    uint32_t rv = found != _ids.end() ? found->second : add(name);
+
+    last.dict = this;
+    last.id = rv;
+    return rv;
+}
+
+bool SequenceDictionary::before(uint32_t x, uint32_t y) const {
+    string const& a = name(x);
+    string const& b = name(y);
+    auto ia = _listed.find(a);
+    auto ib = _listed.find(b);
+    if (ia != _listed.end() && ib != _listed.end())
+        return ia->second < ib->second;
+    if (ia != _listed.end() || ib != _listed.end())
+        return ia != _listed.end();
+
+    return strverscmp(a.c_str(), b.c_str()) < 0;
+}
+
+uint32_t SequenceDictionary::add(StringView const& name) {
+    uint32_t id = _size.load(memory_order_relaxed);
+    if (id >= uint32_t(MAX_CHUNKS) * CHUNK_SIZE) {
+        throw runtime_error(str(format(
+            "Too many sequence names (more than %1%)")
+            % (uint64_t(MAX_CHUNKS) * CHUNK_SIZE)));
+    }
+
+    atomic<Sequence*>& chunk = _chunks[id >> CHUNK_BITS];
+    if (!chunk.load(memory_order_relaxed))
+        chunk.store(new Sequence[CHUNK_SIZE], memory_order_release);
+
+    Sequence& seq = sequence(id);
+    seq.name.assign(name.begin(), name.end());
+
+    auto pos = upper_bound(_sorted.begin(), _sorted.end(), id,
+        [this](uint32_t x, uint32_t y) { return before(x, y); });
+
+    uint64_t lo = pos == _sorted.begin()
+        ? 0 : sequence(*(pos - 1)).order.load(memory_order_relaxed);
+    uint64_t hi = pos == _sorted.end()
+        ? numeric_limits<uint64_t>::max()
+        : sequence(*pos).order.load(memory_order_relaxed);
+
+    bool needRelabel = false;
+    uint64_t key;
+    if (_sorted.empty())
+        key = FIRST_KEY;
+    else if (pos == _sorted.end() && hi - lo > KEY_GAP)
+        key = lo + KEY_GAP;
+    else if (pos == _sorted.begin() && hi - lo > KEY_GAP)
+        key = hi - KEY_GAP;
+    else if (hi - lo > 1)
+        key = lo + (hi - lo) / 2;
+    else {
+        key = 0;
+        needRelabel = true;
+    }
+
+    seq.order.store(key, memory_order_relaxed);
+    _sorted.insert(pos, id);
+    _ids.emplace(seq.name, id);
+    if (needRelabel)
+        relabel();
+
+    // publishes the name and key along with the new size
+    _size.store(id + 1, memory_order_release);
+    return id;
+}
+
+void SequenceDictionary::relabel() {
+    uint64_t key = FIRST_KEY - (_sorted.size() / 2) * KEY_GAP;
+
+    uint32_t version = _version.load(memory_order_relaxed);
+    _version.store(version + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (auto i = _sorted.begin(); i != _sorted.end(); ++i, key += KEY_GAP)
+        sequence(*i).order.store(key, memory_order_relaxed);
+
+    _version.store(version + 2, memory_order_release);
+}
+
+void SequenceDictionary::setOrder(vector<string> const& names) {
+    lock_guard<mutex> lock(_mutex);
+
+    boost::unordered_map<string, uint32_t> listed;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (!listed.emplace(names[i], uint32_t(i)).second) {
+            throw runtime_error(str(format(
+                "Sequence name %1% is listed more than once") % names[i]));
+        }
+    }
+
+    _listed.swap(listed);
+    stable_sort(_sorted.begin(), _sorted.end(),
+        [this](uint32_t x, uint32_t y) { return before(x, y); });
+    relabel();
+}
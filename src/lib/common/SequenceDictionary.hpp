@@ -0,0 +1,128 @@
+#pragma once
+
+#include "StringView.hpp"
+#include "cstdint.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A dictionary of sequence (chromosome) names, shared by the whole process
+// through instance().
+//
+// Names are interned as small integer ids that never change, so records can
+// carry an id rather than their own copy of the name, and names can be
+// tested for equality by id. compare() orders ids by strverscmp on their
+// names, or, once setOrder() has been called, by position in the list of
+// names given to it (e.g., from a .fai file or ##contig header lines), with
+// names that are not in the list after those that are, in strverscmp order.
+//
+// Each id has an order key, and comparing two ids compares their keys. Keys
+// for new names are chosen to fall between those of their neighbours, so
+// adding a name almost never changes the keys of the others. When it does
+// (or setOrder is called), the keys are all rewritten under a sequence lock
+// that compare() retries on, so the dictionary can be used from any number
+// of threads at once.
+class SequenceDictionary : public boost::noncopyable {
+public:
+    // the id of the empty name
+    enum { EMPTY = 0 };
+
+    static SequenceDictionary& instance();
+
+    SequenceDictionary();
+    ~SequenceDictionary();
+
+    // The id of name, adding it to the dictionary if it is new
+    uint32_t id(StringView const& name);
+    uint32_t id(std::string const& name);
+
+    std::string const& name(uint32_t id) const;
+
+    // Less than, equal to or greater than 0 as x comes before, is the same
+    // as or comes after y
+    int compare(uint32_t x, uint32_t y) const;
+
+    bool less(uint32_t x, uint32_t y) const {
+        return compare(x, y) < 0;
+    }
+
+    // Order the given names first, in the order given. Throws
+    // std::runtime_error if a name is repeated.
+    void setOrder(std::vector<std::string> const& names);
+
+    std::size_t size() const;
+
+private:
+    struct Sequence {
+        std::string name;
+        std::atomic<uint64_t> order;
+    };
+
+    enum {
+        CHUNK_BITS = 12,
+        CHUNK_SIZE = 1 << CHUNK_BITS,
+        MAX_CHUNKS = 1 << 16
+    };
+
+    Sequence& sequence(uint32_t id) const;
+    uint32_t add(StringView const& name);
+    bool before(uint32_t x, uint32_t y) const;
+    void relabel();
+
+private:
+    // names are stored in fixed size chunks so that they never move
+    std::atomic<Sequence*> _chunks[MAX_CHUNKS];
+    std::atomic<uint32_t> _size;
+    // odd while order keys are being rewritten
+    std::atomic<uint32_t> _version;
+
+    // the rest is only used with the lock held
+    mutable std::mutex _mutex;
+    boost::unordered_map<std::string, uint32_t> _ids;
+    // ids in order
+    std::vector<uint32_t> _sorted;
+    // positions of names given to setOrder
+    boost::unordered_map<std::string, uint32_t> _listed;
+};
+
+inline
+uint32_t SequenceDictionary::id(std::string const& name) {
+    return id(StringView(name.data(), name.data() + name.size()));
+}
+
+inline
+SequenceDictionary::Sequence& SequenceDictionary::sequence(uint32_t id) const {
+    Sequence* chunk = _chunks[id >> CHUNK_BITS].load(std::memory_order_acquire);
+    return chunk[id & (CHUNK_SIZE - 1)];
+}
+
+inline
+std::string const& SequenceDictionary::name(uint32_t id) const {
+    return sequence(id).name;
+}
+
+inline
+int SequenceDictionary::compare(uint32_t x, uint32_t y) const {
+    if (x == y)
+        return 0;
+
+    Sequence const& sx = sequence(x);
+    Sequence const& sy = sequence(y);
+    for (;;) {
+        uint32_t version = _version.load(std::memory_order_acquire);
+        uint64_t ox = sx.order.load(std::memory_order_relaxed);
+        uint64_t oy = sy.order.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((version & 1) == 0
+            && _version.load(std::memory_order_relaxed) == version)
+        {
+            return ox < oy ? -1 : 1;
+        }
+    }
+}
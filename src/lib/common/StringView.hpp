@@ -118,12 +118,12 @@ bool StringView::startsWith(char const* s) const {
 
 inline
 bool StringView::operator==(StringView const& rhs) const {
-    return rhs.size() == _size && strncmp(_beg, rhs._beg, _size) == 0;
+    return rhs.size() == _size && memcmp(_beg, rhs._beg, _size) == 0;
 }
 
 inline
 bool StringView::operator==(std::string const& rhs) const {
-    return rhs.size() == _size && rhs.compare(0, _size, _beg) == 0;
+    return rhs.size() == _size && rhs.compare(0, _size, _beg, _size) == 0;
 }
 
 inline
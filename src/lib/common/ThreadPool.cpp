@@ -0,0 +1,66 @@
+#include "ThreadPool.hpp"
+
+#include "compat.hpp"
+
+#include <utility>
+
+namespace {
+    // the pool whose worker is running on this thread, if any
+    thread_local ThreadPool const* currentPool = 0;
+}
+
+ThreadPool::ThreadPool(std::size_t numThreads)
+    : _stop(false)
+{
+    _threads.reserve(numThreads);
+    for (std::size_t i = 0; i < numThreads; ++i) {
+        _threads.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cond.notify_all();
+    for (auto i = _threads.begin(); i != _threads.end(); ++i) {
+        i->join();
+    }
+}
+
+ThreadPool::ptr ThreadPool::create(std::size_t numThreads) {
+    return std::make_shared<ThreadPool>(numThreads);
+}
+
+std::size_t ThreadPool::hardwareThreads() {
+    std::size_t rv = std::thread::hardware_concurrency();
+    return rv == 0 ? 1 : rv;
+}
+
+bool ThreadPool::inWorker() const {
+    return currentPool == this;
+}
+
+void ThreadPool::workerLoop() {
+    currentPool = this;
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (!_stop && _jobs.empty()) {
+                _cond.wait(lock);
+            }
+
+            // drain the queue before exiting so that nobody is left
+            // waiting on a future that will never be satisfied.
+            if (_jobs.empty()) {
+                return;
+            }
+
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+        job();
+    }
+}
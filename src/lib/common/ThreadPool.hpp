@@ -0,0 +1,84 @@
+#pragma once
+
+#include <boost/noncopyable.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// A fixed size pool of worker threads consuming a FIFO queue of jobs.
+//
+// Jobs are submitted with submit(f) which returns a std::future for the
+// result of f(). Callers that need results in submission order (e.g., to
+// reassemble a stream that was split into independent pieces) can simply
+// keep the futures in a queue and wait on them front to back.
+//
+// A pool with 0 threads is valid: submitted jobs are run immediately in the
+// calling thread.
+//
+// Jobs submitted by one of the pool's own workers are also run immediately,
+// so a job may wait on jobs it submits (e.g., a sort run being written to a
+// bgzf temp file) without deadlocking when every worker is busy.
+class ThreadPool : public boost::noncopyable {
+public:
+    typedef std::shared_ptr<ThreadPool> ptr;
+
+    explicit ThreadPool(std::size_t numThreads);
+    ~ThreadPool();
+
+    static ptr create(std::size_t numThreads);
+
+    // The number of hardware threads available, or 1 if that is unknown.
+    static std::size_t hardwareThreads();
+
+    std::size_t size() const;
+
+    // true if the calling thread is one of this pool's workers
+    bool inWorker() const;
+
+    template<typename Func>
+    std::future<typename std::result_of<Func()>::type> submit(Func f);
+
+private:
+    void workerLoop();
+
+private:
+    std::vector<std::thread> _threads;
+    std::deque<std::function<void()>> _jobs;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    bool _stop;
+};
+
+inline std::size_t ThreadPool::size() const {
+    return _threads.size();
+}
+
+template<typename Func>
+inline std::future<typename std::result_of<Func()>::type>
+ThreadPool::submit(Func f) {
+    typedef typename std::result_of<Func()>::type ResultType;
+
+    // std::function requires copyable targets, packaged_task is move-only
+    auto task = std::make_shared<std::packaged_task<ResultType()>>(std::move(f));
+    auto rv = task->get_future();
+
+    if (_threads.empty() || inWorker()) {
+        (*task)();
+        return rv;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back([task]() { (*task)(); });
+    }
+    _cond.notify_one();
+    return rv;
+}
@@ -244,7 +244,7 @@ inline bool Tokenizer<DelimType>::extract(T& value) {
 
 template<typename DelimType>
 inline void Tokenizer<DelimType>::remaining(std::string& s) {
-    s = _sbeg+_pos;
+    s.assign(_sbeg + std::min(_pos, _totalLen), _send);
 }
 
 template<typename DelimType>
@@ -266,7 +266,9 @@ inline bool Tokenizer<DelimType>::advance() {
     if (eof())
         return false;
 
-    _lastDelim = _sbeg[_end];
+    // the input need not be null terminated (e.g., a StringView into a
+    // larger buffer), so don't look past the end of it.
+    _lastDelim = _end < _totalLen ? _sbeg[_end] : '\0';
 
     if (_pos == _totalLen)
         ++_eofCalls;
@@ -327,15 +329,15 @@ inline bool Tokenizer<std::string>::eof() const {
 template<>
 inline size_t Tokenizer<char>::nextDelim() {
     if (_totalLen == 0) return 0;
-    char const* rv(0);
-    rv = strchr(_sbeg+_pos, _delim);
+    char const* rv = static_cast<char const*>(
+        memchr(_sbeg + _pos, _delim, _totalLen - _pos));
     return rv == 0 ? std::string::npos : rv-_sbeg;
 }
 
 template<>
 inline size_t Tokenizer<std::string>::nextDelim() {
     if (_totalLen == 0) return 0;
-    char const* rv(0);
-    rv = strpbrk(_sbeg+_pos, _delim.data());
-    return rv == 0 ? std::string::npos : rv-_sbeg;
+    char const* rv = std::find_first_of(_sbeg + _pos, _send,
+        _delim.begin(), _delim.end());
+    return rv == _send ? std::string::npos : rv-_sbeg;
 }
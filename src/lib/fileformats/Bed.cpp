@@ -1,4 +1,5 @@
 #include "Bed.hpp"
+#include "common/StringView.hpp"
 #include "common/Tokenizer.hpp"
 
 #include <boost/format.hpp>
@@ -15,12 +16,13 @@ std::ostream& operator<<(std::ostream& s, const BedHeader& h) {
 }
 
 Bed::Bed()
-    : _start(0)
+    : _chromId(SequenceDictionary::EMPTY)
+    , _start(0)
     , _stop(0)
 {}
 
 Bed::Bed(const Bed& b)
-    : _chrom(b._chrom)
+    : _chromId(b._chromId)
     , _start(b._start)
     , _stop(b._stop)
     , _extraFields(b._extraFields)
@@ -29,7 +31,7 @@ Bed::Bed(const Bed& b)
 }
 
 Bed::Bed(Bed&& b)
-    : _chrom(std::move(b._chrom))
+    : _chromId(b._chromId)
     , _start(b._start)
     , _stop(b._stop)
     , _extraFields(std::move(b._extraFields))
@@ -38,7 +40,7 @@ Bed::Bed(Bed&& b)
 }
 
 Bed& Bed::operator=(Bed&& b) {
-    _chrom = std::move(b._chrom);
+    _chromId = b._chromId;
     _start = std::move(b._start);
     _stop = std::move(b._stop);
     _extraFields = std::move(b._extraFields);
@@ -47,7 +49,7 @@ Bed& Bed::operator=(Bed&& b) {
 }
 
 Bed& Bed::operator=(Bed const& b) {
-    _chrom = b._chrom;
+    _chromId = b._chromId;
     _start = b._start;
     _stop = b._stop;
     _extraFields = b._extraFields;
@@ -56,14 +58,14 @@ Bed& Bed::operator=(Bed const& b) {
 }
 
 Bed::Bed(const std::string& chrom, int64_t start, int64_t stop)
-    : _chrom(chrom)
+    : _chromId(SequenceDictionary::instance().id(chrom))
     , _start(start)
     , _stop(stop)
 {
 }
 
 Bed::Bed(const std::string& chrom, int64_t start, int64_t stop, const ExtraFieldsType& extraFields)
-    : _chrom(chrom)
+    : _chromId(SequenceDictionary::instance().id(chrom))
     , _start(start)
     , _stop(stop)
     , _extraFields(extraFields)
@@ -72,21 +74,36 @@ Bed::Bed(const std::string& chrom, int64_t start, int64_t stop, const ExtraField
 
 
 void Bed::parseLine(const BedHeader*, std::string& line, Bed& bed, int maxExtraFields) {
+    bed.parseFields(StringView(line.data(), line.data() + line.size()), maxExtraFields);
+    bed._line.swap(line);
+}
+
+void Bed::parseLine(const BedHeader*, StringView const& line, Bed& bed, int maxExtraFields) {
+    bed.parseFields(line, maxExtraFields);
+    bed._line.assign(line.begin(), line.end());
+}
+
+void Bed::parseFields(StringView const& line, int maxExtraFields) {
     Tokenizer<char> tokenizer(line);
-    if (!tokenizer.extract(bed._chrom))
+    StringView chrom;
+    if (!tokenizer.extract(chrom))
         throw runtime_error(str(format("Failed to extract chromosome from bed line '%1%'") %line));
+    _chromId = SequenceDictionary::instance().id(chrom);
 
-    if (!tokenizer.extract(bed._start))
+    if (!tokenizer.extract(_start))
         throw runtime_error(str(format("Failed to extract start position from bed line '%1%'") %line));
 
-    if (!tokenizer.extract(bed._stop))
+    if (!tokenizer.extract(_stop))
         throw runtime_error(str(format("Failed to extract stop position from bed line '%1%'") %line));
 
 
-    bed._extraFields.clear();
+    // extract into the existing strings to reuse their storage
+    size_t numExtra = 0;
     int fields = 0;
     while ((maxExtraFields == -1 || fields++ < maxExtraFields) && !tokenizer.eof()) {
-        string extra;
+        if (_extraFields.size() <= numExtra)
+            _extraFields.emplace_back();
+        string& extra = _extraFields[numExtra++];
         tokenizer.extract(extra);
         // make ref/call uppercase and translate 0,- meaning "no data" to *
         if (fields == 1) {
@@ -96,24 +113,30 @@ void Bed::parseLine(const BedHeader*, std::string& line, Bed& bed, int maxExtraF
             if (boost::ends_with(extra, "/0") || boost::ends_with(extra, "/-"))
                 extra[extra.size()-1] = '*';
         }
-        bed._extraFields.push_back(std::move(extra));
     }
-
-    bed._line.swap(line);
+    _extraFields.resize(numExtra);
 }
 
 void Bed::swap(Bed& rhs) {
-    _chrom.swap(rhs._chrom);
+    std::swap(_chromId, rhs._chromId);
     std::swap(_start, rhs._start);
     std::swap(_stop, rhs._stop);
     _line.swap(rhs._line);
     _extraFields.swap(rhs._extraFields);
 }
 
+std::size_t Bed::footprint() const {
+    std::size_t rv = _line.capacity()
+        + _extraFields.capacity() * sizeof(std::string);
+    for (auto i = _extraFields.begin(); i != _extraFields.end(); ++i)
+        rv += i->capacity();
+    return rv;
+}
+
 const std::string& Bed::toString() const {
     if (_line.empty()) {
         stringstream ss;
-        ss << _chrom << "\t" << _start << "\t" << _stop;
+        ss << chrom() << "\t" << _start << "\t" << _stop;
         for (auto iter = _extraFields.begin(); iter != _extraFields.end(); ++iter)
             ss << "\t" << *iter;
         _line = ss.str();
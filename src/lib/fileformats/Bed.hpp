@@ -2,11 +2,14 @@
 
 #include "common/CoordinateView.hpp"
 #include "common/LocusCompare.hpp"
+#include "common/SequenceDictionary.hpp"
+#include "common/StringView.hpp"
 #include "common/cstdint.hpp"
 
 #include <boost/lexical_cast.hpp>
 
 #include <algorithm>
+#include <cstddef>
 #include <ostream>
 #include <sstream>
 #include <stdexcept>
@@ -48,15 +51,20 @@ public:
     Bed& operator=(Bed&& b);
 
     static void parseLine(const BedHeader*, std::string& line, Bed& bed, int maxExtraFields = -1);
+    static void parseLine(const BedHeader*, StringView const& line, Bed& bed, int maxExtraFields = -1);
     void swap(Bed& rhs);
 
     const std::string& chrom() const;
+    // the id of chrom() in SequenceDictionary::instance()
+    uint32_t chromId() const;
     int64_t start() const;
     int64_t stop() const;
     int64_t length() const;
     const std::string& toString() const;
+    // approximate heap memory owned by this object, in bytes
+    std::size_t footprint() const;
 
-    void chrom(std::string chrom);
+    void chrom(std::string const& chrom);
     void start(int64_t start);
     void stop(int64_t stop);
 
@@ -70,7 +78,7 @@ public:
     void setExtra(size_t idx, T const& value, std::string const& filler = ".");
 
     bool operator==(Bed const& rhs) const {
-        return _chrom == rhs._chrom &&
+        return _chromId == rhs._chromId &&
             _start == rhs._start &&
             _stop == rhs._stop &&
             _extraFields == rhs._extraFields
@@ -78,7 +86,10 @@ public:
     }
 
 protected:
-    std::string _chrom;
+    void parseFields(StringView const& line, int maxExtraFields);
+
+protected:
+    uint32_t _chromId;
     int64_t _start;
     int64_t _stop;
     ExtraFieldsType _extraFields;
@@ -87,7 +98,11 @@ protected:
 };
 
 inline const std::string& Bed::chrom() const {
-    return _chrom;
+    return SequenceDictionary::instance().name(_chromId);
+}
+
+inline uint32_t Bed::chromId() const {
+    return _chromId;
 }
 
 inline int64_t Bed::start() const {
@@ -115,8 +130,8 @@ inline void Bed::setExtra(size_t idx, T const& value, std::string const& filler
     _extraFields[idx] = boost::lexical_cast<std::string>(value);
 }
 
-inline void Bed::chrom(std::string chrom) {
-    _chrom = std::move(chrom);
+inline void Bed::chrom(std::string const& chrom) {
+    _chromId = SequenceDictionary::instance().id(chrom);
     _line.clear();
 }
 
@@ -143,6 +158,7 @@ struct BedParser {
     BedParser();
     explicit BedParser(int maxExtraFields);
     void operator()(BedHeader const* h, std::string& line, Bed& bed);
+    void operator()(BedHeader const* h, StringView const& line, Bed& bed);
 };
 
 std::ostream& operator<<(std::ostream& s, const Bed& bed);
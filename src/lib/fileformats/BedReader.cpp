@@ -14,6 +14,10 @@ void BedParser::operator()(BedHeader const* h, std::string& line, Bed& bed) {
     return Bed::parseLine(h, line, bed, maxExtraFields);
 }
 
+void BedParser::operator()(BedHeader const* h, StringView const& line, Bed& bed) {
+    return Bed::parseLine(h, line, bed, maxExtraFields);
+}
+
 BedReader::ptr openBed(InputStream& in, int maxExtraFields /* = -1*/) {
     return TypedStreamFactory<BedParser>{maxExtraFields}(in);
 }
@@ -15,32 +15,33 @@ std::ostream& operator<<(std::ostream& s, const ChromPosHeader& h) {
 }
 
 ChromPos::ChromPos()
-    : _start(0)
+    : _chromId(SequenceDictionary::EMPTY)
+    , _start(0)
 {}
 
 ChromPos::ChromPos(const ChromPos& b)
-    : _chrom(b._chrom)
+    : _chromId(b._chromId)
     , _start(b._start)
     , _line(b._line)
 {
 }
 
 ChromPos::ChromPos(ChromPos&& b)
-    : _chrom(std::move(b._chrom))
+    : _chromId(b._chromId)
     , _start(b._start)
     , _line(std::move(b._line))
 {
 }
 
 ChromPos& ChromPos::operator=(ChromPos const& b) {
-    _chrom = b._chrom;
+    _chromId = b._chromId;
     _start = b._start;
     _line = b._line;
     return *this;
 }
 
 ChromPos& ChromPos::operator=(ChromPos&& b) {
-    _chrom = std::move(b._chrom);
+    _chromId = b._chromId;
     _start = std::move(b._start);
     _line = std::move(b._line);
     return *this;
@@ -49,22 +50,36 @@ ChromPos& ChromPos::operator=(ChromPos&& b) {
 
 
 void ChromPos::parseLine(const ChromPosHeader*, std::string& line, ChromPos& cp) {
+    cp.parseFields(StringView(line.data(), line.data() + line.size()));
+    cp._line.swap(line);
+}
+
+void ChromPos::parseLine(const ChromPosHeader*, StringView const& line, ChromPos& cp) {
+    cp.parseFields(line);
+    cp._line.assign(line.begin(), line.end());
+}
+
+void ChromPos::parseFields(StringView const& line) {
     Tokenizer<char> tokenizer(line);
-    if (!tokenizer.extract(cp._chrom))
+    StringView chrom;
+    if (!tokenizer.extract(chrom))
         throw runtime_error(str(format("Failed to extract chromosome from ChromPos line '%1%'") %line));
+    _chromId = SequenceDictionary::instance().id(chrom);
 
-    if (!tokenizer.extract(cp._start))
+    if (!tokenizer.extract(_start))
         throw runtime_error(str(format("Failed to extract start position from ChromPos line '%1%'") %line));
-
-    cp._line.swap(line);
 }
 
 void ChromPos::swap(ChromPos& rhs) {
-    _chrom.swap(rhs._chrom);
+    std::swap(_chromId, rhs._chromId);
     std::swap(_start, rhs._start);
     _line.swap(rhs._line);
 }
 
+std::size_t ChromPos::footprint() const {
+    return _line.capacity();
+}
+
 const std::string& ChromPos::toString() const {
     return _line;
 }
@@ -2,9 +2,12 @@
 
 #include "common/CoordinateView.hpp"
 #include "common/LocusCompare.hpp"
+#include "common/SequenceDictionary.hpp"
+#include "common/StringView.hpp"
 #include "common/cstdint.hpp"
 
 #include <algorithm>
+#include <cstddef>
 #include <ostream>
 #include <sstream>
 #include <stdexcept>
@@ -38,22 +41,34 @@ public:
 
 
     static void parseLine(const ChromPosHeader*, std::string& line, ChromPos& cp);
+    static void parseLine(const ChromPosHeader*, StringView const& line, ChromPos& cp);
     void swap(ChromPos& rhs);
 
     const std::string& chrom() const;
+    // the id of chrom() in SequenceDictionary::instance()
+    uint32_t chromId() const;
     int64_t start() const;
     int64_t stop() const;
     const std::string& toString() const;
+    // approximate heap memory owned by this object, in bytes
+    std::size_t footprint() const;
 
 protected:
-    std::string _chrom;
+    void parseFields(StringView const& line);
+
+protected:
+    uint32_t _chromId;
     int64_t _start;
 
     mutable std::string _line;
 };
 
 inline const std::string& ChromPos::chrom() const {
-    return _chrom;
+    return SequenceDictionary::instance().name(_chromId);
+}
+
+inline uint32_t ChromPos::chromId() const {
+    return _chromId;
 }
 
 inline int64_t ChromPos::start() const {
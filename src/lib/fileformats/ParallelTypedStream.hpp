@@ -0,0 +1,333 @@
+#pragma once
+
+#include "TypedStream.hpp"
+#include "common/StringView.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/compat.hpp"
+#include "common/cstdint.hpp"
+#include "io/InputStream.hpp"
+
+#include <boost/format.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A drop-in replacement for TypedStream that parses on a thread pool.
+//
+// Lines are read from the input in the calling thread and grouped into
+// chunks, which are parsed by the pool while the consumer works through
+// earlier chunks. Values are handed out in input order, so this suits
+// per-record map operations (filtering, annotating, reporting) whose cost
+// is dominated by parsing.
+//
+// If prepare is given, it is called on each value by the worker that parsed
+// it. This is the place to do further lazy parsing that the consumer will
+// need (e.g., Vcf::Entry::sampleData()) so that it happens in parallel too.
+//
+// Reading starts with the first call to peek or next, so the header may be
+// modified (e.g., to add a FILTER) before then. A parse error is reported by
+// the call to next or peek that reaches the offending line.
+template<typename Parser>
+class ParallelTypedStream {
+public:
+    typedef typename Parser::ValueType ValueType;
+    typedef typename ValueType::HeaderType HeaderType;
+    typedef std::unique_ptr<ParallelTypedStream<Parser>> ptr;
+    typedef std::function<void(ValueType&)> Prepare;
+
+    enum { DEFAULT_CHUNK_SIZE = 512 };
+
+    ParallelTypedStream(Parser& parser, InputStream& in, ThreadPool::ptr pool,
+            Prepare prepare = Prepare(),
+            std::size_t chunkSize = DEFAULT_CHUNK_SIZE)
+        : parser_(parser)
+        , in_(in)
+        , pool_(pool ? pool : ThreadPool::create(0))
+        , prepare_(prepare)
+        , chunkSize_(chunkSize > 0 ? chunkSize : 1)
+        // enough to keep every thread busy while we consume the oldest chunk
+        , maxPending_(2 * pool_->size() + 1)
+        , inputDone_(false)
+        , pos_(0)
+        , lineNum_(0)
+        , valueCount_(0)
+    {
+        using boost::format;
+        try {
+            header_ = HeaderType::fromStream(in_);
+        }
+        catch (std::exception const& e) {
+            throw std::runtime_error(str(format(
+                "Error while parsing header of %1%:\n%2%"
+                ) % in.name() % e.what()));
+        }
+    }
+
+    ~ParallelTypedStream() {
+        // the jobs refer to our parser and header
+        drainPipeline();
+    }
+
+    HeaderType const& header() const {
+        return header_;
+    }
+
+    HeaderType& header() {
+        return header_;
+    }
+
+    std::string const& name() const;
+    bool eof() const;
+    bool peek(ValueType** value);
+    bool next(ValueType& value);
+    std::size_t nextBatch(std::vector<ValueType>& out, std::size_t n);
+    uint64_t valueCount() const;
+    void checkEof() const;
+    uint64_t lineNum() const;
+
+    Parser& parser() {
+        return parser_;
+    }
+
+private:
+    struct Chunk {
+        std::string data;
+        // end offsets and line numbers of each line in data
+        std::vector<std::size_t> ends;
+        std::vector<uint64_t> lineNums;
+        std::vector<ValueType> values;
+        // the number of lines parsed successfully
+        std::size_t count;
+        std::string error;
+    };
+    typedef std::shared_ptr<Chunk> ChunkPtr;
+
+    struct ParseJob {
+        Parser* parser;
+        HeaderType const* header;
+        Prepare const* prepare;
+        std::string const* name;
+        ChunkPtr chunk;
+
+        void operator()() const;
+    };
+
+    struct PendingChunk {
+        ChunkPtr chunk;
+        std::future<void> done;
+    };
+
+    bool readChunk(Chunk& chunk);
+    void fillPipeline();
+    // waits for the pending jobs and discards their chunks
+    void drainPipeline();
+    // Make sure current_ holds a value, returning false at the end of input
+    bool ensureValue();
+
+private:
+    HeaderType header_;
+    Parser parser_;
+    InputStream& in_;
+    ThreadPool::ptr pool_;
+    Prepare prepare_;
+    std::size_t chunkSize_;
+    std::size_t maxPending_;
+
+    std::deque<PendingChunk> pending_;
+    std::vector<ChunkPtr> free_;
+    bool inputDone_;
+
+    ChunkPtr current_;
+    std::size_t pos_;
+    uint64_t lineNum_;
+    uint64_t valueCount_;
+};
+
+template<typename Parser>
+inline void ParallelTypedStream<Parser>::ParseJob::operator()() const {
+    std::string buf;
+    std::size_t n = chunk->ends.size();
+    if (chunk->values.size() < n)
+        chunk->values.resize(n);
+
+    char const* data = chunk->data.data();
+    std::size_t beg = 0;
+    for (chunk->count = 0; chunk->count < n; ++chunk->count) {
+        std::size_t end = chunk->ends[chunk->count];
+        ValueType& value = chunk->values[chunk->count];
+        try {
+            detail::parseLine(*parser, header, StringView(data + beg, data + end),
+                buf, value, 0);
+            if (*prepare)
+                (*prepare)(value);
+        }
+        catch (std::exception const& e) {
+            using boost::format;
+            chunk->error = str(format("Error at %1%:%2%: %3%"
+                ) % *name % chunk->lineNums[chunk->count] % e.what());
+            break;
+        }
+        beg = end;
+    }
+}
+
+template<typename Parser>
+inline bool ParallelTypedStream<Parser>::readChunk(Chunk& chunk) {
+    chunk.data.clear();
+    chunk.ends.clear();
+    chunk.lineNums.clear();
+    chunk.count = 0;
+    chunk.error.clear();
+
+    StringView line;
+    while (chunk.ends.size() < chunkSize_) {
+        if (in_.eof() || !in_.getline(line)) {
+            inputDone_ = true;
+            break;
+        }
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        chunk.data.append(line.begin(), line.end());
+        chunk.ends.push_back(chunk.data.size());
+        chunk.lineNums.push_back(in_.lineNum());
+    }
+    return !chunk.ends.empty();
+}
+
+template<typename Parser>
+inline void ParallelTypedStream<Parser>::fillPipeline() {
+    while (!inputDone_ && pending_.size() < maxPending_) {
+        ChunkPtr chunk;
+        if (free_.empty()) {
+            chunk = std::make_shared<Chunk>();
+        }
+        else {
+            chunk = std::move(free_.back());
+            free_.pop_back();
+        }
+
+        if (!readChunk(*chunk)) {
+            free_.push_back(std::move(chunk));
+            break;
+        }
+
+        ParseJob job{&parser_, &header_, &prepare_, &in_.name(), chunk};
+        pending_.push_back(PendingChunk{chunk, pool_->submit(job)});
+    }
+}
+
+template<typename Parser>
+inline void ParallelTypedStream<Parser>::drainPipeline() {
+    for (auto i = pending_.begin(); i != pending_.end(); ++i) {
+        i->done.wait();
+        free_.push_back(std::move(i->chunk));
+    }
+    pending_.clear();
+}
+
+template<typename Parser>
+inline bool ParallelTypedStream<Parser>::ensureValue() {
+    while (!current_ || pos_ == current_->count) {
+        if (current_) {
+            if (!current_->error.empty()) {
+                // only report the error once
+                std::string error;
+                error.swap(current_->error);
+                inputDone_ = true;
+                drainPipeline();
+                throw std::runtime_error(error);
+            }
+            free_.push_back(std::move(current_));
+        }
+
+        fillPipeline();
+        if (pending_.empty())
+            return false;
+
+        PendingChunk& front = pending_.front();
+        front.done.get();
+        current_ = std::move(front.chunk);
+        pending_.pop_front();
+        pos_ = 0;
+
+        // keep the pool busy while the consumer works on this chunk
+        fillPipeline();
+    }
+    return true;
+}
+
+template<typename Parser>
+inline std::string const& ParallelTypedStream<Parser>::name() const {
+    return in_.name();
+}
+
+template<typename Parser>
+inline bool ParallelTypedStream<Parser>::eof() const {
+    return inputDone_ && pending_.empty()
+        && (!current_ || (pos_ == current_->count && current_->error.empty()));
+}
+
+template<typename Parser>
+inline bool ParallelTypedStream<Parser>::peek(ValueType** value) {
+    if (!ensureValue())
+        return false;
+
+    *value = &current_->values[pos_];
+    return true;
+}
+
+template<typename Parser>
+inline bool ParallelTypedStream<Parser>::next(ValueType& value) {
+    if (!ensureValue())
+        return false;
+
+    // the caller's old value goes back into the chunk to be parsed into
+    value.swap(current_->values[pos_]);
+    lineNum_ = current_->lineNums[pos_];
+    ++pos_;
+    ++valueCount_;
+    return true;
+}
+
+template<typename Parser>
+inline std::size_t ParallelTypedStream<Parser>::nextBatch(
+        std::vector<ValueType>& out, std::size_t n)
+{
+    return readBatch(*this, out, n);
+}
+
+template<typename Parser>
+inline uint64_t ParallelTypedStream<Parser>::valueCount() const {
+    return valueCount_;
+}
+
+template<typename Parser>
+inline void ParallelTypedStream<Parser>::checkEof() const {
+    if (eof())
+        throw std::runtime_error("Attempted to read past eof of stream " + name());
+}
+
+template<typename Parser>
+inline uint64_t ParallelTypedStream<Parser>::lineNum() const {
+    return lineNum_;
+}
+
+template<typename ValueType>
+typename ParallelTypedStream<DefaultParser<ValueType>>::ptr openParallelStream(
+        InputStream& in,
+        ThreadPool::ptr pool,
+        typename ParallelTypedStream<DefaultParser<ValueType>>::Prepare prepare
+            = typename ParallelTypedStream<DefaultParser<ValueType>>::Prepare())
+{
+    DefaultParser<ValueType> parser;
+    return std::make_unique<ParallelTypedStream<DefaultParser<ValueType>>>(
+        parser, in, pool, prepare);
+}
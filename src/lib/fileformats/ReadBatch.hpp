@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Read up to n values from stream (anything with bool next(ValueType&))
+// into out, returning the number read. out is grown to at least n elements
+// but never shrunk: the values already in it are read into again, so the
+// strings and vectors they own are reused from batch to batch. Only the
+// first (returned) count elements are valid.
+template<typename StreamType, typename ValueType>
+std::size_t readBatch(StreamType& stream, std::vector<ValueType>& out,
+        std::size_t n)
+{
+    if (out.size() < n)
+        out.resize(n);
+
+    std::size_t count = 0;
+    while (count < n && stream.next(out[count]))
+        ++count;
+
+    return count;
+}
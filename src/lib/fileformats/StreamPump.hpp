@@ -1,64 +1,99 @@
 #pragma once
 
+#include "ValuePool.hpp"
 #include "common/compat.hpp"
 
+#include <cstddef>
 #include <memory>
 #include <utility>
+#include <vector>
 
+// Reads values from the stream in batches (see TypedStream::nextBatch) and
+// hands them to out one at a time, as lvalues so that their memory stays
+// in the batch to be reused by the next one.
 template<typename StreamType, typename OutputFunc>
 struct StreamPump {
     typedef typename StreamType::ValueType ValueType;
 
-    StreamPump(StreamType& s, OutputFunc& out)
+    enum { DEFAULT_BATCH_SIZE = 1024 };
+
+    StreamPump(StreamType& s, OutputFunc& out,
+            std::size_t batchSize = DEFAULT_BATCH_SIZE)
         : stream_(s)
         , out_(out)
+        , batchSize_(batchSize > 0 ? batchSize : 1)
     {
     }
 
     void execute() {
-        ValueType entry;
-        while (stream_.next(entry)) {
-            out_(std::move(entry));
+        std::vector<ValueType> batch;
+        std::size_t n;
+        while ((n = stream_.nextBatch(batch, batchSize_)) > 0) {
+            for (std::size_t i = 0; i < n; ++i) {
+                out_(batch[i]);
+            }
         }
         out_.flush();
     }
 
     StreamType& stream_;
     OutputFunc& out_;
+    std::size_t batchSize_;
 };
 
 template<typename StreamType, typename OutputFunc>
 StreamPump<StreamType, OutputFunc>
-makeStreamPump(StreamType& s, OutputFunc& out) {
-    return StreamPump<StreamType, OutputFunc>(s, out);
+makeStreamPump(StreamType& s, OutputFunc& out,
+        std::size_t batchSize = StreamPump<StreamType, OutputFunc>::DEFAULT_BATCH_SIZE)
+{
+    return StreamPump<StreamType, OutputFunc>(s, out, batchSize);
 }
 
 
+// Reads values from the stream and hands them to out as unique_ptrs. With a
+// pool, the values are taken from it, so consumers that release values back
+// to the pool have the next ones read into them.
 template<typename StreamType, typename OutputFunc>
 struct PointerStreamPump {
     typedef typename StreamType::ValueType ValueType;
+    typedef ValuePool<ValueType> PoolType;
 
-    PointerStreamPump(StreamType& s, OutputFunc& out)
+    PointerStreamPump(StreamType& s, OutputFunc& out, PoolType* pool = 0)
         : stream_(s)
         , out_(out)
+        , pool_(pool)
     {
     }
 
     void execute() {
-        auto entry = std::make_unique<ValueType>();
+        auto entry = acquire();
         while (stream_.next(*entry)) {
             out_(std::move(entry));
-            entry = std::make_unique<ValueType>();
+            entry = acquire();
         }
+        if (pool_)
+            pool_->release(std::move(entry));
         out_.flush();
     }
 
+    std::unique_ptr<ValueType> acquire() {
+        if (pool_)
+            return pool_->acquire();
+        return std::make_unique<ValueType>();
+    }
+
     StreamType& stream_;
     OutputFunc& out_;
+    PoolType* pool_;
 };
 
 template<typename StreamType, typename OutputFunc>
 PointerStreamPump<StreamType, OutputFunc>
-makePointerStreamPump(StreamType& s, OutputFunc& out) {
-    return PointerStreamPump<StreamType, OutputFunc>(s, out);
+makePointerStreamPump(
+          StreamType& s
+        , OutputFunc& out
+        , ValuePool<typename StreamType::ValueType>* pool = 0
+        )
+{
+    return PointerStreamPump<StreamType, OutputFunc>(s, out, pool);
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "ReadBatch.hpp"
+#include "common/StringView.hpp"
 #include "common/compat.hpp"
 #include "io/InputStream.hpp"
 
@@ -28,6 +30,27 @@ void setSourceIndex(StreamType& stream, size_t idx) {
     SetSourceIndex<typename StreamType::ValueType>{}(stream, idx);
 }
 
+namespace detail {
+    // Parsers that accept a StringView are handed lines straight out of the
+    // input buffer. Others get a copy in a std::string owned by the stream
+    // (whose capacity is reused from line to line).
+    template<typename Parser, typename HeaderType, typename ValueType>
+    auto parseLine(Parser& parser, HeaderType const* header,
+            StringView const& line, std::string&, ValueType& value, int)
+        -> decltype(parser(header, line, value), void())
+    {
+        parser(header, line, value);
+    }
+
+    template<typename Parser, typename HeaderType, typename ValueType>
+    void parseLine(Parser& parser, HeaderType const* header,
+            StringView const& line, std::string& buf, ValueType& value, long)
+    {
+        buf.assign(line.begin(), line.end());
+        parser(header, buf, value);
+    }
+}
+
 template<typename Parser>
 class TypedStream {
 public:
@@ -65,6 +88,11 @@ public:
     bool eof() const;
     bool peek(ValueType** value);
     bool next(ValueType& value);
+    // Read up to n values into out, returning the number read. out is grown
+    // to at least n elements but never shrunk: the values already in it are
+    // parsed into again, so the strings and vectors they own are reused from
+    // batch to batch. Only the first (returned) count elements are valid.
+    std::size_t nextBatch(std::vector<ValueType>& out, std::size_t n);
     uint64_t valueCount() const;
     void checkEof() const;
     uint64_t lineNum() const;
@@ -74,7 +102,7 @@ public:
     }
 
 protected:
-    std::string nextLine();
+    void nextLine(StringView& line);
 
 protected:
     HeaderType header_;
@@ -88,6 +116,7 @@ protected:
     bool cached_;
     bool cachedRv_;
     ValueType cachedValue_;
+    std::string lineBuf_;
 };
 
 template<typename Parser>
@@ -134,12 +163,13 @@ inline bool TypedStream<Parser>::next(ValueType& value) {
         return cachedRv_;
     }
 
-    std::string line = nextLine();
+    StringView line;
+    nextLine(line);
     if (line.empty())
         return false;
 
     try {
-        parser_(&header_, line, value);
+        detail::parseLine(parser_, &header_, line, lineBuf_, value, 0);
     }
     catch (std::exception const& e) {
         using boost::format;
@@ -152,12 +182,17 @@ inline bool TypedStream<Parser>::next(ValueType& value) {
 }
 
 template<typename Parser>
-inline std::string TypedStream<Parser>::nextLine() {
-    std::string line;
+inline std::size_t TypedStream<Parser>::nextBatch(
+        std::vector<ValueType>& out, std::size_t n)
+{
+    return readBatch(*this, out, n);
+}
+
+template<typename Parser>
+inline void TypedStream<Parser>::nextLine(StringView& line) {
     do {
         in_.getline(line);
     } while (!eof() && (line.empty() || line[0] == '#'));
-    return line;
 }
 
 template<typename Parser>
@@ -182,7 +217,12 @@ struct DefaultParser {
     typedef ValueType_ ValueType;
     typedef typename ValueType::HeaderType HeaderType;
 
-    void operator()(HeaderType const* h, std::string& line, ValueType& entry) {
+    // LineType is std::string or StringView. The latter is only accepted
+    // if ValueType knows how to parse it.
+    template<typename LineType>
+    auto operator()(HeaderType const* h, LineType& line, ValueType& entry)
+        -> decltype(ValueType::parseLine(h, line, entry), void())
+    {
         ValueType::parseLine(h, line, entry);
     }
 };
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common/compat.hpp"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+// A free list of heap allocated values for PointerStreamPump. Consumers at
+// the end of a pipeline release the values they are done with here, and the
+// pump reads the next values into them, so the strings and vectors a value
+// owns are reused rather than allocated again for every record. Values that
+// are never released are simply deleted as usual. Not thread safe: use one
+// pool per pipeline.
+template<typename T>
+class ValuePool {
+public:
+    typedef std::unique_ptr<T> ValuePtr;
+
+    ValuePtr acquire() {
+        if (free_.empty())
+            return std::make_unique<T>();
+
+        ValuePtr rv(std::move(free_.back()));
+        free_.pop_back();
+        return rv;
+    }
+
+    void release(ValuePtr value) {
+        if (value)
+            free_.push_back(std::move(value));
+    }
+
+    // Release each (non-null) value, leaving values empty
+    void release(std::vector<ValuePtr>& values) {
+        for (auto i = values.begin(); i != values.end(); ++i)
+            release(std::move(*i));
+        values.clear();
+    }
+
+    std::size_t size() const {
+        return free_.size();
+    }
+
+private:
+    std::vector<ValuePtr> free_;
+};
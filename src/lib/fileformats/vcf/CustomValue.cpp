@@ -3,6 +3,7 @@
 #include <boost/format.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <sstream>
 #include <utility>
 
 using boost::format;
@@ -11,6 +12,108 @@ using namespace std;
 
 BEGIN_NAMESPACE(Vcf)
 
+namespace {
+    // Conversions allowed when storing a ValueType of another type than the
+    // field's (e.g., after setType()). Anything else is an error.
+    template<typename U, typename V>
+    bool convert(U const&, V&) {
+        return false;
+    }
+
+    bool convert(int64_t const& x, double& out) {
+        out = x;
+        return true;
+    }
+
+    template<typename U>
+    bool convert(U const& x, std::string& out) {
+        stringstream ss;
+        ss << x;
+        out = ss.str();
+        return true;
+    }
+
+    template<typename T>
+    struct ValueConverter : public boost::static_visitor<bool> {
+        explicit ValueConverter(T& out) : out(out) {}
+
+        bool operator()(boost::blank const&) const {
+            return false;
+        }
+
+        bool operator()(T const& x) const {
+            out = x;
+            return true;
+        }
+
+        template<typename U>
+        bool operator()(U const& x) const {
+            return convert(x, out);
+        }
+
+        T& out;
+    };
+
+    struct StorageSize : public boost::static_visitor<std::size_t> {
+        template<typename C>
+        std::size_t operator()(C const& values) const {
+            return values.size();
+        }
+    };
+
+    struct StorageFootprint : public boost::static_visitor<std::size_t> {
+        template<typename T>
+        std::size_t operator()(std::vector<T> const& values) const {
+            return values.capacity() * sizeof(T);
+        }
+
+        std::size_t operator()(std::string const& values) const {
+            return values.capacity();
+        }
+
+        std::size_t operator()(
+            std::vector<boost::optional<std::string>> const& values) const
+        {
+            std::size_t rv = values.capacity() * sizeof(values[0]);
+            for (auto i = values.begin(); i != values.end(); ++i) {
+                if (*i)
+                    rv += (*i)->capacity();
+            }
+            return rv;
+        }
+    };
+
+    template<typename T>
+    bool printsEqual(T const& a, T const& b) {
+        return a == b;
+    }
+
+    // doubles are only printed to a few digits, and values that print the
+    // same have always compared equal
+    bool printsEqual(double const& a, double const& b) {
+        if (a == b || memcmp(&a, &b, sizeof(a)) == 0)
+            return true;
+        stringstream sa;
+        stringstream sb;
+        sa << a;
+        sb << b;
+        return sa.str() == sb.str();
+    }
+
+    template<typename C>
+    bool valuesEqual(C const* a, C const* b) {
+        if (!a || !b)
+            return !a && !b;
+        if (a->size() != b->size())
+            return false;
+        for (std::size_t i = 0; i < a->size(); ++i) {
+            if (!printsEqual((*a)[i], (*b)[i]))
+                return false;
+        }
+        return true;
+    }
+}
+
 CustomValue::CustomValue()
     : _type(0)
 {
@@ -24,14 +127,14 @@ CustomValue::CustomValue(CustomValue const& other)
 
 CustomValue::CustomValue(CustomValue&& other)
     : _type(other._type)
-    , _values(std::move(other._values))
 {
+    _values.swap(other._values);
 }
 
 CustomValue::CustomValue(const CustomType* type, const std::vector<ValueType>&& values)
     : _type(type)
-    , _values(std::move(values))
 {
+    setRaw(values);
 }
 
 CustomValue& CustomValue::operator=(CustomValue const& other) {
@@ -91,12 +194,166 @@ CustomValue::CustomValue(const CustomType* type, const string& value)
             %value %CustomType::typeToString(type->type()) %type->id()));
 }
 
-const CustomValue::ValueType* CustomValue::getAny(SizeType idx) const {
+void CustomValue::setType(const CustomType* type) {
+    if (_type && type && _type->type() != type->type() && !empty()) {
+        std::vector<ValueType> values = getRaw();
+        _type = type;
+        setRaw(values);
+    }
+    _type = type;
+}
+
+CustomValue::ValueType CustomValue::getAny(SizeType idx) const {
     type().validateIndex(idx);
-    if (idx >= _values.size() || _values[idx].which() == 0) {
-        return 0;
+    if (idx >= size())
+        return ValueType();
+
+    switch (type().type()) {
+        case CustomType::INTEGER:
+            if (const int64_t* x = get<int64_t>(idx)) return *x;
+            break;
+
+        case CustomType::FLOAT:
+            if (const double* x = get<double>(idx)) return *x;
+            break;
+
+        case CustomType::CHAR:
+            if (const char* x = get<char>(idx)) return *x;
+            break;
+
+        case CustomType::STRING:
+            if (const string* x = get<string>(idx)) return *x;
+            break;
+
+        case CustomType::FLAG:
+            if (const bool* x = get<bool>(idx)) return *x;
+            break;
+
+        default:
+            throw runtime_error("Invalid custom VCF type!");
+            break;
+    }
+    return ValueType();
+}
+
+void CustomValue::setAny(SizeType idx, const ValueType& value) {
+    bool rv = true;
+    switch (type().type()) {
+        case CustomType::INTEGER: {
+                int64_t x = 0;
+                if (value.which() == 0)
+                    slots<int64_t>()[idx] = detail::ValueSlots<int64_t>::missing();
+                else if ((rv = boost::apply_visitor(ValueConverter<int64_t>(x), value)))
+                    slots<int64_t>()[idx] = x;
+            }
+            break;
+
+        case CustomType::FLOAT: {
+                double x = 0.0;
+                if (value.which() == 0)
+                    slots<double>()[idx] = detail::ValueSlots<double>::missing();
+                else if ((rv = boost::apply_visitor(ValueConverter<double>(x), value)))
+                    slots<double>()[idx] = x;
+            }
+            break;
+
+        case CustomType::CHAR: {
+                char x = '\0';
+                if (value.which() == 0)
+                    slots<char>()[idx] = detail::ValueSlots<char>::missing();
+                else if ((rv = boost::apply_visitor(ValueConverter<char>(x), value)))
+                    slots<char>()[idx] = x;
+            }
+            break;
+
+        case CustomType::STRING: {
+                string x;
+                if (value.which() == 0)
+                    slots<string>()[idx] = boost::none;
+                else if ((rv = boost::apply_visitor(ValueConverter<string>(x), value)))
+                    slots<string>()[idx] = std::move(x);
+            }
+            break;
+
+        case CustomType::FLAG: {
+                bool x = false;
+                if (value.which() == 0)
+                    slots<bool>()[idx] = detail::ValueSlots<bool>::missing();
+                else if ((rv = boost::apply_visitor(ValueConverter<bool>(x), value)))
+                    slots<bool>()[idx] = detail::ValueSlots<bool>::store(x);
+            }
+            break;
+
+        default:
+            throw runtime_error("Invalid custom VCF type!");
+            break;
+    }
+
+    if (!rv) {
+        stringstream ss;
+        ss << value;
+        throw runtime_error(str(format("Failed to coerce value '%1%' into %2% for field '%3%'")
+            %ss.str() %CustomType::typeToString(type().type()) %type().id()));
+    }
+}
+
+template<typename T>
+void CustomValue::getRaw_impl(std::vector<ValueType>& out) const {
+    auto values = slots<T>();
+    if (!values)
+        return;
+
+    out.resize(values->size());
+    for (SizeType i = 0; i < values->size(); ++i) {
+        if (const T* x = detail::ValueSlots<T>::get((*values)[i]))
+            out[i] = *x;
+    }
+}
+
+std::vector<CustomValue::ValueType> CustomValue::getRaw() const {
+    std::vector<ValueType> rv;
+    if (empty())
+        return rv;
+
+    switch (type().type()) {
+        case CustomType::INTEGER: getRaw_impl<int64_t>(rv); break;
+        case CustomType::FLOAT: getRaw_impl<double>(rv); break;
+        case CustomType::CHAR: getRaw_impl<char>(rv); break;
+        case CustomType::STRING: getRaw_impl<string>(rv); break;
+        case CustomType::FLAG: getRaw_impl<bool>(rv); break;
+        default:
+            throw runtime_error("Invalid custom VCF type!");
+            break;
+    }
+    return rv;
+}
+
+void CustomValue::setRaw(std::vector<ValueType> const& values) {
+    _values = Storage();
+    if (values.empty())
+        return;
+
+    resize(values.size());
+    for (SizeType i = 0; i < values.size(); ++i)
+        setAny(i, values[i]);
+}
+
+template<typename T>
+void CustomValue::resize_impl(SizeType size) {
+    slots<T>().resize(size, detail::ValueSlots<T>::missing());
+}
+
+void CustomValue::resize(SizeType size) {
+    switch (type().type()) {
+        case CustomType::INTEGER: resize_impl<int64_t>(size); break;
+        case CustomType::FLOAT: resize_impl<double>(size); break;
+        case CustomType::CHAR: resize_impl<char>(size); break;
+        case CustomType::STRING: resize_impl<string>(size); break;
+        case CustomType::FLAG: resize_impl<bool>(size); break;
+        default:
+            throw runtime_error("Invalid custom VCF type!");
+            break;
     }
-    return &_values[idx];
 }
 
 const CustomType& CustomValue::type() const {
@@ -106,11 +363,15 @@ const CustomType& CustomValue::type() const {
 }
 
 CustomValue::SizeType CustomValue::size() const {
-    return _values.size();
+    return boost::apply_visitor(StorageSize(), _values);
 }
 
 bool CustomValue::empty() const {
-    return _values.empty();
+    return size() == 0;
+}
+
+std::size_t CustomValue::footprint() const {
+    return boost::apply_visitor(StorageFootprint(), _values);
 }
 
 // This gets called to notify existing values how many alleles there are.
@@ -125,7 +386,7 @@ void CustomValue::setNumAlts(uint32_t n) {
         maxValue = n + 1;
     }
 
-    if (_values.size() > maxValue) {
+    if (size() > maxValue) {
         std::stringstream ss;
         ss << (*this);
         throw std::runtime_error(str(format(
@@ -135,16 +396,17 @@ void CustomValue::setNumAlts(uint32_t n) {
     }
 
     if (type().numberType() == CustomType::PER_ALLELE) {
-        _values.resize(n);
+        resize(n);
     }
     else if (type().numberType() == CustomType::PER_ALLELE_REF) {
-        _values.resize(n + 1);
+        resize(n + 1);
     }
 }
 
 std::string CustomValue::getString(SizeType idx) const {
     type().validateIndex(idx);
-    if (idx >= _values.size() || _values[idx].empty())
+    ValueType value = getAny(idx);
+    if (value.which() == 0)
         return ".";
 
     stringstream ss;
@@ -217,16 +479,65 @@ std::string CustomValue::toString() const {
     return ss.str();
 }
 
+bool CustomValue::operator==(const CustomValue& rhs) const {
+    if (*_type != rhs.type())
+        return false;
+
+    // an empty value and one of only missing elements both print as "."
+    if (size() != rhs.size())
+        return toString() == rhs.toString();
+
+    switch (type().type()) {
+        case CustomType::INTEGER:
+            return valuesEqual(slots<int64_t>(), rhs.slots<int64_t>());
+
+        case CustomType::FLOAT:
+            return valuesEqual(slots<double>(), rhs.slots<double>());
+
+        case CustomType::CHAR:
+            return valuesEqual(slots<char>(), rhs.slots<char>());
+
+        case CustomType::STRING:
+            return valuesEqual(slots<string>(), rhs.slots<string>());
+
+        case CustomType::FLAG:
+            return valuesEqual(slots<bool>(), rhs.slots<bool>());
+
+        default:
+            throw runtime_error("Invalid custom VCF type!");
+            break;
+    }
+}
+
+template<typename T>
+void CustomValue::append_impl(const CustomValue& other) {
+    auto values = other.slots<T>();
+    if (!values)
+        return;
+
+    auto& dst = slots<T>();
+    dst.insert(dst.end(), values->begin(), values->end());
+}
+
 void CustomValue::append(const CustomValue& other) {
     if (other.type() != type())
         throw runtime_error(str(format("Attempted to concatenate conflicting custom types: %1% and %2%")
             %type().toString() %other.type().toString()));
-    SizeType idx = size();
+    if (other.empty())
+        return;
+
     SizeType newSize = size() + other.size();
     type().validateIndex(newSize-1);
-    ensureCapacity(newSize);
-    for (SizeType i = 0; i < other.size(); ++i)
-        _values[idx++] = other._values[i];
+    switch (type().type()) {
+        case CustomType::INTEGER: append_impl<int64_t>(other); break;
+        case CustomType::FLOAT: append_impl<double>(other); break;
+        case CustomType::CHAR: append_impl<char>(other); break;
+        case CustomType::STRING: append_impl<string>(other); break;
+        case CustomType::FLAG: append_impl<bool>(other); break;
+        default:
+            throw runtime_error("Invalid custom VCF type!");
+            break;
+    }
 }
 
 CustomValue& CustomValue::operator+=(const CustomValue& rhs) {
@@ -5,20 +5,135 @@
 #include "common/Tokenizer.hpp"
 #include "common/namespaces.hpp"
 
+#include <boost/optional.hpp>
 #include <boost/variant.hpp>
 
 #include <algorithm>
-#include <functional>
+#include <cstddef>
+#include <cstring>
+#include <limits>
 #include <string>
 #include <vector>
 #include <ostream>
 
 BEGIN_NAMESPACE(Vcf)
 
+namespace detail {
+    // How CustomValue stores values of type T: the container holding them
+    // and the element standing for a missing value ('.').
+    template<typename T>
+    struct ValueSlots;
+
+    template<>
+    struct ValueSlots<int64_t> {
+        typedef std::vector<int64_t> Container;
+
+        static int64_t missing() {
+            return std::numeric_limits<int64_t>::min();
+        }
+
+        static int64_t const* get(int64_t const& x) {
+            return x == missing() ? 0 : &x;
+        }
+
+        static int64_t store(int64_t x) {
+            return x;
+        }
+    };
+
+    template<>
+    struct ValueSlots<double> {
+        typedef std::vector<double> Container;
+
+        // a NaN that parsing won't produce
+        static double missing() {
+            uint64_t const bits = 0x7ff00000000007a1ULL;
+            double rv;
+            std::memcpy(&rv, &bits, sizeof(rv));
+            return rv;
+        }
+
+        static bool isMissing(double const& x) {
+            double const m = missing();
+            return std::memcmp(&x, &m, sizeof(x)) == 0;
+        }
+
+        static double const* get(double const& x) {
+            return isMissing(x) ? 0 : &x;
+        }
+
+        static double store(double x) {
+            return x;
+        }
+    };
+
+    template<>
+    struct ValueSlots<char> {
+        typedef std::string Container;
+
+        static char missing() {
+            return '\0';
+        }
+
+        static char const* get(char const& x) {
+            return x == missing() ? 0 : &x;
+        }
+
+        static char store(char x) {
+            return x;
+        }
+    };
+
+    // Flags share the character storage, as 't' and 'f'
+    template<>
+    struct ValueSlots<bool> {
+        typedef std::string Container;
+
+        static char missing() {
+            return '\0';
+        }
+
+        static bool const* get(char const& x) {
+            static bool const values[] = {false, true};
+            return x == missing() ? 0 : &values[x == 't'];
+        }
+
+        static char store(bool x) {
+            return x ? 't' : 'f';
+        }
+    };
+
+    // "" is a valid string, so strings carry their own missing flag
+    template<>
+    struct ValueSlots<std::string> {
+        typedef std::vector<boost::optional<std::string>> Container;
+
+        static boost::optional<std::string> missing() {
+            return boost::none;
+        }
+
+        static std::string const* get(boost::optional<std::string> const& x) {
+            return x ? &*x : 0;
+        }
+
+        static boost::optional<std::string> store(std::string const& x) {
+            return x;
+        }
+    };
+}
+
+// The value of an INFO or FORMAT field.
+//
+// Values are kept in one container whose element type is given by the
+// CustomType's data type (e.g., a std::vector<int64_t> for Integer
+// fields), with a sentinel element (or, for strings, an unset optional) for
+// missing values rather than a variant per element. ValueType is only used
+// to pass single values of any type in and out (getAny(), getRaw(),
+// setRaw()).
 class CustomValue {
 public:
     typedef boost::variant<boost::blank, int64_t, double, char, bool, std::string> ValueType;
-    typedef std::vector<ValueType>::size_type SizeType;
+    typedef std::size_t SizeType;
 
     CustomValue();
 
@@ -32,11 +147,13 @@ public:
     CustomValue(const CustomType* type, const std::string& value);
     CustomValue(const CustomType* type, const std::vector<ValueType>&& values);
 
-    void setType(const CustomType* type) { _type = type; }
+    // values are converted if the data type changes
+    void setType(const CustomType* type);
     const CustomType& type() const;
     SizeType size() const;
     bool empty() const;
-    const ValueType* getAny(SizeType idx) const;
+    // blank if the value at idx is missing
+    ValueType getAny(SizeType idx) const;
 
     template<typename T>
     const T* get(SizeType idx = 0) const;
@@ -44,13 +161,8 @@ public:
     template<typename T>
     void set(SizeType idx, const T& value);
 
-    std::vector<ValueType> const& getRaw() const {
-        return _values;
-    }
-
-    void setRaw(std::vector<ValueType> values) {
-        _values.swap(values);
-    }
+    std::vector<ValueType> getRaw() const;
+    void setRaw(std::vector<ValueType> const& values);
 
     std::string getString(SizeType idx) const;
     void toStream(std::ostream& s) const;
@@ -58,6 +170,9 @@ public:
     std::string toString(SizeType idx) const;
     void setNumAlts(uint32_t n);
 
+    // approximate heap memory owned by this object, in bytes
+    std::size_t footprint() const;
+
     void append(const CustomValue& other);
 
     CustomValue& operator+=(const CustomValue& rhs);
@@ -65,30 +180,49 @@ public:
     bool operator!=(const CustomValue& rhs) const;
 
 protected:
+    typedef boost::variant<
+        std::vector<int64_t>,
+        std::vector<double>,
+        std::string,
+        std::vector<boost::optional<std::string>>
+        > Storage;
+
+    // the container for values of type T, replacing the values held if
+    // they are of another type
+    template<typename T>
+    typename detail::ValueSlots<T>::Container& slots();
+
+    // null if the values held are not of type T
+    template<typename T>
+    typename detail::ValueSlots<T>::Container const* slots() const;
+
     template<typename T>
     void add(const CustomValue& rhs) {
+        typedef detail::ValueSlots<T> Slots;
         ensureCapacity(rhs.size());
-        for (SizeType i = 0; i < type().number(); ++i) {
+        auto& values = slots<T>();
+        for (SizeType i = 0; i < values.size(); ++i) {
             T val(0);
             const T* a = get<T>(i);
             const T* b = rhs.get<T>(i);
             if (a != NULL) val += *a;
             if (b != NULL) val += *b;
-            _values[i] = val;
+            values[i] = Slots::store(val);
         }
     }
 
     template<typename T>
     bool set(const std::string& value) {
+        typedef detail::ValueSlots<T> Slots;
         if (value.empty()) {
-            _values.clear();
+            _values = Storage();
             return true;
         }
 
         type().typecheck<T>();
-        uint32_t nItems = std::count_if(value.begin(), value.end(),
-            std::bind1st(std::equal_to<char>(), ',')) + 1;
-        _values.resize(nItems);
+        uint32_t nItems = std::count(value.begin(), value.end(), ',') + 1;
+        auto& values = slots<T>();
+        values.assign(nItems, Slots::missing());
 
         Tokenizer<char> t(value, ',');
 
@@ -103,20 +237,30 @@ protected:
                 t.advance();
             }
             else if (t.extract(tmp)) {
-                _values[idx] = tmp;
+                values[idx] = Slots::store(tmp);
             }
             else {
                 return false;
             }
             ++idx;
         }
-        type().validateIndex(_values.size()-1);
+        type().validateIndex(values.size()-1);
 
         return t.eof();
     }
 
+    void setAny(SizeType idx, const ValueType& value);
+    void resize(SizeType size);
 
-    void ensureCapacity(uint32_t size);
+    template<typename T>
+    void resize_impl(SizeType size);
+
+    template<typename T>
+    void append_impl(const CustomValue& other);
+
+    template<typename T>
+    void getRaw_impl(std::vector<ValueType>& out) const;
+    void ensureCapacity(SizeType size);
 
 protected:
     template<typename T>
@@ -124,25 +268,41 @@ protected:
 
 protected:
     const CustomType* _type;
-    std::vector<ValueType> _values;
+    Storage _values;
 };
 
+template<typename T>
+inline typename detail::ValueSlots<T>::Container& CustomValue::slots() {
+    typedef typename detail::ValueSlots<T>::Container Container;
+    Container* rv = boost::get<Container>(&_values);
+    if (!rv) {
+        _values = Container();
+        rv = boost::get<Container>(&_values);
+    }
+    return *rv;
+}
+
+template<typename T>
+inline typename detail::ValueSlots<T>::Container const* CustomValue::slots() const {
+    return boost::get<typename detail::ValueSlots<T>::Container>(&_values);
+}
+
 template<typename T>
 inline const T* CustomValue::get(SizeType idx) const {
     type().typecheck<T>();
     type().validateIndex(idx);
-    if (idx >= _values.size())
+    auto values = slots<T>();
+    if (!values || idx >= values->size())
         return 0;
-    return boost::get<T>(&_values[idx]);
+    return detail::ValueSlots<T>::get((*values)[idx]);
 }
 
 
 template<>
 inline void CustomValue::set<CustomValue::ValueType>(SizeType idx, const ValueType& value) {
-    // skip type checking
     type().validateIndex(idx);
     ensureCapacity(idx+1);
-    _values[idx] = value;
+    setAny(idx, value);
 }
 
 template<typename T>
@@ -150,20 +310,12 @@ inline void CustomValue::set(SizeType idx, const T& value) {
     type().typecheck<T>();
     type().validateIndex(idx);
     ensureCapacity(idx+1);
-    _values[idx] = value;
+    slots<T>()[idx] = detail::ValueSlots<T>::store(value);
 }
 
-inline void CustomValue::ensureCapacity(uint32_t size) {
-    if (size > _values.size())
-        _values.resize(size);
-}
-
-inline bool CustomValue::operator==(const CustomValue& rhs) const {
-    // TODO: make this more efficient instead of using toString
-    // the problem is you can't compare boost::any objects without casting to
-    // the proper type, which we'd have to switch for
-    return *_type == rhs.type() &&
-        toString() == rhs.toString();
+inline void CustomValue::ensureCapacity(SizeType size) {
+    if (size > this->size())
+        resize(size);
 }
 
 inline bool CustomValue::operator!=(const CustomValue& rhs) const {
@@ -172,14 +324,16 @@ inline bool CustomValue::operator!=(const CustomValue& rhs) const {
 
 template<typename T>
 inline void CustomValue::toStream_impl(ostream& s) const {
-    if (empty()) {
-        type().emptyRepr(s);
-    }
-    for (SizeType i = 0; i < size(); ++i) {
+    auto values = slots<T>();
+    if (!values)
+        return;
+
+    for (SizeType i = 0; i < values->size(); ++i) {
         if (i > 0)
             s << ",";
-        if (_values[i].which() != 0)
-            s << _values[i];
+        T const* x = detail::ValueSlots<T>::get((*values)[i]);
+        if (x)
+            s << *x;
         else
             s << '.';
     }
@@ -23,6 +23,21 @@ using namespace std;
 
 namespace {
     std::string const MISSING_STRING = ".";
+
+    // Split [beg, end) into out, reusing the storage of the strings
+    // already there.
+    void splitInto(char const* beg, char const* end, char delim,
+            std::vector<std::string>& out)
+    {
+        Tokenizer<char> tok(beg, end, delim);
+        size_t n = 0;
+        while (!tok.eof()) {
+            if (out.size() <= n)
+                out.emplace_back();
+            tok.extract(out[n++]);
+        }
+        out.resize(n);
+    }
 }
 
 BEGIN_NAMESPACE(Vcf)
@@ -55,10 +70,18 @@ void Entry::parseLine(const Header* hdr, std::string& s, Entry& e) {
     e.parse(hdr, s);
 }
 
+void Entry::parseLine(const Header* hdr, StringView const& s, Entry& e) {
+    e.parse(hdr, s);
+}
+
 void Entry::parseLineAndReheader(const Header* hdr, const Header* newH, std::string& s, Entry& e) {
     e.parseAndReheader(hdr, newH, s);
 }
 
+void Entry::parseLineAndReheader(const Header* hdr, const Header* newH, StringView const& s, Entry& e) {
+    e.parseAndReheader(hdr, newH, s);
+}
+
 const char* Entry::fieldToString(FieldName field) {
     if (field >= UNDEFINED)
         return 0;
@@ -76,62 +99,78 @@ Entry::FieldName Entry::fieldFromString(const char* name) {
 
 Entry::Entry()
     : _header(0)
+    , _chromId(SequenceDictionary::EMPTY)
     , _pos(0)
     , _startWithoutPadding(0)
     , _stopWithoutPadding(0)
+    , _parsedIdentifiers(true)
     , _qual(MISSING_QUALITY)
+    , _textEnds()
     , _parsedSamples(false)
 {
+    _modified.set();
 }
 
 Entry::Entry(Entry const& e)
     : _header(e._header)
-    , _chrom(e._chrom)
+    , _chromId(e._chromId)
     , _pos(e._pos)
     , _startWithoutPadding(e._startWithoutPadding)
     , _stopWithoutPadding(e._stopWithoutPadding)
     , _identifiers(e._identifiers)
+    , _parsedIdentifiers(e._parsedIdentifiers)
     , _ref(e._ref)
     , _alt(e._alt)
     , _qual(e._qual)
     , _failedFilters(e._failedFilters)
     , _info(e._info)
+    , _text(e._text)
+    , _modified(e._modified)
     , _sampleString(e._sampleString)
     , _parsedSamples(e._parsedSamples)
     , _sampleData(e._sampleData)
 {
+    copy(e._textEnds, e._textEnds + FORMAT, _textEnds);
 }
 
 Entry::Entry(Entry&& e)
     : _header(e._header)
-    , _chrom(std::move(e._chrom))
+    , _chromId(e._chromId)
     , _pos(e._pos)
     , _startWithoutPadding(e._startWithoutPadding)
     , _stopWithoutPadding(e._stopWithoutPadding)
     , _identifiers(std::move(e._identifiers))
+    , _parsedIdentifiers(e._parsedIdentifiers)
     , _ref(std::move(e._ref))
     , _alt(std::move(e._alt))
     , _qual(e._qual)
     , _failedFilters(std::move(e._failedFilters))
     , _info(std::move(e._info))
+    , _text(std::move(e._text))
+    , _modified(e._modified)
     , _sampleString(std::move(e._sampleString))
     , _parsedSamples(e._parsedSamples)
     , _sampleData(std::move(e._sampleData))
 {
+    copy(e._textEnds, e._textEnds + FORMAT, _textEnds);
 }
 
 Entry& Entry::operator=(Entry const& e) {
     _header = e._header;
-    _chrom = e._chrom;
+    _chromId = e._chromId;
     _pos = e._pos;
     _startWithoutPadding = e._startWithoutPadding;
     _stopWithoutPadding = e._stopWithoutPadding;
     _identifiers = e._identifiers;
+    _parsedIdentifiers = e._parsedIdentifiers;
     _ref = e._ref;
     _alt = e._alt;
     _qual = e._qual;
     _failedFilters = e._failedFilters;
     _info = e._info;
+    _text = e._text;
+    copy(e._textEnds, e._textEnds + FORMAT, _textEnds);
+    _modified = e._modified;
     _sampleString = e._sampleString;
     _parsedSamples = e._parsedSamples;
     _sampleData = e._sampleData;
@@ -140,16 +179,20 @@ Entry& Entry::operator=(Entry const& e) {
 
 Entry& Entry::operator=(Entry&& e) {
     _header = std::move(e._header);
-    _chrom = std::move(e._chrom);
+    _chromId = e._chromId;
     _pos = e._pos;
     _startWithoutPadding = e._startWithoutPadding;
     _stopWithoutPadding = e._stopWithoutPadding;
     _identifiers = std::move(e._identifiers);
+    _parsedIdentifiers = e._parsedIdentifiers;
     _ref = std::move(e._ref);
     _alt = std::move(e._alt);
     _qual = std::move(e._qual);
     _failedFilters = std::move(e._failedFilters);
     _info = std::move(e._info);
+    _text = std::move(e._text);
+    copy(e._textEnds, e._textEnds + FORMAT, _textEnds);
+    _modified = e._modified;
     _sampleString = std::move(e._sampleString);
     _parsedSamples = std::move(e._parsedSamples);
     _sampleData = std::move(e._sampleData);
@@ -158,19 +201,25 @@ Entry& Entry::operator=(Entry&& e) {
 
 Entry::Entry(const Header* h)
     : _header(h)
+    , _chromId(SequenceDictionary::EMPTY)
     , _pos(0)
     , _startWithoutPadding(0)
     , _stopWithoutPadding(0)
+    , _parsedIdentifiers(true)
     , _qual(MISSING_QUALITY)
+    , _textEnds()
     , _parsedSamples(false)
 {
+    _modified.set();
 }
 
 Entry::Entry(const Header* h, const string& s)
     : _header(h)
     , _startWithoutPadding(0)
     , _stopWithoutPadding(0)
+    , _parsedIdentifiers(true)
     , _qual(MISSING_QUALITY)
+    , _textEnds()
     , _parsedSamples(false)
 {
     parse(h, s);
@@ -178,14 +227,18 @@ Entry::Entry(const Header* h, const string& s)
 
 Entry::Entry(EntryMerger&& merger)
     : _header(merger.mergedHeader())
-    , _chrom(merger.chrom())
+    , _chromId(SequenceDictionary::instance().id(merger.chrom()))
     , _pos(merger.pos())
-    , _identifiers(std::move(merger.identifiers()))
+    , _identifiers(merger.identifiers().begin(), merger.identifiers().end())
+    , _parsedIdentifiers(true)
     , _ref(merger.ref())
     , _qual(merger.qual())
-    , _failedFilters(std::move(merger.failedFilters()))
+    , _failedFilters(merger.failedFilters().begin(), merger.failedFilters().end())
+    , _textEnds()
     , _parsedSamples(true)
 {
+    _modified.set();
+
     if (!merger.merged()) {
         stringstream ss;
         for (size_t i = 0; i < merger.entryCount(); ++i) {
@@ -216,60 +269,72 @@ void Entry::parseAndReheader(const Header* h, const Header* newHeader, const str
     reheader(newHeader);
 }
 
+void Entry::parseAndReheader(const Header* h, const Header* newHeader, StringView const& s) {
+    parse(h, s);
+    reheader(newHeader);
+}
+
 void Entry::parse(const Header* h, const string& s) {
+    parse(h, StringView(s.data(), s.data() + s.size()));
+}
+
+void Entry::parse(const Header* h, StringView const& s) {
     _parsedSamples = false;
     _header = h;
 
-    // clear containers
-    _info.clear();
+    // clear containers. fields held in strings are assigned in place below
+    // so that their storage is reused from one entry to the next.
     _sampleData.clear();
     _identifiers.clear();
-    _alt.clear();
+    _parsedIdentifiers = false;
     _failedFilters.clear();
 
     Tokenizer<char> tok(s, '\t');
-    if (!tok.extract(_chrom))
-        throw runtime_error("Failed to extract chromosome from vcf entry: " + s);
+    StringView chrom;
+    if (!tok.extract(chrom))
+        throw runtime_error(str(format("Failed to extract chromosome from vcf entry: %1%") % s));
+    _chromId = SequenceDictionary::instance().id(chrom);
     if (!tok.extract(_pos))
-        throw runtime_error("Failed to extract position from vcf entry: " + s);
+        throw runtime_error(str(format("Failed to extract position from vcf entry: %1%") % s));
 
     char const* beg(0);
     char const* end(0);
 
-    // ids
+    // ids, split by parseIdentifiers() if they are used
     if (!tok.extract(&beg, &end))
-        throw runtime_error("Failed to extract id from vcf entry: " + s);
-
-    if (end-beg != 1 || *beg != '.')
-        Tokenizer<char>::split(beg, end, ';', inserter(_identifiers, _identifiers.begin()));
+        throw runtime_error(str(format("Failed to extract id from vcf entry: %1%") % s));
 
     // ref alleles
     if (!tok.extract(_ref))
-        throw runtime_error("Failed to extract ref alleles from vcf entry: " + s);
+        throw runtime_error(str(format("Failed to extract ref alleles from vcf entry: %1%") % s));
 
     // alt alleles
     if (!tok.extract(&beg, &end))
-        throw runtime_error("Failed to extract alt alleles from vcf entry: " + s);
+        throw runtime_error(str(format("Failed to extract alt alleles from vcf entry: %1%") % s));
 
     if (end-beg != 1 || *beg != '.')
-        Tokenizer<char>::split(beg, end, ',', back_inserter(_alt));
+        splitInto(beg, end, ',', _alt);
+    else
+        _alt.clear();
 
     // phred quality
-    string qualstr;
-    if (!tok.extract(qualstr))
-        throw runtime_error("Failed to extract quality from vcf entry: " + s);
-    if (qualstr == ".")
+    if (tok.eof() || !tok.extract(&beg, &end))
+        throw runtime_error(str(format("Failed to extract quality from vcf entry: %1%") % s));
+    if (end-beg == 1 && *beg == '.')
         _qual = MISSING_QUALITY;
     else
-        _qual = lexical_cast<double>(qualstr);
+        _qual = lexical_cast<double>(beg, end-beg);
 
     // failed filters
     if (!tok.extract(&beg, &end))
-        throw runtime_error("Failed to extract filters from vcf entry: " + s);
-
-    if (end-beg != 1 || *beg != '.')
-        Tokenizer<char>::split(beg, end, ';', inserter(_failedFilters,_failedFilters.end()));
+        throw runtime_error(str(format("Failed to extract filters from vcf entry: %1%") % s));
 
+    if (end-beg != 1 || *beg != '.') {
+        Tokenizer<char> filters(beg, end, ';');
+        StringView name;
+        while (filters.extract(name))
+            _failedFilters.insert(name);
+    }
 
     // If pass is present as well as other failed filters, remove pass
     if (_failedFilters.size() > 1) {
@@ -278,17 +343,47 @@ void Entry::parse(const Header* h, const string& s) {
 
     // info entries
     if (!tok.extract(&beg, &end))
-        throw runtime_error("Failed to extract info from vcf entry: " + s);
+        throw runtime_error(str(format("Failed to extract info from vcf entry: %1%") % s));
 
-    _info = decltype(_info)(std::string(beg, end));
+    _info.assign(beg, end);
+    setText(s.begin(), end);
 
     tok.remaining(_sampleString);
     _parsedSamples = false;
     computeStartStop();
 }
 
+void Entry::setText(char const* beg, char const* end) {
+    _text.assign(beg, end);
+    _modified.reset();
+
+    size_t n = 0;
+    for (size_t i = 0; i < _text.size(); ++i) {
+        if (_text[i] == '\t')
+            _textEnds[n++] = i;
+    }
+    _textEnds[n] = _text.size();
+}
+
+void Entry::parseIdentifiers() const {
+    _parsedIdentifiers = true;
+
+    char const* beg = _text.data() + _textEnds[POS] + 1;
+    char const* end = _text.data() + _textEnds[ID];
+    if (end-beg == 1 && *beg == '.')
+        return;
+
+    splitInto(beg, end, ';', _identifiers);
+    sort(_identifiers.begin(), _identifiers.end());
+    _identifiers.erase(unique(_identifiers.begin(), _identifiers.end()), _identifiers.end());
+}
+
 void Entry::addIdentifier(const std::string& id) {
-    _identifiers.insert(id);
+    identifiers();
+    auto i = lower_bound(_identifiers.begin(), _identifiers.end(), id);
+    if (i == _identifiers.end() || *i != id)
+        _identifiers.insert(i, id);
+    _modified.set(ID);
 }
 
 void Entry::addFilter(const std::string& filterName) {
@@ -301,15 +396,15 @@ void Entry::addFilter(const std::string& filterName) {
             ) % filterName));
     }
 
-    if (_failedFilters.find("PASS") != _failedFilters.end()) {
-        _failedFilters.erase("PASS");
-    }
+    _failedFilters.erase("PASS");
 
     _failedFilters.insert(filterName);
+    _modified.set(FILTER);
 }
 
 void Entry::clearFilters() {
     _failedFilters.clear();
+    _modified.set(FILTER);
 }
 
 string Entry::toString() const {
@@ -318,17 +413,39 @@ string Entry::toString() const {
     return ss.str();
 }
 
+std::size_t Entry::footprint() const {
+    std::size_t rv = _ref.capacity()
+        + _alt.capacity() * sizeof(std::string)
+        + _identifiers.capacity() * sizeof(std::string)
+        + _failedFilters.footprint()
+        + _info.footprint()
+        + _text.capacity()
+        + _sampleString.capacity()
+        + _sampleData.footprint();
+
+    for (auto i = _alt.begin(); i != _alt.end(); ++i)
+        rv += i->capacity();
+    for (auto i = _identifiers.begin(); i != _identifiers.end(); ++i)
+        rv += i->capacity();
+
+    return rv;
+}
+
 void Entry::swap(Entry& other) {
-    _chrom.swap(other._chrom);
+    std::swap(_chromId, other._chromId);
     std::swap(_pos, other._pos);
     std::swap(_startWithoutPadding, other._startWithoutPadding);
     std::swap(_stopWithoutPadding, other._stopWithoutPadding);
     _identifiers.swap(other._identifiers);
+    std::swap(_parsedIdentifiers, other._parsedIdentifiers);
     _ref.swap(other._ref);
     _alt.swap(other._alt);
     std::swap(_qual, other._qual);
     _failedFilters.swap(other._failedFilters);
     _info.swap(other._info);
+    _text.swap(other._text);
+    swap_ranges(_textEnds, _textEnds + FORMAT, other._textEnds);
+    std::swap(_modified, other._modified);
     _sampleData.swap(other._sampleData);
     std::swap(_header, other._header);
     std::swap(_parsedSamples, other._parsedSamples);
@@ -367,7 +484,7 @@ void Entry::setInfo(std::string const& key, CustomValue const& value) {
 
 SampleData& Entry::sampleData() {
     if (!_parsedSamples) {
-        _sampleData.parse(_header, _sampleString);
+        _sampleData.parse(_header, std::move(_sampleString));
         _parsedSamples = true;
     }
 
@@ -376,7 +493,7 @@ SampleData& Entry::sampleData() {
 
 const SampleData& Entry::sampleData() const {
     if (!_parsedSamples) {
-        _sampleData.parse(_header, _sampleString);
+        _sampleData.parse(_header, std::move(_sampleString));
         _parsedSamples = true;
     }
 
@@ -420,25 +537,76 @@ void Entry::samplesToStream(std::ostream& s) const {
     if (!_parsedSamples) {
         s << _sampleString;
     }
+    else if (!_sampleData.modified()) {
+        s << _sampleData.raw();
+    }
     else {
         s << sampleData();
     }
 }
 
 void Entry::allButSamplesToStream(std::ostream& s) const {
-    s << _chrom << '\t' << _pos << '\t'
-        << streamJoin(identifiers()).delimiter(";").emptyString(".");
+    if (_modified.none()) {
+        s.write(_text.data(), _text.size());
+        return;
+    }
 
-    s << '\t' << _ref << '\t'
-        << streamJoin(_alt).delimiter(",").emptyString(".");
+    for (int field = CHROM; field < FORMAT; ++field) {
+        if (field != CHROM)
+            s << '\t';
 
-    if (_qual <= Vcf::Entry::MISSING_QUALITY)
-        s << "\t.\t";
-    else
-        s << '\t' << _qual << '\t';
+        if (_modified[field]) {
+            fieldToStream(s, FieldName(field));
+        }
+        else {
+            uint32_t beg = field == CHROM ? 0 : _textEnds[field - 1] + 1;
+            s.write(_text.data() + beg, _textEnds[field] - beg);
+        }
+    }
+}
+
+void Entry::fieldToStream(std::ostream& s, FieldName field) const {
+    switch (field) {
+        case CHROM:
+            s << chrom();
+            break;
+
+        case POS:
+            s << _pos;
+            break;
+
+        case ID:
+            s << streamJoin(identifiers()).delimiter(";").emptyString(".");
+            break;
+
+        case REF:
+            s << _ref;
+            break;
+
+        case ALT:
+            s << streamJoin(_alt).delimiter(",").emptyString(".");
+            break;
+
+        case QUAL:
+            if (_qual <= Vcf::Entry::MISSING_QUALITY)
+                s << '.';
+            else
+                s << _qual;
+            break;
 
-    s << streamJoin(_failedFilters).delimiter(";").emptyString(".");
-    s << '\t' << _info;
+        case FILTER:
+            s << streamJoin(_failedFilters).delimiter(";").emptyString(".");
+            break;
+
+        case INFO:
+            s << _info;
+            break;
+
+        default:
+            throw runtime_error(str(format("Cannot write vcf field %1%")
+                % fieldToString(field)));
+            break;
+    }
 }
 
 void Entry::replaceAlts(uint64_t pos, std::string ref, std::vector<std::string> alt) {
@@ -447,15 +615,22 @@ void Entry::replaceAlts(uint64_t pos, std::string ref, std::vector<std::string>
     _pos = pos;
     _ref = std::move(ref);
     _alt = std::move(alt);
+    _modified.set(POS).set(REF).set(ALT);
 }
 
 void Entry::computeStartStop() {
-    // FIXME: don't copy alleles.
-    std::vector<std::string> alleles(_alt.size() + 1);
-    alleles[0] = _ref;
-    std::copy(_alt.begin(), _alt.end(), alleles.begin() + 1);
-    _startWithoutPadding = _pos - 1 + commonPrefixMulti(alleles);
-    _stopWithoutPadding = _startWithoutPadding + _ref.size() - commonSuffixMulti(alleles);
+    // the common prefix (suffix) of all alleles is the shortest common
+    // prefix (suffix) of the ref and each alt
+    uint64_t prefix = _ref.size();
+    uint64_t suffix = _ref.size();
+    for (auto i = _alt.begin(); i != _alt.end(); ++i) {
+        prefix = std::min(prefix, commonPrefix(
+            _ref.begin(), _ref.end(), i->begin(), i->end()));
+        suffix = std::min(suffix, commonPrefix(
+            _ref.rbegin(), _ref.rend(), i->rbegin(), i->rend()));
+    }
+    _startWithoutPadding = _pos - 1 + prefix;
+    _stopWithoutPadding = _startWithoutPadding + _ref.size() - suffix;
 }
 
 InfoFields::MapType const& Entry::getInfo_() const {
@@ -463,6 +638,7 @@ InfoFields::MapType const& Entry::getInfo_() const {
 }
 
 InfoFields::MapType& Entry::getInfo_() {
+    _modified.set(INFO);
     return *_info.get(*_header, _alt.size());
 }
 
@@ -483,4 +659,8 @@ void ReheaderingParser::operator()(Header const* h, std::string& line, Entry& en
     return Entry::parseLineAndReheader(h, newHeader, line, entry);
 }
 
+void ReheaderingParser::operator()(Header const* h, StringView const& line, Entry& entry) {
+    return Entry::parseLineAndReheader(h, newHeader, line, entry);
+}
+
 END_NAMESPACE(Vcf)
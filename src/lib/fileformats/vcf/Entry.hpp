@@ -1,18 +1,23 @@
 #pragma once
 
 #include "CustomValue.hpp"
+#include "FilterSet.hpp"
 #include "Header.hpp"
 #include "InfoFields.hpp"
 #include "LazyValue.hpp"
 #include "SampleData.hpp"
 #include "common/CoordinateView.hpp"
 #include "common/LocusCompare.hpp"
+#include "common/SequenceDictionary.hpp"
+#include "common/StringView.hpp"
 #include "common/Tokenizer.hpp"
 #include "common/cstdint.hpp"
 #include "common/namespaces.hpp"
 #include "fileformats/TypedStream.hpp"
 
 #include <boost/lexical_cast.hpp>
+#include <bitset>
+#include <cstddef>
 #include <map>
 #include <ostream>
 #include <string>
@@ -57,7 +62,9 @@ public:
     static const char* fieldToString(FieldName field);
     static FieldName fieldFromString(const char* name);
     static void parseLine(const Header* hdr, std::string& s, Entry& e);
+    static void parseLine(const Header* hdr, StringView const& s, Entry& e);
     static void parseLineAndReheader(const Header* hdr, const Header* newH, std::string& s, Entry& e);
+    static void parseLineAndReheader(const Header* hdr, const Header* newH, StringView const& s, Entry& e);
     static bool posLess(Entry const& a, Entry const& b);
     static bool chromEq(const std::string& chrom, Entry const& b);
 
@@ -81,20 +88,27 @@ public:
 
     const Header& header() const;
     void parse(const Header* h, const std::string& s);
+    void parse(const Header* h, StringView const& s);
     void parseAndReheader(const Header* h, const Header* newH, const std::string& s);
+    void parseAndReheader(const Header* h, const Header* newH, StringView const& s);
 
     void addIdentifier(const std::string& id);
     void addFilter(const std::string& filterName);
     void clearFilters();
 
-    const std::string& chrom() const { return _chrom; }
+    const std::string& chrom() const {
+        return SequenceDictionary::instance().name(_chromId);
+    }
+    // the id of chrom() in SequenceDictionary::instance()
+    uint32_t chromId() const { return _chromId; }
     const uint64_t& pos() const { return _pos; }
-    const std::set<std::string>& identifiers() const { return _identifiers; }
+    // sorted, without duplicates
+    const std::vector<std::string>& identifiers() const;
     const std::string& ref() const { return _ref; }
     const std::vector<std::string>& alt() const { return _alt; }
     const std::string& alt(GenotypeIndex const& idx) const;
     double qual() const { return _qual; }
-    const std::set<std::string>& failedFilters() const { return _failedFilters; }
+    const FilterSet& failedFilters() const { return _failedFilters; }
     const CustomValueMap& info() const { return getInfo_(); }
     const CustomValue* info(std::string const& key) const;
     void setInfo(std::string const& key, CustomValue const& value);
@@ -130,6 +144,8 @@ public:
     int32_t altIdx(const std::string& alt) const;
 
     std::string toString() const;
+    // approximate heap memory owned by this object, in bytes
+    std::size_t footprint() const;
     std::vector<std::string> allelesForSample(size_t sampleIdx) const;
 
     void swap(Entry& other);
@@ -143,24 +159,42 @@ public:
 private:
     InfoFields::MapType const& getInfo_() const;
     InfoFields::MapType& getInfo_();
+    void setText(char const* beg, char const* end);
+    void parseIdentifiers() const;
+    void fieldToStream(std::ostream& s, FieldName field) const;
 
 protected:
     const Header* _header;
-    std::string _chrom;
+    uint32_t _chromId;
     uint64_t _pos;
     int64_t _startWithoutPadding;
     int64_t _stopWithoutPadding;
-    std::set<std::string> _identifiers;
+    // split from the ID column of _text when first used
+    mutable std::vector<std::string> _identifiers;
+    mutable bool _parsedIdentifiers;
     std::string _ref;
     std::vector<std::string> _alt;
     double _qual;
-    std::set<std::string> _failedFilters;
+    FilterSet _failedFilters;
     LazyValue<InfoFields> _info;
-    std::string _sampleString;
+    // The CHROM to INFO columns as they were read, the offset one past the
+    // end of each, and which of them have been changed since. Unchanged
+    // columns are written back from _text.
+    std::string _text;
+    uint32_t _textEnds[FORMAT];
+    std::bitset<FORMAT> _modified;
+    // the sample columns until they are parsed, when SampleData takes them
+    mutable std::string _sampleString;
     mutable bool _parsedSamples;
     mutable SampleData _sampleData;
 };
 
+inline const std::vector<std::string>& Entry::identifiers() const {
+    if (!_parsedIdentifiers)
+        parseIdentifiers();
+    return _identifiers;
+}
+
 inline bool containsInsertions(Vcf::Entry const& v) {
     // no lambdas in gcc 4.4 :(
     for (auto i = v.alt().begin(); i != v.alt().end(); ++i) {
@@ -170,6 +204,23 @@ inline bool containsInsertions(Vcf::Entry const& v) {
     return false;
 }
 
+// Parses the sample columns of an entry and decodes the given FORMAT
+// fields. This can be given to ParallelTypedStream so that the fields a
+// command reads are decoded by the worker threads rather than when first
+// looked up.
+struct SampleFieldDecoder {
+    explicit SampleFieldDecoder(std::vector<std::string> keys)
+        : keys(std::move(keys))
+    {
+    }
+
+    void operator()(Entry& e) const {
+        e.sampleData().decode(keys);
+    }
+
+    std::vector<std::string> keys;
+};
+
 struct ReheaderingParser {
     typedef Entry ValueType;
 
@@ -177,6 +228,7 @@ struct ReheaderingParser {
 
     ReheaderingParser(Header const* newHeader);
     void operator()(Header const* h, std::string& line, Entry& entry);
+    void operator()(Header const* h, StringView const& line, Entry& entry);
 };
 
 std::ostream& operator<<(std::ostream& s, const Entry& e);
@@ -96,11 +96,11 @@ EntryMerger::EntryMerger(
         }
 
         // merge identifiers
-        const set<string>& idents = e->identifiers();
+        auto const& idents = e->identifiers();
         copy(idents.begin(), idents.end(), inserter(_identifiers, _identifiers.begin()));
 
         // Merge filters
-        const set<string>& filters = e->failedFilters();
+        auto const& filters = e->failedFilters();
         copy(filters.begin(), filters.end(), inserter(_filters, _filters.begin()));
 
         const vector<string>& samples = e->header().sampleNames();
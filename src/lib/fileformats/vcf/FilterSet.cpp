@@ -0,0 +1,203 @@
+#include "FilterSet.hpp"
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_set.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+using namespace std;
+
+BEGIN_NAMESPACE(Vcf)
+
+namespace {
+    struct ViewHash {
+        size_t operator()(StringView const& x) const {
+            return boost::hash_range(x.begin(), x.end());
+        }
+    };
+
+    struct ViewEqual {
+        bool operator()(StringView const& x, string const& y) const {
+            return x == y;
+        }
+    };
+
+    // orders as std::string does
+    int compare(string const& x, StringView const& y) {
+        size_t n = min(x.size(), y.size());
+        int rv = n ? memcmp(x.data(), y.begin(), n) : 0;
+        if (rv != 0)
+            return rv;
+        return x.size() < y.size() ? -1 : x.size() > y.size();
+    }
+
+    struct Pool {
+        mutex lock;
+        // nodes, and so the names in them, never move
+        boost::unordered_set<string> names;
+    };
+
+    Pool& pool() {
+        static Pool p;
+        return p;
+    }
+
+    // Each thread remembers the names it has seen most recently, so most
+    // lookups don't need the pool's lock.
+    size_t const RECENT_SIZE = 16;
+    thread_local string const* recent[RECENT_SIZE] = {0};
+    thread_local size_t recentNext = 0;
+}
+
+std::string const* FilterSet::intern(StringView const& name) {
+    for (size_t i = 0; i < RECENT_SIZE && recent[i]; ++i) {
+        if (name == *recent[i])
+            return recent[i];
+    }
+
+    Pool& p = pool();
+    string const* rv;
+    {
+        lock_guard<mutex> lock(p.lock);
+        auto found = p.names.find(name, ViewHash(), ViewEqual());
+        if (found == p.names.end()) {
+            if (p.names.size() >= MAX_INTERNED)
+                return 0;
+            found = p.names.emplace(name.begin(), name.end()).first;
+        }
+        rv = &*found;
+    }
+
+    recent[recentNext] = rv;
+    recentNext = (recentNext + 1) % RECENT_SIZE;
+    return rv;
+}
+
+FilterSet::FilterSet()
+    : _inline()
+    , _size(0)
+{
+}
+
+FilterSet::FilterSet(FilterSet const& other)
+    : _inline()
+    , _owned(other._owned)
+    , _size(other._size)
+{
+    if (_size <= INLINE_SIZE)
+        copy(other._inline, other._inline + _size, _inline);
+    else
+        _heap = other._heap;
+}
+
+FilterSet::FilterSet(FilterSet&& other)
+    : _inline()
+    , _heap(std::move(other._heap))
+    , _owned(std::move(other._owned))
+    , _size(other._size)
+{
+    copy(other._inline, other._inline + min<uint32_t>(_size, INLINE_SIZE), _inline);
+    other._size = 0;
+}
+
+FilterSet& FilterSet::operator=(FilterSet const& other) {
+    _size = other._size;
+    if (_size <= INLINE_SIZE)
+        copy(other._inline, other._inline + _size, _inline);
+    else
+        _heap = other._heap;
+    _owned = other._owned;
+    return *this;
+}
+
+FilterSet& FilterSet::operator=(FilterSet&& other) {
+    _size = other._size;
+    if (_size <= INLINE_SIZE)
+        copy(other._inline, other._inline + _size, _inline);
+    else
+        _heap.swap(other._heap);
+    _owned.swap(other._owned);
+    other._size = 0;
+    return *this;
+}
+
+uint32_t FilterSet::lowerBound(StringView const& name) const {
+    std::string const* const* names = data();
+    uint32_t lo = 0;
+    uint32_t hi = _size;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (compare(*names[mid], name) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+FilterSet::const_iterator FilterSet::find(StringView const& name) const {
+    uint32_t pos = lowerBound(name);
+    if (pos < _size && *data()[pos] == name)
+        return begin() + pos;
+    return end();
+}
+
+bool FilterSet::insert(StringView const& name) {
+    uint32_t pos = lowerBound(name);
+    if (pos < _size && *data()[pos] == name)
+        return false;
+
+    std::string const* interned = intern(name);
+    if (!interned) {
+        _owned.push_back(std::make_shared<string const>(name.begin(), name.end()));
+        interned = _owned.back().get();
+    }
+    if (_size < INLINE_SIZE) {
+        copy_backward(_inline + pos, _inline + _size, _inline + _size + 1);
+        _inline[pos] = interned;
+    }
+    else {
+        if (_size == INLINE_SIZE)
+            _heap.assign(_inline, _inline + _size);
+        _heap.insert(_heap.begin() + pos, interned);
+    }
+    ++_size;
+    return true;
+}
+
+bool FilterSet::erase(StringView const& name) {
+    uint32_t pos = lowerBound(name);
+    if (pos == _size || !(*data()[pos] == name))
+        return false;
+
+    if (_size <= INLINE_SIZE) {
+        copy(_inline + pos + 1, _inline + _size, _inline + pos);
+    }
+    else {
+        _heap.erase(_heap.begin() + pos);
+        if (_heap.size() == INLINE_SIZE)
+            copy(_heap.begin(), _heap.end(), _inline);
+    }
+    --_size;
+    return true;
+}
+
+void FilterSet::swap(FilterSet& other) {
+    swap_ranges(_inline, _inline + INLINE_SIZE, other._inline);
+    _heap.swap(other._heap);
+    _owned.swap(other._owned);
+    std::swap(_size, other._size);
+}
+
+std::size_t FilterSet::footprint() const {
+    std::size_t rv = _heap.capacity() * sizeof(std::string const*)
+        + _owned.capacity() * sizeof(_owned[0]);
+    for (auto i = _owned.begin(); i != _owned.end(); ++i)
+        rv += sizeof(std::string) + (*i)->capacity();
+    return rv;
+}
+
+END_NAMESPACE(Vcf)
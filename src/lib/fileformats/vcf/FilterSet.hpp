@@ -0,0 +1,165 @@
+#pragma once
+
+#include "common/StringView.hpp"
+#include "common/cstdint.hpp"
+#include "common/namespaces.hpp"
+
+#include <boost/iterator/indirect_iterator.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+BEGIN_NAMESPACE(Vcf)
+
+// The FILTER names of an entry, in the order (and with the uniqueness) of a
+// std::set<std::string>.
+//
+// Names come from a small vocabulary, so they are interned: each name is
+// stored once for the whole process and a set only holds pointers to the
+// shared copies, inline for up to INLINE_SIZE names. Copying a set or
+// adding a name to one that is already known allocates nothing. So that
+// input with unbounded FILTER names can't grow the pool forever, at most
+// MAX_INTERNED names are interned; sets hold reference counted copies of
+// any others. The names a set gives out stay at the same address for as
+// long as any copy of the set holding them exists.
+class FilterSet {
+public:
+    typedef boost::indirect_iterator<std::string const* const*> const_iterator;
+    typedef const_iterator iterator;
+    typedef std::string value_type;
+    typedef std::size_t size_type;
+
+    enum {
+        INLINE_SIZE = 4,
+        MAX_INTERNED = 1 << 16
+    };
+
+    // The shared copy of name, adding it if it is new. Returns null if name
+    // is new and MAX_INTERNED names are interned already.
+    static std::string const* intern(StringView const& name);
+
+    FilterSet();
+    FilterSet(FilterSet const& other);
+    FilterSet(FilterSet&& other);
+
+    template<typename Iter>
+    FilterSet(Iter beg, Iter end);
+
+    FilterSet& operator=(FilterSet const& other);
+    FilterSet& operator=(FilterSet&& other);
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    size_type size() const;
+    bool empty() const;
+
+    const_iterator find(StringView const& name) const;
+    const_iterator find(std::string const& name) const;
+    const_iterator find(char const* name) const;
+    size_type count(StringView const& name) const;
+    size_type count(std::string const& name) const;
+    size_type count(char const* name) const;
+
+    // false if name was already present
+    bool insert(StringView const& name);
+    bool insert(std::string const& name);
+    bool insert(char const* name);
+    // false if name was not present
+    bool erase(StringView const& name);
+    bool erase(std::string const& name);
+    bool erase(char const* name);
+    void clear();
+
+    void swap(FilterSet& other);
+
+    // approximate heap memory owned by this object, in bytes
+    std::size_t footprint() const;
+
+private:
+    std::string const* const* data() const;
+    // the position name is or would be at
+    uint32_t lowerBound(StringView const& name) const;
+
+private:
+    std::string const* _inline[INLINE_SIZE];
+    // holds every name once there are more than INLINE_SIZE
+    std::vector<std::string const*> _heap;
+    // names that weren't interned. erased names are only dropped by clear()
+    std::vector<std::shared_ptr<std::string const>> _owned;
+    uint32_t _size;
+};
+
+template<typename Iter>
+inline FilterSet::FilterSet(Iter beg, Iter end)
+    : _inline()
+    , _size(0)
+{
+    for (; beg != end; ++beg)
+        insert(*beg);
+}
+
+inline std::string const* const* FilterSet::data() const {
+    return _size <= INLINE_SIZE ? _inline : _heap.data();
+}
+
+inline FilterSet::const_iterator FilterSet::begin() const {
+    return const_iterator(data());
+}
+
+inline FilterSet::const_iterator FilterSet::end() const {
+    return const_iterator(data() + _size);
+}
+
+inline FilterSet::size_type FilterSet::size() const {
+    return _size;
+}
+
+inline bool FilterSet::empty() const {
+    return _size == 0;
+}
+
+inline FilterSet::const_iterator FilterSet::find(std::string const& name) const {
+    return find(StringView(name.data(), name.data() + name.size()));
+}
+
+inline FilterSet::const_iterator FilterSet::find(char const* name) const {
+    return find(StringView(name));
+}
+
+inline FilterSet::size_type FilterSet::count(StringView const& name) const {
+    return find(name) != end();
+}
+
+inline FilterSet::size_type FilterSet::count(std::string const& name) const {
+    return find(name) != end();
+}
+
+inline FilterSet::size_type FilterSet::count(char const* name) const {
+    return find(name) != end();
+}
+
+inline bool FilterSet::insert(std::string const& name) {
+    return insert(StringView(name.data(), name.data() + name.size()));
+}
+
+inline bool FilterSet::insert(char const* name) {
+    return insert(StringView(name));
+}
+
+inline bool FilterSet::erase(std::string const& name) {
+    return erase(StringView(name.data(), name.data() + name.size()));
+}
+
+inline bool FilterSet::erase(char const* name) {
+    return erase(StringView(name));
+}
+
+inline void FilterSet::clear() {
+    _heap.clear();
+    _owned.clear();
+    _size = 0;
+}
+
+END_NAMESPACE(Vcf)
@@ -40,6 +40,7 @@ public:
         , sampleIndices_(numStreams)
         , filterTypes_(filterTypes)
         , numStreams_(numStreams)
+        , sequence_(SequenceDictionary::EMPTY)
         , entries_(numStreams)
         , out_(outputWriter)
         , final_(false)
@@ -62,17 +63,15 @@ public:
             throw std::runtime_error("Attempted to push entry onto finalized GenotypeComparator");
         }
 
-        if (sequence_.empty()) {
-            sequence_ = e->chrom();
+        if (sequence_ == SequenceDictionary::EMPTY) {
+            sequence_ = e->chromId();
             region_.begin = e->start();
         }
         else if (!want(e)) {
             process();
             region_.begin = e->start();
             region_.end = e->stop();
-            if (sequence_ != e->chrom()) {
-                sequence_ = e->chrom();
-            }
+            sequence_ = e->chromId();
         }
 
         size_t streamIdx = e->header().sourceIndex();
@@ -90,7 +89,7 @@ public:
 private:
     bool want(Entry const* e) const {
         Region entryRegion = {e->start(), e->stop()};
-        return sequence_ == e->chrom() && region_.overlap(entryRegion) > 0;
+        return sequence_ == e->chromId() && region_.overlap(entryRegion) > 0;
     }
 
     bool shouldSkip(size_t streamIdx, bool isFiltered) const {
@@ -164,7 +163,7 @@ private:
             for (auto i = sd.begin(); i != sd.end(); ++i) {
                 auto const& rawvs = i->first;
                 auto const& who = i->second;
-                out_(sampleIdx, sequence_, rawvs, who);
+                out_(sampleIdx, SequenceDictionary::instance().name(sequence_), rawvs, who);
             }
             sd.clear();
         }
@@ -182,7 +181,8 @@ private:
     std::vector<FilterType> filterTypes_;
     size_t numStreams_;
     Region region_;
-    std::string sequence_;
+    // SequenceDictionary id
+    uint32_t sequence_;
     std::vector<EntryVector> entries_;
     OutputWriter& out_;
     bool final_;
@@ -3,6 +3,7 @@
 #include "common/compat.hpp"
 #include "common/namespaces.hpp"
 
+#include <cstddef>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -84,6 +85,12 @@ public:
         data_.reset();
     }
 
+    // Replace the value with unparsed text, reusing existing storage
+    void assign(char const* beg, char const* end) {
+        text_.assign(beg, end);
+        data_.reset();
+    }
+
     friend std::ostream& operator<<(std::ostream& os, LazyValue const& x) {
         if (x.data_) {
             os << *x.data_;
@@ -97,6 +104,12 @@ public:
         return os;
     }
 
+    // approximate heap memory owned by this object, in bytes (not counting
+    // any owned by the parsed value itself)
+    std::size_t footprint() const {
+        return text_.capacity() + (data_ ? sizeof(T) : 0);
+    }
+
     void swap(LazyValue& rhs) {
         text_.swap(rhs.text_);
         data_.swap(rhs.data_);
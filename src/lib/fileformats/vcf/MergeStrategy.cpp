@@ -69,9 +69,14 @@ MergeStrategy::MergeStrategy(
     setDefaultMerger("ignore");
 }
 
+MergeStrategy MergeStrategy::forHeader(const Header* header) const {
+    MergeStrategy rv(*this);
+    rv._header = header;
+    return rv;
+}
+
 bool MergeStrategy::canMerge(Entry const& a, Entry const& b) const {
-    int rv = strverscmp(a.chrom().c_str(), b.chrom().c_str());
-    if (rv != 0)
+    if (a.chromId() != b.chromId())
         return false;
 
     if (exactPos())
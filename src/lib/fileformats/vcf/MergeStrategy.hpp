@@ -53,6 +53,11 @@ public:
         SamplePriority samplePriority = eORDER,
         ConsensusFilter const* cnsFilt = 0);
 
+    /// Copy this strategy for merging into a different header, e.g., the
+    /// header of an intermediate file when merging in several passes.
+    /// \param header the merged vcf header for the copy
+    MergeStrategy forHeader(const Header* header) const;
+
     /// Retrieve the ValueMerger object responsible for merging the named info field.
     /// \param id names an info field
     /// \exception runtime_error if no action can be found to handle the field
@@ -0,0 +1,335 @@
+#include "SampleColumn.hpp"
+
+#include "CustomType.hpp"
+#include "common/Tokenizer.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+using namespace std;
+
+BEGIN_NAMESPACE(Vcf)
+
+namespace {
+    uint32_t const MAX_COUNT = numeric_limits<uint16_t>::max();
+    int8_t const MISSING_ALLELE = -1;
+
+    // Parses [beg, end) as a decimal integer, failing if printing the
+    // result wouldn't give back the same text (e.g., "+1", "01" or "-0").
+    bool parseCanonical(char const* beg, char const* end, int32_t& out) {
+        bool neg = beg != end && *beg == '-';
+        char const* p = beg + neg;
+        size_t digits = end - p;
+        if (digits == 0 || digits > 9 || (*p == '0' && (digits > 1 || neg)))
+            return false;
+
+        int32_t v = 0;
+        for (; p != end; ++p) {
+            if (*p < '0' || *p > '9')
+                return false;
+            v = v * 10 + (*p - '0');
+        }
+        out = neg ? -v : v;
+        return true;
+    }
+
+    // "." and "" both parse to an empty CustomValue
+    bool isEmpty(StringView const& field) {
+        return field.empty() || (field.size() == 1 && field[0] == '.');
+    }
+
+    bool isGenotypeDelim(char c) {
+        return c == '/' || c == '|';
+    }
+}
+
+int32_t const SampleColumn::MISSING = numeric_limits<int32_t>::min();
+
+SampleColumn::SampleColumn()
+    : _type(0)
+    , _storage(VALUES)
+    , _size(0)
+    , _width(0)
+{
+}
+
+SampleColumn::SampleColumn(
+        CustomType const* type,
+        std::vector<StringView> const& fields,
+        std::size_t stride,
+        std::size_t offset,
+        std::vector<int16_t> const& fieldCounts
+        )
+    : _type(type)
+    , _storage(VALUES)
+    , _size(fieldCounts.size())
+    , _width(0)
+{
+    if (type->id() == "GT" && type->type() == CustomType::STRING
+        && parseGenotypes(fields, stride, offset, fieldCounts))
+    {
+        _storage = GENOTYPE;
+        return;
+    }
+
+    if (type->type() == CustomType::INTEGER
+        && parseIntegers(fields, stride, offset, fieldCounts))
+    {
+        _storage = INTEGER;
+        return;
+    }
+
+    _width = 0;
+    vector<uint16_t>().swap(_counts);
+    vector<int8_t>().swap(_alleles);
+    vector<bool>().swap(_phased);
+    vector<int32_t>().swap(_ints);
+
+    _values.resize(_size);
+    string buf;
+    for (uint32_t i = 0; i < _size; ++i) {
+        if (fieldCounts[i] <= int16_t(offset))
+            continue;
+
+        StringView const& field = fields[i * stride + offset];
+        buf.assign(field.begin(), field.end());
+        _values[i] = CustomValue(type, buf);
+    }
+}
+
+bool SampleColumn::parseGenotypes(
+        std::vector<StringView> const& fields,
+        std::size_t stride,
+        std::size_t offset,
+        std::vector<int16_t> const& fieldCounts)
+{
+    uint32_t width = 0;
+    for (uint32_t i = 0; i < _size; ++i) {
+        if (fieldCounts[i] <= int16_t(offset))
+            continue;
+
+        StringView const& field = fields[i * stride + offset];
+        if (!isEmpty(field)) {
+            uint32_t n = 1 + count_if(field.begin(), field.end(), isGenotypeDelim);
+            width = max(width, n);
+        }
+    }
+
+    if (width > MAX_COUNT)
+        return false;
+
+    _width = width;
+    _counts.assign(_size, 0);
+    _phased.assign(_size, false);
+    _alleles.assign(size_t(_size) * width, MISSING_ALLELE);
+
+    for (uint32_t i = 0; i < _size; ++i) {
+        if (fieldCounts[i] <= int16_t(offset))
+            continue;
+
+        StringView const& field = fields[i * stride + offset];
+        if (isEmpty(field))
+            continue;
+
+        // all of the alleles must be separated by the same delimiter to be
+        // written back the same way
+        int8_t* alleles = &_alleles[size_t(i) * width];
+        char delim = 0;
+        uint32_t n = 0;
+        char const* beg = field.begin();
+        for (;;) {
+            char const* end = find_if(beg, field.end(), isGenotypeDelim);
+            int32_t value;
+            if (end - beg == 1 && *beg == '.')
+                alleles[n++] = MISSING_ALLELE;
+            else if (parseCanonical(beg, end, value) && value >= 0
+                    && value <= numeric_limits<int8_t>::max())
+                alleles[n++] = int8_t(value);
+            else
+                return false;
+
+            if (end == field.end())
+                break;
+
+            if (delim != 0 && *end != delim)
+                return false;
+            delim = *end;
+            beg = end + 1;
+        }
+
+        _counts[i] = n;
+        _phased[i] = delim == '|';
+    }
+
+    return true;
+}
+
+bool SampleColumn::parseIntegers(
+        std::vector<StringView> const& fields,
+        std::size_t stride,
+        std::size_t offset,
+        std::vector<int16_t> const& fieldCounts)
+{
+    uint32_t width = 0;
+    for (uint32_t i = 0; i < _size; ++i) {
+        if (fieldCounts[i] <= int16_t(offset))
+            continue;
+
+        StringView const& field = fields[i * stride + offset];
+        if (!isEmpty(field)) {
+            uint32_t n = 1 + std::count(field.begin(), field.end(), ',');
+            width = max(width, n);
+        }
+    }
+
+    if (width > MAX_COUNT)
+        return false;
+
+    _width = width;
+    _counts.assign(_size, 0);
+    _ints.assign(size_t(_size) * width, MISSING);
+
+    for (uint32_t i = 0; i < _size; ++i) {
+        if (fieldCounts[i] <= int16_t(offset))
+            continue;
+
+        StringView const& field = fields[i * stride + offset];
+        if (isEmpty(field))
+            continue;
+
+        int32_t* values = &_ints[size_t(i) * width];
+        uint32_t n = 0;
+        char const* beg = field.begin();
+        for (;;) {
+            char const* end = find(beg, field.end(), ',');
+            if (end - beg == 1 && *beg == '.')
+                values[n++] = MISSING;
+            else if (!parseCanonical(beg, end, values[n++]))
+                return false;
+
+            if (end == field.end())
+                break;
+            beg = end + 1;
+        }
+
+        // as CustomValue does, reject more values than the type allows
+        _type->validateIndex(n - 1);
+        _counts[i] = n;
+    }
+
+    return true;
+}
+
+CustomValue const& SampleColumn::value(uint32_t sampleIdx) const {
+    if (_storage != VALUES && _values.empty())
+        buildValues();
+
+    return _values[sampleIdx];
+}
+
+CustomValue SampleColumn::release(uint32_t sampleIdx) {
+    if (_storage != VALUES && _values.empty())
+        buildValues();
+
+    return std::move(_values[sampleIdx]);
+}
+
+void SampleColumn::buildValues() const {
+    _values.resize(_size);
+    string gt;
+    for (uint32_t i = 0; i < _size; ++i) {
+        uint32_t n = _counts[i];
+        if (n == 0) {
+            _values[i] = CustomValue(_type);
+            continue;
+        }
+
+        vector<CustomValue::ValueType> values;
+        if (_storage == GENOTYPE) {
+            genotypeString(i, gt);
+            values.push_back(gt);
+        }
+        else {
+            values.resize(n);
+            for (uint32_t j = 0; j < n; ++j) {
+                int32_t v = integer(i, j);
+                if (v != MISSING)
+                    values[j] = int64_t(v);
+            }
+        }
+        _values[i] = CustomValue(_type, std::move(values));
+    }
+}
+
+void SampleColumn::toStream(std::ostream& s, uint32_t sampleIdx) const {
+    if (_storage == VALUES) {
+        s << _values[sampleIdx];
+        return;
+    }
+
+    uint32_t n = _counts[sampleIdx];
+    if (n == 0) {
+        s << '.';
+        return;
+    }
+
+    if (_storage == GENOTYPE) {
+        char delim = _phased[sampleIdx] ? '|' : '/';
+        for (uint32_t i = 0; i < n; ++i) {
+            if (i > 0)
+                s << delim;
+            int32_t a = allele(sampleIdx, i);
+            if (a == MISSING)
+                s << '.';
+            else
+                s << a;
+        }
+    }
+    else {
+        for (uint32_t i = 0; i < n; ++i) {
+            if (i > 0)
+                s << ',';
+            int32_t v = integer(sampleIdx, i);
+            if (v == MISSING)
+                s << '.';
+            else
+                s << v;
+        }
+    }
+}
+
+void SampleColumn::genotypeString(uint32_t sampleIdx, std::string& out) const {
+    out.clear();
+    char delim = _phased[sampleIdx] ? '|' : '/';
+    for (uint32_t i = 0; i < _counts[sampleIdx]; ++i) {
+        if (i > 0)
+            out += delim;
+
+        int32_t a = allele(sampleIdx, i);
+        if (a == MISSING) {
+            out += '.';
+        }
+        else {
+            if (a >= 100)
+                out += char('0' + a / 100);
+            if (a >= 10)
+                out += char('0' + a / 10 % 10);
+            out += char('0' + a % 10);
+        }
+    }
+}
+
+std::size_t SampleColumn::footprint() const {
+    std::size_t rv = _counts.capacity() * sizeof(uint16_t)
+        + _alleles.capacity()
+        + _phased.capacity() / 8
+        + _ints.capacity() * sizeof(int32_t)
+        + _values.capacity() * sizeof(CustomValue);
+
+    for (auto i = _values.begin(); i != _values.end(); ++i)
+        rv += i->footprint();
+    return rv;
+}
+
+END_NAMESPACE(Vcf)
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "CustomValue.hpp"
+#include "common/StringView.hpp"
+#include "common/cstdint.hpp"
+#include "common/namespaces.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+BEGIN_NAMESPACE(Vcf)
+
+class CustomType;
+
+// The values of one FORMAT field for every sample of an entry, parsed
+// straight from the sample text.
+//
+// GT is stored as int8 allele indices (ploidy per sample, padded to the
+// greatest ploidy) and a phase flag per sample, and Integer fields as int32
+// values (padded to the greatest number of values) with a sentinel for '.'.
+// Anything else, or any field whose text would not be written back exactly
+// from those arrays (e.g., "007" or mixed phasing), is stored as one
+// CustomValue per sample. CustomValues for the packed fields are only built
+// if value() is called.
+class SampleColumn {
+public:
+    enum Storage {
+        GENOTYPE,
+        INTEGER,
+        VALUES
+    };
+
+    // the value of integer() or allele() for '.'
+    static int32_t const MISSING;
+
+    SampleColumn();
+
+    // fields[i * stride + offset] is the text for sample i if
+    // fieldCounts[i] > offset, otherwise sample i has no value.
+    SampleColumn(
+        CustomType const* type,
+        std::vector<StringView> const& fields,
+        std::size_t stride,
+        std::size_t offset,
+        std::vector<int16_t> const& fieldCounts
+        );
+
+    // true for default constructed columns
+    bool empty() const;
+    CustomType const& type() const;
+    Storage storage() const;
+
+    // the number of alleles (GENOTYPE) or values (INTEGER) of a sample
+    uint32_t count(uint32_t sampleIdx) const;
+    int32_t integer(uint32_t sampleIdx, uint32_t idx) const;
+    int32_t allele(uint32_t sampleIdx, uint32_t idx) const;
+    bool phased(uint32_t sampleIdx) const;
+
+    // only valid for samples that have a value
+    CustomValue const& value(uint32_t sampleIdx) const;
+    // moves the value out, leaving the column's copy empty
+    CustomValue release(uint32_t sampleIdx);
+
+    void toStream(std::ostream& s, uint32_t sampleIdx) const;
+    // sets out to the GT text of a sample (GENOTYPE only)
+    void genotypeString(uint32_t sampleIdx, std::string& out) const;
+
+    // approximate heap memory owned by this object, in bytes
+    std::size_t footprint() const;
+
+protected:
+    bool parseGenotypes(std::vector<StringView> const& fields,
+        std::size_t stride, std::size_t offset,
+        std::vector<int16_t> const& fieldCounts);
+
+    bool parseIntegers(std::vector<StringView> const& fields,
+        std::size_t stride, std::size_t offset,
+        std::vector<int16_t> const& fieldCounts);
+
+    void buildValues() const;
+
+protected:
+    CustomType const* _type;
+    Storage _storage;
+    uint32_t _size;
+    // values per sample in _alleles/_ints
+    uint32_t _width;
+    std::vector<uint16_t> _counts;
+    std::vector<int8_t> _alleles;
+    std::vector<bool> _phased;
+    std::vector<int32_t> _ints;
+    // for VALUES, or built on demand from the packed values
+    mutable std::vector<CustomValue> _values;
+};
+
+inline bool SampleColumn::empty() const {
+    return _type == 0;
+}
+
+inline CustomType const& SampleColumn::type() const {
+    return *_type;
+}
+
+inline SampleColumn::Storage SampleColumn::storage() const {
+    return _storage;
+}
+
+inline uint32_t SampleColumn::count(uint32_t sampleIdx) const {
+    return _counts[sampleIdx];
+}
+
+inline int32_t SampleColumn::integer(uint32_t sampleIdx, uint32_t idx) const {
+    return _ints[sampleIdx * _width + idx];
+}
+
+inline int32_t SampleColumn::allele(uint32_t sampleIdx, uint32_t idx) const {
+    int8_t a = _alleles[sampleIdx * _width + idx];
+    return a < 0 ? MISSING : a;
+}
+
+inline bool SampleColumn::phased(uint32_t sampleIdx) const {
+    return _phased[sampleIdx];
+}
+
+END_NAMESPACE(Vcf)
@@ -28,6 +28,10 @@ namespace {
     bool customTypeIdMatches(string const& id, CustomType const* type) {
         return type && type->id() == id;
     }
+
+    // one field of every sample, reused from column to column
+    thread_local vector<StringView> sampleFields;
+    thread_local vector<int16_t> sampleFieldCounts;
 }
 
 SampleData& SampleData::operator=(SampleData const& other) {
@@ -37,6 +41,12 @@ SampleData& SampleData::operator=(SampleData const& other) {
     // deep copy values
     for (auto i = other._values.begin(); i != other._values.end(); ++i)
         _values.insert(_values.end(), make_pair(i->first, new ValueVector(*i->second)));
+    _columnar = other._columnar;
+    _raw = other._raw;
+    _spans = other._spans;
+    _columns = other._columns;
+    _fieldCounts = other._fieldCounts;
+    _modified = other._modified;
     return *this;
 }
 
@@ -44,16 +54,27 @@ SampleData& SampleData::operator=(SampleData&& other) {
     std::swap(_header, other._header);
     _format.swap(other._format);
     _values.swap(other._values);
+    std::swap(_columnar, other._columnar);
+    _raw.swap(other._raw);
+    _spans.swap(other._spans);
+    _columns.swap(other._columns);
+    _fieldCounts.swap(other._fieldCounts);
+    std::swap(_modified, other._modified);
     return *this;
 }
 
 
 SampleData::SampleData()
     : _header(0)
+    , _columnar(false)
+    , _modified(true)
 {
 }
 
-SampleData::SampleData(SampleData const& other) {
+SampleData::SampleData(SampleData const& other)
+    : _columnar(false)
+    , _modified(true)
+{
     *this = other;
 }
 
@@ -61,10 +82,20 @@ SampleData::SampleData(SampleData&& other)
     : _header(other._header)
     , _format(std::move(other._format))
     , _values(std::move(other._values))
+    , _raw(std::move(other._raw))
+    , _columnar(other._columnar)
+    , _spans(std::move(other._spans))
+    , _columns(std::move(other._columns))
+    , _fieldCounts(std::move(other._fieldCounts))
+    , _modified(other._modified)
 {
 }
 
-SampleData::SampleData(Header const* h, std::string const& raw) {
+SampleData::SampleData(Header const* h, std::string const& raw)
+    : _header(0)
+    , _columnar(false)
+    , _modified(true)
+{
     try {
         parse(h, raw);
     } catch (...) {
@@ -74,9 +105,14 @@ SampleData::SampleData(Header const* h, std::string const& raw) {
 }
 
 void SampleData::parse(Header const* h, std::string const& raw) {
+    parse(h, std::string(raw));
+}
+
+void SampleData::parse(Header const* h, std::string&& raw) {
     _header = h;
+    _raw = std::move(raw);
 
-    Tokenizer<char> tok(raw, '\t');
+    Tokenizer<char> tok(_raw, '\t');
     char const* beg(0);
     char const* end(0);
 
@@ -93,6 +129,85 @@ void SampleData::parse(Header const* h, std::string const& raw) {
         }
     }
 
+    // mirrored columns share their values, which only the per-sample
+    // representation can do
+    uint32_t sampleCount = _header->mirroredSamples().empty()
+        ? parseColumns(tok)
+        : parseRows(tok);
+
+    if (sampleCount > _header->sampleNames().size()) {
+        throw runtime_error(str(boost::format(
+            "More samples than described in VCF header (%1% vs %2%)."
+            ) %sampleCount %_header->sampleNames().size()));
+    }
+
+    _modified = false;
+}
+
+uint32_t SampleData::parseColumns(Tokenizer<char>& tok) {
+    size_t nFormat = _format.size();
+    char const* base = _raw.data();
+    _spans.clear();
+    _fieldCounts.clear();
+
+    char const* beg(0);
+    char const* end(0);
+    while (tok.extract(&beg, &end)) {
+        // allow trailing tabs because our data has some :/
+        if (tok.eof() && end-beg == 0)
+            break;
+
+        size_t first = _fieldCounts.size() * nFormat;
+        _spans.resize(first + nFormat);
+        if (end-beg == 1 && *beg == '.') {
+            _fieldCounts.push_back(-1);
+            continue;
+        }
+
+        Span* row = _spans.data() + first;
+        Tokenizer<char> t(beg, end, ':');
+        char const* fieldBeg(0);
+        char const* fieldEnd(0);
+        size_t n = 0;
+        while (t.extract(&fieldBeg, &fieldEnd)) {
+            if (n == nFormat)
+                throw runtime_error("More per-sample values than described in format section");
+            row[n++] = Span(fieldBeg - base, fieldEnd - base);
+        }
+        _fieldCounts.push_back(int16_t(n));
+    }
+
+    // the fields are only decoded when first asked for, see decoded()
+    _columns.assign(nFormat, SampleColumn());
+    _columnar = true;
+    return _fieldCounts.size();
+}
+
+SampleColumn const& SampleData::decoded(int offset) const {
+    SampleColumn& column = _columns[offset];
+    if (!column.empty())
+        return column;
+
+    size_t nFormat = _format.size();
+    vector<StringView>& fields = sampleFields;
+    vector<int16_t>& counts = sampleFieldCounts;
+    fields.resize(_fieldCounts.size());
+    counts.resize(_fieldCounts.size());
+    for (size_t i = 0; i < _fieldCounts.size(); ++i) {
+        counts[i] = _fieldCounts[i] > offset ? 1 : 0;
+        if (counts[i]) {
+            Span const& span = _spans[i * nFormat + offset];
+            fields[i] = StringView(_raw.data() + span.first, _raw.data() + span.second);
+        }
+    }
+
+    column = SampleColumn(_format[offset], fields, 1, 0, counts);
+    return column;
+}
+
+uint32_t SampleData::parseRows(Tokenizer<char>& tok) {
+    char const* beg(0);
+    char const* end(0);
     uint32_t sampleIdx(0);
     while (tok.extract(&beg, &end)) {
         vector<string> data;
@@ -130,16 +245,13 @@ void SampleData::parse(Header const* h, std::string const& raw) {
         }
     }
 
-
-    if (sampleIdx > _header->sampleNames().size()) {
-        throw runtime_error(str(boost::format(
-            "More samples than described in VCF header (%1% vs %2%)."
-            ) %sampleIdx %_header->sampleNames().size()));
-    }
+    return sampleIdx;
 }
 
 SampleData::SampleData(Header const* h, FormatType&& fmt, MapType&& values)
     : _header(h)
+    , _columnar(false)
+    , _modified(true)
 {
     _format.swap(fmt);
     _values.swap(values);
@@ -174,6 +286,7 @@ void SampleData::reheader(Header const* newHeader) {
     if (!newHeader)
         throw runtime_error("Attempted to reheader Vcf SampleData with null header!");
 
+    materialize();
     MapType newData;
     for (auto i = _values.begin(); i != _values.end(); ++i) {
         const string& sampleName = header().sampleNames()[i->first];
@@ -183,18 +296,77 @@ void SampleData::reheader(Header const* newHeader) {
 
     _header = newHeader;
     _values.swap(newData);
+    _modified = true;
 }
 
 void SampleData::clear() {
     _header = 0;
     _format.clear();
     freeValues();
+    _columnar = false;
+    _raw.clear();
+    _spans.clear();
+    _columns.clear();
+    _fieldCounts.clear();
+    _modified = true;
 }
 
 void SampleData::swap(SampleData& other) {
     std::swap(_header, other._header);
     _format.swap(other._format);
     _values.swap(other._values);
+    std::swap(_columnar, other._columnar);
+    _raw.swap(other._raw);
+    _spans.swap(other._spans);
+    _columns.swap(other._columns);
+    _fieldCounts.swap(other._fieldCounts);
+    std::swap(_modified, other._modified);
+}
+
+void SampleData::materialize() const {
+    if (!_columnar)
+        return;
+
+    for (size_t j = 0; j < _columns.size(); ++j)
+        decoded(j);
+
+    for (uint32_t i = 0; i < _fieldCounts.size(); ++i) {
+        if (_fieldCounts[i] < 0)
+            continue;
+
+        std::unique_ptr<ValueVector> values(new ValueVector(_fieldCounts[i]));
+        for (int16_t j = 0; j < _fieldCounts[i]; ++j)
+            (*values)[j] = _columns[j].release(i);
+        _values.insert(_values.end(), make_pair(i, values.release()));
+    }
+
+    // _raw is kept for raw()
+    _columnar = false;
+    vector<Span>().swap(_spans);
+    vector<SampleColumn>().swap(_columns);
+    vector<int16_t>().swap(_fieldCounts);
+}
+
+bool SampleData::hasField(uint32_t sampleIdx, int offset) const {
+    return sampleIdx < _fieldCounts.size() && _fieldCounts[sampleIdx] > offset;
+}
+
+template<typename Func>
+void SampleData::forEachValue(int offset, Func f) const {
+    if (_columnar) {
+        for (uint32_t i = 0; i < _fieldCounts.size(); ++i) {
+            if (_fieldCounts[i] >= 0)
+                f(i, hasField(i, offset) ? &decoded(offset).value(i) : 0);
+        }
+        return;
+    }
+
+    for (auto i = _values.begin(); i != _values.end(); ++i) {
+        if (i->second == 0)
+            continue;
+        auto const& values = *i->second;
+        f(i->first, values.size() > size_t(offset) ? &values[offset] : 0);
+    }
 }
 
 void SampleData::setSampleField(uint32_t sampleIdx, Vcf::CustomValue&& value) {
@@ -204,6 +376,7 @@ void SampleData::setSampleField(uint32_t sampleIdx, Vcf::CustomValue&& value) {
             ) % value.type().id() % sampleIdx));
     }
 
+    materialize();
     int ftIdx = appendFormatFieldIfNotExists(value.type().id());
 
     ValueVector*& values = _values[sampleIdx];
@@ -215,10 +388,12 @@ void SampleData::setSampleField(uint32_t sampleIdx, Vcf::CustomValue&& value) {
     }
 
     (*values)[ftIdx] = std::move(value);
+    _modified = true;
 }
 
 
 void SampleData::addFilter(uint32_t sampleIdx, std::string const& filterName) {
+    materialize();
     auto sampleIter = _values.find(sampleIdx);
     if (sampleIter == _values.end() || sampleIter->second == 0) {
         cerr << "Warning: attempted to filter nonexistant sample\n";
@@ -258,12 +433,21 @@ void SampleData::addFilter(uint32_t sampleIdx, std::string const& filterName) {
     stringstream ss;
     ss << streamJoin(filters).delimiter(";").emptyString(".");
     values[ftIdx] = CustomValue(FT, ss.str());
+    _modified = true;
 }
 
 SampleData::FormatType const& SampleData::format() const {
     return _format;
 }
 
+bool SampleData::modified() const {
+    return _modified;
+}
+
+std::string const& SampleData::raw() const {
+    return _raw;
+}
+
 int SampleData::formatKeyIndex(std::string const& key) const {
     auto i = find_if(_format.begin(), _format.end(),
             boost::bind(&customTypeIdMatches, key, _1));
@@ -272,7 +456,25 @@ int SampleData::formatKeyIndex(std::string const& key) const {
     return distance(_format.begin(), i);
 }
 
+void SampleData::decode(std::vector<std::string> const& keys) const {
+    if (!_columnar)
+        return;
+
+    for (auto i = keys.begin(); i != keys.end(); ++i) {
+        int offset = formatKeyIndex(*i);
+        if (offset != -1)
+            decoded(offset);
+    }
+}
+
 CustomValue const* SampleData::get(uint32_t sampleIdx, std::string const& key) const {
+    if (_columnar) {
+        int offset = formatKeyIndex(key);
+        if (offset == -1 || !hasField(sampleIdx, offset))
+            return 0;
+        return &decoded(offset).value(sampleIdx);
+    }
+
     ValueVector const* values = get(sampleIdx);
 
     // no data for that sample
@@ -291,6 +493,7 @@ CustomValue const* SampleData::get(uint32_t sampleIdx, std::string const& key) c
 }
 
 SampleData::ValueVector const* SampleData::get(uint32_t sampleIdx) const {
+    materialize();
     auto iter = _values.find(sampleIdx);
     if (iter == _values.end())
         return 0;
@@ -299,18 +502,25 @@ SampleData::ValueVector const* SampleData::get(uint32_t sampleIdx) const {
 }
 
 SampleData::const_iterator SampleData::begin() const {
+    materialize();
     return _values.begin();
 }
 
 SampleData::const_iterator SampleData::end() const {
+    materialize();
     return _values.end();
 }
 
 SampleData::MapType::size_type SampleData::size() const {
+    if (_columnar)
+        return count_if(_fieldCounts.begin(), _fieldCounts.end(),
+            [](int16_t n) { return n >= 0; });
     return _values.size();
 }
 
 SampleData::MapType::size_type SampleData::count(uint32_t idx) const {
+    if (_columnar)
+        return idx < _fieldCounts.size() && _fieldCounts[idx] >= 0;
     return _values.count(idx);
 }
 
@@ -319,19 +529,40 @@ bool SampleData::hasGenotypeData() const {
 }
 
 GenotypeCall const& SampleData::genotype(uint32_t sampleIdx) const {
+    int gtIdx;
+    if (_columnar && (gtIdx = formatKeyIndex("GT")) != -1
+        && decoded(gtIdx).storage() == SampleColumn::GENOTYPE)
+    {
+        SampleColumn const& gt = _columns[gtIdx];
+        if (!hasField(sampleIdx, gtIdx) || gt.count(sampleIdx) == 0)
+            return GenotypeCall::Null;
+
+        gt.genotypeString(sampleIdx, _gtString);
+        return cachedGenotype(_gtString);
+    }
+
     const string* gtString(0);
     const CustomValue* v = get(sampleIdx, "GT");
     if (!v || v->empty() || (gtString = v->get<string>(0)) == 0 || gtString->empty())
         return GenotypeCall::Null;
 
-    auto inserted = _gtCache.insert(make_pair(*gtString, GenotypeCall()));
-    // if it wasn't already in the cache
-    if (inserted.second)
-        inserted.first->second = GenotypeCall(*gtString);
-    return inserted.first->second;
+    return cachedGenotype(*gtString);
+}
+
+GenotypeCall const& SampleData::cachedGenotype(std::string const& gt) const {
+    // look up before inserting so that hits don't copy gt
+    auto found = _gtCache.find(gt);
+    if (found != _gtCache.end())
+        return found->second;
+
+    return _gtCache.insert(make_pair(gt, GenotypeCall(gt))).first->second;
 }
 
 uint32_t SampleData::samplesWithData() const {
+    if (_columnar)
+        return count_if(_fieldCounts.begin(), _fieldCounts.end(),
+            [](int16_t n) { return n > 0; });
+
     uint32_t rv(0);
     for (auto i = _values.begin(); i != _values.end(); ++i)
         if (!i->second->empty())
@@ -384,19 +615,16 @@ int32_t SampleData::samplesFailedFilter() const {
 
     uint32_t offset = distance(_format.begin(), i);
     uint32_t numFailedFilter = 0;
-    for (auto i = _values.begin(); i != _values.end(); ++i) {
-        if (i->second == 0)
-            continue;
-        auto const& values = *i->second;
-        if (values.size() > offset) {
+    forEachValue(offset, [&numFailedFilter](uint32_t, CustomValue const* value) {
+        if (value) {
             //then we have some data
             const std::string *filter;
             //if it has a value (assume . is processed correctly) and we're able to get a value and it is not pass then failed
-            if (!values[offset].empty() && (filter = values[offset].get<std::string>(0)) != 0 && *filter != std::string("PASS")) {
+            if (!value->empty() && (filter = value->get<std::string>(0)) != 0 && *filter != std::string("PASS")) {
                numFailedFilter++;
             }
         }
-    }
+    });
     return numFailedFilter;
 }
 
@@ -409,26 +637,25 @@ int32_t SampleData::samplesEvaluatedByFilter() const {
 
     uint32_t offset = distance(_format.begin(), i);
     uint32_t numEvaluatedByFilter = 0;
-    for (auto i = _values.begin(); i != _values.end(); ++i) {
-        if (i->second == 0)
-            continue;
-        auto const& values = *i->second;
-        if (values.size() > offset) {
+    forEachValue(offset, [&numEvaluatedByFilter](uint32_t, CustomValue const* value) {
+        if (value) {
             //then we have some data
             //if it has a value (assume . is processed correctly) and we're able to get a value and it is not pass then failed
-            if (!values[offset].empty() && values[offset].get<std::string>(0) != 0) {
+            if (!value->empty() && value->get<std::string>(0) != 0) {
                numEvaluatedByFilter++;
             }
         }
-    }
+    });
     return numEvaluatedByFilter;
 }
 
 void SampleData::renumberGT(std::map<size_t, size_t> const& altMap) {
+    materialize();
     int gtIdx = formatKeyIndex("GT");
     if (gtIdx == -1)
         return;
 
+    _modified = true;
     for (auto iter = _values.begin(); iter != _values.end(); ++iter) {
         ValueVector& vals = *iter->second;
         if (vals.size() <= size_t(gtIdx))
@@ -469,13 +696,41 @@ void SampleData::removeLowDepthGenotypes(uint32_t lowDepth) {
         return;
 
     uint32_t offset = distance(_format.begin(), i);
+    if (_columnar) {
+        SampleColumn const& dp = decoded(offset);
+        for (uint32_t i = 0; i < _fieldCounts.size(); ++i) {
+            if (_fieldCounts[i] <= 0)
+                continue;
+
+            bool keep;
+            if (!hasField(i, offset) || dp.count(i) == 0)
+                keep = false;
+            else if (dp.storage() == SampleColumn::INTEGER) {
+                int32_t depth = dp.integer(i, 0);
+                keep = depth != SampleColumn::MISSING && int64_t(depth) >= lowDepth;
+            }
+            else {
+                const int64_t* v = dp.value(i).get<int64_t>(0);
+                keep = v && *v >= lowDepth;
+            }
+
+            if (!keep) {
+                _fieldCounts[i] = 0;
+                _modified = true;
+            }
+        }
+        return;
+    }
+
     for (auto i = _values.begin(); i != _values.end(); ++i) {
         if (i->second == 0)
             continue;
         auto& values = *i->second;
         const int64_t *v;
-        if (values[offset].empty() || (v = values[offset].get<int64_t>(0)) == 0 || *v < lowDepth)
+        if (values[offset].empty() || (v = values[offset].get<int64_t>(0)) == 0 || *v < lowDepth) {
             values.clear();
+            _modified = true;
+        }
     }
 }
 
@@ -488,6 +743,31 @@ void SampleData::removeFilteredWhitelist(std::set<std::string> const& whitelist)
         return;
 
     uint32_t offset = distance(_format.begin(), i);
+    auto failsWhitelist = [&whitelist](CustomValue const& ft) {
+        for (size_t filtIdx = 0; filtIdx < ft.size(); ++filtIdx) {
+            std::string const* filterName = ft.get<std::string>(filtIdx);
+            if (filterName && *filterName != "PASS" && *filterName != "." &&
+                whitelist.count(*filterName) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    if (_columnar) {
+        for (uint32_t i = 0; i < _fieldCounts.size(); ++i) {
+            if (!hasField(i, offset))
+                continue;
+
+            CustomValue const& ft = decoded(offset).value(i);
+            if (!ft.empty() && failsWhitelist(ft)) {
+                _fieldCounts[i] = 0;
+                _modified = true;
+            }
+        }
+        return;
+    }
 
     for (auto i = _values.begin(); i != _values.end(); ++i) {
         if (i->second == 0)
@@ -498,18 +778,42 @@ void SampleData::removeFilteredWhitelist(std::set<std::string> const& whitelist)
             continue; // no filter here
         }
 
-        for (size_t filtIdx = 0; filtIdx < values[offset].size(); ++filtIdx) {
-            std::string const* filterName = values[offset].get<std::string>(filtIdx);
-            if (filterName && *filterName != "PASS" && *filterName != "." &&
-                whitelist.count(*filterName) == 0)
-            {
-                values.clear();
-            }
+        if (failsWhitelist(values[offset])) {
+            values.clear();
+            _modified = true;
+        }
+    }
+}
+
+void SampleData::writeSample(std::ostream& s, uint32_t sampleIdx, bool emptyDot) const {
+    int16_t n = _fieldCounts[sampleIdx];
+    if (n == 0 && emptyDot)
+        s << '.';
+
+    for (int16_t i = 0; i < n; ++i) {
+        if (i > 0)
+            s << ':';
+
+        // fields that were never decoded are written back as they were read
+        if (_columns[i].empty()) {
+            Span const& span = _spans[size_t(sampleIdx) * _format.size() + i];
+            s.write(_raw.data() + span.first, span.second - span.first);
+        }
+        else {
+            _columns[i].toStream(s, sampleIdx);
         }
     }
 }
 
 void SampleData::sampleToStream(std::ostream& s, size_t sampleIdx) const {
+    if (_columnar) {
+        if (count(sampleIdx))
+            writeSample(s, sampleIdx, false);
+        else
+            s << ".";
+        return;
+    }
+
     auto data = get(sampleIdx);
     if (!data) {
         s << ".";
@@ -533,9 +837,31 @@ int SampleData::appendFormatField(std::string const& key) {
         throw runtime_error(str(boost::format("Unknown id in FORMAT field: %1%") % key));
     }
     _format.push_back(type);
+    _modified = true;
     return _format.size() - 1;
 }
 
+std::size_t SampleData::footprint() const {
+    // map nodes hold a key and a pointer plus the tree links
+    std::size_t rv = _format.capacity() * sizeof(CustomType const*)
+        + _values.size() * (sizeof(MapType::value_type) + 4 * sizeof(void*))
+        + _raw.capacity()
+        + _spans.capacity() * sizeof(Span)
+        + _columns.capacity() * sizeof(SampleColumn)
+        + _fieldCounts.capacity() * sizeof(int16_t);
+
+    for (auto i = _columns.begin(); i != _columns.end(); ++i)
+        rv += i->footprint();
+
+    for (auto i = _values.begin(); i != _values.end(); ++i) {
+        ValueVector const& values = *i->second;
+        rv += sizeof(ValueVector) + values.capacity() * sizeof(CustomValue);
+        for (auto j = values.begin(); j != values.end(); ++j)
+            rv += j->footprint();
+    }
+    return rv;
+}
+
 void SampleData::formatToStream(std::ostream& s) const {
     auto const& fmt = format();
     if (!fmt.empty()) {
@@ -549,11 +875,22 @@ void SampleData::formatToStream(std::ostream& s) const {
     }
 }
 
-std::ostream& operator<<(std::ostream& s, SampleData const& sampleData) {
+void SampleData::toStream(std::ostream& s) const {
+    formatToStream(s);
+    uint32_t nSamples = header().sampleCount();
+    if (_columnar) {
+        for (uint32_t i = 0; i < nSamples; ++i) {
+            s << '\t';
+            if (count(i))
+                writeSample(s, i, true);
+            else
+                s << '.';
+        }
+        return;
+    }
+
     uint32_t sampleCounter(0);
-    sampleData.formatToStream(s);
-    uint32_t nSamples = sampleData.header().sampleCount();
-    for (auto i = sampleData.begin(); i != sampleData.end(); ++i) {
+    for (auto i = _values.begin(); i != _values.end(); ++i) {
         s << '\t';
         while (sampleCounter < i->first) {
             s << ".\t";
@@ -570,8 +907,10 @@ std::ostream& operator<<(std::ostream& s, SampleData const& sampleData) {
     while (sampleCounter++ < nSamples) {
         s << "\t.";
     }
+}
 
-
+std::ostream& operator<<(std::ostream& s, SampleData const& sampleData) {
+    sampleData.toStream(s);
     return s;
 }
 
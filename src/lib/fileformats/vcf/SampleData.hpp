@@ -1,22 +1,38 @@
 #pragma once
 
 #include "GenotypeCall.hpp"
+#include "SampleColumn.hpp"
 #include "common/namespaces.hpp"
 #include "common/cstdint.hpp"
 
 #include <boost/unordered_map.hpp>
 
+#include <cstddef>
 #include <map>
 #include <ostream>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
+template<typename DelimType>
+class Tokenizer;
+
 BEGIN_NAMESPACE(Vcf)
 
 class CustomType;
 class CustomValue;
 class Header;
 
+// The per-sample (FORMAT) fields of a VCF entry.
+//
+// parse() only finds where each sample's fields are. A FORMAT field is
+// decoded, for every sample at once, into a SampleColumn the first time it
+// is looked up; fields that never are get written back as they were read.
+// Lookups by sample and key, genotypes, depth and FT filtering and output
+// all work on the columns; the per-sample ValueVectors are only built (once,
+// replacing the columns) when something asks for them (begin(),
+// get(sampleIdx)) or modifies a sample.
 class SampleData {
 public:
     typedef std::vector<CustomValue> ValueVector;
@@ -49,6 +65,9 @@ public:
     MapType::size_type count(uint32_t idx) const;
     int formatKeyIndex(std::string const& key) const;
 
+    // decodes the given FORMAT fields now rather than when first looked up
+    void decode(std::vector<std::string> const& keys) const;
+
     CustomValue const* get(uint32_t sampleIdx, std::string const& key) const;
     std::vector<CustomValue> const* get(uint32_t sampleIdx) const;
 
@@ -68,10 +87,23 @@ public:
 
     void renumberGT(std::map<size_t, size_t> const& altMap);
 
+    // false if nothing has changed since parse(), i.e., writing the text
+    // that was parsed would give the same result
+    bool modified() const;
+    // the text given to parse(); only meaningful while !modified()
+    std::string const& raw() const;
+
+    // approximate heap memory owned by this object, in bytes
+    std::size_t footprint() const;
+
     void formatToStream(std::ostream& s) const;
     void sampleToStream(std::ostream& s, size_t sampleIdx) const;
+    // FORMAT and every sample column
+    void toStream(std::ostream& s) const;
 
     void parse(Header const* h, std::string const& raw);
+    // like parse(h, raw), but takes raw's text rather than copying it
+    void parse(Header const* h, std::string&& raw);
 
     int appendFormatFieldIfNotExists(std::string const& key);
 
@@ -79,11 +111,44 @@ protected:
     int appendFormatField(std::string const& key);
     void freeValues();
 
+    uint32_t parseRows(Tokenizer<char>& tok);
+    uint32_t parseColumns(Tokenizer<char>& tok);
+    // decodes FORMAT field offset for every sample, if it hasn't been
+    SampleColumn const& decoded(int offset) const;
+    // replaces the columns with _values
+    void materialize() const;
+
+    bool hasField(uint32_t sampleIdx, int offset) const;
+    void writeSample(std::ostream& s, uint32_t sampleIdx, bool emptyDot) const;
+    GenotypeCall const& cachedGenotype(std::string const& gt) const;
+
+    // Calls f(sampleIdx, value) for each sample with data, where value is
+    // the sample's value for FORMAT field offset, or null.
+    template<typename Func>
+    void forEachValue(int offset, Func f) const;
+
 protected:
     Header const* _header;
     std::vector<CustomType const*> _format;
-    MapType _values;
+    mutable MapType _values;
+
+    // the text given to parse()
+    std::string _raw;
+
+    // offsets of a field's first and one past its last character in _raw
+    typedef std::pair<uint32_t, uint32_t> Span;
+
+    // while _columnar, the values are in _columns rather than _values, and
+    // _fieldCounts has the number of fields given for each sample (-1 for
+    // samples with no data). _spans has nFormat entries per sample, and
+    // _columns an empty column for each field not decoded yet.
+    mutable bool _columnar;
+    mutable std::vector<Span> _spans;
+    mutable std::vector<SampleColumn> _columns;
+    mutable std::vector<int16_t> _fieldCounts;
+    bool _modified;
 
+    mutable std::string _gtString;
     mutable boost::unordered_map<std::string, GenotypeCall> _gtCache;
 };
 
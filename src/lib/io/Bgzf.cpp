@@ -0,0 +1,153 @@
+#include "Bgzf.hpp"
+
+#include "common/Exceptions.hpp"
+#include "common/cstdint.hpp"
+
+#include <boost/format.hpp>
+
+#include <zlib.h>
+
+#include <cstring>
+
+using boost::format;
+
+BEGIN_NAMESPACE(Bgzf)
+
+namespace {
+    unsigned readUint16(char const* p) {
+        unsigned char const* u = reinterpret_cast<unsigned char const*>(p);
+        return u[0] | (u[1] << 8);
+    }
+
+    uint32_t readUint32(char const* p) {
+        unsigned char const* u = reinterpret_cast<unsigned char const*>(p);
+        return uint32_t(u[0])
+            | (uint32_t(u[1]) << 8)
+            | (uint32_t(u[2]) << 16)
+            | (uint32_t(u[3]) << 24);
+    }
+
+    void writeUint16(char* p, unsigned x) {
+        p[0] = char(x & 0xff);
+        p[1] = char((x >> 8) & 0xff);
+    }
+
+    void writeUint32(char* p, uint32_t x) {
+        for (int i = 0; i < 4; ++i) {
+            p[i] = char((x >> (8 * i)) & 0xff);
+        }
+    }
+
+    // gzip magic, deflate, FEXTRA, mtime=0, xfl=0, os=unknown, xlen=6,
+    // subfield "BC" of length 2. BSIZE follows.
+    char const BLOCK_HEADER[] = {
+        '\x1f', '\x8b', '\x08', '\x04',
+        '\0', '\0', '\0', '\0',
+        '\0', '\xff',
+        '\x06', '\0',
+        'B', 'C', '\x02', '\0'
+    };
+}
+
+char const EOF_BLOCK[28] = {
+    '\x1f', '\x8b', '\x08', '\x04', '\0', '\0', '\0', '\0', '\0', '\xff',
+    '\x06', '\0', 'B', 'C', '\x02', '\0', '\x1b', '\0', '\x03', '\0',
+    '\0', '\0', '\0', '\0', '\0', '\0', '\0', '\0'
+};
+
+bool isBlockHeader(char const* buf, std::size_t size) {
+    return size >= HEADER_SIZE
+        && buf[0] == '\x1f'
+        && buf[1] == '\x8b'
+        && buf[2] == '\x08'
+        && (buf[3] & 0x04) // FEXTRA
+        && readUint16(buf + 10) == 6
+        && buf[12] == 'B'
+        && buf[13] == 'C'
+        && readUint16(buf + 14) == 2;
+}
+
+std::size_t blockSize(char const* header) {
+    return readUint16(header + 16) + 1;
+}
+
+void inflateBlock(char const* block, std::size_t size, std::string& out) {
+    if (size < HEADER_SIZE + FOOTER_SIZE || !isBlockHeader(block, size)) {
+        throw IOError("Invalid BGZF block header");
+    }
+
+    char const* footer = block + size - FOOTER_SIZE;
+    uint32_t expectedCrc = readUint32(footer);
+    uint32_t expectedSize = readUint32(footer + 4);
+    if (expectedSize > MAX_BLOCK_SIZE) {
+        throw IOError(str(format(
+            "Invalid BGZF block: uncompressed size %1% is too large"
+            ) % expectedSize));
+    }
+
+    out.resize(expectedSize);
+    if (expectedSize == 0) {
+        return;
+    }
+
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(block + HEADER_SIZE));
+    zs.avail_in = size - HEADER_SIZE - FOOTER_SIZE;
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = expectedSize;
+
+    // negative window bits: raw deflate data, no zlib/gzip wrapper
+    if (inflateInit2(&zs, -15) != Z_OK) {
+        throw IOError("Failed to initialize zlib for BGZF decompression");
+    }
+    int rv = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+
+    if (rv != Z_STREAM_END || zs.total_out != expectedSize) {
+        throw IOError("Failed to inflate BGZF block: corrupt data");
+    }
+
+    uint32_t crc = crc32(0L, reinterpret_cast<Bytef const*>(out.data()), out.size());
+    if (crc != expectedCrc) {
+        throw IOError("Failed to inflate BGZF block: crc mismatch");
+    }
+}
+
+void deflateBlock(char const* data, std::size_t size, std::string& out, int level) {
+    if (size > MAX_INPUT_SIZE) {
+        throw IOError(str(format(
+            "Attempted to write BGZF block with too much data (%1% bytes)"
+            ) % size));
+    }
+
+    out.resize(MAX_BLOCK_SIZE);
+    std::memcpy(&out[0], BLOCK_HEADER, sizeof(BLOCK_HEADER));
+
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zs.avail_in = size;
+    zs.next_out = reinterpret_cast<Bytef*>(&out[HEADER_SIZE]);
+    zs.avail_out = MAX_BLOCK_SIZE - HEADER_SIZE - FOOTER_SIZE;
+
+    if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw IOError("Failed to initialize zlib for BGZF compression");
+    }
+    int rv = deflate(&zs, Z_FINISH);
+    deflateEnd(&zs);
+
+    if (rv != Z_STREAM_END) {
+        throw IOError("Failed to deflate BGZF block");
+    }
+
+    std::size_t total = HEADER_SIZE + zs.total_out + FOOTER_SIZE;
+    writeUint16(&out[16], total - 1);
+
+    char* footer = &out[HEADER_SIZE + zs.total_out];
+    writeUint32(footer, crc32(0L, reinterpret_cast<Bytef const*>(data), size));
+    writeUint32(footer + 4, size);
+    out.resize(total);
+}
+
+END_NAMESPACE(Bgzf)
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "common/cstdint.hpp"
+#include "common/namespaces.hpp"
+
+#include <cstddef>
+#include <string>
+
+// Helpers for the BGZF ("blocked gzip") format used by bgzip, samtools and
+// tabix. A BGZF file is a series of gzip members, each of which holds at
+// most 64KiB of uncompressed data and records its own compressed size in a
+// "BC" extra field of the gzip header. This makes each block independently
+// decompressable and lets us locate block boundaries without inflating.
+BEGIN_NAMESPACE(Bgzf)
+
+enum {
+    HEADER_SIZE = 18,
+    FOOTER_SIZE = 8,
+    MAX_BLOCK_SIZE = 65536,
+    // leave room for incompressible data to fit in a single block
+    MAX_INPUT_SIZE = 0xff00
+};
+
+// The empty block that terminates well formed BGZF files
+extern char const EOF_BLOCK[28];
+
+// True if the first HEADER_SIZE bytes of buf describe a BGZF block header.
+bool isBlockHeader(char const* buf, std::size_t size);
+
+// The total size (header, data, and footer) of the block whose header is
+// given. The header must have passed isBlockHeader.
+std::size_t blockSize(char const* header);
+
+// Inflate the complete block [block, block+size) into out (replacing its
+// contents). Throws IOError on corrupt data.
+void inflateBlock(char const* block, std::size_t size, std::string& out);
+
+// Compress [data, data+size) into a single complete BGZF block, replacing
+// the contents of out. size must not exceed MAX_INPUT_SIZE.
+void deflateBlock(char const* data, std::size_t size, std::string& out,
+    int level = -1);
+
+// A virtual file offset addresses a byte of uncompressed data: the upper 48
+// bits hold the file offset of the block containing it and the lower 16 bits
+// the offset within the uncompressed block. These are what tabix and CSI
+// indexes store.
+inline uint64_t makeVirtualOffset(uint64_t blockOffset, unsigned withinBlock) {
+    return (blockOffset << 16) | (withinBlock & 0xffff);
+}
+
+inline uint64_t blockOffset(uint64_t virtualOffset) {
+    return virtualOffset >> 16;
+}
+
+inline unsigned withinBlockOffset(uint64_t virtualOffset) {
+    return virtualOffset & 0xffff;
+}
+
+END_NAMESPACE(Bgzf)
@@ -0,0 +1,237 @@
+#include "BgzfLineSource.hpp"
+
+#include "Bgzf.hpp"
+#include "common/Exceptions.hpp"
+#include "common/compat.hpp"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+using boost::format;
+
+namespace {
+    // upper bound on the number of blocks in flight per line source. this
+    // keeps memory use in check when many files are open at once.
+    std::size_t const maxBlocksInFlight = 8;
+
+    struct InflateJob {
+        std::shared_ptr<std::string> raw;
+
+        std::shared_ptr<std::string> operator()() const {
+            auto rv = std::make_shared<std::string>();
+            Bgzf::inflateBlock(raw->data(), raw->size(), *rv);
+            return rv;
+        }
+    };
+}
+
+BgzfLineSource::BgzfLineSource(std::string const& path, ThreadPool::ptr pool)
+    : _path(path)
+    , _fp(std::fopen(path.c_str(), "rb"))
+    , _pool(pool ? pool : ThreadPool::create(0))
+    , _maxPending(std::min(_pool->size() + 1, maxBlocksInFlight))
+    , _readOffset(0)
+    , _blockOffset(0)
+    , _pos(0)
+    , _inputDone(false)
+    , _bad(_fp == NULL)
+    , _eof(false)
+{
+}
+
+BgzfLineSource::~BgzfLineSource() {
+    if (_fp) {
+        std::fclose(_fp);
+    }
+}
+
+bool BgzfLineSource::isBgzf(std::string const& path) {
+    std::FILE* fp = std::fopen(path.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+
+    char header[Bgzf::HEADER_SIZE];
+    std::size_t n = std::fread(header, 1, sizeof(header), fp);
+    std::fclose(fp);
+    return Bgzf::isBlockHeader(header, n);
+}
+
+bool BgzfLineSource::readBlock(std::string& block) {
+    char header[Bgzf::HEADER_SIZE];
+    std::size_t n = std::fread(header, 1, sizeof(header), _fp);
+    if (n == 0) {
+        return false;
+    }
+
+    if (!Bgzf::isBlockHeader(header, n)) {
+        throw IOError(str(format(
+            "Invalid or truncated BGZF block header in %1%") % _path));
+    }
+
+    std::size_t size = Bgzf::blockSize(header);
+    if (size < Bgzf::HEADER_SIZE + Bgzf::FOOTER_SIZE) {
+        throw IOError(str(format("Invalid BGZF block size in %1%") % _path));
+    }
+
+    block.resize(size);
+    std::memcpy(&block[0], header, sizeof(header));
+    std::size_t remaining = size - sizeof(header);
+    if (std::fread(&block[sizeof(header)], 1, remaining, _fp) != remaining) {
+        throw IOError(str(format("Truncated BGZF block in %1%") % _path));
+    }
+    _readOffset += size;
+    return true;
+}
+
+void BgzfLineSource::fillPipeline() {
+    while (!_inputDone && _pending.size() < _maxPending) {
+        InflateJob job{std::make_shared<std::string>()};
+        uint64_t offset = _readOffset;
+        if (!readBlock(*job.raw)) {
+            _inputDone = true;
+            break;
+        }
+        _pending.push_back(PendingBlock{offset, _pool->submit(job)});
+    }
+}
+
+bool BgzfLineSource::nextBlock() {
+    _pos = 0;
+    _block.reset();
+    while (true) {
+        fillPipeline();
+        if (_pending.empty()) {
+            return false;
+        }
+
+        try {
+            _blockOffset = _pending.front().offset;
+            _block = _pending.front().data.get();
+        }
+        catch (std::exception const& e) {
+            _bad = true;
+            throw IOError(str(format("Error reading %1%: %2%") % _path % e.what()));
+        }
+        _pending.pop_front();
+
+        // top up the pipeline before handing the block to the caller
+        fillPipeline();
+
+        // skip empty blocks (e.g., the EOF marker)
+        if (!_block->empty()) {
+            return true;
+        }
+    }
+}
+
+bool BgzfLineSource::getline(std::string& line) {
+    StringView view;
+    bool rv = getline(view);
+    line.assign(view.begin(), view.end());
+    return rv;
+}
+
+bool BgzfLineSource::getline(StringView& line) {
+    line.clear();
+    if (_bad) {
+        return false;
+    }
+
+    // lines that fit in a single block are returned as views into the
+    // block. lines spanning blocks are assembled in _spill.
+    _spill.clear();
+    do {
+        if (_block && _pos < _block->size()) {
+            char const* first = _block->data() + _pos;
+            char const* last = _block->data() + _block->size();
+            char const* nl = static_cast<char const*>(
+                std::memchr(first, '\n', last - first));
+
+            if (nl) {
+                _pos = nl - _block->data() + 1;
+                if (_spill.empty()) {
+                    line.assign(first, nl);
+                }
+                else {
+                    _spill.append(first, nl);
+                    line.assign(_spill.data(), _spill.data() + _spill.size());
+                }
+                return true;
+            }
+
+            _spill.append(first, last);
+            _pos = _block->size();
+        }
+    } while (nextBlock());
+
+    line.assign(_spill.data(), _spill.data() + _spill.size());
+    _eof = line.empty();
+    return !_eof;
+}
+
+void BgzfLineSource::seek(uint64_t virtualOffset) {
+    if (_bad) {
+        return;
+    }
+
+    // blocks still being inflated are simply abandoned
+    _pending.clear();
+    _block.reset();
+    _pos = 0;
+    _inputDone = false;
+    _eof = false;
+
+    _readOffset = Bgzf::blockOffset(virtualOffset);
+    if (fseeko(_fp, _readOffset, SEEK_SET) != 0) {
+        _bad = true;
+        throw IOError(str(format("Failed to seek to offset %1% in %2%")
+            % _readOffset % _path));
+    }
+
+    unsigned within = Bgzf::withinBlockOffset(virtualOffset);
+    if (within > 0) {
+        if (!nextBlock() || _blockOffset != Bgzf::blockOffset(virtualOffset)
+            || within > _block->size())
+        {
+            throw IOError(str(format("Invalid virtual offset %1% for %2%")
+                % virtualOffset % _path));
+        }
+        _pos = within;
+    }
+}
+
+uint64_t BgzfLineSource::tell() const {
+    if (_block && _pos < _block->size()) {
+        return Bgzf::makeVirtualOffset(_blockOffset, _pos);
+    }
+
+    uint64_t next = _pending.empty() ? _readOffset : _pending.front().offset;
+    return Bgzf::makeVirtualOffset(next, 0);
+}
+
+char BgzfLineSource::peek() {
+    if (_block && _pos < _block->size()) {
+        return (*_block)[_pos];
+    }
+
+    if (!_bad && nextBlock()) {
+        return (*_block)[0];
+    }
+
+    return EOF;
+}
+
+bool BgzfLineSource::eof() const {
+    return (!_block || _pos >= _block->size()) && _eof;
+}
+
+bool BgzfLineSource::good() const {
+    return !_bad && !eof();
+}
+
+BgzfLineSource::operator bool() const {
+    return good();
+}
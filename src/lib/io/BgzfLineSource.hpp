@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ILineSource.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/cstdint.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+
+// Line source for BGZF compressed files.
+//
+// Compressed blocks are read sequentially by the calling thread (which is
+// cheap: the block size is stored in each block header) and handed off to a
+// thread pool to be inflated. Decompressed blocks are consumed in file order,
+// so several blocks can be in flight at once while the caller parses lines.
+//
+// The thread pool may be shared by many line sources. When no pool is given
+// (or the pool has no threads), blocks are inflated in the calling thread.
+class BgzfLineSource : public ILineSource {
+public:
+    explicit BgzfLineSource(std::string const& path,
+        ThreadPool::ptr pool = ThreadPool::ptr());
+    ~BgzfLineSource();
+
+    // Returns true if the file at path starts with a BGZF block header
+    static bool isBgzf(std::string const& path);
+
+    operator bool() const;
+    char peek();
+    bool eof() const;
+    bool good() const;
+    bool getline(std::string& line);
+    bool getline(StringView& line);
+
+    // Position the source at the given virtual offset (see Bgzf.hpp)
+    void seek(uint64_t virtualOffset);
+    // The virtual offset of the next byte to be read
+    uint64_t tell() const;
+
+private:
+    typedef std::shared_ptr<std::string> BlockPtr;
+
+    struct PendingBlock {
+        uint64_t offset;
+        std::future<BlockPtr> data;
+    };
+
+    bool readBlock(std::string& block);
+    void fillPipeline();
+    bool nextBlock();
+
+private:
+    std::string _path;
+    std::FILE* _fp;
+    ThreadPool::ptr _pool;
+    std::size_t _maxPending;
+    std::deque<PendingBlock> _pending;
+    uint64_t _readOffset;
+    BlockPtr _block;
+    uint64_t _blockOffset;
+    std::size_t _pos;
+    std::string _spill;
+    bool _inputDone;
+    bool _bad;
+    bool _eof;
+};
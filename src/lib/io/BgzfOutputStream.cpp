@@ -0,0 +1,200 @@
+#include "BgzfOutputStream.hpp"
+
+#include "Bgzf.hpp"
+#include "common/Exceptions.hpp"
+
+#include <boost/format.hpp>
+
+#include <cstring>
+#include <iostream>
+
+using boost::format;
+
+namespace {
+    struct DeflateJob {
+        std::shared_ptr<std::string> raw;
+
+        std::shared_ptr<std::string> operator()() const {
+            auto rv = std::make_shared<std::string>();
+            Bgzf::deflateBlock(raw->data(), raw->size(), *rv);
+            return rv;
+        }
+    };
+}
+
+BgzfOutputStream::Buffer::Buffer(std::string const& path,
+        TabixIndexBuilder* index, ThreadPool::ptr pool)
+    : _path(path)
+    , _fp(path == "-" ? stdout : std::fopen(path.c_str(), "wb"))
+    , _ownFile(path != "-")
+    , _index(index)
+    , _pool(pool ? pool : ThreadPool::create(0))
+    // enough to keep every thread busy while we wait on the oldest block
+    , _maxPending(2 * _pool->size())
+    , _offset(0)
+    , _lineStart(0)
+{
+    if (!_fp) {
+        throw IOError(str(format("Failed to open file %1%") % path));
+    }
+    resetBuffer();
+}
+
+BgzfOutputStream::Buffer::~Buffer() {
+    if (_fp && _ownFile) {
+        std::fclose(_fp);
+    }
+}
+
+BgzfOutputStream::Buffer::int_type BgzfOutputStream::Buffer::overflow(int_type c) {
+    submitBlock();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int BgzfOutputStream::Buffer::sync() {
+    return 0;
+}
+
+void BgzfOutputStream::Buffer::write(char const* data, std::size_t size) {
+    if (std::fwrite(data, 1, size, _fp) != size) {
+        throw IOError(str(format("Failed to write to %1%") % _path));
+    }
+}
+
+void BgzfOutputStream::Buffer::resetBuffer() {
+    if (_spare.empty()) {
+        _current = std::make_shared<std::string>();
+    }
+    else {
+        _current = std::move(_spare.back());
+        _spare.pop_back();
+    }
+
+    _current->resize(Bgzf::MAX_INPUT_SIZE);
+    char* beg = &(*_current)[0];
+    setp(beg, beg + _current->size());
+}
+
+void BgzfOutputStream::Buffer::submitBlock() {
+    std::size_t size = pptr() - pbase();
+    if (size > 0) {
+        _current->resize(size);
+        DeflateJob job{_current};
+        _pending.push_back(PendingBlock{_current, _pool->submit(job)});
+        resetBuffer();
+    }
+
+    while (_pending.size() > _maxPending) {
+        writeBlock();
+    }
+}
+
+// Write out the oldest pending block once it is compressed
+void BgzfOutputStream::Buffer::writeBlock() {
+    PendingBlock& block = _pending.front();
+    BlockPtr compressed = block.compressed.get();
+    if (_index) {
+        indexLines(block.raw->data(), block.raw->size(),
+            _offset, _offset + compressed->size());
+    }
+    write(compressed->data(), compressed->size());
+    _offset += compressed->size();
+
+    _spare.push_back(std::move(block.raw));
+    _pending.pop_front();
+}
+
+void BgzfOutputStream::Buffer::indexLines(char const* data, std::size_t size,
+        uint64_t blockOffset, uint64_t nextBlockOffset)
+{
+    char const* end = data + size;
+    char const* p = data;
+    while (p != end) {
+        char const* nl = static_cast<char const*>(std::memchr(p, '\n', end - p));
+        if (!nl) {
+            _line.append(p, end);
+            break;
+        }
+
+        // lines spanning blocks are assembled in _line
+        StringView line(p, nl);
+        if (!_line.empty()) {
+            _line.append(p, nl);
+            line.assign(_line.data(), _line.data() + _line.size());
+        }
+
+        // a line ending a block is followed by the start of the next one
+        p = nl + 1;
+        uint64_t lineEnd = p == end
+            ? Bgzf::makeVirtualOffset(nextBlockOffset, 0)
+            : Bgzf::makeVirtualOffset(blockOffset, p - data);
+
+        _index->addLine(line, _lineStart, lineEnd);
+        _line.clear();
+        _lineStart = lineEnd;
+    }
+}
+
+void BgzfOutputStream::Buffer::close() {
+    if (!_fp) {
+        return;
+    }
+
+    submitBlock();
+    while (!_pending.empty()) {
+        writeBlock();
+    }
+
+    if (_index && !_line.empty()) {
+        uint64_t end = Bgzf::makeVirtualOffset(_offset, 0);
+        _index->addLine(StringView(_line.data(), _line.data() + _line.size()),
+            _lineStart, end);
+        _line.clear();
+    }
+    write(Bgzf::EOF_BLOCK, sizeof(Bgzf::EOF_BLOCK));
+
+    bool ok = _ownFile ? std::fclose(_fp) == 0 : std::fflush(_fp) == 0;
+    _fp = 0;
+    if (!ok) {
+        throw IOError(str(format("Failed to write to %1%") % _path));
+    }
+}
+
+BgzfOutputStream::BgzfOutputStream(std::string const& path,
+        TabixIndexBuilder::ptr index, ThreadPool::ptr pool)
+    : std::ostream(0)
+    , _path(path)
+    , _index(std::move(index))
+    , _buf(path, _index.get(), pool)
+    , _closed(false)
+{
+    if (_index && path == "-") {
+        throw IOError("Unable to index output written to stdout");
+    }
+    rdbuf(&_buf);
+}
+
+BgzfOutputStream::~BgzfOutputStream() {
+    try {
+        close();
+    }
+    catch (std::exception const& e) {
+        std::cerr << "Error closing " << _path << ": " << e.what() << "\n";
+    }
+}
+
+void BgzfOutputStream::close() {
+    if (_closed) {
+        return;
+    }
+
+    _closed = true;
+    _buf.close();
+    if (_index) {
+        _index->write(_path + _index->extension());
+    }
+}
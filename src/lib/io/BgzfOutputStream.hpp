@@ -0,0 +1,95 @@
+#pragma once
+
+#include "TabixIndexBuilder.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/cstdint.hpp"
+
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// An output stream writing BGZF compressed data, as bgzip does.
+//
+// When given an index builder, each line written is passed to it along
+// with its virtual offsets, and the index is written next to the data
+// (path + index->extension()) by close(). This lets sorted output be
+// compressed and indexed in the same pass that writes it.
+//
+// Data is only compressed once a full block has been written (or the
+// stream is closed): flushing the stream does not cut a block short, since
+// small blocks compress poorly.
+//
+// Full blocks are handed to a thread pool to be compressed and written out
+// (and indexed) in order as they complete. When no pool is given (or the
+// pool has no threads), blocks are compressed in the writing thread.
+class BgzfOutputStream : public std::ostream {
+public:
+    typedef std::unique_ptr<BgzfOutputStream> ptr;
+
+    // path may be "-" for stdout, but only when not indexing
+    explicit BgzfOutputStream(std::string const& path,
+        TabixIndexBuilder::ptr index = TabixIndexBuilder::ptr(),
+        ThreadPool::ptr pool = ThreadPool::ptr());
+    ~BgzfOutputStream();
+
+    // Write any remaining data, the BGZF EOF marker, and the index.
+    // Throws IOError on failure.
+    void close();
+
+private:
+    class Buffer : public std::streambuf {
+    public:
+        Buffer(std::string const& path, TabixIndexBuilder* index,
+            ThreadPool::ptr pool);
+        ~Buffer();
+
+        void close();
+
+    protected:
+        int_type overflow(int_type c);
+        int sync();
+
+    private:
+        typedef std::shared_ptr<std::string> BlockPtr;
+
+        struct PendingBlock {
+            BlockPtr raw;
+            std::future<BlockPtr> compressed;
+        };
+
+        void submitBlock();
+        void writeBlock();
+        void resetBuffer();
+        void indexLines(char const* data, std::size_t size,
+            uint64_t blockOffset, uint64_t nextBlockOffset);
+        void write(char const* data, std::size_t size);
+
+    private:
+        std::string _path;
+        std::FILE* _fp;
+        bool _ownFile;
+        TabixIndexBuilder* _index;
+        ThreadPool::ptr _pool;
+        std::size_t _maxPending;
+        std::deque<PendingBlock> _pending;
+        // the block being filled, and spares to fill next
+        BlockPtr _current;
+        std::vector<BlockPtr> _spare;
+        uint64_t _offset;
+
+        // the line currently being written, and its start
+        std::string _line;
+        uint64_t _lineStart;
+    };
+
+private:
+    std::string _path;
+    TabixIndexBuilder::ptr _index;
+    Buffer _buf;
+    bool _closed;
+};
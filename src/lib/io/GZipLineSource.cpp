@@ -6,20 +6,21 @@
 
 #include <cstddef>
 #include <cstdio>
+#include <cstring>
 
 using boost::format;
 
 namespace {
-    static int const bufsz = 4096;
+    static int const bufsz = 65536;
 }
 
+// Holds decompressed data that has not yet been handed out as lines. Lines
+// are returned as views into the buffer. When a line does not fit in the
+// space remaining, the partial line is moved to the front of the buffer (or
+// the buffer is grown if the line is longer than the buffer) before reading
+// more data.
 class GZipLineSource::LineBuffer {
 public:
-    enum Status {
-        WHOLE_LINE = 0,
-        PARTIAL_LINE
-    };
-
     typedef char value_type;
     typedef size_t size_type;
 
@@ -27,21 +28,12 @@ public:
         : _buf(capacity)
         , _beg(0u)
         , _end(0u)
+        , _scan(0u)
     {
     }
 
     bool empty() const {
-        return _end == 0;
-    }
-
-    void setEnd(size_type newEnd) {
-        _end = newEnd;
-    }
-
-    value_type* buffer() {
-        assert(_beg == 0);
-        assert(_end == 0);
-        return _buf.data();
+        return _beg == _end;
     }
 
     value_type peek() const {
@@ -53,33 +45,64 @@ public:
         return _buf.size();
     }
 
-    template<typename Appendable>
-    Status appendUntil(Appendable& tgt, value_type ch) {
-        Status rv(PARTIAL_LINE);
-        value_type const* first = _buf.data() + _beg;
+    // Point line at the next complete line (excluding the delimiter) and
+    // consume it. Returns false if the buffer does not hold a whole line.
+    bool nextLine(StringView& line, value_type delim) {
+        value_type const* first = _buf.data() + _scan;
         value_type const* last = _buf.data() + _end;
-        value_type const* chPos = std::find(first, last, ch);
-        size_t sz = chPos - first;
-        tgt.append(first, sz);
-        if (chPos == last) {
-            _beg = _end = 0u;
+        value_type const* pos = static_cast<value_type const*>(
+            std::memchr(first, delim, last - first));
+
+        if (pos == 0) {
+            // remember where we stopped so we don't rescan this data
+            _scan = _end;
+            return false;
         }
-        else {
-            _beg = chPos - _buf.data() + 1;
-            rv = WHOLE_LINE;
+
+        line.assign(_buf.data() + _beg, pos);
+        _beg = _scan = pos - _buf.data() + 1;
+        return true;
+    }
+
+    // Point line at whatever data remains in the buffer and consume it.
+    void takeRemaining(StringView& line) {
+        line.assign(_buf.data() + _beg, _buf.data() + _end);
+        _beg = _scan = _end;
+    }
+
+    // Make room for more data at the end of the buffer, returning a pointer
+    // to the free space. The number of bytes available is given by
+    // available().
+    value_type* reserve() {
+        if (_beg > 0) {
+            size_type n = _end - _beg;
+            std::memmove(_buf.data(), _buf.data() + _beg, n);
+            _scan -= _beg;
+            _end = n;
+            _beg = 0;
         }
 
-        if (_beg == _end) {
-            _beg = _end = 0u;
+        if (_end == _buf.size()) {
+            _buf.resize(_buf.size() * 2);
         }
 
-        return rv;
+        return _buf.data() + _end;
+    }
+
+    size_type available() const {
+        return _buf.size() - _end;
+    }
+
+    void commit(size_type n) {
+        assert(n <= available());
+        _end += n;
     }
 
 private:
     std::vector<value_type> _buf;
     size_type _beg;
     size_type _end;
+    size_type _scan;
 };
 
 
@@ -107,27 +130,34 @@ GZipLineSource::~GZipLineSource() {
 }
 
 bool GZipLineSource::getline(std::string& line) {
-    line.erase();
-    LineBuffer::Status lineStatus(LineBuffer::PARTIAL_LINE);
+    StringView view;
+    bool rv = getline(view);
+    line.assign(view.begin(), view.end());
+    return rv;
+}
 
-    if (!_buffer->empty()) {
-        lineStatus = _buffer->appendUntil(line, '\n');
-        if (lineStatus == LineBuffer::WHOLE_LINE) {
-            return true;
-        }
+bool GZipLineSource::getline(StringView& line) {
+    line.clear();
+    if (_buffer->nextLine(line, '\n')) {
+        return true;
     }
 
-    LineBuffer::value_type* data = _buffer->buffer();
-    int sz;
-    while ((sz = gzread(_fp, data, _buffer->size())) > 0) {
-        _buffer->setEnd(sz);
-        lineStatus = _buffer->appendUntil(line, '\n');
-        if (lineStatus == LineBuffer::WHOLE_LINE) {
+    while (true) {
+        LineBuffer::value_type* data = _buffer->reserve();
+        int sz = gzread(_fp, data, _buffer->available());
+        if (sz <= 0) {
             break;
         }
+
+        _buffer->commit(sz);
+        if (_buffer->nextLine(line, '\n')) {
+            return true;
+        }
     }
 
-    _eof = !(lineStatus == LineBuffer::WHOLE_LINE || (line.size()));
+    // the last line of the file may lack a trailing newline
+    _buffer->takeRemaining(line);
+    _eof = line.empty();
     return !_eof;
 }
 
@@ -24,6 +24,7 @@ public:
     bool eof() const;
     bool good() const;
     bool getline(std::string& line);
+    bool getline(StringView& line);
 
     static size_t bufferSize();
 
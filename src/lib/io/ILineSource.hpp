@@ -1,5 +1,7 @@
 #pragma once
 
+#include "common/StringView.hpp"
+
 #include <istream>
 #include <memory>
 #include <string>
@@ -14,4 +16,20 @@ public:
     virtual char peek() = 0;
     virtual bool eof() const = 0;
     virtual bool good() const = 0;
+
+    // Read the next line without copying it. The view refers to memory
+    // owned by the line source and is only valid until the next call to
+    // getline or peek. The default implementation reads into an internal
+    // string; sources that buffer their input should override this to
+    // point directly into their buffers.
+    virtual bool getline(StringView& line);
+
+private:
+    std::string _lineBuffer;
 };
+
+inline bool ILineSource::getline(StringView& line) {
+    bool rv = getline(_lineBuffer);
+    line.assign(_lineBuffer.data(), _lineBuffer.data() + _lineBuffer.size());
+    return rv;
+}
@@ -0,0 +1,185 @@
+#include "IndexedLineSource.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+IndexedLineSource::IndexedLineSource(
+        std::unique_ptr<BgzfLineSource> source,
+        TabixIndex::ptr index,
+        std::vector<GenomicRegion> const& regions)
+    : _source(std::move(source))
+    , _index(std::move(index))
+    , _chunkIdx(0)
+    , _headerLines(0)
+    , _inHeader(true)
+    , _haveLine(false)
+    , _lineConsumed(false)
+    , _eof(false)
+{
+    for (auto r = regions.begin(); r != regions.end(); ++r) {
+        int32_t tid = _index->sequenceId(r->chrom);
+        if (tid < 0 || r->end <= r->begin) {
+            continue;
+        }
+
+        _intervals[r->chrom].push_back(Interval{r->begin, r->end});
+
+        auto chunks = _index->query(tid, r->begin, r->end);
+        _chunks.insert(_chunks.end(), chunks.begin(), chunks.end());
+    }
+
+    // merge overlapping intervals so that each record is tested against
+    // (and reported for) at most one of them
+    for (auto i = _intervals.begin(); i != _intervals.end(); ++i) {
+        auto& iv = i->second;
+        std::sort(iv.begin(), iv.end(),
+            [](Interval const& a, Interval const& b) {
+                return a.begin < b.begin;
+            });
+
+        std::size_t n = 0;
+        for (std::size_t j = 0; j < iv.size(); ++j) {
+            if (n > 0 && iv[j].begin <= iv[n - 1].end) {
+                iv[n - 1].end = std::max(iv[n - 1].end, iv[j].end);
+            }
+            else {
+                iv[n++] = iv[j];
+            }
+        }
+        iv.resize(n);
+    }
+
+    // likewise for chunks, so that no part of the file is read twice
+    std::sort(_chunks.begin(), _chunks.end(),
+        [](TabixIndex::Chunk const& a, TabixIndex::Chunk const& b) {
+            return a.beg < b.beg;
+        });
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < _chunks.size(); ++i) {
+        if (n > 0 && _chunks[i].beg <= _chunks[n - 1].end) {
+            _chunks[n - 1].end = std::max(_chunks[n - 1].end, _chunks[i].end);
+        }
+        else {
+            _chunks[n++] = _chunks[i];
+        }
+    }
+    _chunks.resize(n);
+}
+
+bool IndexedLineSource::isHeader(StringView const& line) const {
+    return _headerLines < _index->skip()
+        || line.empty()
+        || line[0] == _index->meta();
+}
+
+bool IndexedLineSource::overlaps(StringView const& line) const {
+    if (line.empty() || line[0] == _index->meta()) {
+        return false;
+    }
+
+    StringView seq;
+    int64_t beg;
+    int64_t end;
+    _index->config().parseRecord(line, seq, beg, end);
+
+    auto found = _intervals.find(std::string(seq.begin(), seq.end()));
+    if (found == _intervals.end()) {
+        return false;
+    }
+
+    // the first interval ending after this record begins is the only one
+    // that can overlap it
+    auto const& iv = found->second;
+    auto i = std::upper_bound(iv.begin(), iv.end(), beg,
+        [](int64_t pos, Interval const& x) {
+            return pos < x.end;
+        });
+    return i != iv.end() && i->begin < end;
+}
+
+bool IndexedLineSource::readNext(StringView& line) {
+    if (_inHeader) {
+        if (_source->getline(line) && isHeader(line)) {
+            ++_headerLines;
+            return true;
+        }
+
+        _inHeader = false;
+        if (!_chunks.empty()) {
+            _source->seek(_chunks[0].beg);
+        }
+    }
+
+    while (_chunkIdx < _chunks.size()) {
+        if (_source->tell() >= _chunks[_chunkIdx].end
+            || !_source->getline(line))
+        {
+            if (++_chunkIdx < _chunks.size()) {
+                _source->seek(_chunks[_chunkIdx].beg);
+            }
+            continue;
+        }
+
+        if (overlaps(line)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// The line returned by getline is a view into the underlying source, so
+// reading the next one must wait until the caller asks for it.
+bool IndexedLineSource::fetch() {
+    if (_haveLine && !_lineConsumed) {
+        return true;
+    }
+
+    if (_eof) {
+        return false;
+    }
+
+    _haveLine = readNext(_line);
+    _lineConsumed = false;
+    _eof = !_haveLine;
+    return _haveLine;
+}
+
+bool IndexedLineSource::getline(std::string& line) {
+    StringView view;
+    bool rv = getline(view);
+    line.assign(view.begin(), view.end());
+    return rv;
+}
+
+bool IndexedLineSource::getline(StringView& line) {
+    if (!fetch()) {
+        line.clear();
+        return false;
+    }
+
+    line = _line;
+    _lineConsumed = true;
+    return true;
+}
+
+char IndexedLineSource::peek() {
+    if (!fetch()) {
+        return EOF;
+    }
+
+    // empty lines are returned as such, peek shows their newline
+    return _line.empty() ? '\n' : _line[0];
+}
+
+bool IndexedLineSource::eof() const {
+    return _eof;
+}
+
+bool IndexedLineSource::good() const {
+    return !_eof;
+}
+
+IndexedLineSource::operator bool() const {
+    return good();
+}
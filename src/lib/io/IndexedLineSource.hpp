@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ILineSource.hpp"
+#include "BgzfLineSource.hpp"
+#include "TabixIndex.hpp"
+#include "common/GenomicRegion.hpp"
+#include "common/cstdint.hpp"
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Line source returning only the records of an indexed BGZF file that
+// overlap a set of regions.
+//
+// Header lines (those starting with the index's meta character, and the
+// number of lines it says to skip) are read from the start of the file and
+// returned first so that the usual header parsing still works. After that,
+// only the chunks the index gives for the regions are read. Records are
+// returned once each, in file order, no matter how many regions they hit.
+class IndexedLineSource : public ILineSource {
+public:
+    IndexedLineSource(
+        std::unique_ptr<BgzfLineSource> source,
+        TabixIndex::ptr index,
+        std::vector<GenomicRegion> const& regions);
+
+    operator bool() const;
+    char peek();
+    bool eof() const;
+    bool good() const;
+    bool getline(std::string& line);
+    bool getline(StringView& line);
+
+private:
+    struct Interval {
+        int64_t begin;
+        int64_t end;
+    };
+
+    bool fetch();
+    bool readNext(StringView& line);
+    bool isHeader(StringView const& line) const;
+    bool overlaps(StringView const& line) const;
+
+private:
+    std::unique_ptr<BgzfLineSource> _source;
+    TabixIndex::ptr _index;
+    // sorted, non-overlapping intervals to report for each sequence
+    std::map<std::string, std::vector<Interval>> _intervals;
+    std::vector<TabixIndex::Chunk> _chunks;
+    std::size_t _chunkIdx;
+    int _headerLines;
+    bool _inHeader;
+
+    StringView _line;
+    bool _haveLine;
+    bool _lineConsumed;
+    bool _eof;
+};
@@ -14,6 +14,8 @@ CompressionType compressionTypeFromString(const string& s) {
         return NONE;
     else if (s == "g")
         return GZIP;
+    else if (s == "b")
+        return BGZF;
     else
         throw runtime_error(str(format("Invalid compression string '%1%'. Expected one of: n,g,z,b") %s));
 }
@@ -57,8 +59,17 @@ void InputStream::rewind() {
 }
 
 bool InputStream::getline(string& line) {
+    StringView view;
+    bool rv = getline(view);
+    line.assign(view.begin(), view.end());
+    return rv;
+}
+
+bool InputStream::getline(StringView& line) {
+    line.clear();
     if (_cacheIter != _cache.end()) {
-        line = *_cacheIter++;
+        string const& cached = *_cacheIter++;
+        line.assign(cached.data(), cached.data() + cached.size());
         ++_lineNum;
         return true;
     }
@@ -71,7 +82,7 @@ bool InputStream::getline(string& line) {
 
 
     if (_caching && _in) {
-        _cache.push_back(line);
+        _cache.emplace_back(line.begin(), line.end());
         _cacheIter = _cache.end();
     }
 
@@ -10,6 +10,7 @@
 enum CompressionType {
     NONE,
     GZIP,
+    BGZF,
     N_COMPRESSION_TYPES
 };
 
@@ -28,6 +29,8 @@ public:
     void caching(bool value);
     void rewind();
     bool getline(std::string& line);
+    // The view is valid until the next call to getline or peek
+    bool getline(StringView& line);
     bool eof() const;
     bool good() const;
     char peek();
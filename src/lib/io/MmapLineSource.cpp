@@ -0,0 +1,118 @@
+#include "MmapLineSource.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+
+MmapLineSource::MmapLineSource(std::string const& path)
+    : _path(path)
+    , _fd(::open(path.c_str(), O_RDONLY))
+    , _data(0)
+    , _size(0)
+    , _pos(0)
+    , _end(0)
+    , _bad(_fd < 0)
+    , _eof(false)
+{
+    struct stat st;
+    if (_bad || fstat(_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        _bad = true;
+        return;
+    }
+
+    // mmap refuses zero length mappings; an empty file just has no lines
+    _size = st.st_size;
+    if (_size == 0) {
+        return;
+    }
+
+    void* addr = mmap(0, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (addr == MAP_FAILED) {
+        _bad = true;
+        _size = 0;
+        return;
+    }
+
+    madvise(addr, _size, MADV_SEQUENTIAL);
+    _data = static_cast<char const*>(addr);
+    _pos = _data;
+    _end = _data + _size;
+}
+
+MmapLineSource::~MmapLineSource() {
+    if (_data) {
+        munmap(const_cast<char*>(_data), _size);
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+}
+
+bool MmapLineSource::isMappable(std::string const& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+
+    std::FILE* fp = std::fopen(path.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+
+    unsigned char magic[2] = {0, 0};
+    std::size_t n = std::fread(magic, 1, sizeof(magic), fp);
+    std::fclose(fp);
+    return n < 2 || magic[0] != 0x1f || magic[1] != 0x8b;
+}
+
+bool MmapLineSource::getline(std::string& line) {
+    StringView view;
+    bool rv = getline(view);
+    line.assign(view.begin(), view.end());
+    return rv;
+}
+
+bool MmapLineSource::getline(StringView& line) {
+    line.clear();
+    if (_pos == _end) {
+        _eof = true;
+        return false;
+    }
+
+    // memchr is vectorised by the C library
+    char const* nl = static_cast<char const*>(
+        std::memchr(_pos, '\n', _end - _pos));
+    if (nl) {
+        line.assign(_pos, nl);
+        _pos = nl + 1;
+    }
+    else {
+        // the last line of the file may lack a trailing newline
+        line.assign(_pos, _end);
+        _pos = _end;
+    }
+    return true;
+}
+
+char MmapLineSource::peek() {
+    if (_pos == _end) {
+        return EOF;
+    }
+    return *_pos;
+}
+
+bool MmapLineSource::eof() const {
+    return _pos == _end && _eof;
+}
+
+bool MmapLineSource::good() const {
+    return !_bad && !eof();
+}
+
+MmapLineSource::operator bool() const {
+    return good();
+}
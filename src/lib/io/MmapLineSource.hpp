@@ -0,0 +1,38 @@
+#pragma once
+
+#include "ILineSource.hpp"
+
+#include <cstddef>
+#include <string>
+
+// Line source for uncompressed regular files.
+//
+// The whole file is mapped into memory and lines are returned as views into
+// the mapping, so reading never copies data through an intermediate buffer.
+// The kernel is told that access will be sequential so that it can read
+// ahead aggressively and drop pages behind us.
+class MmapLineSource : public ILineSource {
+public:
+    explicit MmapLineSource(std::string const& path);
+    ~MmapLineSource();
+
+    // Returns true if path names a regular file that is not gzip compressed
+    static bool isMappable(std::string const& path);
+
+    operator bool() const;
+    char peek();
+    bool eof() const;
+    bool good() const;
+    bool getline(std::string& line);
+    bool getline(StringView& line);
+
+private:
+    std::string _path;
+    int _fd;
+    char const* _data;
+    std::size_t _size;
+    char const* _pos;
+    char const* _end;
+    bool _bad;
+    bool _eof;
+};
@@ -0,0 +1,167 @@
+#include "ReadAheadLineSource.hpp"
+
+#include "common/compat.hpp"
+
+#include <cstdio>
+#include <utility>
+
+ReadAheadLineSource::ReadAheadLineSource(ILineSource::ptr source,
+        std::size_t batchSize, std::size_t maxBatches)
+    : _source(std::move(source))
+    , _batchSize(batchSize)
+    , _maxBatches(maxBatches > 0 ? maxBatches : 1)
+    , _stop(false)
+    , _line(0)
+    , _bad(!*_source)
+    , _eof(false)
+{
+    if (!_bad) {
+        _thread = std::thread(&ReadAheadLineSource::readLoop, this);
+    }
+}
+
+ReadAheadLineSource::~ReadAheadLineSource() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _space.notify_all();
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+bool ReadAheadLineSource::fill(Batch& batch) {
+    batch.data.clear();
+    batch.ends.clear();
+    batch.last = false;
+    batch.bad = false;
+    batch.error = std::exception_ptr();
+
+    try {
+        StringView line;
+        while (batch.data.size() < _batchSize) {
+            if (!_source->getline(line)) {
+                batch.last = true;
+                batch.bad = !_source->eof();
+                break;
+            }
+            batch.data.append(line.begin(), line.end());
+            batch.ends.push_back(batch.data.size());
+        }
+    }
+    catch (...) {
+        batch.last = true;
+        batch.error = std::current_exception();
+    }
+    return !batch.last;
+}
+
+void ReadAheadLineSource::readLoop() {
+    bool more = true;
+    while (more) {
+        BatchPtr batch;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (!_stop && _full.size() >= _maxBatches) {
+                _space.wait(lock);
+            }
+            if (_stop) {
+                return;
+            }
+
+            if (_free.empty()) {
+                batch = std::make_unique<Batch>();
+                batch->data.reserve(_batchSize);
+            }
+            else {
+                batch = std::move(_free.back());
+                _free.pop_back();
+            }
+        }
+
+        more = fill(*batch);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _full.push_back(std::move(batch));
+        }
+        _ready.notify_one();
+    }
+}
+
+bool ReadAheadLineSource::ensureLine() {
+    while (!_batch || _line == _batch->ends.size()) {
+        if (_batch && _batch->last) {
+            if (_batch->error) {
+                // only report the error once
+                std::exception_ptr error = _batch->error;
+                _batch->error = std::exception_ptr();
+                _bad = true;
+                std::rethrow_exception(error);
+            }
+            _bad = _bad || _batch->bad;
+            return false;
+        }
+        if (_bad) {
+            return false;
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_batch) {
+            _free.push_back(std::move(_batch));
+        }
+        while (_full.empty()) {
+            _ready.wait(lock);
+        }
+        _batch = std::move(_full.front());
+        _full.pop_front();
+        _line = 0;
+        lock.unlock();
+        _space.notify_one();
+    }
+    return true;
+}
+
+bool ReadAheadLineSource::getline(std::string& line) {
+    StringView view;
+    bool rv = getline(view);
+    line.assign(view.begin(), view.end());
+    return rv;
+}
+
+bool ReadAheadLineSource::getline(StringView& line) {
+    line.clear();
+    if (!ensureLine()) {
+        _eof = true;
+        return false;
+    }
+
+    char const* data = _batch->data.data();
+    std::size_t beg = _line == 0 ? 0 : _batch->ends[_line - 1];
+    line.assign(data + beg, data + _batch->ends[_line]);
+    ++_line;
+    return true;
+}
+
+char ReadAheadLineSource::peek() {
+    if (!ensureLine()) {
+        return EOF;
+    }
+
+    std::size_t beg = _line == 0 ? 0 : _batch->ends[_line - 1];
+    // an empty line starts with its newline
+    return beg == _batch->ends[_line] ? '\n' : _batch->data[beg];
+}
+
+bool ReadAheadLineSource::eof() const {
+    return _eof;
+}
+
+bool ReadAheadLineSource::good() const {
+    return !_bad && !eof();
+}
+
+ReadAheadLineSource::operator bool() const {
+    return good();
+}
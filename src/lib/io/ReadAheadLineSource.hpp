@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ILineSource.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Wraps another line source, reading it on a background thread.
+//
+// The reader thread fills batches of lines (about batchSize bytes each)
+// and queues them for the consumer, keeping at most maxBatches ready at
+// once. This lets reading and decompressing the input overlap with parsing
+// it. Lines are returned as views into the current batch, so getline does
+// not copy them a second time.
+//
+// Exceptions thrown by the wrapped source are rethrown to the consumer by
+// the getline or peek call that reaches the point where they happened.
+class ReadAheadLineSource : public ILineSource {
+public:
+    enum {
+        DEFAULT_BATCH_SIZE = 1 << 20,
+        DEFAULT_MAX_BATCHES = 4
+    };
+
+    explicit ReadAheadLineSource(ILineSource::ptr source,
+        std::size_t batchSize = DEFAULT_BATCH_SIZE,
+        std::size_t maxBatches = DEFAULT_MAX_BATCHES);
+    ~ReadAheadLineSource();
+
+    operator bool() const;
+    char peek();
+    bool eof() const;
+    bool good() const;
+    bool getline(std::string& line);
+    bool getline(StringView& line);
+
+private:
+    struct Batch {
+        std::string data;
+        // end offsets of each line in data
+        std::vector<std::size_t> ends;
+        // the wrapped source has no more lines after this batch
+        bool last;
+        // the wrapped source stopped before reaching the end of its input
+        bool bad;
+        std::exception_ptr error;
+    };
+    typedef std::unique_ptr<Batch> BatchPtr;
+
+    void readLoop();
+    bool fill(Batch& batch);
+    // Make sure the current batch has a line left to read, waiting for the
+    // reader thread if needed. Returns false at the end of the input.
+    bool ensureLine();
+
+private:
+    ILineSource::ptr _source;
+    std::size_t _batchSize;
+    std::size_t _maxBatches;
+
+    std::mutex _mutex;
+    std::condition_variable _ready;
+    std::condition_variable _space;
+    std::deque<BatchPtr> _full;
+    std::vector<BatchPtr> _free;
+    bool _stop;
+
+    // consumer side
+    BatchPtr _batch;
+    std::size_t _line;
+    bool _bad;
+    bool _eof;
+
+    std::thread _thread;
+};
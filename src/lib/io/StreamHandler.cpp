@@ -2,11 +2,16 @@
 
 #include "common/Exceptions.hpp"
 #include "common/compat.hpp"
+#include "io/BgzfLineSource.hpp"
 #include "io/GZipLineSource.hpp"
+#include "io/IndexedLineSource.hpp"
+#include "io/MmapLineSource.hpp"
+#include "io/ReadAheadLineSource.hpp"
 
 #include <boost/format.hpp>
 
 #include <cstdio>
+#include <stdexcept>
 
 using namespace std;
 using boost::format;
@@ -14,34 +19,146 @@ using boost::format;
 StreamHandler::StreamHandler()
     : _cinReferences(0)
     , _coutReferences(0)
+    , _threads(ThreadPool::hardwareThreads())
+    , _outputCompression(NONE)
+    , _readAhead(false)
 {
 }
 
 std::vector<InputStream::ptr> StreamHandler::openForReading(
         std::vector<std::string> const& paths)
 {
+    return openForReading(paths, std::vector<GenomicRegion>());
+}
+
+InputStream::ptr StreamHandler::openForReading(std::string const& path) {
+    return open(path, std::vector<GenomicRegion>(), _readAhead);
+}
+
+std::vector<InputStream::ptr> StreamHandler::openForReading(
+        std::vector<std::string> const& paths,
+        std::vector<GenomicRegion> const& regions)
+{
+    bool readAhead = _readAhead && paths.size() <= MAX_READ_AHEAD_INPUTS;
     std::vector<InputStream::ptr> rv;
     for (auto i = paths.begin(); i != paths.end(); ++i) {
-        rv.push_back(openForReading(*i));
+        rv.push_back(open(*i, regions, readAhead));
     }
     return rv;
 }
 
+InputStream::ptr StreamHandler::openForReading(std::string const& path,
+        std::vector<GenomicRegion> const& regions)
+{
+    return open(path, regions, _readAhead);
+}
 
-InputStream::ptr StreamHandler::openForReading(std::string const& path) {
+InputStream::ptr StreamHandler::openWithoutReadAhead(std::string const& path,
+        std::vector<GenomicRegion> const& regions)
+{
+    return open(path, regions, false);
+}
+
+InputStream::ptr StreamHandler::open(std::string const& path,
+        std::vector<GenomicRegion> const& regions, bool readAhead)
+{
     ILineSource::ptr lineSource;
-    if (path == "-") {
-        lineSource = std::make_unique<GZipLineSource>(fileno(stdin));
+    if (!regions.empty()) {
+        if (path == "-" || !BgzfLineSource::isBgzf(path)) {
+            throw IOError(str(format(
+                "Reading regions of %1% requires it to be bgzip compressed and "
+                "indexed") % path));
+        }
+
+        TabixIndex::ptr index = TabixIndex::forDataFile(path);
+        if (!index) {
+            throw IOError(str(format(
+                "No tabix or CSI index (%1%.tbi or %1%.csi) found") % path));
+        }
+
+        auto source = std::make_unique<BgzfLineSource>(path, threadPool());
+        if (!*source) {
+            throw IOError(str(format("Failed to open file %1%") %path));
+        }
+
+        lineSource = std::make_unique<IndexedLineSource>(
+            std::move(source), std::move(index), regions);
     }
     else {
-        lineSource = std::make_unique<GZipLineSource>(path);
+        if (path == "-") {
+            lineSource = std::make_unique<GZipLineSource>(fileno(stdin));
+        }
+        else if (BgzfLineSource::isBgzf(path)) {
+            lineSource = std::make_unique<BgzfLineSource>(path, threadPool());
+        }
+        else if (MmapLineSource::isMappable(path)) {
+            lineSource = std::make_unique<MmapLineSource>(path);
+        }
+        else {
+            lineSource = std::make_unique<GZipLineSource>(path);
+        }
+        if (!*lineSource) {
+            throw IOError(str(format("Failed to open file %1%") %path));
+        }
     }
-    if (!*lineSource) {
-        throw IOError(str(format("Failed to open file %1%") %path));
+
+    if (readAhead) {
+        lineSource = std::make_unique<ReadAheadLineSource>(std::move(lineSource));
     }
     return InputStream::create(path, lineSource);
 }
 
+ThreadPool::ptr StreamHandler::threadPool() {
+    if (!_threadPool && _threads > 0) {
+        _threadPool = ThreadPool::create(_threads);
+    }
+    return _threadPool;
+}
+
+void StreamHandler::outputCompression(CompressionType type) {
+    if (type != NONE && type != BGZF) {
+        throw runtime_error("Output can only be uncompressed or bgzf compressed");
+    }
+    _outputCompression = type;
+}
+
+std::ostream* StreamHandler::getOutput(std::string const& path) {
+    // like getFile, repeated requests for the same output share a stream
+    auto i = _bgzfStreams.find(path);
+    if (i != _bgzfStreams.end()) {
+        if (path == "-") {
+            ++_coutReferences;
+        }
+        return i->second.get();
+    }
+    return getBgzf(path);
+}
+
+std::ostream* StreamHandler::getBgzf(std::string const& path,
+        TabixIndexBuilder::ptr index)
+{
+    if (_bgzfStreams.count(path) || _streams.count(path)) {
+        throw IOError(str(format(
+            "Attempted to open file %1% multiple times in an unsupported way. Abort."
+            ) % path));
+    }
+
+    if (path == "-") {
+        ++_coutReferences;
+    }
+
+    boost::shared_ptr<BgzfOutputStream> s(
+        new BgzfOutputStream(path, std::move(index), threadPool()));
+    _bgzfStreams[path] = s;
+    return s.get();
+}
+
+void StreamHandler::close() {
+    for (auto i = _bgzfStreams.begin(); i != _bgzfStreams.end(); ++i) {
+        i->second->close();
+    }
+}
+
 iostream* StreamHandler::getFile(const std::string& path, openmode mode) {
     auto i = _streams.find(path);
     if (i != _streams.end()) {
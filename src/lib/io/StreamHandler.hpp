@@ -1,7 +1,11 @@
 #pragma once
 
+#include "io/BgzfOutputStream.hpp"
 #include "io/InputStream.hpp"
 #include "io/ILineSource.hpp"
+#include "io/TabixIndexBuilder.hpp"
+#include "common/GenomicRegion.hpp"
+#include "common/ThreadPool.hpp"
 #include "common/cstdint.hpp"
 
 #include <boost/shared_ptr.hpp>
@@ -17,12 +21,32 @@
 class StreamHandler {
 public:
     typedef std::ios_base::openmode openmode;
+    enum { MAX_READ_AHEAD_INPUTS = 4 };
+
     StreamHandler();
 
     InputStream::ptr openForReading(std::string const& path);
     std::vector<InputStream::ptr> openForReading(
             std::vector<std::string> const& paths);
 
+    // Open a file returning only records overlapping the given regions.
+    // This requires a BGZF compressed file with a tabix or CSI index
+    // (path.tbi or path.csi); only the parts of the file that the index
+    // says may hold overlapping records are read. When regions is empty
+    // this is the same as openForReading(path).
+    InputStream::ptr openForReading(std::string const& path,
+            std::vector<GenomicRegion> const& regions);
+    std::vector<InputStream::ptr> openForReading(
+            std::vector<std::string> const& paths,
+            std::vector<GenomicRegion> const& regions);
+
+    // Like openForReading, but never reads ahead. Use this for files of
+    // which only the header or a few lines are read, or when many files
+    // are opened one at a time.
+    InputStream::ptr openWithoutReadAhead(std::string const& path,
+            std::vector<GenomicRegion> const& regions =
+                std::vector<GenomicRegion>());
+
     // T must be istream, ostream, or iostream
     // we can't just use iostream because that won't work for cin/cout
     template<typename T>
@@ -37,9 +61,36 @@ public:
     template<typename StreamType, typename WrapperType>
     std::vector< boost::shared_ptr<WrapperType> > wrap(const std::vector<std::string>& paths);
 
+    // Open path for writing BGZF compressed data. When index is given, it
+    // is built from the lines written (which must be sorted) and saved
+    // alongside the data when the stream is closed.
+    std::ostream* getBgzf(std::string const& path,
+        TabixIndexBuilder::ptr index = TabixIndexBuilder::ptr());
+
+    // Finish writing all BGZF output streams. Throws IOError on failure.
+    void close();
+
     uint32_t cinReferences() const;
     uint32_t coutReferences() const;
 
+    // Number of worker threads used to inflate BGZF input and deflate BGZF
+    // output. The pool is shared by all files opened by this handler. 0
+    // means (de)compress in the reading or writing thread. Must be set
+    // before opening any BGZF files to have an effect.
+    void threads(std::size_t n);
+    ThreadPool::ptr threadPool();
+
+    // Read each file opened with openForReading on a background thread,
+    // so that reading and decompressing it overlaps with parsing. Each
+    // such file costs a thread and a few MiB of buffered lines, so when
+    // more than MAX_READ_AHEAD_INPUTS files are opened at once none of
+    // them are read ahead.
+    void readAhead(bool value);
+
+    // Compression applied to files opened with get<ostream>: NONE or BGZF.
+    void outputCompression(CompressionType type);
+    CompressionType outputCompression() const;
+
 protected:
     struct Stream {
         boost::shared_ptr<std::iostream> stream;
@@ -47,11 +98,19 @@ protected:
     };
 
     std::iostream* getFile(const std::string& path, openmode mode);
+    std::ostream* getOutput(const std::string& path);
+    InputStream::ptr open(std::string const& path,
+        std::vector<GenomicRegion> const& regions, bool readAhead);
 
 protected:
     std::map<std::string, Stream> _streams;
+    std::map<std::string, boost::shared_ptr<BgzfOutputStream>> _bgzfStreams;
     uint32_t _cinReferences;
     uint32_t _coutReferences;
+    std::size_t _threads;
+    ThreadPool::ptr _threadPool;
+    CompressionType _outputCompression;
+    bool _readAhead;
 };
 
 inline uint32_t StreamHandler::cinReferences() const {
@@ -62,6 +121,18 @@ inline uint32_t StreamHandler::coutReferences() const {
     return _coutReferences;
 }
 
+inline void StreamHandler::threads(std::size_t n) {
+    _threads = n;
+}
+
+inline void StreamHandler::readAhead(bool value) {
+    _readAhead = value;
+}
+
+inline CompressionType StreamHandler::outputCompression() const {
+    return _outputCompression;
+}
+
 template<>
 inline std::istream* StreamHandler::get<std::istream>(const std::string& path) {
     if (path == "-") {
@@ -74,7 +145,9 @@ inline std::istream* StreamHandler::get<std::istream>(const std::string& path) {
 
 template<>
 inline std::ostream* StreamHandler::get<std::ostream>(const std::string& path) {
-    if (path == "-") {
+    if (_outputCompression == BGZF) {
+        return getOutput(path);
+    } else if (path == "-") {
         ++_coutReferences;
         return &std::cout;
     } else {
@@ -6,6 +6,7 @@ class StreamLineSource : public ILineSource {
 public:
     explicit StreamLineSource(std::istream& in);
 
+    using ILineSource::getline;
     bool getline(std::string& line);
     char peek();
     bool eof() const;
@@ -0,0 +1,454 @@
+#include "TabixIndex.hpp"
+
+#include "common/Exceptions.hpp"
+
+#include <boost/format.hpp>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    bool fileExists(std::string const& path) {
+        return std::ifstream(path.c_str()).good();
+    }
+
+    uint32_t parentBin(uint32_t bin) {
+        return (bin - 1) >> 3;
+    }
+
+    // All bins that may hold records overlapping [beg, end)
+    void regionToBins(int64_t beg, int64_t end, int minShift, int depth,
+            std::vector<uint32_t>& bins)
+    {
+        bins.clear();
+        --end;
+        int shift = minShift + depth * 3;
+        for (int level = 0; level <= depth; ++level, shift -= 3) {
+            uint32_t offset = TabixIndex::firstBin(level);
+            uint32_t b = offset + (beg >> shift);
+            uint32_t e = offset + (end >> shift);
+            for (uint32_t i = b; i <= e; ++i) {
+                bins.push_back(i);
+            }
+        }
+    }
+
+    bool chunkLess(TabixIndex::Chunk const& a, TabixIndex::Chunk const& b) {
+        return a.beg < b.beg;
+    }
+
+    // The 1-based column n of a tab delimited line. Returns false if the
+    // line does not have that many columns.
+    bool column(StringView const& line, int n, StringView& out) {
+        char const* beg = line.begin();
+        char const* end = line.end();
+        for (int i = 1; i < n; ++i) {
+            char const* tab = static_cast<char const*>(
+                std::memchr(beg, '\t', end - beg));
+            if (!tab) {
+                return false;
+            }
+            beg = tab + 1;
+        }
+
+        char const* tab = static_cast<char const*>(
+            std::memchr(beg, '\t', end - beg));
+        out.assign(beg, tab ? tab : end);
+        return true;
+    }
+
+    bool parsePosition(char const* beg, char const* end, int64_t& pos) {
+        if (beg == end) {
+            return false;
+        }
+
+        pos = 0;
+        for (; beg != end; ++beg) {
+            if (*beg < '0' || *beg > '9') {
+                return false;
+            }
+            pos = pos * 10 + (*beg - '0');
+        }
+        return true;
+    }
+
+    // The value of END in a vcf INFO column, if there is one
+    bool infoEnd(StringView const& info, int64_t& end) {
+        char const* p = info.begin();
+        while (p != info.end()) {
+            char const* semi = std::find(p, info.end(), ';');
+            if (semi - p > 4 && std::memcmp(p, "END=", 4) == 0) {
+                return parsePosition(p + 4, semi, end);
+            }
+            p = semi == info.end() ? semi : semi + 1;
+        }
+        return false;
+    }
+}
+
+int32_t const TabixIndex::TABIX_MIN_SHIFT;
+int32_t const TabixIndex::TABIX_DEPTH;
+
+TabixIndex::Config TabixIndex::Config::vcf() {
+    return Config{VCF, 1, 2, 0, '#', 0};
+}
+
+TabixIndex::Config TabixIndex::Config::bed() {
+    return Config{GENERIC | 0x10000, 1, 2, 3, '#', 0};
+}
+
+TabixIndex::Config TabixIndex::Config::chromPos() {
+    return Config{GENERIC, 1, 2, 0, '#', 0};
+}
+
+void TabixIndex::Config::parseRecord(StringView const& line, StringView& seq,
+        int64_t& beg, int64_t& end) const
+{
+    StringView field;
+    if (!column(line, seqColumn, seq)
+        || !column(line, beginColumn, field)
+        || !parsePosition(field.begin(), field.end(), beg))
+    {
+        throw IOError(str(boost::format(
+            "Failed to find sequence and position of record: %1%") % line));
+    }
+
+    if (!zeroBased()) {
+        --beg;
+    }
+
+    end = 0;
+    if (type() == VCF) {
+        // the end of a vcf record is given by INFO/END if present (e.g.,
+        // for symbolic alleles), otherwise by the length of REF.
+        if (!column(line, 8, field) || !infoEnd(field, end)) {
+            if (column(line, 4, field)) {
+                end = beg + field.size();
+            }
+        }
+    }
+    else if (endColumn > 0) {
+        if (!column(line, endColumn, field)
+            || !parsePosition(field.begin(), field.end(), end))
+        {
+            throw IOError(str(boost::format(
+                "Failed to find end position of record: %1%") % line));
+        }
+    }
+
+    // zero length records (e.g., bed insertions) hit the base after them
+    end = std::max(end, beg + 1);
+}
+
+uint32_t TabixIndex::firstBin(int level) {
+    return ((1u << (level * 3)) - 1) / 7;
+}
+
+uint32_t TabixIndex::regionToBin(int64_t beg, int64_t end,
+        int minShift, int depth)
+{
+    --end;
+    int shift = minShift;
+    for (int level = depth; level > 0; --level, shift += 3) {
+        if (beg >> shift == end >> shift) {
+            return firstBin(level) + (beg >> shift);
+        }
+    }
+    return 0;
+}
+
+// Sequential little endian reader over the decompressed index
+class TabixIndex::Reader {
+public:
+    explicit Reader(std::string const& path)
+        : _path(path)
+        , _pos(0)
+    {
+        gzFile fp = gzopen(path.c_str(), "rb");
+        if (fp == Z_NULL) {
+            throw IOError(str(boost::format("Failed to open index file %1%") % path));
+        }
+
+        char buf[65536];
+        int n;
+        while ((n = gzread(fp, buf, sizeof(buf))) > 0) {
+            _data.append(buf, n);
+        }
+        gzclose(fp);
+
+        if (n < 0) {
+            throw IOError(str(boost::format("Failed to read index file %1%") % path));
+        }
+    }
+
+    std::string const& path() const {
+        return _path;
+    }
+
+    char const* bytes(std::size_t n) {
+        if (_data.size() - _pos < n) {
+            throw IOError(str(boost::format("Truncated index file %1%") % _path));
+        }
+        char const* rv = _data.data() + _pos;
+        _pos += n;
+        return rv;
+    }
+
+    uint64_t readUnsigned(std::size_t n) {
+        unsigned char const* p = reinterpret_cast<unsigned char const*>(bytes(n));
+        uint64_t rv = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            rv |= uint64_t(p[i]) << (8 * i);
+        }
+        return rv;
+    }
+
+    int32_t int32() {
+        return int32_t(uint32_t(readUnsigned(4)));
+    }
+
+    uint32_t uint32() {
+        return uint32_t(readUnsigned(4));
+    }
+
+    uint64_t uint64() {
+        return readUnsigned(8);
+    }
+
+    // A count that must not be negative
+    std::size_t count() {
+        int32_t n = int32();
+        if (n < 0) {
+            throw IOError(str(boost::format("Corrupt index file %1%") % _path));
+        }
+        return n;
+    }
+
+private:
+    std::string _path;
+    std::string _data;
+    std::size_t _pos;
+};
+
+TabixIndex::TabixIndex()
+    : _csi(false)
+    , _minShift(TABIX_MIN_SHIFT)
+    , _depth(TABIX_DEPTH)
+    , _config(Config::chromPos())
+{
+}
+
+TabixIndex::ptr TabixIndex::fromFile(std::string const& indexPath) {
+    Reader in(indexPath);
+    ptr rv(new TabixIndex);
+    rv->_path = indexPath;
+
+    char const* magic = in.bytes(4);
+    if (std::memcmp(magic, "TBI\1", 4) == 0) {
+        rv->parseTabix(in);
+    }
+    else if (std::memcmp(magic, "CSI\1", 4) == 0) {
+        rv->parseCsi(in);
+    }
+    else {
+        throw IOError(str(boost::format(
+            "%1% is not a tabix or CSI index") % indexPath));
+    }
+
+    return rv;
+}
+
+TabixIndex::ptr TabixIndex::forDataFile(std::string const& dataPath) {
+    std::string tbi = dataPath + ".tbi";
+    if (fileExists(tbi)) {
+        return fromFile(tbi);
+    }
+
+    std::string csi = dataPath + ".csi";
+    if (fileExists(csi)) {
+        return fromFile(csi);
+    }
+
+    return ptr();
+}
+
+void TabixIndex::parseTabix(Reader& in) {
+    std::size_t nRef = in.count();
+    parseConfig(in);
+    if (_names.size() != nRef) {
+        throw IOError(str(boost::format(
+            "Corrupt index file %1%: expected %2% sequence names, found %3%"
+            ) % in.path() % nRef % _names.size()));
+    }
+    parseReferences(in, false);
+}
+
+void TabixIndex::parseCsi(Reader& in) {
+    _csi = true;
+    _minShift = in.int32();
+    _depth = in.int32();
+    if (_minShift <= 0 || _depth <= 0 || _minShift + 3 * _depth > 62) {
+        throw IOError(str(boost::format(
+            "Corrupt index file %1%: invalid binning scheme") % in.path()));
+    }
+
+    std::size_t auxSize = in.count();
+    if (auxSize < 28) {
+        throw IOError(str(boost::format(
+            "CSI index %1% does not describe a tab delimited file"
+            ) % in.path()));
+    }
+    parseConfig(in);
+
+    std::size_t nRef = in.count();
+    if (_names.size() != nRef) {
+        throw IOError(str(boost::format(
+            "Corrupt index file %1%: expected %2% sequence names, found %3%"
+            ) % in.path() % nRef % _names.size()));
+    }
+    parseReferences(in, true);
+}
+
+void TabixIndex::parseConfig(Reader& in) {
+    _config.format = in.int32();
+    _config.seqColumn = in.int32();
+    _config.beginColumn = in.int32();
+    _config.endColumn = in.int32();
+    _config.meta = char(in.int32());
+    _config.skip = in.int32();
+
+    std::size_t namesSize = in.count();
+    char const* names = in.bytes(namesSize);
+    char const* end = names + namesSize;
+    while (names < end) {
+        char const* nul = static_cast<char const*>(
+            std::memchr(names, '\0', end - names));
+        if (!nul) {
+            nul = end;
+        }
+        _nameIds[std::string(names, nul)] = _names.size();
+        _names.push_back(std::string(names, nul));
+        names = nul + 1;
+    }
+}
+
+void TabixIndex::parseReferences(Reader& in, bool csi) {
+    // the bin after the last real one holds metadata, not records
+    uint32_t pseudoBin = firstBin(_depth + 1) + 1;
+
+    _refs.resize(_names.size());
+    for (auto ref = _refs.begin(); ref != _refs.end(); ++ref) {
+        std::size_t nBin = in.count();
+        for (std::size_t i = 0; i < nBin; ++i) {
+            uint32_t binId = in.uint32();
+            Bin bin;
+            bin.loffset = csi ? in.uint64() : 0;
+            std::size_t nChunk = in.count();
+            bin.chunks.resize(nChunk);
+            for (std::size_t j = 0; j < nChunk; ++j) {
+                bin.chunks[j].beg = in.uint64();
+                bin.chunks[j].end = in.uint64();
+            }
+
+            if (binId != pseudoBin) {
+                ref->bins[binId] = std::move(bin);
+            }
+        }
+
+        if (!csi) {
+            std::size_t nIntervals = in.count();
+            ref->linear.resize(nIntervals);
+            for (std::size_t i = 0; i < nIntervals; ++i) {
+                ref->linear[i] = in.uint64();
+            }
+        }
+    }
+}
+
+int32_t TabixIndex::sequenceId(std::string const& name) const {
+    auto i = _nameIds.find(name);
+    return i == _nameIds.end() ? -1 : i->second;
+}
+
+uint64_t TabixIndex::minOffset(Reference const& ref, int64_t beg) const {
+    if (!_csi) {
+        if (ref.linear.empty()) {
+            return 0;
+        }
+        std::size_t idx = beg >> _minShift;
+        return idx < ref.linear.size() ? ref.linear[idx] : ref.linear.back();
+    }
+
+    // CSI stores the offset in each bin instead. use the smallest bin
+    // containing beg that is present in the index.
+    uint32_t bin = firstBin(_depth) + (beg >> _minShift);
+    while (true) {
+        auto i = ref.bins.find(bin);
+        if (i != ref.bins.end()) {
+            return i->second.loffset;
+        }
+        if (bin == 0) {
+            return 0;
+        }
+        bin = parentBin(bin);
+    }
+}
+
+std::vector<TabixIndex::Chunk> TabixIndex::query(
+        int32_t tid, int64_t beg, int64_t end) const
+{
+    std::vector<Chunk> rv;
+    if (tid < 0 || std::size_t(tid) >= _refs.size()) {
+        return rv;
+    }
+
+    int64_t maxPos = int64_t(1) << (_minShift + 3 * _depth);
+    beg = std::max(beg, int64_t(0));
+    end = std::min(end, maxPos);
+    if (end <= beg) {
+        return rv;
+    }
+
+    Reference const& ref = _refs[tid];
+    uint64_t minOff = minOffset(ref, beg);
+
+    std::vector<uint32_t> bins;
+    regionToBins(beg, end, _minShift, _depth, bins);
+    for (auto b = bins.begin(); b != bins.end(); ++b) {
+        auto bin = ref.bins.find(*b);
+        if (bin == ref.bins.end()) {
+            continue;
+        }
+
+        auto const& chunks = bin->second.chunks;
+        for (auto c = chunks.begin(); c != chunks.end(); ++c) {
+            if (c->end > minOff) {
+                rv.push_back(*c);
+            }
+        }
+    }
+
+    // merge overlapping and adjacent chunks
+    std::sort(rv.begin(), rv.end(), &chunkLess);
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < rv.size(); ++i) {
+        if (n > 0 && rv[i].beg <= rv[n - 1].end) {
+            rv[n - 1].end = std::max(rv[n - 1].end, rv[i].end);
+        }
+        else {
+            rv[n++] = rv[i];
+        }
+    }
+    rv.resize(n);
+
+    // chunks may start before the minimum offset (only their ends were
+    // checked above). there is no point reading that data.
+    if (!rv.empty() && rv[0].beg < minOff) {
+        rv[0].beg = minOff;
+    }
+
+    return rv;
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "common/StringView.hpp"
+#include "common/cstdint.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Reader for tabix (.tbi) and CSI (.csi) indexes of BGZF compressed,
+// position sorted text files (see the tabix and CSI specifications in the
+// hts-specs repository).
+//
+// Both formats divide each sequence into a hierarchy of bins. Each bin
+// lists the chunks (ranges of BGZF virtual offsets) holding records that
+// fall in it. Querying a region returns the (merged) chunks that may hold
+// overlapping records. The caller must still check each record read.
+class TabixIndex {
+public:
+    typedef std::unique_ptr<TabixIndex> ptr;
+
+    enum Format {
+        GENERIC = 0,
+        SAM = 1,
+        VCF = 2
+    };
+
+    // Describes where to find the sequence and coordinates of each record.
+    // This is stored in both .tbi and .csi indexes of text files.
+    struct Config {
+        int32_t format;
+        // 1-based column numbers. endColumn is 0 if there is no end column.
+        int32_t seqColumn;
+        int32_t beginColumn;
+        int32_t endColumn;
+        // lines starting with this character are comments
+        char meta;
+        // number of lines to skip at the start of the file
+        int32_t skip;
+
+        // the same as tabix's presets
+        static Config vcf();
+        static Config bed();
+        // chromosome and 1-based position (e.g., joinx chrompos files)
+        static Config chromPos();
+
+        Format type() const;
+        // true if begin coordinates in the data are 0-based (e.g., BED)
+        bool zeroBased() const;
+
+        // Find the sequence and 0-based, half open interval of the record
+        // on the given line. Zero length records are given length 1. Throws
+        // IOError if the line is missing the required columns.
+        void parseRecord(StringView const& line, StringView& seq,
+            int64_t& beg, int64_t& end) const;
+    };
+
+    struct Chunk {
+        uint64_t beg;
+        uint64_t end;
+    };
+
+    // The tabix binning scheme. CSI files give their own.
+    static int32_t const TABIX_MIN_SHIFT = 14;
+    static int32_t const TABIX_DEPTH = 5;
+
+    // The first bin number at the given level of a binning scheme
+    static uint32_t firstBin(int level);
+    // The smallest bin holding all of [beg, end)
+    static uint32_t regionToBin(int64_t beg, int64_t end,
+        int minShift, int depth);
+
+    // Load the index at indexPath. Throws IOError if it cannot be read.
+    static ptr fromFile(std::string const& indexPath);
+
+    // Find and load the index for the data file at dataPath, looking for
+    // dataPath.tbi and then dataPath.csi. Returns null if neither exists.
+    static ptr forDataFile(std::string const& dataPath);
+
+    Config const& config() const;
+    Format format() const;
+    bool zeroBased() const;
+    int seqColumn() const;
+    int beginColumn() const;
+    int endColumn() const;
+    char meta() const;
+    int skip() const;
+
+    std::vector<std::string> const& sequenceNames() const;
+    // The id of the named sequence, or -1 if it is not in the index
+    int32_t sequenceId(std::string const& name) const;
+
+    // Chunks that may contain records overlapping the 0-based, half-open
+    // interval [beg, end) of sequence tid, sorted by offset.
+    std::vector<Chunk> query(int32_t tid, int64_t beg, int64_t end) const;
+
+private:
+    struct Bin {
+        uint64_t loffset;
+        std::vector<Chunk> chunks;
+    };
+
+    struct Reference {
+        std::map<uint32_t, Bin> bins;
+        // tabix only: the smallest offset of records starting in each
+        // 2^minShift window
+        std::vector<uint64_t> linear;
+    };
+
+    class Reader;
+
+    TabixIndex();
+    void parseTabix(Reader& in);
+    void parseCsi(Reader& in);
+    void parseConfig(Reader& in);
+    void parseReferences(Reader& in, bool csi);
+    uint64_t minOffset(Reference const& ref, int64_t beg) const;
+
+private:
+    std::string _path;
+    bool _csi;
+    int32_t _minShift;
+    int32_t _depth;
+    Config _config;
+    std::vector<std::string> _names;
+    std::map<std::string, int32_t> _nameIds;
+    std::vector<Reference> _refs;
+};
+
+inline TabixIndex::Format TabixIndex::Config::type() const {
+    return Format(format & 0xffff);
+}
+
+inline bool TabixIndex::Config::zeroBased() const {
+    return (format & 0x10000) != 0;
+}
+
+inline TabixIndex::Config const& TabixIndex::config() const {
+    return _config;
+}
+
+inline TabixIndex::Format TabixIndex::format() const {
+    return _config.type();
+}
+
+inline bool TabixIndex::zeroBased() const {
+    return _config.zeroBased();
+}
+
+inline int TabixIndex::seqColumn() const {
+    return _config.seqColumn;
+}
+
+inline int TabixIndex::beginColumn() const {
+    return _config.beginColumn;
+}
+
+inline int TabixIndex::endColumn() const {
+    return _config.endColumn;
+}
+
+inline char TabixIndex::meta() const {
+    return _config.meta;
+}
+
+inline int TabixIndex::skip() const {
+    return _config.skip;
+}
+
+inline std::vector<std::string> const& TabixIndex::sequenceNames() const {
+    return _names;
+}
@@ -0,0 +1,231 @@
+#include "TabixIndexBuilder.hpp"
+
+#include "Bgzf.hpp"
+#include "common/Exceptions.hpp"
+#include "common/UnsortedDataError.hpp"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+    // CSI lets us pick the binning scheme. This is tabix's, with one more
+    // level to allow for sequences up to 2^32 bases long.
+    int32_t const CSI_DEPTH = 6;
+
+    uint64_t const UNSET = std::numeric_limits<uint64_t>::max();
+
+    void putInt32(std::string& out, int32_t x) {
+        uint32_t v = uint32_t(x);
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(char((v >> (8 * i)) & 0xff));
+        }
+    }
+
+    void putUint64(std::string& out, uint64_t x) {
+        for (int i = 0; i < 8; ++i) {
+            out.push_back(char((x >> (8 * i)) & 0xff));
+        }
+    }
+
+    // The position at which bin starts
+    int64_t binStart(uint32_t bin, int minShift, int depth) {
+        int level = depth;
+        while (level > 0 && bin < TabixIndex::firstBin(level)) {
+            --level;
+        }
+        int shift = minShift + 3 * (depth - level);
+        return int64_t(bin - TabixIndex::firstBin(level)) << shift;
+    }
+}
+
+TabixIndexBuilder::IndexType TabixIndexBuilder::indexTypeFromString(
+        std::string const& s)
+{
+    if (s == "tbi") {
+        return TBI;
+    }
+    else if (s == "csi") {
+        return CSI;
+    }
+
+    throw std::runtime_error(str(boost::format(
+        "Invalid index type '%1%'. Expected one of: tbi,csi") % s));
+}
+
+TabixIndexBuilder::TabixIndexBuilder(IndexType type,
+        TabixIndex::Config const& config)
+    : _type(type)
+    , _config(config)
+    , _minShift(TabixIndex::TABIX_MIN_SHIFT)
+    , _depth(type == CSI ? CSI_DEPTH : TabixIndex::TABIX_DEPTH)
+    , _maxPosition(int64_t(1) << (_minShift + 3 * _depth))
+    , _lastBegin(0)
+    , _lineCount(0)
+{
+}
+
+std::string TabixIndexBuilder::extension() const {
+    return _type == CSI ? ".csi" : ".tbi";
+}
+
+void TabixIndexBuilder::addLine(StringView const& line,
+        uint64_t beg, uint64_t end)
+{
+    if (_lineCount++ < _config.skip || line.empty()
+        || line[0] == _config.meta)
+    {
+        return;
+    }
+
+    StringView seqView;
+    int64_t pos;
+    int64_t stop;
+    _config.parseRecord(line, seqView, pos, stop);
+
+    if (stop > _maxPosition) {
+        throw IOError(str(boost::format(
+            "Position %1% is too large for a %2% index (the maximum is %3%)"
+            ) % stop % extension() % _maxPosition));
+    }
+
+    if (_names.empty() || !(_names.back() == seqView)) {
+        std::string seq(seqView.begin(), seqView.end());
+        if (_nameIds.count(seq)) {
+            throw UnsortedDataError(str(boost::format(
+                "Unable to index unsorted data: records for sequence %1% are "
+                "not contiguous") % seq));
+        }
+        _nameIds[seq] = _names.size();
+        _names.push_back(seq);
+        _refs.push_back(Reference());
+        _lastBegin = 0;
+    }
+
+    if (pos < _lastBegin) {
+        throw UnsortedDataError(str(boost::format(
+            "Unable to index unsorted data: %1%:%2% follows %1%:%3%"
+            ) % _names.back() % pos % _lastBegin));
+    }
+    _lastBegin = pos;
+
+    Reference& ref = _refs.back();
+
+    // records in the same bgzf block share a chunk, even if records from
+    // other bins come between them
+    auto& chunks = ref.bins[TabixIndex::regionToBin(pos, stop, _minShift, _depth)];
+    if (!chunks.empty()
+        && Bgzf::blockOffset(chunks.back().end) == Bgzf::blockOffset(beg))
+    {
+        chunks.back().end = end;
+    }
+    else {
+        chunks.push_back(TabixIndex::Chunk{beg, end});
+    }
+
+    std::size_t firstWindow = pos >> _minShift;
+    std::size_t lastWindow = (stop - 1) >> _minShift;
+    if (ref.linear.size() <= lastWindow) {
+        ref.linear.resize(lastWindow + 1, UNSET);
+    }
+    for (std::size_t w = firstWindow; w <= lastWindow; ++w) {
+        if (ref.linear[w] == UNSET) {
+            ref.linear[w] = beg;
+        }
+    }
+}
+
+void TabixIndexBuilder::writeConfig(std::string& out) const {
+    putInt32(out, _config.format);
+    putInt32(out, _config.seqColumn);
+    putInt32(out, _config.beginColumn);
+    putInt32(out, _config.endColumn);
+    putInt32(out, _config.meta);
+    putInt32(out, _config.skip);
+
+    std::string names;
+    for (auto i = _names.begin(); i != _names.end(); ++i) {
+        names += *i;
+        names += '\0';
+    }
+    putInt32(out, names.size());
+    out += names;
+}
+
+void TabixIndexBuilder::write(std::string const& path) const {
+    std::string data;
+    if (_type == TBI) {
+        data.append("TBI\1", 4);
+        putInt32(data, _names.size());
+        writeConfig(data);
+    }
+    else {
+        data.append("CSI\1", 4);
+        putInt32(data, _minShift);
+        putInt32(data, _depth);
+        std::string aux;
+        writeConfig(aux);
+        putInt32(data, aux.size());
+        data += aux;
+        putInt32(data, _names.size());
+    }
+
+    for (auto ref = _refs.begin(); ref != _refs.end(); ++ref) {
+        // windows without records of their own can start at the offset of
+        // the window before them
+        std::vector<uint64_t> linear(ref->linear);
+        uint64_t last = 0;
+        for (auto i = linear.begin(); i != linear.end(); ++i) {
+            if (*i == UNSET) {
+                *i = last;
+            }
+            last = *i;
+        }
+
+        putInt32(data, ref->bins.size());
+        for (auto bin = ref->bins.begin(); bin != ref->bins.end(); ++bin) {
+            putInt32(data, bin->first);
+            if (_type == CSI) {
+                std::size_t w = binStart(bin->first, _minShift, _depth) >> _minShift;
+                putUint64(data, w < linear.size() ? linear[w] : last);
+            }
+
+            putInt32(data, bin->second.size());
+            for (auto c = bin->second.begin(); c != bin->second.end(); ++c) {
+                putUint64(data, c->beg);
+                putUint64(data, c->end);
+            }
+        }
+
+        if (_type == TBI) {
+            putInt32(data, linear.size());
+            for (auto i = linear.begin(); i != linear.end(); ++i) {
+                putUint64(data, *i);
+            }
+        }
+    }
+
+    std::FILE* fp = std::fopen(path.c_str(), "wb");
+    if (!fp) {
+        throw IOError(str(boost::format(
+            "Failed to open index file %1% for writing") % path));
+    }
+
+    bool ok = true;
+    std::string block;
+    for (std::size_t pos = 0; ok && pos < data.size(); pos += Bgzf::MAX_INPUT_SIZE) {
+        std::size_t n = std::min<std::size_t>(Bgzf::MAX_INPUT_SIZE, data.size() - pos);
+        Bgzf::deflateBlock(data.data() + pos, n, block);
+        ok = std::fwrite(block.data(), 1, block.size(), fp) == block.size();
+    }
+    ok = ok && std::fwrite(Bgzf::EOF_BLOCK, 1, sizeof(Bgzf::EOF_BLOCK), fp)
+        == sizeof(Bgzf::EOF_BLOCK);
+    ok = (std::fclose(fp) == 0) && ok;
+
+    if (!ok) {
+        throw IOError(str(boost::format("Failed to write index file %1%") % path));
+    }
+}
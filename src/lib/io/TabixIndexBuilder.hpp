@@ -0,0 +1,66 @@
+#pragma once
+
+#include "TabixIndex.hpp"
+#include "common/StringView.hpp"
+#include "common/cstdint.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Builds a tabix (.tbi) or CSI (.csi) index from the lines of a BGZF file
+// as they are written. Lines must be given in file order along with their
+// start and end virtual offsets, and records must be sorted by sequence and
+// position (as tabix requires). Comment and header lines are accepted and
+// left out of the index.
+class TabixIndexBuilder {
+public:
+    typedef std::unique_ptr<TabixIndexBuilder> ptr;
+
+    enum IndexType {
+        TBI,
+        CSI
+    };
+
+    // Parse "tbi" or "csi". Throws std::runtime_error for anything else.
+    static IndexType indexTypeFromString(std::string const& s);
+
+    TabixIndexBuilder(IndexType type, TabixIndex::Config const& config);
+
+    IndexType indexType() const;
+    // The extension (".tbi" or ".csi") to give the index file
+    std::string extension() const;
+
+    // Add the line stored at virtual offsets [beg, end). Throws
+    // UnsortedDataError if records are out of order.
+    void addLine(StringView const& line, uint64_t beg, uint64_t end);
+
+    // Write the (BGZF compressed) index to path. Throws IOError on failure.
+    void write(std::string const& path) const;
+
+private:
+    struct Reference {
+        std::map<uint32_t, std::vector<TabixIndex::Chunk>> bins;
+        std::vector<uint64_t> linear;
+    };
+
+    void writeConfig(std::string& out) const;
+
+private:
+    IndexType _type;
+    TabixIndex::Config _config;
+    int32_t _minShift;
+    int32_t _depth;
+    int64_t _maxPosition;
+
+    std::vector<std::string> _names;
+    std::map<std::string, int32_t> _nameIds;
+    std::vector<Reference> _refs;
+    int64_t _lastBegin;
+    int _lineCount;
+};
+
+inline TabixIndexBuilder::IndexType TabixIndexBuilder::indexType() const {
+    return _type;
+}
@@ -2,8 +2,6 @@
 #include "fileformats/vcf/Header.hpp"
 #include "common/Sequence.hpp"
 
-#include <boost/bind.hpp>
-
 #include <locale>
 #include <string>
 #include <boost/format.hpp>
@@ -16,10 +14,6 @@ using namespace std;
 
 BEGIN_NAMESPACE(Metrics)
 namespace {
-    bool customTypeIdMatches(string const& id, Vcf::CustomType const* type) {
-        return type && type->id() == id;
-    }
-
     bool minorAlleleSort (int i,int j) { return (i != 0 && i<j); }
 
     bool isRefOrNull(Vcf::GenotypeIndex const& gtidx) {
@@ -42,9 +36,11 @@ EntryMetrics::EntryMetrics(Vcf::Entry const& entry, std::vector<std::string> con
 void EntryMetrics::calculateGenotypeDistribution() {
     // convenience
     auto const& sd = _entry.sampleData();
+    uint32_t nSamples = _entry.header().sampleCount();
 
-    for (auto i = sd.begin(); i != sd.end(); ++i) {
-        auto const& sampleIdx = i->first;
+    for (uint32_t sampleIdx = 0; sampleIdx < nSamples; ++sampleIdx) {
+        if (!sd.count(sampleIdx))
+            continue;
 
         // skip filtered samples
         if (sd.isSampleFiltered(sampleIdx))
@@ -190,7 +186,7 @@ void EntryMetrics::identifyNovelAlleles() {
             if(database->size() == numAlts) {
                 //we know we have the same number of values as alts
                 for(Vcf::CustomValue::SizeType j = 0; j != _novelByAlt.size(); ++j) {
-                    _novelByAlt[j] = _novelByAlt[j] && database->getAny(j) == 0;
+                    _novelByAlt[j] = _novelByAlt[j] && database->getAny(j).which() == 0;
                 }
             }
             else {
@@ -291,9 +287,7 @@ void SampleMetrics::processEntry(Vcf::Entry& e, EntryMetrics& m) {
 
     // convenience
     auto const& sd = e.sampleData();
-    auto const& fmt = sd.format();
-    uint64_t offset = distance(fmt.begin(), find_if(fmt.begin(), fmt.end(),
-            boost::bind(&customTypeIdMatches, "FT", _1)));
+    uint32_t nSamples = e.header().sampleCount();
 
     locale loc;
     std::string ref(e.ref());   //for mutation spectrum
@@ -310,14 +304,13 @@ void SampleMetrics::processEntry(Vcf::Entry& e, EntryMetrics& m) {
         }
     }
 
-    for (auto i = sd.begin(); i != sd.end(); ++i) {
-        auto const& sampleIdx = i->first;
-        if (i->second == 0)
+    for (uint32_t sampleIdx = 0; sampleIdx < nSamples; ++sampleIdx) {
+        if (!sd.count(sampleIdx))
             continue;
-        auto const& values = *i->second;
 
-        if (values.size() > offset) {
-            const std::string *filter(values[offset].get<std::string>(0));
+        Vcf::CustomValue const* ft = sd.get(sampleIdx, "FT");
+        if (ft) {
+            const std::string *filter(ft->get<std::string>(0));
             if (filter != 0 && *filter != "PASS") {
                 ++_perSampleFilteredCall[sampleIdx];
                 continue;
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common/CoordinateView.hpp"
+#include "common/LocusCompare.hpp"
+
+// Decides whether two loci intersect, or which comes first if they don't.
+// Loci on different sequences are ordered by SequenceDictionary. Identical
+// insertions (zero length loci) intersect, and with adjacentInsertions, so
+// does an insertion immediately before or after the other locus.
+class IntersectCompare {
+public:
+    enum Result {
+        BEFORE,
+        INTERSECT,
+        AFTER
+    };
+
+    explicit IntersectCompare(bool adjacentInsertions = false)
+        : _adjacentInsertions(adjacentInsertions)
+    {}
+
+    template<typename TA, typename TB>
+    Result operator()(TA const& a, TB const& b) const {
+        int rv = detail::compareChrom(DefaultCoordinateView(), a, b, 0);
+        if (rv < 0)
+            return BEFORE;
+        if (rv > 0)
+            return AFTER;
+
+        if (_adjacentInsertions) {
+            // to handle adjacent/exact match insertions!
+            if ((containsInsertions(a) && (a.stop() == b.start() || a.start() == b.stop())) ||
+                (containsInsertions(b) && (b.stop() == a.start() || b.start() == a.stop())) )
+            {
+                return INTERSECT;
+            }
+        }
+        // to handle identical insertions
+        else if (a.start() == a.stop() && b.start() == b.stop() && a.start() == b.start())
+            return INTERSECT;
+
+        if (a.stop() <= b.start())
+            return BEFORE;
+        if (b.stop() <= a.start())
+            return AFTER;
+
+        return INTERSECT;
+    }
+
+    bool adjacentInsertions() const {
+        return _adjacentInsertions;
+    }
+
+private:
+    bool _adjacentInsertions;
+};
+
+// Called by the intersectors once every value from B intersecting a has
+// been passed to the collector (and a to missA, if it hit nothing).
+// Collectors that need to know when a is done provide an overload.
+template<typename CollectorType, typename TypeA>
+inline void finishA(CollectorType&, TypeA const&) {}
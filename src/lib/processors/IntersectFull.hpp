@@ -1,13 +1,26 @@
 #pragma once
 
+#include "IntersectCompare.hpp"
 #include "common/UnsortedDataError.hpp"
+#include "common/cstdint.hpp"
 
 #include <boost/format.hpp>
+
+#include <algorithm>
+#include <cstddef>
 #include <cstring>
-#include <list>
+#include <vector>
 
 // This class is capable of performing intersection as well as symmetric
 // difference.
+//
+// Records from B that may still intersect later records from A are cached
+// in a ring buffer, in the order they were read. Records are swapped into
+// the buffer, so their storage is reused by the stream for the records read
+// after them. Records that can no longer intersect anything are dropped by
+// moving the ones still needed before them back over them and advancing
+// the front of the buffer, which costs no more than the scan that found
+// them.
 template<typename StreamTypeA, typename StreamTypeB, typename CollectorType>
 class IntersectFull {
 public: // types and data
@@ -17,27 +30,22 @@ public: // types and data
 
     // cache types
     struct CacheEntry {
-        CacheEntry(const TypeB& v) : value(v), hit(false) {}
-        CacheEntry(const TypeB& v, bool hit) : value(v), hit(hit) {}
+        CacheEntry() : hit(false), removed(false) {}
 
         TypeB value;
         bool hit;
+        bool removed;
     };
 
-    typedef typename std::list<CacheEntry> CacheType;
-    typedef typename CacheType::iterator CacheIterator;
-
-    // compare results
-    enum Compare {
-        BEFORE,
-        INTERSECT,
-        AFTER
-    };
-
+    typedef IntersectCompare::Result Compare;
 
 public: // code
     IntersectFull(StreamTypeA& a, StreamTypeB& b, CollectorType& rc, bool adjacentInsertions = false)
-        : _a(a) , _b(b), _rc(rc), _adjacentInsertions(adjacentInsertions)
+        : _a(a) , _b(b), _rc(rc), _compare(adjacentInsertions)
+        , _cache(MIN_CACHE_SIZE)
+        , _head(0)
+        , _size(0)
+        , _maxStop(0)
     {
     }
 
@@ -45,48 +53,7 @@ public: // code
 
     template<typename TA, typename TB>
     Compare compare(const TA& a, const TB& b) const {
-        if (_adjacentInsertions)
-            return compareWithAdjacentInsertions(a, b);
-
-        int rv = strverscmp(a.chrom().c_str(), b.chrom().c_str());
-        if (rv < 0)
-            return BEFORE;
-        if (rv > 0)
-            return AFTER;
-
-        // to handle identical insertions
-        if (a.start() == a.stop() && b.start() == b.stop() && a.start() == b.start())
-            return INTERSECT;
-
-        if (a.stop() <= b.start())
-            return BEFORE;
-        if (b.stop() <= a.start())
-            return AFTER;
-
-        return INTERSECT;
-    }
-
-    template<typename TA, typename TB>
-    Compare compareWithAdjacentInsertions(const TA& a, const TB& b) const {
-        int rv = strverscmp(a.chrom().c_str(), b.chrom().c_str());
-        if (rv < 0)
-            return BEFORE;
-        if (rv > 0)
-            return AFTER;
-
-        // to handle adjacent/exact match insertions!
-        if ((containsInsertions(a) && (a.stop() == b.start() || a.start() == b.stop())) ||
-            (containsInsertions(b) && (b.stop() == a.start() || b.start() == a.stop())) )
-        {
-            return INTERSECT;
-        }
-
-        if (a.stop() <= b.start())
-            return BEFORE;
-        if (b.stop() <= a.start())
-            return AFTER;
-
-        return INTERSECT;
+        return _compare(a, b);
     }
 
     bool eof() const {
@@ -95,33 +62,43 @@ public: // code
 
     bool checkCache(const TypeA& valueA) {
         bool rv = false;
-        auto iter = _cache.begin();
-        while (iter != _cache.end()) {
-            Compare cmp = compare(valueA, iter->value);
-            if (cmp == BEFORE) {
+        std::size_t removed = 0;
+        std::size_t i = 0;
+        for (; i < _size; ++i) {
+            CacheEntry& e = cacheAt(i);
+            Compare cmp = compare(valueA, e.value);
+            if (cmp == IntersectCompare::BEFORE) {
                 break;
-            } else if (cmp == AFTER) {
-                auto toRemove = iter;
-                ++iter;
-                cacheRemove(toRemove);
+            } else if (cmp == IntersectCompare::AFTER) {
+                cacheRemove(e);
+                e.removed = true;
+                ++removed;
                 continue;
             }
 
-            bool isHit = _rc.hit(valueA, iter->value);
+            bool isHit = _rc.hit(valueA, e.value);
             rv |= isHit;
-            iter->hit |= isHit;
-            ++iter;
+            e.hit |= isHit;
         }
+
+        if (removed > 0)
+            dropRemoved(i, removed);
         return rv;
     }
 
+    // Reads the next value, checking that the one after it doesn't come
+    // before it. Checking ahead rather than behind means values can be
+    // moved away once they have been read.
     template<typename T, typename S>
     bool advanceSorted(S& stream, T& value) {
         using boost::format;
+        if (!stream.next(value))
+            return false;
+
         T* peek = NULL;
-        if (stream.peek(&peek) && compare(*peek, value) == BEFORE)
+        if (!stream.eof() && stream.peek(&peek) && compare(*peek, value) == IntersectCompare::BEFORE)
             throw UnsortedDataError(str(format("Unsorted data found in stream %1%\n'%2%' follows '%3%'") %stream.name() %peek->toString() %value.toString()));
-        return stream.next(value);
+        return true;
     }
 
     void execute() {
@@ -129,13 +106,15 @@ public: // code
         TypeB valueB;
         while (!_a.eof() && advanceSorted(_a, valueA)) {
             // burn entries from the cache
-            while (!_cache.empty() && compare(valueA, _cache.front().value) == AFTER)
+            if (cacheExpired(valueA))
+                clearCache();
+            while (_size > 0 && compare(valueA, cacheAt(0).value) == IntersectCompare::AFTER)
                 popCache();
 
             // look ahead and burn entries from the input file
             TypeB* peek = NULL;
-            if (_cache.empty()) {
-                while (!_b.eof() && _b.peek(&peek) && compare(valueA, *peek) == AFTER) {
+            if (_size == 0) {
+                while (!_b.eof() && _b.peek(&peek) && compare(valueA, *peek) == IntersectCompare::AFTER) {
                     advanceSorted(_b, valueB);
                     if (_rc.wantMissB())
                         _rc.missB(valueB);
@@ -145,10 +124,10 @@ public: // code
             bool hitA = checkCache(valueA);
             while (!_b.eof() && advanceSorted(_b, valueB)) {
                 Compare cmp = compare(valueA, valueB);
-                if (cmp == BEFORE) {
+                if (cmp == IntersectCompare::BEFORE) {
                     cache(valueB, false);
                     break;
-                } else if (cmp == AFTER) {
+                } else if (cmp == IntersectCompare::AFTER) {
                     if (_rc.wantMissB())
                         _rc.missB(valueB);
                     continue;
@@ -162,33 +141,109 @@ public: // code
             if (!hitA && _rc.wantMissA()) {
                 _rc.missA(valueA);
             }
+            finishA(_rc, valueA);
         }
-        while (_rc.wantMissB() && !_cache.empty())
-            popCache();
+        if (_rc.wantMissB())
+            clearCache();
         while (_rc.wantMissB() && !_b.eof() && advanceSorted(_b, valueB))
             _rc.missB(valueB);
     }
 
-    void cache(const TypeB& valueB, bool hit) {
-        _cache.push_back(CacheEntry(valueB, hit));
+    // Moves valueB to the back of the cache, leaving valueB with storage
+    // from a value that is no longer needed.
+    void cache(TypeB& valueB, bool hit) {
+        if (_size == _cache.size())
+            grow();
+
+        bool sameChrom = _size > 0 && valueB.chromId() == cacheAt(_size - 1).value.chromId();
+        _maxStop = sameChrom ? std::max(_maxStop, int64_t(valueB.stop())) : valueB.stop();
+
+        CacheEntry& e = cacheAt(_size++);
+        e.value.swap(valueB);
+        e.hit = hit;
+        e.removed = false;
     }
 
-    void cacheRemove(const CacheIterator& iter) {
-        if (!iter->hit && _rc.wantMissB())
-            _rc.missB(iter->value);
-        _cache.erase(iter);
+    void cacheRemove(CacheEntry const& e) {
+        if (!e.hit && _rc.wantMissB())
+            _rc.missB(e.value);
     }
 
     void popCache() {
-        cacheRemove(_cache.begin());
+        cacheRemove(cacheAt(0));
+        _head = (_head + 1) & (_cache.size() - 1);
+        --_size;
+    }
+
+    void clearCache() {
+        for (std::size_t i = 0; i < _size; ++i)
+            cacheRemove(cacheAt(i));
+        _head = 0;
+        _size = 0;
+    }
+
+protected:
+    enum { MIN_CACHE_SIZE = 16 };
+
+    // the cache's capacity is always a power of 2
+    CacheEntry& cacheAt(std::size_t i) {
+        return _cache[(_head + i) & (_cache.size() - 1)];
+    }
+
+    // True if nothing in the cache can intersect valueA or anything after
+    // it: either valueA is on a later sequence than the newest entry, or
+    // it starts after every entry on the same sequence has stopped.
+    bool cacheExpired(TypeA const& valueA) const {
+        if (_size == 0)
+            return false;
+
+        TypeB const& last = _cache[(_head + _size - 1) & (_cache.size() - 1)].value;
+        int chrom = detail::compareChrom(DefaultCoordinateView(), valueA, last, 0);
+        return chrom > 0 || (chrom == 0 && _maxStop < valueA.start());
+    }
+
+    // Drops the entries among the first n that are no longer needed
+    // (and have been reported with cacheRemove). The rest of the first n
+    // are moved back, keeping their order, so that the removed entries are
+    // all at the front.
+    void dropRemoved(std::size_t n, std::size_t removed) {
+        std::size_t to = n;
+        for (std::size_t from = n; from-- > 0 && to > removed;) {
+            CacheEntry& e = cacheAt(from);
+            if (e.removed)
+                continue;
+            if (--to != from) {
+                CacheEntry& dst = cacheAt(to);
+                dst.value.swap(e.value);
+                dst.hit = e.hit;
+                dst.removed = false;
+            }
+        }
+        _head = (_head + removed) & (_cache.size() - 1);
+        _size -= removed;
+    }
+
+    void grow() {
+        std::vector<CacheEntry> bigger(_cache.size() * 2);
+        for (std::size_t i = 0; i < _size; ++i) {
+            CacheEntry& e = cacheAt(i);
+            bigger[i].value.swap(e.value);
+            bigger[i].hit = e.hit;
+        }
+        _cache.swap(bigger);
+        _head = 0;
     }
 
 protected:
     StreamTypeA& _a;
     StreamTypeB& _b;
     CollectorType& _rc;
-    CacheType _cache;
-    bool _adjacentInsertions;
+    IntersectCompare _compare;
+    std::vector<CacheEntry> _cache;
+    std::size_t _head;
+    std::size_t _size;
+    // the greatest stop of the entries on the same sequence as the newest
+    int64_t _maxStop;
 };
 
 template<typename StreamTypeA, typename StreamTypeB, typename OutType>
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "IntersectCompare.hpp"
+#include "IntervalIndex.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Intersects values against an IntervalIndex of B values held in memory,
+// reporting to a collector with the same interface as IntersectFull's.
+// Unlike IntersectFull, the A values need not be sorted, and since the
+// index is only read, any number of IntersectIndexed objects may share it
+// (e.g., one per thread).
+template<typename TypeB, typename CollectorType>
+class IntersectIndexed {
+public:
+    typedef IntervalIndex<TypeB> IndexType;
+
+    IntersectIndexed(IndexType const& b, CollectorType& rc,
+            bool adjacentInsertions = false)
+        : _b(b)
+        , _rc(rc)
+        , _compare(adjacentInsertions)
+    {}
+
+    // Reports the B values intersecting a (in the order they were added to
+    // the index), or a as a miss if there are none. If hitsB is given, the
+    // numbers of the B values hit are appended to it.
+    template<typename TypeA>
+    bool intersect(TypeA const& a, std::vector<uint32_t>* hitsB = 0) {
+        _found.clear();
+        // every intersection is within the closed interval, see
+        // IntersectCompare
+        _b.find(a.chromId(), a.start(), a.stop(), _found);
+
+        bool hitA = false;
+        for (auto i = _found.begin(); i != _found.end(); ++i) {
+            TypeB const& b = _b[*i];
+            if (_compare(a, b) != IntersectCompare::INTERSECT)
+                continue;
+
+            bool hit = _rc.hit(a, b);
+            hitA |= hit;
+            if (hit && hitsB)
+                hitsB->push_back(*i);
+        }
+
+        if (!hitA && _rc.wantMissA())
+            _rc.missA(a);
+        finishA(_rc, a);
+
+        return hitA;
+    }
+
+    // Intersects every value in stream a, then reports the B values that
+    // were never hit.
+    template<typename StreamTypeA>
+    void execute(StreamTypeA& a) {
+        typename StreamTypeA::ValueType valueA;
+        std::vector<bool> hitB(_b.size());
+        std::vector<uint32_t> hitsB;
+        std::vector<uint32_t>* hits = _rc.wantMissB() ? &hitsB : 0;
+        while (!a.eof() && a.next(valueA)) {
+            hitsB.clear();
+            intersect(valueA, hits);
+            for (auto i = hitsB.begin(); i != hitsB.end(); ++i)
+                hitB[*i] = true;
+        }
+
+        if (hits)
+            reportMissesB(hitB);
+    }
+
+    // Reports the B values not flagged in hitB as misses, in the order they
+    // were added to the index.
+    void reportMissesB(std::vector<bool> const& hitB) {
+        for (std::size_t i = 0; i < hitB.size(); ++i) {
+            if (!hitB[i])
+                _rc.missB(_b[i]);
+        }
+    }
+
+private:
+    IndexType const& _b;
+    CollectorType& _rc;
+    IntersectCompare _compare;
+    std::vector<uint32_t> _found;
+};
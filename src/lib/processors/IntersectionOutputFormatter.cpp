@@ -26,6 +26,11 @@ public:
     virtual ~ColumnBase() {}
 
     virtual void output(const Bed& a, const Bed& b) = 0;
+    // columns from A are output the same way whether or not there is a b
+    virtual void outputCounts(const Bed& a, const std::vector<uint32_t>&) {
+        output(a, a);
+    }
+    virtual bool usesB() const { return _which == 1; }
     virtual unsigned which() const { return _which; }
     virtual unsigned extraFields() const { return _extraFields; }
 
@@ -45,6 +50,33 @@ public:
         _s << a.chrom() << "\t" << std::max(a.start(), b.start()) << "\t"
             << std::min(a.stop(), b.stop());
     }
+
+    bool usesB() const { return true; }
+};
+
+// The number of values hit in each B input (or with flagsOnly, 1 if there
+// were any and 0 if not), one column per input
+class HitCountColumns : public ColumnBase {
+public:
+    HitCountColumns(std::ostream& s, bool flagsOnly)
+        : ColumnBase(s, 0)
+        , _flagsOnly(flagsOnly)
+    {}
+
+    void output(const Bed&, const Bed&) {
+        throw runtime_error("Hit count columns can't be output for a pair of records");
+    }
+
+    void outputCounts(const Bed&, const std::vector<uint32_t>& hitCounts) {
+        for (auto i = hitCounts.begin(); i != hitCounts.end(); ++i) {
+            if (i != hitCounts.begin())
+                _s << "\t";
+            _s << (_flagsOnly ? uint32_t(*i > 0) : *i);
+        }
+    }
+
+protected:
+    bool _flagsOnly;
 };
 
 class Column : public ColumnBase {
@@ -154,7 +186,8 @@ public:
 };
 
 Formatter::Formatter(const std::string& formatString, std::ostream& s)
-    : _s(s)
+    : _hitCounts(false)
+    , _s(s)
 {
     Tokenizer<char> tokenizer(formatString, ' ');
     string token;
@@ -169,10 +202,23 @@ Formatter::Formatter(const std::string& formatString, std::ostream& s)
             _columns.push_back(new CompleteColumn(s, 0));
         } else if (token == "B") {
             _columns.push_back(new CompleteColumn(s, 1));
+        } else if (token == "C" || token == "H") {
+            _columns.push_back(new HitCountColumns(s, token == "H"));
+            _hitCounts = true;
         } else {
             Column::parse(token, s, _columns);
         }
     }
+
+    if (_hitCounts) {
+        for (auto i = _columns.begin(); i != _columns.end(); ++i) {
+            if (i->usesB()) {
+                throw runtime_error(str(format(
+                    "Invalid format string '%1%': hit count columns (C, H) "
+                    "can't be combined with columns from B") %formatString));
+            }
+        }
+    }
 }
 
 Formatter::~Formatter() {
@@ -186,6 +232,14 @@ void Formatter::output(const Bed& a, const Bed& b) {
     _s << "\n";
 }
 
+void Formatter::output(const Bed& a, const std::vector<uint32_t>& hitCounts) {
+    for (unsigned i = 0; i < _columns.size(); ++i) {
+        _columns[i].outputCounts(a, hitCounts);
+        if (i < _columns.size() - 1) _s << "\t";
+    }
+    _s << "\n";
+}
+
 unsigned Formatter::extraFields(unsigned which) const {
     unsigned n = 0;
     for (auto i = _columns.begin(); i != _columns.end(); ++i)
@@ -194,4 +248,8 @@ unsigned Formatter::extraFields(unsigned which) const {
     return n;
 }
 
+bool Formatter::hitCounts() const {
+    return _hitCounts;
+}
+
 }
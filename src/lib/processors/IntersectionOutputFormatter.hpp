@@ -1,6 +1,7 @@
 #pragma once
 
 #include "boost/ptr_container/ptr_vector.hpp"
+#include "common/cstdint.hpp"
 
 #include <iostream>
 #include <memory>
@@ -19,10 +20,18 @@ public:
     virtual ~Formatter();
 
     void output(const Bed& a, const Bed& b);
+    // Outputs a once, with the number of values it hit in each of the B
+    // inputs for the C and H columns. Only valid if hitCounts() is true.
+    void output(const Bed& a, const std::vector<uint32_t>& hitCounts);
     unsigned extraFields(unsigned which) const;
 
+    // True if the format has per input hit columns (C or H), in which case
+    // it has no columns from B
+    bool hitCounts() const;
+
 protected:
     std::string _formatString;
+    bool _hitCounts;
     boost::ptr_vector<ColumnBase> _columns;
     std::ostream& _s;
 };
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "common/CoordinateView.hpp"
+#include "common/cstdint.hpp"
+
+#include <boost/unordered_map.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// An in-memory index of values by locus, for finding every value that
+// overlaps a query interval. Values can be added in any order; once build()
+// has been called, find() may be called from any number of threads.
+//
+// Each sequence's intervals are kept sorted by start in flat arrays that
+// double as an implicit binary search tree (as in cgranges): the node at
+// position i of level k has i's low k bits set to 0111..1, its children
+// are i -/+ 2^(k-1), and leaves are at the even positions. Each node also
+// records the greatest stop in its subtree, so whole subtrees that end
+// before the query are skipped.
+template<typename ValueType, typename CoordView = DefaultCoordinateView>
+class IntervalIndex {
+public:
+    explicit IntervalIndex(CoordView cv = CoordView())
+        : _cv(cv)
+    {}
+
+    void add(ValueType value) {
+        Contig& c = _contigs[_cv.chromId(value)];
+        c.starts.push_back(_cv.start(value));
+        c.stops.push_back(_cv.stop(value));
+        c.values.push_back(_values.size());
+        _values.push_back(std::move(value));
+    }
+
+    void build() {
+        for (auto i = _contigs.begin(); i != _contigs.end(); ++i)
+            i->second.build();
+    }
+
+    // The number of values, which are numbered in the order they were added
+    std::size_t size() const {
+        return _values.size();
+    }
+
+    ValueType const& operator[](std::size_t idx) const {
+        return _values[idx];
+    }
+
+    // Appends to out the numbers of the values on sequence chromId with
+    // start <= stop and stop >= start (i.e., that overlap or touch the
+    // closed interval [start, stop]), in the order they were added.
+    void find(uint32_t chromId, int64_t start, int64_t stop,
+            std::vector<uint32_t>& out) const
+    {
+        auto found = _contigs.find(chromId);
+        if (found == _contigs.end())
+            return;
+
+        std::size_t first = out.size();
+        found->second.find(start, stop, out);
+        std::sort(out.begin() + first, out.end());
+    }
+
+private:
+    struct Contig {
+        std::vector<int64_t> starts;
+        std::vector<int64_t> stops;
+        // the greatest stop in the subtree below each node
+        std::vector<int64_t> maxStops;
+        // the number of the value at each position
+        std::vector<uint32_t> values;
+        // the level of the root
+        int maxLevel;
+
+        void build();
+        void find(int64_t start, int64_t stop, std::vector<uint32_t>& out) const;
+    };
+
+private:
+    CoordView _cv;
+    std::vector<ValueType> _values;
+    boost::unordered_map<uint32_t, Contig> _contigs;
+};
+
+template<typename ValueType, typename CoordView>
+inline void IntervalIndex<ValueType, CoordView>::Contig::build() {
+    std::size_t n = starts.size();
+    std::vector<std::size_t> order(n);
+    for (std::size_t i = 0; i < n; ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+        [this](std::size_t x, std::size_t y) { return starts[x] < starts[y]; });
+
+    std::vector<int64_t> sortedStarts(n);
+    std::vector<int64_t> sortedStops(n);
+    std::vector<uint32_t> sortedValues(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        sortedStarts[i] = starts[order[i]];
+        sortedStops[i] = stops[order[i]];
+        sortedValues[i] = values[order[i]];
+    }
+    starts.swap(sortedStarts);
+    stops.swap(sortedStops);
+    values.swap(sortedValues);
+
+    maxStops = stops;
+    maxLevel = -1;
+    if (n == 0)
+        return;
+
+    // last is the max stop below the rightmost node of the current level,
+    // which stands in for children past the end of the arrays
+    std::size_t lastIdx = 0;
+    int64_t last = 0;
+    for (std::size_t i = 0; i < n; i += 2) {
+        lastIdx = i;
+        last = stops[i];
+    }
+
+    int k = 1;
+    for (; (std::size_t(1) << k) <= n; ++k) {
+        std::size_t x = std::size_t(1) << (k - 1);
+        std::size_t first = (x << 1) - 1;
+        std::size_t step = x << 2;
+        for (std::size_t i = first; i < n; i += step) {
+            int64_t left = maxStops[i - x];
+            int64_t right = i + x < n ? maxStops[i + x] : last;
+            maxStops[i] = std::max(stops[i], std::max(left, right));
+        }
+
+        lastIdx = (lastIdx >> k & 1) ? lastIdx - x : lastIdx + x;
+        if (lastIdx < n)
+            last = std::max(last, maxStops[lastIdx]);
+    }
+    maxLevel = k - 1;
+}
+
+template<typename ValueType, typename CoordView>
+inline void IntervalIndex<ValueType, CoordView>::Contig::find(
+        int64_t start, int64_t stop, std::vector<uint32_t>& out) const
+{
+    if (maxLevel < 0)
+        return;
+
+    struct Node {
+        int level;
+        std::size_t idx;
+        // whether the left subtree has been visited
+        bool visited;
+    };
+
+    std::size_t n = starts.size();
+    // the tree is at most 64 levels deep, and each level pushes at most 2
+    Node stack[128];
+    std::size_t top = 0;
+    stack[top++] = Node{maxLevel, (std::size_t(1) << maxLevel) - 1, false};
+
+    while (top > 0) {
+        Node z = stack[--top];
+        if (z.level <= 3) {
+            // small subtrees are quicker to scan
+            std::size_t i = z.idx >> z.level << z.level;
+            std::size_t end = std::min(n, i + (std::size_t(2) << z.level) - 1);
+            for (; i < end && starts[i] <= stop; ++i) {
+                if (stops[i] >= start)
+                    out.push_back(values[i]);
+            }
+        }
+        else if (!z.visited) {
+            std::size_t left = z.idx - (std::size_t(1) << (z.level - 1));
+            stack[top++] = Node{z.level, z.idx, true};
+            if (left >= n || maxStops[left] >= start)
+                stack[top++] = Node{z.level - 1, left, false};
+        }
+        else if (z.idx < n && starts[z.idx] <= stop) {
+            if (stops[z.idx] >= start)
+                out.push_back(values[z.idx]);
+            stack[top++] = Node{
+                z.level - 1, z.idx + (std::size_t(1) << (z.level - 1)), false};
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#include "MergePlan.hpp"
+
+#include <boost/format.hpp>
+
+#include <stdexcept>
+
+using boost::format;
+
+std::vector<MergeStep> planMerge(std::vector<uint64_t> sizes,
+        std::size_t maxFanIn)
+{
+    if (maxFanIn < 2) {
+        throw std::runtime_error(str(format(
+            "Can not merge sorted runs with a fan-in of %1%") % maxFanIn));
+    }
+
+    std::vector<MergeStep> steps;
+    if (sizes.size() <= maxFanIn)
+        return steps;
+
+    // each pass replaces count runs with one
+    std::size_t excess = sizes.size() - maxFanIn;
+    std::size_t count = (excess - 1) % (maxFanIn - 1) + 2;
+
+    while (sizes.size() > maxFanIn) {
+        MergeStep step = {0, count};
+        uint64_t total = 0;
+        for (std::size_t i = 0; i < count; ++i)
+            total += sizes[i];
+
+        uint64_t best = total;
+        for (std::size_t i = count; i < sizes.size(); ++i) {
+            total += sizes[i];
+            total -= sizes[i - count];
+            if (total < best) {
+                best = total;
+                step.first = i - count + 1;
+            }
+        }
+
+        sizes[step.first] = best;
+        sizes.erase(sizes.begin() + step.first + 1,
+            sizes.begin() + step.first + count);
+        steps.push_back(step);
+        count = maxFanIn;
+    }
+
+    return steps;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "common/cstdint.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Plans a merge of sorted runs that never reads more than maxFanIn of them
+// at once, for when there are too many to open together.
+//
+// The runs are merged in intermediate passes, each of which merges `count`
+// adjacent runs starting at `first` into a single run that takes their place
+// in the list (so positions refer to the list as it is after the steps
+// before). Only merging adjacent runs means that records that compare equal
+// keep the order of the runs they came from.
+struct MergeStep {
+    std::size_t first;
+    std::size_t count;
+};
+
+// Given the size of each run (e.g., in bytes), return the intermediate
+// merges to perform, in order. Once they are done, at most maxFanIn runs
+// are left for the final merge. The first pass merges just enough runs that
+// every later pass (including the final merge) can merge maxFanIn, and each
+// pass merges the adjacent runs with the smallest total size, so that as
+// little data as possible is read and written more than once.
+//
+// Throws std::runtime_error if maxFanIn is less than 2.
+std::vector<MergeStep> planMerge(std::vector<uint64_t> sizes,
+        std::size_t maxFanIn);
@@ -1,76 +1,222 @@
 #pragma once
 
+#include "SortKey.hpp"
 #include "common/LocusCompare.hpp"
 #include "common/RelOps.hpp"
+#include "common/SequenceDictionary.hpp"
+#include "common/cstdint.hpp"
+#include "fileformats/ReadBatch.hpp"
 
 #include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <functional>
+#include <limits>
 #include <memory>
-#include <set>
+#include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
-namespace {
-    template<typename StreamType, typename LessThanCmp>
-    struct StreamLessThan {
-        StreamLessThan(LessThanCmp cmp = LessThanCmp())
+namespace detail {
+    template<typename Method>
+    struct ComparesStop : std::false_type {};
+
+    template<>
+    struct ComparesStop<StartAndStop> : std::true_type {};
+
+    // Compares the values at the heads of the streams being merged.
+    // update(i, value) is called whenever stream i gets a new head, and
+    // less(a, b, x, y) compares the heads x and y of streams a and b.
+    template<typename ValueType, typename LessThanCmp>
+    class MergeHeads {
+    public:
+        explicit MergeHeads(LessThanCmp cmp)
             : cmp_(cmp)
         {}
 
-        bool operator()(StreamType* a, StreamType* b) const {
-            typedef typename StreamType::ValueType ValueType;
-            ValueType* pa(0);
-            ValueType* pb(0);
-            if (a->eof()) return false;
-            if (b->eof()) return true;
-            a->peek(&pa);
-            b->peek(&pb);
-            return cmp_(*pa, *pb);
+        void reset(std::size_t) {}
+        void update(std::size_t, ValueType const&) {}
+
+        bool less(std::size_t, std::size_t,
+                ValueType const* x, ValueType const* y) const
+        {
+            return cmp_(*x, *y);
         }
 
+    private:
         LessThanCmp cmp_;
     };
-}
 
+    // For the default locus comparison, the (sequence id, start, stop) of
+    // each head is cached, so comparing heads is a few integer compares
+    // (see SequenceDictionary).
+    template<typename ValueType, typename Method>
+    class MergeHeads<
+              ValueType
+            , CompareToLessThan<LocusCompare<DefaultCoordinateView, Method>>
+            >
+    {
+    public:
+        typedef CompareToLessThan<LocusCompare<DefaultCoordinateView, Method>>
+            LessThanCmp;
+
+        explicit MergeHeads(LessThanCmp)
+            : dict_(SequenceDictionary::instance())
+        {}
 
+        void reset(std::size_t n) {
+            Key k = {SequenceDictionary::EMPTY, 0, 0};
+            keys_.assign(n, k);
+        }
+
+        void update(std::size_t i, ValueType const& value) {
+            Key& k = keys_[i];
+            k.chrom = cv_.chromId(value);
+            k.start = cv_.start(value);
+            k.stop = ComparesStop<Method>::value ? cv_.stop(value) : 0;
+        }
+
+        bool less(std::size_t a, std::size_t b,
+                ValueType const*, ValueType const*) const
+        {
+            Key const& x = keys_[a];
+            Key const& y = keys_[b];
+            if (x.chrom != y.chrom)
+                return dict_.less(x.chrom, y.chrom);
+            if (x.start != y.start)
+                return x.start < y.start;
+            return x.stop < y.stop;
+        }
+
+    private:
+        struct Key {
+            uint32_t chrom;
+            int64_t start;
+            int64_t stop;
+        };
+
+    private:
+        SequenceDictionary const& dict_;
+        DefaultCoordinateView cv_;
+        std::vector<Key> keys_;
+    };
+}
+
+// Merges sorted streams with a loser tree: each internal node holds the
+// stream that lost the comparison there, and the overall winner is kept at
+// the root. Taking a value only replays the path from the winner's leaf to
+// the root, i.e., about log2(#streams) comparisons. Ties go to the stream
+// that comes first in the input, so the merge is stable.
 template<typename StreamType , typename LessThanCmp>
 class MergeSorted {
 public:
     typedef typename StreamType::ValueType ValueType;
     typedef std::unique_ptr<StreamType> StreamPtr;
-    typedef StreamLessThan<StreamType, LessThanCmp> StreamCmp;
+    typedef detail::MergeHeads<ValueType, LessThanCmp> HeadsType;
 
     MergeSorted(std::vector<StreamPtr> const& inputs, LessThanCmp cmp = LessThanCmp())
         : inputs_(inputs)
-        , sortedInputs_(StreamCmp(cmp))
+        , cmp_(cmp)
+        , heads_(inputs.size(), 0)
+        , tree_(std::max<std::size_t>(inputs.size(), 1), 0)
     {
-        for (auto i = inputs_.begin(); i != inputs_.end(); ++i)
-            if (!(*i)->eof())
-                sortedInputs_.insert(i->get());
+        cmp_.reset(inputs_.size());
+        for (std::size_t i = 0; i < inputs_.size(); ++i)
+            refresh(i);
+
+        if (!inputs_.empty())
+            tree_[0] = build(1);
     }
 
     bool next(ValueType& next) {
-        using namespace std;
-        if (sortedInputs_.empty())
-            return false;
+        std::size_t source;
+        return this->next(next, source);
+    }
+
+    // As next(value), also setting source to the index of the input stream
+    // the value came from
+    bool next(ValueType& next, std::size_t& source) {
+        while (!inputs_.empty()) {
+            std::size_t winner = tree_[0];
+            if (!heads_[winner])
+                return false;
 
-        bool rv = false;
-        while (rv == false && !sortedInputs_.empty()) {
-            StreamType* s = (*sortedInputs_.begin());
-            sortedInputs_.erase(sortedInputs_.begin());
-            if ((rv = s->next(next))) {
-                ValueType* p;
-                if (s->peek(&p))
-                    sortedInputs_.insert(s);
+            bool rv = inputs_[winner]->next(next);
+            refresh(winner);
+            replay(winner);
+            if (rv) {
+                source = winner;
+                return true;
             }
         }
 
-        return rv;
+        return false;
+    }
+
+    // Merge up to n values into out, returning the number merged. As with
+    // TypedStream::nextBatch, out is never shrunk and its values are reused.
+    std::size_t nextBatch(std::vector<ValueType>& out, std::size_t n) {
+        return readBatch(*this, out, n);
+    }
+
+private:
+    void refresh(std::size_t i) {
+        ValueType* p(0);
+        StreamType& s = *inputs_[i];
+        if (s.eof() || !s.peek(&p))
+            p = 0;
+
+        heads_[i] = p;
+        if (p)
+            cmp_.update(i, *p);
+    }
+
+    // Does stream a's head come before stream b's? Exhausted streams sort
+    // last.
+    bool before(std::size_t a, std::size_t b) const {
+        if (!heads_[a])
+            return false;
+        if (!heads_[b])
+            return true;
+        if (cmp_.less(a, b, heads_[a], heads_[b]))
+            return true;
+        if (cmp_.less(b, a, heads_[b], heads_[a]))
+            return false;
+        return a < b;
+    }
+
+    // Leaf i of the tree is node k + i, where k is the number of streams,
+    // and the parent of node n is n / 2. Returns the winner below node.
+    std::size_t build(std::size_t node) {
+        std::size_t k = inputs_.size();
+        if (node >= k)
+            return node - k;
+
+        std::size_t a = build(2 * node);
+        std::size_t b = build(2 * node + 1);
+        if (before(b, a))
+            std::swap(a, b);
+
+        tree_[node] = b;
+        return a;
+    }
+
+    void replay(std::size_t winner) {
+        for (std::size_t node = (winner + inputs_.size()) / 2; node > 0; node /= 2) {
+            if (before(tree_[node], winner))
+                std::swap(tree_[node], winner);
+        }
+        tree_[0] = winner;
     }
 
 protected:
     std::vector<StreamPtr> const& inputs_;
-    std::multiset<StreamType*, StreamCmp> sortedInputs_;
+    HeadsType cmp_;
+    // the value at the head of each stream, or null if it is exhausted
+    std::vector<ValueType*> heads_;
+    // tree_[0] is the winner, tree_[1..k-1] the losers at internal nodes
+    std::vector<std::size_t> tree_;
 };
 
 
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "MergePlan.hpp"
 #include "MergeSorted.hpp"
 #include "SortBuffer.hpp"
+#include "SortRun.hpp"
+#include "common/StringView.hpp"
 #include "common/compat.hpp"
 #include "common/cstdint.hpp"
 
@@ -11,11 +14,56 @@
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <fstream>
+#include <future>
 #include <iterator>
 #include <memory>
+#include <numeric>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+namespace detail {
+    // Output functions that can be called with a formatted line (as a
+    // StringView) as well as with a value
+    template<typename OutputFunc>
+    struct AcceptsLines {
+    private:
+        template<typename T>
+        static auto test(int) -> decltype(
+            std::declval<T&>()(std::declval<StringView const&>()),
+            std::true_type());
+
+        template<typename T>
+        static std::false_type test(...);
+
+    public:
+        typedef decltype(test<OutputFunc>(0)) type;
+        static bool const value = type::value;
+    };
+}
+
+// External merge sort of one or more input streams.
+//
+// Values are read into a SortBuffer until it is full, at which point it is
+// sorted and written to a temp file (a "run"), and reading continues into a
+// new buffer. The runs and the final buffer are then merged.
+//
+// When given a thread pool with workers, full buffers are sorted and written
+// out by the pool while the next buffer is filled. Up to MAX_SPILLS buffers
+// may be spilling at once, and both the line limit and the byte budget set
+// by maxBytes are shared between them and the buffer being filled.
+//
+// When the output function accepts formatted lines, buffers are spilled as
+// sort runs (see SortRun.hpp) and merged by key, with spilled records passed
+// to the output as the lines they were written as. Otherwise they are
+// spilled as text and parsed again to be merged.
+//
+// With a limit on the number of open files, spilled buffers are closed
+// until they are merged, and if there are more than the limit they are
+// merged in intermediate passes as planned by planMerge, each one written
+// to a new temp file.
 template<typename StreamType, typename StreamOpener, typename OutputFunc>
 class Sort {
 public:
@@ -26,6 +74,21 @@ public:
     typedef std::unique_ptr<BufferType> BufferPtr;
     typedef std::unique_ptr<Sort> ptr;
 
+    typedef std::integral_constant<bool,
+              BufferType::UsesDefaultCompare::value
+              && detail::AcceptsLines<OutputFunc>::value
+            > UsesRuns;
+
+    enum { MAX_SPILLS = 3 };
+
+    // Bounds on the read buffer for each temp file when merging with a
+    // limit on open files
+    enum {
+        MIN_READ_BUFFER_SIZE = 64 << 10,
+        MAX_READ_BUFFER_SIZE = 64 << 20,
+        DEFAULT_READ_BUFFER_SIZE = 1 << 20
+    };
+
     Sort(Sort const&) = delete;
     Sort& operator=(Sort const&) = delete;
 
@@ -36,42 +99,76 @@ public:
             HeaderType& outputHeader,
             uint64_t maxInMem,
             bool stable,
-            CompressionType compression = NONE
+            CompressionType compression = NONE,
+            ThreadPool::ptr pool = ThreadPool::ptr()
         )
         : _inputs(inputs)
         , _streamOpener(streamOpener)
         , _out(out)
         , _outputHeader(outputHeader)
         , _maxInMem(maxInMem)
+        , _maxBytes(0)
+        , _maxOpenFiles(0)
         , _stable(stable)
         , _compression(compression)
+        , _pool(pool ? pool : ThreadPool::create(0))
+        , _maxSpills(std::min<std::size_t>(_pool->size(), MAX_SPILLS))
     {
     }
 
+    ~Sort() {
+        // the jobs refer to our buffers
+        for (auto i = _spills.begin(); i != _spills.end(); ++i)
+            i->wait();
+    }
+
+    // Also spill the buffer to disk once it holds about this many bytes
+    // (0 means no limit)
+    void maxBytes(uint64_t maxBytes) {
+        _maxBytes = maxBytes;
+    }
+
+    // Merge at most this many temp files at once (0 means no limit,
+    // otherwise it must be at least 2)
+    void maxOpenFiles(std::size_t maxOpenFiles) {
+        _maxOpenFiles = maxOpenFiles;
+    }
+
     void execute() {
         using namespace std;
 
-        std::unique_ptr<BufferType> buf(new BufferType(_streamOpener, _outputHeader, _stable, _compression));
+        BufferPtr buf = newBuffer();
+        uint64_t maxInMem = std::max<uint64_t>(_maxInMem / (_maxSpills + 1), 1);
+        uint64_t maxBytes = _maxBytes / (_maxSpills + 1);
 
         for (unsigned idx = 0; idx < _inputs.size(); ++idx) {
 
             while (!_inputs[idx]->eof()) {
-                ValueType* vptr = new ValueType;
-                if (!_inputs[idx]->next(*vptr)) {
-                    delete vptr;
+                ValueType* vptr = buf->alloc();
+                bool gotValue;
+                try {
+                    gotValue = _inputs[idx]->next(*vptr);
+                }
+                catch (...) {
+                    buf->discard(vptr);
+                    throw;
+                }
+                if (!gotValue) {
+                    buf->discard(vptr);
                     break;
                 }
                 buf->push_back(vptr);
-                if (buf->size() >= _maxInMem) {
-                    buf->sort();
-                    buf->writeTmp();
-                    _buffers.push_back(std::move(buf));
-                    buf.reset(new BufferType(_streamOpener, _outputHeader,
-                        _stable, _compression));
+                if (buf->size() >= maxInMem
+                    || (maxBytes > 0 && buf->bytes() >= maxBytes))
+                {
+                    spill(std::move(buf));
+                    buf = newBuffer();
                 }
             }
         }
 
+        waitForSpills(0);
+
         if (_buffers.empty()) {
             buf->sort();
             buf->write(_out);
@@ -80,14 +177,165 @@ public:
                 buf->sort();
                 _buffers.push_back(std::move(buf));
             }
-            auto merger = makeMergeSorted(_buffers);
-            ValueType e;
-            while (merger.next(e)) {
-                _out(e);
+            merge(UsesRuns());
+        }
+    }
+
+protected:
+    BufferPtr newBuffer() {
+        BufferPtr buf(new BufferType(_streamOpener, _outputHeader,
+            _stable, _compression, _pool));
+        if (_maxOpenFiles > 0)
+            buf->closeTmpFile(readBufferSize());
+        return buf;
+    }
+
+    // Split the memory budget between the files being merged at once
+    std::size_t readBufferSize() const {
+        if (_maxBytes == 0)
+            return DEFAULT_READ_BUFFER_SIZE;
+
+        uint64_t size = _maxBytes / _maxOpenFiles;
+        size = std::max<uint64_t>(size, MIN_READ_BUFFER_SIZE);
+        return std::min<uint64_t>(size, MAX_READ_BUFFER_SIZE);
+    }
+
+    // The intermediate passes needed to merge the spilled buffers (which
+    // come before any that was not spilled) within the open file limit
+    std::vector<MergeStep> planPasses() const {
+        if (_maxOpenFiles == 0)
+            return std::vector<MergeStep>();
+
+        std::vector<uint64_t> sizes;
+        for (auto i = _buffers.begin(); i != _buffers.end(); ++i) {
+            if ((*i)->spilled())
+                sizes.push_back((*i)->spilledBytes());
+        }
+        return planMerge(sizes, _maxOpenFiles);
+    }
+
+    // Replace count buffers starting at first with merged
+    void replaceBuffers(std::size_t first, std::size_t count, BufferPtr merged) {
+        auto iter = _buffers.begin() + first;
+        *iter = std::move(merged);
+        _buffers.erase(iter + 1, iter + count);
+    }
+
+    // Sort buf and write it to a temp file on the thread pool, waiting for
+    // earlier buffers first if too many are already being written.
+    void spill(BufferPtr buf) {
+        BufferType* b = buf.get();
+        _buffers.push_back(std::move(buf));
+        _spills.push_back(_pool->submit([b]() {
+            b->sort();
+            writeBuffer(*b, UsesRuns());
+        }));
+        waitForSpills(_maxSpills);
+    }
+
+    static void writeBuffer(BufferType& buf, std::true_type) {
+        buf.writeRun();
+    }
+
+    static void writeBuffer(BufferType& buf, std::false_type) {
+        buf.writeTmp();
+    }
+
+    void merge(std::false_type) {
+        std::vector<MergeStep> passes = planPasses();
+        for (auto step = passes.begin(); step != passes.end(); ++step) {
+            auto first = _buffers.begin() + step->first;
+            std::vector<BufferPtr> group(
+                std::make_move_iterator(first),
+                std::make_move_iterator(first + step->count));
+            for (auto i = group.begin(); i != group.end(); ++i)
+                (*i)->open();
+
+            BufferPtr merged = newBuffer();
+            auto merger = makeMergeSorted(group);
+            merged->writeTmp(merger);
+            replaceBuffers(step->first, step->count, std::move(merged));
+        }
+
+        for (auto i = _buffers.begin(); i != _buffers.end(); ++i)
+            (*i)->open();
+
+        auto merger = makeMergeSorted(_buffers);
+        ValueType e;
+        while (merger.next(e)) {
+            _out(e);
+        }
+    }
+
+    void merge(std::true_type) {
+        typedef SortRecordSource<ValueType> SourceType;
+
+        // each buffer numbers its chromosomes separately
+        ChromRanker chroms;
+        std::vector<std::vector<uint32_t>> chromMaps(_buffers.size());
+        for (std::size_t i = 0; i < _buffers.size(); ++i) {
+            auto const& names = _buffers[i]->chromNames();
+            for (auto name = names.begin(); name != names.end(); ++name)
+                chromMaps[i].push_back(chroms.id(*name));
+        }
+
+        std::vector<uint32_t> ranks = chroms.ranks();
+        for (auto i = chromMaps.begin(); i != chromMaps.end(); ++i) {
+            for (auto id = i->begin(); id != i->end(); ++id)
+                *id = ranks[*id];
+        }
+
+        // runs written by intermediate passes use the ranks as ids
+        std::vector<std::string> rankedNames(ranks.size());
+        for (std::size_t i = 0; i < ranks.size(); ++i)
+            rankedNames[ranks[i]] = chroms.names()[i];
+        std::vector<uint32_t> identity(ranks.size());
+        std::iota(identity.begin(), identity.end(), 0);
+
+        std::vector<MergeStep> passes = planPasses();
+        for (auto step = passes.begin(); step != passes.end(); ++step) {
+            BufferPtr merged = newBuffer();
+            {
+                std::vector<typename SourceType::ptr> group;
+                for (std::size_t i = step->first; i < step->first + step->count; ++i)
+                    group.push_back(_buffers[i]->records(std::move(chromMaps[i])));
+
+                MergeSorted<SourceType, SortRecordLessThan> merger(group);
+                merged->writeRun(merger, rankedNames);
+            }
+
+            replaceBuffers(step->first, step->count, std::move(merged));
+            auto maps = chromMaps.begin() + step->first;
+            *maps = identity;
+            chromMaps.erase(maps + 1, maps + step->count);
+        }
+
+        std::vector<typename SourceType::ptr> sources;
+        for (std::size_t i = 0; i < _buffers.size(); ++i)
+            sources.push_back(_buffers[i]->records(std::move(chromMaps[i])));
+
+        MergeSorted<SourceType, SortRecordLessThan> merger(sources);
+        SortRecord<ValueType> record;
+        while (merger.next(record)) {
+            if (record.value) {
+                _out(*record.value);
+            }
+            else {
+                std::string const& line = record.line;
+                _out(StringView(line.data(), line.data() + line.size()));
             }
         }
     }
 
+    void waitForSpills(std::size_t maxPending) {
+        while (_spills.size() > maxPending) {
+            // rethrows any error from the job
+            std::future<void> job = std::move(_spills.front());
+            _spills.pop_front();
+            job.get();
+        }
+    }
+
 protected:
     std::vector<StreamPtr> const& _inputs;
     StreamOpener& _streamOpener;
@@ -95,8 +343,13 @@ protected:
     HeaderType& _outputHeader;
     std::vector<BufferPtr> _buffers;
     uint64_t _maxInMem;
+    uint64_t _maxBytes;
+    std::size_t _maxOpenFiles;
     bool _stable;
     CompressionType _compression;
+    ThreadPool::ptr _pool;
+    std::size_t _maxSpills;
+    std::deque<std::future<void>> _spills;
 };
 
 template<typename StreamType, typename StreamOpener, typename OutputFunc>
@@ -108,6 +361,7 @@ typename Sort<StreamType, StreamOpener, OutputFunc>::ptr makeSort(
         , uint64_t maxInMem
         , bool stable
         , CompressionType compression = NONE
+        , ThreadPool::ptr pool = ThreadPool::ptr()
         )
 {
     return std::make_unique<Sort<StreamType, StreamOpener, OutputFunc>>(
@@ -118,5 +372,6 @@ typename Sort<StreamType, StreamOpener, OutputFunc>::ptr makeSort(
         , maxInMem
         , stable
         , compression
+        , pool
         );
 }
@@ -1,18 +1,68 @@
 #pragma once
 
+#include "common/Arena.hpp"
 #include "common/LocusCompare.hpp"
+#include "common/ThreadPool.hpp"
+#include "processors/SortKey.hpp"
+#include "processors/SortRun.hpp"
+#include "io/BgzfLineSource.hpp"
+#include "io/BgzfOutputStream.hpp"
 #include "io/TempFile.hpp"
 #include "io/InputStream.hpp"
 
+#include <boost/filesystem.hpp>
 #include <boost/format.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 
 #include <algorithm>
-#include <deque>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
 #include <iterator>
+#include <limits>
 #include <memory>
+#include <ostream>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace detail {
+    // Value types that own heap memory report it with footprint()
+    template<typename T>
+    auto heapFootprint(T const& value, int) -> decltype(value.footprint()) {
+        return value.footprint();
+    }
+
+    template<typename T>
+    std::size_t heapFootprint(T const&, long) {
+        return 0;
+    }
+}
+
+// Values are constructed in large arena blocks rather than allocated one at
+// a time, and all of them are destroyed and their blocks released at once
+// when the buffer is written to a temp file. bytes() estimates the memory
+// held by the buffer (arena blocks plus the values' own heap storage) so
+// that callers can spill it on a memory budget.
+//
+// With the default comparison, sort() extracts a SortKey from each value and
+// radix sorts the keys, so values are only touched once each rather than
+// by every comparison. Large buffers have their keys sorted in parallel on
+// the thread pool. The keys are kept, so that the buffer can be written out
+// as a sort run (see SortRun.hpp) with writeRun() and merged by key with
+// records().
+//
+// Otherwise, writeTmp() writes the values out as text, to be parsed again
+// when the buffer is read back with peek() and next().
+//
+// Either kind of temp file can also be written from a merge of other
+// buffers, for merging runs in more than one pass (see MergePlan.hpp).
+// When closeTmpFile() has been called, temp files are closed once written
+// and only reopened when they are read, so that many buffers can be spilled
+// without running out of file descriptors.
 
 template<
           typename StreamType
@@ -25,103 +75,185 @@ public:
     typedef typename std::unique_ptr<StreamType> StreamPtr;
     typedef typename StreamType::ValueType ValueType;
     typedef typename ValueType::HeaderType HeaderType;
-    typedef typename std::deque<ValueType*>::size_type size_type;
+    typedef typename std::vector<ValueType*>::size_type size_type;
+    typedef std::is_same<LessThanCmp, CompareToLessThan<LocusCompare<>>>
+        UsesDefaultCompare;
 
     SortBuffer(
               StreamOpener& streamOpener
             , const HeaderType& h
             , bool stable
             , CompressionType compression
+            , ThreadPool::ptr pool = ThreadPool::ptr()
             , LessThanCmp cmp = LessThanCmp()
             )
         : _streamOpener(streamOpener)
         , _header(h)
         , _stable(stable)
         , _compression(compression)
+        , _pool(pool)
+        , _pos(0)
+        , _heapBytes(0)
+        , _readBufferSize(0)
+        , _tmpOpen(false)
         , _inputStream("anon", _in)
         , _cmp(cmp)
     {}
 
     ~SortBuffer() {
-        for (auto iter = _buf.begin(); iter != _buf.end(); ++iter)
-            delete *iter;
+        clear();
+    }
+
+    // Construct a new value in the arena for the caller to fill in. It must
+    // then be passed to either push_back or discard.
+    ValueType* alloc() {
+        return _arena.template create<ValueType>();
     }
 
     void push_back(ValueType* value) {
         _buf.push_back(value);
+        _heapBytes += detail::heapFootprint(*value, 0);
+    }
+
+    void discard(ValueType* value) {
+        value->~ValueType();
+    }
+
+    std::size_t bytes() const {
+        return _arena.capacity() + _heapBytes
+            + _buf.capacity() * sizeof(ValueType*);
+    }
+
+    // Close the temp file once it is written, reopening it with a read
+    // buffer of readBufferSize bytes when it is read. Must be called before
+    // the buffer is spilled.
+    void closeTmpFile(std::size_t readBufferSize) {
+        _readBufferSize = readBufferSize;
     }
 
     void sort() {
-        if (_stable)
-            std::stable_sort(_buf.begin(), _buf.end(), _cmp);
-        else
-            std::sort(_buf.begin(), _buf.end(), _cmp);
+        sort(UsesDefaultCompare());
     }
 
     size_type size() const {
-        return _buf.size();
+        return _buf.size() - _pos;
     }
 
     bool empty() const {
-        return _buf.empty() && _stream.get() == NULL;
+        return size() == 0 && !spilled();
+    }
+
+    bool spilled() const {
+        return _tmpfile.get() != NULL;
+    }
+
+    // The size of the temp file, if it has a name (see closeTmpFile)
+    uint64_t spilledBytes() const {
+        if (!spilled() || _tmpfile->path().empty())
+            return 0;
+        return boost::filesystem::file_size(_tmpfile->path());
     }
 
     void write(OutputFunc& out) const {
-        for (auto iter = _buf.begin(); iter != _buf.end(); ++iter)
+        for (auto iter = _buf.begin() + _pos; iter != _buf.end(); ++iter)
             out(**iter);
     }
 
     void writeTmp() {
-        namespace io = boost::iostreams;
+        writeTmpFile([this](std::ostream& out) {
+            out << _header;
+            for (auto iter = _buf.begin() + _pos; iter != _buf.end(); ++iter)
+                out << **iter << "\n";
+        });
 
-        if (_tmpfile.get() != NULL)
-            throw std::runtime_error("Attempt to re-serialize sort buffer");
+        if (_readBufferSize == 0)
+            open();
+    }
 
-        _tmpfile = TempFile::create(TempFile::ANON);
+    // Write the values produced by merger (e.g., a MergeSorted of other
+    // buffers) as this buffer's temp file, as with writeTmp().
+    template<typename MergerType>
+    void writeTmp(MergerType& merger) {
+        writeTmpFile([this, &merger](std::ostream& out) {
+            out << _header;
+            ValueType value;
+            while (merger.next(value))
+                out << value << "\n";
+        });
 
-        // data won't be flushed until filtering_stream goes out of scope
-        {
-            io::filtering_stream<io::output> out;
-            io::gzip_compressor gzip;
+        if (_readBufferSize == 0)
+            open();
+    }
 
-            switch (_compression) {
-                case GZIP: out.push(gzip); break;
-                case NONE:
-                default:
-                    break;
-            }
+    // Open the temp file written by writeTmp() for peek() and next()
+    void open() {
+        if (spilled() && _stream.get() == NULL)
+            _stream = _streamOpener(tmpInput());
+    }
 
-            out.push(_tmpfile->stream());
-            out << _header;
-            for (auto iter = _buf.begin(); iter != _buf.end(); ++iter) {
+    // Write the buffer as a sort run. Requires sort() to have been called.
+    void writeRun() {
+        static_assert(UsesDefaultCompare::value,
+            "sort runs are only written with the default comparison");
+
+        writeTmpFile([this](std::ostream& out) {
+            auto key = _keys.begin();
+            for (auto iter = _buf.begin() + _pos; iter != _buf.end(); ++iter) {
+                writeSortKey(out, *key++);
                 out << **iter << "\n";
-                delete *iter;
             }
-            _buf.clear();
-        }
+        });
+    }
 
-        _tmpfile->stream().seekg(0);
+    // Write the records produced by merger (e.g., a MergeSorted of other
+    // buffers' records()) as this buffer's sort run. chromNames names the
+    // chromosome ids in the records' keys.
+    template<typename MergerType>
+    void writeRun(MergerType& merger, std::vector<std::string> chromNames) {
+        writeTmpFile([&merger](std::ostream& out) {
+            SortRecord<ValueType> record;
+            while (merger.next(record)) {
+                writeSortKey(out, record.key);
+                if (record.value)
+                    out << *record.value;
+                else
+                    out << record.line;
+                out << "\n";
+            }
+        });
 
-        switch (_compression) {
-            case GZIP: _in.push(_gzipDecompressor); break;
-            case NONE:
-            default:
-                break;
-        }
+        _chromNames.swap(chromNames);
+    }
 
-        _in.push(_tmpfile->stream());
+    // The names of the chromosomes in the buffer, indexed by the chromosome
+    // ids in its keys. Available once sort() has been called.
+    std::vector<std::string> const& chromNames() const {
+        return _chromNames;
+    }
 
-        _stream = _streamOpener(_inputStream);
+    // The buffer's records, in sorted order, for merging by key. chromRanks
+    // maps the buffer's chromosome ids to those used by the merge.
+    typename SortRecordSource<ValueType>::ptr records(
+            std::vector<uint32_t> chromRanks)
+    {
+        typedef typename SortRecordSource<ValueType>::ptr SourcePtr;
+        if (spilled()) {
+            return SourcePtr(new SpilledRecords<ValueType>(
+                tmpInput(), std::move(chromRanks)));
+        }
+
+        return SourcePtr(new BufferedRecords<ValueType>(
+            _buf.data() + _pos, _keys.data(), size(), std::move(chromRanks)));
     }
 
     bool peek(ValueType** v) {
         if (_stream.get() != NULL)
             return _stream->peek(v);
 
-        if (_buf.empty())
+        if (_pos == _buf.size())
             return false;
 
-        *v = _buf[0];
+        *v = _buf[_pos];
         return true;
     }
 
@@ -129,12 +261,11 @@ public:
         if (_stream.get() != NULL)
             return _stream->next(v);
 
-        if (_buf.empty())
+        if (_pos == _buf.size())
             return false;
 
-        v = *_buf[0];
-        delete _buf[0];
-        _buf.pop_front();
+        // the value is destroyed along with the rest of the arena later
+        v.swap(*_buf[_pos++]);
         return true;
     }
 
@@ -142,7 +273,152 @@ public:
         if (_stream.get() != NULL)
             return _stream->eof();
 
-        return _buf.empty();
+        return _pos == _buf.size();
+    }
+
+protected:
+    void sort(std::false_type) {
+        if (_stable)
+            std::stable_sort(_buf.begin() + _pos, _buf.end(), _cmp);
+        else
+            std::sort(_buf.begin() + _pos, _buf.end(), _cmp);
+    }
+
+    // The radix sort is stable, so this serves stable sorts too
+    void sort(std::true_type) {
+        size_type n = size();
+        if (n > std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("Too many records in sort buffer");
+
+        DefaultCoordinateView cv;
+        ChromRanker chroms;
+        std::vector<SortKey> keys(n);
+        for (size_type i = 0; i < n; ++i) {
+            ValueType const& v = *_buf[_pos + i];
+            SortKey& key = keys[i];
+            key.chrom = chroms.id(cv.chrom(v));
+            key.index = uint32_t(i);
+            key.start = SortKey::bias(cv.start(v));
+            key.stop = SortKey::bias(cv.stop(v));
+        }
+
+        std::vector<uint32_t> ranks = chroms.ranks();
+        for (auto i = keys.begin(); i != keys.end(); ++i)
+            i->chrom = ranks[i->chrom];
+
+        if (_pool)
+            parallelSort(keys, *_pool);
+        else
+            radixSort(keys);
+
+        std::vector<ValueType*> sorted(_buf.begin(), _buf.begin() + _pos);
+        sorted.reserve(_buf.size());
+        for (auto i = keys.begin(); i != keys.end(); ++i)
+            sorted.push_back(_buf[_pos + i->index]);
+        _buf.swap(sorted);
+
+        // chromosome ids in the keys are now ranks, so name them that way
+        std::vector<std::string> const& names = chroms.names();
+        _chromNames.resize(names.size());
+        for (std::size_t i = 0; i < names.size(); ++i)
+            _chromNames[ranks[i]] = names[i];
+        _keys.swap(keys);
+    }
+
+    // Write the remaining values to a temp file with write(out), then
+    // release them.
+    template<typename WriteFunc>
+    void writeTmpFile(WriteFunc write) {
+        namespace io = boost::iostreams;
+
+        if (spilled())
+            throw std::runtime_error("Attempt to re-serialize sort buffer");
+
+        if (_compression == BGZF) {
+            // bgzf blocks are (de)compressed on the thread pool, but the
+            // reader needs a path to open, so the temp file can't be
+            // anonymous.
+            _tmpfile = TempFile::create(TempFile::CLEANUP);
+            BgzfOutputStream out(_tmpfile->path(), TabixIndexBuilder::ptr(), _pool);
+            write(out);
+            clear();
+            out.close();
+            return;
+        }
+
+        // files that are closed have to be found again by name
+        _tmpfile = TempFile::create(
+            _readBufferSize > 0 ? TempFile::CLEANUP : TempFile::ANON);
+
+        // data won't be flushed until filtering_stream goes out of scope
+        {
+            io::filtering_stream<io::output> out;
+            io::gzip_compressor gzip;
+
+            switch (_compression) {
+                case GZIP: out.push(gzip); break;
+                case NONE:
+                default:
+                    break;
+            }
+
+            out.push(_tmpfile->stream());
+            write(out);
+            clear();
+        }
+
+        if (_readBufferSize > 0)
+            _tmpfile->stream().close();
+    }
+
+    // The temp file, opened for reading the first time this is called
+    InputStream& tmpInput() {
+        if (!_tmpOpen)
+            openTmpFile();
+
+        return _bgzfInput ? *_bgzfInput : _inputStream;
+    }
+
+    void openTmpFile() {
+        _tmpOpen = true;
+        if (_compression == BGZF) {
+            ILineSource::ptr src(new BgzfLineSource(_tmpfile->path(), _pool));
+            _bgzfInput = InputStream::create("anon", src);
+            return;
+        }
+
+        switch (_compression) {
+            case GZIP: _in.push(_gzipDecompressor); break;
+            case NONE:
+            default:
+                break;
+        }
+
+        std::fstream& file = _tmpfile->stream();
+        if (_readBufferSize == 0) {
+            file.seekg(0);
+            _in.push(file);
+            return;
+        }
+
+        file.open(_tmpfile->path().c_str(), std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error(str(boost::format(
+                "Failed to reopen temp file %1%: %2%")
+                % _tmpfile->path() % strerror(errno)));
+        }
+        _in.push(file, _readBufferSize);
+    }
+
+    // Destroy all values and release the memory holding them
+    void clear() {
+        for (auto iter = _buf.begin(); iter != _buf.end(); ++iter)
+            (*iter)->~ValueType();
+        std::vector<ValueType*>().swap(_buf);
+        std::vector<SortKey>().swap(_keys);
+        _arena.reset();
+        _pos = 0;
+        _heapBytes = 0;
     }
 
 protected:
@@ -150,13 +426,26 @@ protected:
     const HeaderType& _header;
     bool _stable;
     CompressionType _compression;
-    std::deque<ValueType*> _buf;
+    ThreadPool::ptr _pool;
+    Arena _arena;
+    std::vector<ValueType*> _buf;
+    // the next value to be returned by next()
+    size_type _pos;
+    std::size_t _heapBytes;
+    // non-zero if the temp file is closed until it is read
+    std::size_t _readBufferSize;
+    // keys and chromosome names for the values, once sorted
+    std::vector<SortKey> _keys;
+    std::vector<std::string> _chromNames;
     TempFile::ptr _tmpfile;
+    bool _tmpOpen;
     StreamPtr _stream;
 
     // for reading compressed tmp file
     boost::iostreams::filtering_stream<boost::iostreams::input> _in;
     boost::iostreams::gzip_decompressor _gzipDecompressor;
     InputStream _inputStream;
+    // for reading bgzf compressed tmp file
+    InputStream::ptr _bgzfInput;
     LessThanCmp _cmp;
 };
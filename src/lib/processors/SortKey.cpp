@@ -0,0 +1,224 @@
+#include "SortKey.hpp"
+#include "common/SequenceDictionary.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    // 8 bits each of stop, start, then chrom, least significant first
+    std::size_t const NUM_DIGITS = 8 + 8 + 4;
+    std::size_t const RADIX = 256;
+    // below this, comparison sorting beats setting up the radix sort
+    std::size_t const MIN_RADIX_SORT_SIZE = 64;
+    // below this, splitting the work up costs more than it saves
+    std::size_t const MIN_PARALLEL_SORT_SIZE = 1 << 16;
+
+    inline unsigned digit(SortKey const& key, std::size_t d) {
+        if (d < 8)
+            return (key.stop >> (8 * d)) & 0xff;
+        if (d < 16)
+            return (key.start >> (8 * (d - 8))) & 0xff;
+        return (key.chrom >> (8 * (d - 16))) & 0xff;
+    }
+
+    // Sort [first, last), using tmp (of the same size) as scratch space.
+    // Returns whichever of first or tmp holds the result.
+    SortKey* radixSort(SortKey* first, SortKey* last, SortKey* tmp) {
+        std::size_t n = last - first;
+        if (n < 2)
+            return first;
+
+        // histogram every digit in one pass over the data
+        std::vector<std::size_t> counts(NUM_DIGITS * RADIX, 0);
+        for (SortKey const* i = first; i != last; ++i) {
+            for (std::size_t d = 0; d < NUM_DIGITS; ++d)
+                ++counts[d * RADIX + digit(*i, d)];
+        }
+
+        for (std::size_t d = 0; d < NUM_DIGITS; ++d) {
+            std::size_t* count = &counts[d * RADIX];
+            if (count[digit(*first, d)] == n)
+                continue;
+
+            std::size_t offset = 0;
+            for (std::size_t b = 0; b < RADIX; ++b) {
+                std::size_t c = count[b];
+                count[b] = offset;
+                offset += c;
+            }
+
+            for (std::size_t i = 0; i < n; ++i)
+                tmp[count[digit(first[i], d)]++] = first[i];
+
+            std::swap(first, tmp);
+        }
+        return first;
+    }
+
+    char const HEX_DIGITS[] = "0123456789abcdef";
+
+    template<typename T>
+    void writeHex(std::ostream& out, T value) {
+        char buf[2 * sizeof(T)];
+        for (std::size_t i = sizeof(buf); i > 0; --i) {
+            buf[i - 1] = HEX_DIGITS[value & 0xf];
+            value >>= 4;
+        }
+        out.write(buf, sizeof(buf));
+    }
+
+    template<typename T>
+    char const* readHex(char const* beg, T& value) {
+        value = 0;
+        for (char const* end = beg + 2 * sizeof(T); beg != end; ++beg) {
+            unsigned digit;
+            if (*beg >= '0' && *beg <= '9')
+                digit = *beg - '0';
+            else if (*beg >= 'a' && *beg <= 'f')
+                digit = *beg - 'a' + 10;
+            else
+                throw std::runtime_error("Invalid sort key in sort run");
+            value = (value << 4) | digit;
+        }
+        return beg;
+    }
+}
+
+ChromRanker::ChromRanker()
+    : _lastId(0)
+{
+}
+
+uint32_t ChromRanker::id(std::string const& name) {
+    if (!_names.empty() && _names[_lastId] == name)
+        return _lastId;
+
+    auto inserted = _ids.insert(std::make_pair(name, uint32_t(_names.size())));
+    if (inserted.second)
+        _names.push_back(name);
+
+    _lastId = inserted.first->second;
+    return _lastId;
+}
+
+std::vector<std::string> const& ChromRanker::names() const {
+    return _names;
+}
+
+std::vector<uint32_t> ChromRanker::ranks() const {
+    SequenceDictionary& dict = SequenceDictionary::instance();
+    std::vector<uint32_t> dictIds(_names.size());
+    std::vector<uint32_t> order(_names.size());
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        dictIds[i] = dict.id(_names[i]);
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) {
+        return dict.less(dictIds[x], dictIds[y]);
+    });
+
+    std::vector<uint32_t> rv(_names.size());
+    for (uint32_t rank = 0; rank < order.size(); ++rank)
+        rv[order[rank]] = rank;
+    return rv;
+}
+
+bool operator<(SortKey const& x, SortKey const& y) {
+    if (x.chrom != y.chrom)
+        return x.chrom < y.chrom;
+    if (x.start != y.start)
+        return x.start < y.start;
+    return x.stop < y.stop;
+}
+
+void radixSort(std::vector<SortKey>& keys) {
+    if (keys.size() < MIN_RADIX_SORT_SIZE) {
+        std::stable_sort(keys.begin(), keys.end());
+        return;
+    }
+
+    std::vector<SortKey> tmp(keys.size());
+    SortKey* first = keys.data();
+    if (radixSort(first, first + keys.size(), tmp.data()) != first)
+        keys.swap(tmp);
+}
+
+void parallelSort(std::vector<SortKey>& keys, ThreadPool& pool) {
+    std::size_t n = keys.size();
+    std::size_t pieces = std::min(pool.size(), n / MIN_PARALLEL_SORT_SIZE);
+    if (pieces < 2 || pool.inWorker()) {
+        radixSort(keys);
+        return;
+    }
+
+    std::vector<SortKey> tmp(n);
+    std::vector<std::size_t> bounds;
+    for (std::size_t i = 0; i <= pieces; ++i)
+        bounds.push_back(n * i / pieces);
+
+    // sort each piece, leaving the result in keys
+    std::vector<std::future<void>> jobs;
+    for (std::size_t i = 0; i < pieces; ++i) {
+        SortKey* first = keys.data() + bounds[i];
+        SortKey* last = keys.data() + bounds[i + 1];
+        SortKey* scratch = tmp.data() + bounds[i];
+        jobs.push_back(pool.submit([first, last, scratch]() {
+            if (radixSort(first, last, scratch) != first)
+                std::copy(scratch, scratch + (last - first), first);
+        }));
+    }
+    for (auto i = jobs.begin(); i != jobs.end(); ++i)
+        i->get();
+
+    // merge adjacent runs until only one is left. std::merge takes from
+    // the first range on ties, so this stays stable.
+    while (bounds.size() > 2) {
+        jobs.clear();
+        std::vector<std::size_t> merged;
+        std::size_t i = 0;
+        for (; i + 2 < bounds.size(); i += 2) {
+            SortKey const* a = keys.data() + bounds[i];
+            SortKey const* b = keys.data() + bounds[i + 1];
+            SortKey const* c = keys.data() + bounds[i + 2];
+            SortKey* out = tmp.data() + bounds[i];
+            jobs.push_back(pool.submit([a, b, c, out]() {
+                std::merge(a, b, b, c, out);
+            }));
+            merged.push_back(bounds[i]);
+        }
+        // an odd run out is carried over as is
+        if (i + 1 < bounds.size()) {
+            std::copy(keys.begin() + bounds[i], keys.begin() + bounds[i + 1],
+                tmp.begin() + bounds[i]);
+            merged.push_back(bounds[i]);
+        }
+        merged.push_back(n);
+
+        for (auto j = jobs.begin(); j != jobs.end(); ++j)
+            j->get();
+
+        keys.swap(tmp);
+        bounds.swap(merged);
+    }
+}
+
+void writeSortKey(std::ostream& out, SortKey const& key) {
+    writeHex(out, key.chrom);
+    writeHex(out, key.start);
+    writeHex(out, key.stop);
+}
+
+char const* readSortKey(char const* beg, char const* end, SortKey& key) {
+    if (end - beg < SORT_KEY_TEXT_SIZE)
+        throw std::runtime_error("Truncated sort key in sort run");
+
+    beg = readHex(beg, key.chrom);
+    beg = readHex(beg, key.start);
+    beg = readHex(beg, key.stop);
+    key.index = 0;
+    return beg;
+}
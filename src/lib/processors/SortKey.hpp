@@ -0,0 +1,74 @@
+#pragma once
+
+#include "common/ThreadPool.hpp"
+#include "common/cstdint.hpp"
+
+#include <boost/unordered_map.hpp>
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// A compact key for sorting records by locus without touching the records
+// themselves. Ordering keys by (chrom, start, stop) gives the same order as
+// LocusCompare<> on the records they were made from, as long as chrom holds
+// the rank of the chromosome name in SequenceDictionary order (see
+// ChromRanker).
+struct SortKey {
+    uint32_t chrom;
+    // the position of the record this key was made from
+    uint32_t index;
+    // coordinates are stored biased so that unsigned order matches signed
+    uint64_t start;
+    uint64_t stop;
+
+    static uint64_t bias(int64_t x) {
+        return uint64_t(x) ^ (uint64_t(1) << 63);
+    }
+};
+
+// Assigns small integer ids to chromosome names as they are seen, then
+// ranks them in SequenceDictionary order.
+class ChromRanker {
+public:
+    ChromRanker();
+
+    uint32_t id(std::string const& name);
+
+    // The names seen so far, indexed by id
+    std::vector<std::string> const& names() const;
+
+    // The SequenceDictionary rank of each name, indexed by id
+    std::vector<uint32_t> ranks() const;
+
+private:
+    boost::unordered_map<std::string, uint32_t> _ids;
+    std::vector<std::string> _names;
+    // records usually come in runs with the same chromosome
+    uint32_t _lastId;
+};
+
+bool operator<(SortKey const& x, SortKey const& y);
+
+// Stable LSD radix sort of keys by (chrom, start, stop). Bytes that are the
+// same in every key (e.g., the high bytes of coordinates) are skipped. Small
+// inputs are sorted with std::stable_sort instead.
+void radixSort(std::vector<SortKey>& keys);
+
+// As above, but splits the keys into one piece per thread in the pool,
+// radix sorts the pieces in parallel and then merges them pairwise, also in
+// parallel. Small inputs are just sorted in the calling thread.
+void parallelSort(std::vector<SortKey>& keys, ThreadPool& pool);
+
+// Keys are stored in sort run files as SORT_KEY_TEXT_SIZE hex digits
+// (chrom, start and stop; not index) so that runs can be read back with
+// any line source, compressed or not.
+enum { SORT_KEY_TEXT_SIZE = 8 + 16 + 16 };
+
+void writeSortKey(std::ostream& out, SortKey const& key);
+
+// Parse a key written by writeSortKey from the start of [beg, end), returning
+// a pointer to the first character after it. Throws std::runtime_error if
+// there is no valid key there.
+char const* readSortKey(char const* beg, char const* end, SortKey& key);
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "SortKey.hpp"
+#include "common/StringView.hpp"
+#include "io/InputStream.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Sort runs hold records that have already been formatted for output, each
+// preceded by its sort key (see writeSortKey). Merging runs compares the keys
+// and passes the formatted lines straight through to the output, so spilled
+// records are never parsed again.
+//
+// Chromosome ids in a run's keys are local to the SortBuffer that wrote it.
+// Readers are given a map from those to ranks shared by all of the runs
+// being merged.
+
+// A record being merged: either a line read from a run, or a value still held
+// in memory (which has yet to be formatted).
+template<typename ValueType>
+struct SortRecord {
+    SortRecord()
+        : value(0)
+    {}
+
+    void swap(SortRecord& other) {
+        std::swap(key, other.key);
+        line.swap(other.line);
+        std::swap(value, other.value);
+    }
+
+    SortKey key;
+    std::string line;
+    ValueType const* value;
+};
+
+struct SortRecordLessThan {
+    template<typename RecordType>
+    bool operator()(RecordType const& x, RecordType const& y) const {
+        return x.key < y.key;
+    }
+};
+
+template<typename T>
+class SortRecordSource {
+public:
+    typedef SortRecord<T> ValueType;
+    typedef std::unique_ptr<SortRecordSource> ptr;
+
+    virtual ~SortRecordSource() {}
+
+    virtual bool peek(ValueType** record) = 0;
+    virtual bool next(ValueType& record) = 0;
+    virtual bool eof() const = 0;
+};
+
+// Records read back from a run written to a temp file
+template<typename T>
+class SpilledRecords : public SortRecordSource<T> {
+public:
+    typedef SortRecord<T> ValueType;
+
+    SpilledRecords(InputStream& in, std::vector<uint32_t> chromRanks)
+        : _in(in)
+        , _chromRanks(std::move(chromRanks))
+        , _haveCurrent(false)
+        , _eof(false)
+    {
+        // always reading one record ahead keeps eof() accurate
+        read();
+    }
+
+    bool peek(ValueType** record) {
+        if (!_haveCurrent && !read())
+            return false;
+
+        *record = &_current;
+        return true;
+    }
+
+    bool next(ValueType& record) {
+        if (!_haveCurrent && !read())
+            return false;
+
+        record.swap(_current);
+        _haveCurrent = false;
+        read();
+        return true;
+    }
+
+    bool eof() const {
+        return !_haveCurrent;
+    }
+
+private:
+    bool read() {
+        StringView line;
+        if (_eof || !_in.getline(line)) {
+            _eof = true;
+            return false;
+        }
+
+        char const* beg = readSortKey(line.begin(), line.end(), _current.key);
+        _current.key.chrom = _chromRanks.at(_current.key.chrom);
+        _current.line.assign(beg, line.end());
+        _current.value = 0;
+        _haveCurrent = true;
+        return true;
+    }
+
+private:
+    InputStream& _in;
+    std::vector<uint32_t> _chromRanks;
+    ValueType _current;
+    bool _haveCurrent;
+    bool _eof;
+};
+
+// Sorted values that are still in memory, along with their keys
+template<typename T>
+class BufferedRecords : public SortRecordSource<T> {
+public:
+    typedef SortRecord<T> ValueType;
+
+    BufferedRecords(T* const* values, SortKey const* keys, std::size_t size,
+            std::vector<uint32_t> chromRanks)
+        : _values(values)
+        , _keys(keys)
+        , _size(size)
+        , _pos(0)
+        , _chromRanks(std::move(chromRanks))
+    {}
+
+    bool peek(ValueType** record) {
+        if (_pos == _size)
+            return false;
+
+        fill(_current);
+        *record = &_current;
+        return true;
+    }
+
+    bool next(ValueType& record) {
+        if (_pos == _size)
+            return false;
+
+        fill(record);
+        ++_pos;
+        return true;
+    }
+
+    bool eof() const {
+        return _pos == _size;
+    }
+
+private:
+    void fill(ValueType& record) const {
+        record.key = _keys[_pos];
+        record.key.chrom = _chromRanks[record.key.chrom];
+        record.value = _values[_pos];
+    }
+
+private:
+    T* const* _values;
+    SortKey const* _keys;
+    std::size_t _size;
+    std::size_t _pos;
+    std::vector<uint32_t> _chromRanks;
+    ValueType _current;
+};
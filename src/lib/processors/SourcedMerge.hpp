@@ -0,0 +1,96 @@
+#pragma once
+
+#include "MergeSorted.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A value tagged with the index of the input it was read from. It can be
+// used anywhere a ValueType can.
+template<typename ValueType>
+class Sourced : public ValueType {
+public:
+    Sourced()
+        : _sourceIndex(0)
+    {}
+
+    std::size_t sourceIndex() const {
+        return _sourceIndex;
+    }
+
+    void sourceIndex(std::size_t idx) {
+        _sourceIndex = idx;
+    }
+
+    void swap(Sourced& rhs) {
+        ValueType::swap(rhs);
+        std::swap(_sourceIndex, rhs._sourceIndex);
+    }
+
+private:
+    std::size_t _sourceIndex;
+};
+
+// Merges sorted streams into a single stream of Sourced values, with the
+// same eof/peek/next interface as TypedStream.
+template<typename StreamType>
+class SourcedMerge {
+public:
+    typedef Sourced<typename StreamType::ValueType> ValueType;
+    typedef std::unique_ptr<StreamType> StreamPtr;
+
+    explicit SourcedMerge(std::vector<StreamPtr> const& inputs)
+        : _merger(inputs)
+    {
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            if (i > 0)
+                _name += ", ";
+            _name += inputs[i]->name();
+        }
+        _cached = read(_next);
+    }
+
+    std::string const& name() const {
+        return _name;
+    }
+
+    bool eof() const {
+        return !_cached;
+    }
+
+    bool peek(ValueType** value) {
+        *value = &_next;
+        return _cached;
+    }
+
+    bool next(ValueType& value) {
+        if (!_cached)
+            return false;
+
+        value.swap(_next);
+        _cached = read(_next);
+        return true;
+    }
+
+private:
+    bool read(ValueType& value) {
+        std::size_t source;
+        if (!_merger.next(value, source))
+            return false;
+
+        value.sourceIndex(source);
+        return true;
+    }
+
+private:
+    typedef CompareToLessThan<typename StreamType::ValueType::DefaultCompare>
+        LessThanCmp;
+
+    MergeSorted<StreamType, LessThanCmp> _merger;
+    std::string _name;
+    ValueType _next;
+    bool _cached;
+};
@@ -6,6 +6,7 @@
 #include "fileformats/vcf/GenotypeMerger.hpp" // TODO: move DisjointAllelesException out of this header
 #include "fileformats/vcf/Header.hpp"
 #include "fileformats/vcf/MergeStrategy.hpp"
+#include "fileformats/ValuePool.hpp"
 
 #include <memory>
 #include <vector>
@@ -15,15 +16,18 @@ class VcfEntryMerger {
 public:
     typedef std::unique_ptr<Vcf::Entry> ValuePtr;
     typedef std::vector<ValuePtr> ValuePtrVector;
+    typedef ValuePool<Vcf::Entry> PoolType;
 
     VcfEntryMerger(
               OutputFunc& out
             , Vcf::Header* mergedHeader
             , Vcf::MergeStrategy const& mergeStrategy
+            , PoolType* pool = 0
             )
         : out_(out)
         , mergedHeader_(mergedHeader)
         , mergeStrategy_(mergeStrategy)
+        , pool_(pool)
     {}
 
     void writeMergedEntry(Vcf::Entry& e) {
@@ -38,9 +42,8 @@ public:
         // have to move the entries into this vector
         std::vector<Vcf::Entry> rawEntries(entries.size());
         for (std::size_t i = 0; i < entries.size(); ++i) {
-            rawEntries[i] = std::move(*entries[i]);
+            rawEntries[i].swap(*entries[i]);
         }
-        entries.clear();
 
         auto begin = rawEntries.data();
         auto end = rawEntries.data() + rawEntries.size();
@@ -59,21 +62,29 @@ public:
                     e->reheader(mergedHeader_);
                     writeMergedEntry(*e);
                 }
-                return;
             }
+            else {
+                // create and output the new merged entry
+                Entry merged(std::move(merger));
+                if (cnsFilt)
+                    cnsFilt->apply(merged, &merger.sampleCounts());
 
-            // create and output the new merged entry
-            Entry merged(std::move(merger));
-            if (cnsFilt)
-                cnsFilt->apply(merged, &merger.sampleCounts());
-
-            writeMergedEntry(merged);
+                writeMergedEntry(merged);
+            }
         } catch (const DisjointGenotypesError& e) {
             // FIXME: do something
             // probably try to figure out which entries are fighting,
             // take one out, and reject it.
             throw;
         }
+
+        // hand the entries (and the buffers they own) back to be read into
+        if (pool_) {
+            for (std::size_t i = 0; i < entries.size(); ++i) {
+                entries[i]->swap(rawEntries[i]);
+            }
+            pool_->release(entries);
+        }
     }
 
 
@@ -81,6 +92,7 @@ private:
     OutputFunc& out_;
     Vcf::Header* mergedHeader_;
     Vcf::MergeStrategy const& mergeStrategy_;
+    PoolType* pool_;
 };
 
 template<typename OutputFunc>
@@ -89,8 +101,9 @@ makeVcfEntryMerger(
           OutputFunc& out
         , Vcf::Header* mergedHeader
         , Vcf::MergeStrategy const& mergeStrategy
+        , ValuePool<Vcf::Entry>* pool = 0
         )
 {
-    return VcfEntryMerger<OutputFunc>(out, mergedHeader, mergeStrategy);
+    return VcfEntryMerger<OutputFunc>(out, mergedHeader, mergeStrategy, pool);
 }
 
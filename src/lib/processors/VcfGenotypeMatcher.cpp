@@ -55,6 +55,7 @@ VcfGenotypeMatcher::VcfGenotypeMatcher(
         , std::vector<Vcf::FilterType> const& filterTypes
         , EntryOutput& entryOutput
         , bool includeRefAlleles
+        , PoolType* pool
         )
     : numFiles_(streamNames.size())
     , numSamples_(sampleNames.size())
@@ -65,6 +66,7 @@ VcfGenotypeMatcher::VcfGenotypeMatcher(
     , filterTypes_(filterTypes)
     , entryOutput_(entryOutput)
     , includeRefAlleles_(includeRefAlleles)
+    , pool_(pool)
     , gtDicts_(numSamples_)
     , partialSampleCounters_(numSamples_)
     , exactSampleCounters_(numSamples_)
@@ -274,6 +276,8 @@ void VcfGenotypeMatcher::reset() {
         di->clear();
 
     entryGenotypes_.clear();
+    if (pool_)
+        pool_->release(entries_);
     entries_.clear();
 }
 
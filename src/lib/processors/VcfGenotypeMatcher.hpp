@@ -6,6 +6,7 @@
 // eventually, this may replace GenotypeComparator
 #include "fileformats/vcf/GenotypeComparator.hpp"
 #include "fileformats/vcf/RawVariant.hpp"
+#include "fileformats/ValuePool.hpp"
 #include "io/StreamHandler.hpp"
 
 #include <boost/function.hpp>
@@ -36,6 +37,7 @@ public:
     typedef boost::unordered_map<FileIndexSet, size_t> SampleCounter;
 
     typedef boost::function<void(Vcf::Entry const&)> EntryOutput;
+    typedef ValuePool<Vcf::Entry> PoolType;
 
     VcfGenotypeMatcher(
           std::vector<std::string> const& streamNames
@@ -45,6 +47,7 @@ public:
         , std::vector<Vcf::FilterType> const& filterTypes
         , EntryOutput& entryOutput
         , bool includeRefAlleles
+        , PoolType* pool = 0
         );
 
     void operator()(EntryList&& entries);
@@ -98,6 +101,7 @@ private:
     std::vector<Vcf::FilterType> const& filterTypes_;
     EntryOutput& entryOutput_;
     bool includeRefAlleles_;
+    PoolType* pool_;
 
     EntryList entries_;
 
@@ -5,8 +5,10 @@
 #include <boost/config.hpp>
 #include <boost/graph/adjacency_matrix.hpp>
 #include <boost/graph/connected_components.hpp>
+#include <boost/unordered_map.hpp>
 #include <boost/unordered_set.hpp>
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -71,7 +73,7 @@ public:
         template<typename GroupType>
         bool operator()(GroupType const& x, GroupType const& y) const {
             if (x->empty() || y->empty())
-                return true; // doesn't matter if one or both are empty;
+                return !x->empty(); // doesn't matter, but must be consistent
 
             if ((*x)[0]->start() < (*y)[0]->start())
                 return true;
@@ -109,9 +111,17 @@ public:
         std::vector<int> components(entries.size());
         connected_components(graph, &components[0]);
 
-        boost::unordered_map<int, ValuePtrVector> groups;
+        // groups are numbered in order of their first entry, so that groups
+        // at the same position come out in the order their entries came in
+        // (i.e., input file order when merging)
+        std::vector<ValuePtrVector> groups;
+        boost::unordered_map<int, std::size_t> groupIndex;
         for (std::size_t i = 0; i < components.size(); ++i) {
-            groups[components[i]].push_back(std::move(entries[i]));
+            auto inserted = groupIndex.insert(
+                std::make_pair(components[i], groups.size()));
+            if (inserted.second)
+                groups.emplace_back();
+            groups[inserted.first->second].push_back(std::move(entries[i]));
         }
 
         // The groups are not necessarily sorted at this point
@@ -121,9 +131,9 @@ public:
         std::vector<ValuePtrVector*> sortedGroups;
         sortedGroups.reserve(groups.size());
         for (auto i = groups.begin(); i != groups.end(); ++i) {
-            sortedGroups.push_back(&i->second);
+            sortedGroups.push_back(&*i);
         }
-        std::sort(sortedGroups.begin(), sortedGroups.end(), SortHelper_{});
+        std::stable_sort(sortedGroups.begin(), sortedGroups.end(), SortHelper_{});
 
         for (auto i = sortedGroups.begin(); i != sortedGroups.end(); ++i) {
             out_(std::move(**i));
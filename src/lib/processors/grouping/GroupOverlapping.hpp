@@ -47,7 +47,6 @@ public:
         , coordView_(std::move(rhs.coordView_))
         , beginFunc_(std::move(rhs.beginFunc_))
         , endFunc_(std::move(rhs.endFunc_))
-        , sequence_(std::move(rhs.sequence_))
         , region_(std::move(rhs.region_))
         , bundle_(std::move(rhs.bundle_))
     {}
@@ -79,8 +78,12 @@ public:
     }
 
 private:
+    // Everything in bundle_ is on the same sequence, so the first entry
+    // stands in for it (comparing sequence ids where the values have them).
     bool overlaps(ValueType const& entry) {
-        if (!sequence_.empty() && coordView_.chrom(entry) == sequence_) {
+        if (!bundle_.empty()
+            && detail::compareChrom(coordView_, entry, *bundle_.front(), 0) == 0)
+        {
             Region r{coordView_.start(entry), coordView_.stop(entry)};
             return region_.overlap(r) > 0;
         }
@@ -88,7 +91,6 @@ private:
     }
 
     void assignRegion(ValueType const& entry) {
-        sequence_ = coordView_.chrom(entry);
         region_.begin = coordView_.start(entry);
         region_.end = coordView_.stop(entry);
     }
@@ -99,7 +101,6 @@ private:
     BeginFunc beginFunc_;
     EndFunc endFunc_;
 
-    std::string sequence_;
     Region region_;
     ValuePtrVector bundle_;
 };
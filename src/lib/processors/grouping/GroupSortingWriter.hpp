@@ -4,6 +4,7 @@
 
 #include <boost/noncopyable.hpp>
 
+#include <algorithm>
 #include <ostream>
 #include <vector>
 
@@ -31,14 +32,15 @@ struct GroupSortingWriter : public boost::noncopyable {
     }
 
     void operator()(Vcf::Entry e) {
-        if (!entries.empty() && e.chrom() != entries[0].chrom())
+        if (!entries.empty() && e.chromId() != entries[0].chromId())
             endGroup();
 
         entries.push_back(std::move(e));
     }
 
+    // entries at the same position are kept in the order they came in
     void endGroup() {
-        std::sort(entries.begin(), entries.end(), SortHelper_{});
+        std::stable_sort(entries.begin(), entries.end(), SortHelper_{});
         for (auto i = entries.begin(); i != entries.end(); ++i) {
             out << *i << "\n";
         }
@@ -8,6 +8,8 @@
 #include <boost/accumulators/statistics/variance.hpp>
 
 #include <cmath>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <vector>
 #include <string>
@@ -27,6 +29,10 @@ namespace detail {
         > accum_type;
 }
 
+// The number of groups of each size. Unlike the accumulators these can be
+// added together, e.g., to combine the stats of merges run separately.
+typedef std::map<std::size_t, uint64_t> GroupSizeCounts;
+
 template<typename OutputFunc>
 class GroupStats {
 public:
@@ -38,9 +44,23 @@ public:
     template<typename ValuePtr>
     void operator()(std::vector<ValuePtr> entries) {
         accum_(entries.size());
+        ++sizeCounts_[entries.size()];
         out_(std::move(entries));
     }
 
+    GroupSizeCounts const& sizeCounts() const {
+        return sizeCounts_;
+    }
+
+    // Add groups counted elsewhere
+    void add(GroupSizeCounts const& counts) {
+        for (auto i = counts.begin(); i != counts.end(); ++i) {
+            for (uint64_t n = 0; n < i->second; ++n)
+                accum_(i->first);
+            sizeCounts_[i->first] += i->second;
+        }
+    }
+
     template<typename OS>
     friend OS& operator<<(OS& os, GroupStats const& stats) {
         namespace ba = boost::accumulators;
@@ -57,6 +77,7 @@ private:
     OutputFunc& out_;
     std::string name_;
     detail::accum_type accum_;
+    GroupSizeCounts sizeCounts_;
 };
 
 template<typename OutputFunc>
@@ -1,5 +1,7 @@
 #include "CommandBase.hpp"
 
+#include "common/SequenceDictionary.hpp"
+#include "common/Tokenizer.hpp"
 #include "common/compat.hpp"
 
 #include <boost/format.hpp>
@@ -15,6 +17,8 @@ using namespace std;
 
 CommandBase::CommandBase()
     : _optionsParsed(false)
+    , _threads(ThreadPool::hardwareThreads())
+    , _readAhead(false)
 {
 }
 
@@ -28,6 +32,27 @@ void CommandBase::parseCommandLine(std::vector<std::string> const& args) {
 
     _opts.add_options()
         ("help,h", "this message")
+
+        ("output-compression",
+            po::value<string>(&_outputCompression)->default_value("n"),
+            "compression to use for output files, n=none, b=bgzf")
+
+        ("threads",
+            po::value<size_t>(&_threads)->default_value(_threads),
+            "number of threads used to compress and decompress bgzf data "
+            "and by subcommands that can split up their work (e.g., sort).")
+
+        ("read-ahead",
+            po::bool_switch(&_readAhead),
+            "read each input file on a background thread while it is "
+            "parsed. this costs a thread and a few MiB of memory per input "
+            "and is ignored by commands given more than 4 input files.")
+
+        ("sequence-order",
+            po::value<string>(&_sequenceOrderFile),
+            "order sequences (chromosomes) as in this .fai index or in the "
+            "##contig lines of this vcf header, rather than by name. "
+            "sequences that are not listed come after those that are.")
         ;
 
     configureOptions();
@@ -53,9 +78,59 @@ void CommandBase::parseCommandLine(std::vector<std::string> const& args) {
     }
 
     checkHelp();
+
+    _streams.threads(_threads);
+    _streams.readAhead(_readAhead);
+    _streams.outputCompression(compressionTypeFromString(_outputCompression));
+
+    if (!_sequenceOrderFile.empty())
+        SequenceDictionary::instance().setOrder(readSequenceOrder());
+
     finalizeOptions();
 }
 
+void CommandBase::closeStreams() {
+    _streams.close();
+}
+
+vector<string> CommandBase::readSequenceOrder() {
+    InputStream::ptr in = _streams.openWithoutReadAhead(_sequenceOrderFile);
+    bool fai = _sequenceOrderFile.size() > 4
+        && _sequenceOrderFile.compare(_sequenceOrderFile.size() - 4, 4, ".fai") == 0;
+
+    vector<string> rv;
+    string line;
+    while (getline(*in, line)) {
+        if (fai) {
+            rv.push_back(line.substr(0, line.find('\t')));
+            continue;
+        }
+
+        if (line.compare(0, 2, "##") != 0)
+            break;
+        if (line.compare(0, 10, "##contig=<") != 0)
+            continue;
+
+        // the ID is required to be the first field
+        string::size_type beg = line.find("ID=", 10);
+        string::size_type end = line.find_first_of(",>", beg);
+        if (beg != 10 || end == string::npos) {
+            throw runtime_error(str(format(
+                "Invalid contig header line at %1%:%2%: %3%"
+                ) % _sequenceOrderFile % in->lineNum() % line));
+        }
+        rv.push_back(line.substr(beg + 3, end - beg - 3));
+    }
+
+    if (rv.empty()) {
+        throw runtime_error(str(format(
+            "No sequence names found in %1% (expected a .fai file or a vcf "
+            "with ##contig header lines)") % _sequenceOrderFile));
+    }
+
+    return rv;
+}
+
 void CommandBase::checkHelp() const {
     if (_varMap.count("help")) {
         stringstream ss;
@@ -71,3 +146,75 @@ void CommandBase::parseCommandLine(int argc, char** argv) {
     std::vector<std::string> args(argv + 1, argv + argc);
     parseCommandLine(args);
 }
+
+void CommandBase::addRegionOptions() {
+    _opts.add_options()
+        ("region",
+            po::value<vector<string>>(&_regionStrings),
+            "only process records overlapping this region (chr, chr:start "
+            "or chr:start-end, 1-based inclusive). may be given more than "
+            "once. input files must be bgzip compressed and tabix indexed.")
+
+        ("regions-file",
+            po::value<string>(&_regionsFile),
+            "like --region, but read regions from the given bed file")
+        ;
+}
+
+vector<GenomicRegion> const& CommandBase::regions() {
+    if (_regions) {
+        return *_regions;
+    }
+
+    _regions = std::make_unique<vector<GenomicRegion>>();
+    for (auto i = _regionStrings.begin(); i != _regionStrings.end(); ++i) {
+        _regions->push_back(GenomicRegion::fromString(*i));
+    }
+
+    if (!_regionsFile.empty()) {
+        InputStream::ptr in = _streams.openForReading(_regionsFile);
+        string line;
+        while (getline(*in, line)) {
+            if (line.empty() || line[0] == '#'
+                || line.compare(0, 5, "track") == 0
+                || line.compare(0, 7, "browser") == 0)
+            {
+                continue;
+            }
+
+            GenomicRegion r;
+            Tokenizer<char> tok(line, '\t');
+            if (!tok.extract(r.chrom) || !tok.extract(r.begin)
+                || !tok.extract(r.end) || r.end < r.begin)
+            {
+                throw runtime_error(str(format(
+                    "Invalid region at %1%:%2%: %3%"
+                    ) % _regionsFile % in->lineNum() % line));
+            }
+            _regions->push_back(r);
+        }
+    }
+
+    return *_regions;
+}
+
+void CommandBase::addIndexOptions() {
+    _opts.add_options()
+        ("index",
+            po::value<string>(&_indexType),
+            "bgzip compress the output and write a tabix (tbi) or CSI (csi) "
+            "index for it alongside. requires --output-file.")
+        ;
+}
+
+std::ostream* CommandBase::openOutput(std::string const& path,
+        TabixIndex::Config const& config)
+{
+    if (_indexType.empty()) {
+        return _streams.get<ostream>(path);
+    }
+
+    auto type = TabixIndexBuilder::indexTypeFromString(_indexType);
+    return _streams.getBgzf(path,
+        std::make_unique<TabixIndexBuilder>(type, config));
+}
@@ -1,11 +1,15 @@
 #pragma once
 
 #include "common/Exceptions.hpp"
+#include "common/GenomicRegion.hpp"
 #include "common/cstdint.hpp"
 #include "io/StreamHandler.hpp"
+#include "io/TabixIndex.hpp"
 
 #include <boost/program_options.hpp>
 
+#include <cstddef>
+
 #include <iostream>
 #include <map>
 #include <memory>
@@ -38,12 +42,34 @@ public:
     void parseCommandLine(int argc, char** argv);
     void parseCommandLine(std::vector<std::string> const& args);
 
+    // Finish writing compressed output. Throws IOError on failure.
+    void closeStreams();
+
 protected:
     virtual void configureOptions() {}
     virtual void finalizeOptions() {}
 
+    // Adds the --region and --regions-file options. Commands calling this
+    // should open their inputs with _streams.openForReading(..., regions())
+    void addRegionOptions();
+    // The regions given on the command line, or an empty list if none were
+    std::vector<GenomicRegion> const& regions();
+
+    // The value of --threads
+    std::size_t threads() const;
+
+    // Adds the --index option, for commands producing sorted output
+    void addIndexOptions();
+    // Open the output file. If --index was given, the output is bgzip
+    // compressed and indexed using config to find the position of each
+    // record.
+    std::ostream* openOutput(std::string const& path,
+        TabixIndex::Config const& config);
+
 private:
     void checkHelp() const;
+    // The sequence names listed in the --sequence-order file
+    std::vector<std::string> readSequenceOrder();
 
 protected:
     bool _optionsParsed;
@@ -52,4 +78,18 @@ protected:
     std::unique_ptr<boost::program_options::parsed_options> _parsedArgs;
     boost::program_options::variables_map _varMap;
     StreamHandler _streams;
+
+private:
+    std::vector<std::string> _regionStrings;
+    std::string _regionsFile;
+    std::unique_ptr<std::vector<GenomicRegion>> _regions;
+    std::string _indexType;
+    std::string _outputCompression;
+    std::size_t _threads;
+    bool _readAhead;
+    std::string _sequenceOrderFile;
 };
+
+inline std::size_t CommandBase::threads() const {
+    return _threads;
+}
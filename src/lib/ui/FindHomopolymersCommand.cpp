@@ -86,8 +86,9 @@ void FindHomopolymersCommand::finalizeOptions() {
 }
 
 namespace {
-    bool strversLessThan(std::string const& x, std::string const& y) {
-        return strverscmp(x.c_str(), y.c_str()) < 0;
+    bool sequenceLessThan(std::string const& x, std::string const& y) {
+        SequenceDictionary& dict = SequenceDictionary::instance();
+        return dict.less(dict.id(x), dict.id(y));
     }
 }
 
@@ -99,7 +100,7 @@ void FindHomopolymersCommand::exec() {
 
     if (sequences_.empty()) {
         sequences_ = faIndex.sequenceOrder();
-        sort(sequences_.begin(), sequences_.end(), strversLessThan);
+        sort(sequences_.begin(), sequences_.end(), sequenceLessThan);
     }
 
     for (auto i = sequences_.begin(); i != sequences_.end(); ++i) {
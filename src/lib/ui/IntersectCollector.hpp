@@ -4,7 +4,51 @@
 #include "fileformats/Variant.hpp"
 #include "processors/IntersectionOutputFormatter.hpp"
 
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
+#include <vector>
+
+// Decides whether an a and b that intersect are a match under the exact
+// position and allele options
+class IntersectMatcher {
+public:
+    IntersectMatcher(
+            bool exactPos,
+            bool exactAllele,
+            bool iubMatch,
+            bool dbsnpMatch
+            )
+        : _exactPos(exactPos)
+        , _exactAllele(exactAllele)
+        , _iubMatch(iubMatch)
+        , _dbsnpMatch(dbsnpMatch)
+    {}
+
+    bool operator()(const Variant& va, const Variant& vb) const {
+        // TODO: clean this up! stop using bools and pass in a mode or functor
+        // i.e., flatten this
+        if (_exactAllele) {
+            if (!va.positionMatch(vb))
+                return false;
+
+            if (_dbsnpMatch)
+                return va.alleleDbSnpMatch(vb);
+            else if (_iubMatch)
+                return va.allelePartialMatch(vb);
+            else
+                return va.alleleMatch(vb);
+        }
+
+        return !_exactPos || va.positionMatch(vb);
+    }
+
+protected:
+    bool _exactPos;
+    bool _exactAllele;
+    bool _iubMatch;
+    bool _dbsnpMatch;
+};
 
 class IntersectCollector {
 public:
@@ -19,10 +63,7 @@ public:
             std::ostream* missB = NULL
             )
         : _outputBoth(outputBoth)
-        , _exactPos(exactPos)
-        , _exactAllele(exactAllele)
-        , _iubMatch(iubMatch)
-        , _dbsnpMatch(dbsnpMatch)
+        , _match(exactPos, exactAllele, iubMatch, dbsnpMatch)
         , _outputFormatter(outputFormatter)
         , _missA(missA)
         , _missB(missB)
@@ -63,23 +104,7 @@ public:
         }
         ++_hitCount;
 
-        // TODO: clean this up! stop using bools and pass in a mode or functor
-        // i.e., flatten this
-        if (_exactAllele) {
-            if (!va.positionMatch(vb))
-                return false;
-
-            if (_dbsnpMatch) {
-                if (!va.alleleDbSnpMatch(vb))
-                    return false;
-            } else if (_iubMatch) {
-                if (!va.allelePartialMatch(vb))
-                    return false;
-            } else if (!va.alleleMatch(vb)) {
-                return false;
-            }
-
-        } else if (_exactPos && !va.positionMatch(vb))
+        if (!_match(va, vb))
             return false;
 
         _lastA = va;
@@ -91,12 +116,71 @@ public:
 protected:
     Variant _lastA;
     bool _outputBoth;
-    bool _exactPos;
-    bool _exactAllele;
-    bool _iubMatch;
-    bool _dbsnpMatch;
+    IntersectMatcher _match;
     IntersectionOutput::Formatter& _outputFormatter;
     std::ostream* _missA;
     std::ostream* _missB;
     uint32_t _hitCount;
 };
+
+// Reports every value in A once, along with the number of values it hit
+// in each B input. B values must be Sourced (see SourcedMerge).
+class IntersectCountCollector {
+public:
+    IntersectCountCollector(
+            IntersectMatcher const& match,
+            std::size_t numSources,
+            IntersectionOutput::Formatter& outputFormatter,
+            std::ostream* missA = NULL,
+            std::ostream* missB = NULL
+            )
+        : _match(match)
+        , _outputFormatter(outputFormatter)
+        , _missA(missA)
+        , _missB(missB)
+        , _hitCounts(numSources)
+    {}
+
+    void missA(const Bed& a) {
+        if (_missA)
+            *_missA << a << "\n";
+    }
+
+    void missB(const Bed& b) {
+        if (_missB)
+            *_missB << b << "\n";
+    }
+
+    bool wantMissA() const {
+        return _missA;
+    }
+
+    bool wantMissB() const {
+        return _missB;
+    }
+
+    template<typename TypeB>
+    bool hit(const Bed& a, const TypeB& b) {
+        if (!_match(Variant(a), Variant(b)))
+            return false;
+
+        ++_hitCounts[b.sourceIndex()];
+        return true;
+    }
+
+    void finishA(const Bed& a) {
+        _outputFormatter.output(a, _hitCounts);
+        std::fill(_hitCounts.begin(), _hitCounts.end(), 0);
+    }
+
+protected:
+    IntersectMatcher _match;
+    IntersectionOutput::Formatter& _outputFormatter;
+    std::ostream* _missA;
+    std::ostream* _missB;
+    std::vector<uint32_t> _hitCounts;
+};
+
+inline void finishA(IntersectCountCollector& c, const Bed& a) {
+    c.finishA(a);
+}
@@ -1,16 +1,23 @@
 #include "IntersectCommand.hpp"
 #include "IntersectCollector.hpp"
 
+#include "common/ThreadPool.hpp"
 #include "common/cstdint.hpp"
 #include "fileformats/BedReader.hpp"
+#include "fileformats/Variant.hpp"
 #include "processors/IntersectFull.hpp"
+#include "processors/IntersectIndexed.hpp"
+#include "processors/IntervalIndex.hpp"
 #include "processors/IntersectionOutputFormatter.hpp"
+#include "processors/SourcedMerge.hpp"
 
 #include <boost/format.hpp>
 
 #include <algorithm>
 #include <cstdio>
+#include <deque>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <iterator>
 #include <memory>
@@ -21,6 +28,36 @@ namespace po = boost::program_options;
 using boost::format;
 using namespace std;
 
+namespace {
+    // the number of records from file a in each job given to the thread pool
+    size_t const BATCH_SIZE = 4096;
+
+    struct BatchResult {
+        typedef std::shared_ptr<BatchResult> ptr;
+
+        string hits;
+        string missesA;
+        vector<uint32_t> hitsB;
+    };
+
+    bool sameVariant(Bed const& x, Bed const& y) {
+        Variant vx(x);
+        Variant vy(y);
+        return vx.positionMatch(vy) && vx.alleleMatch(vy);
+    }
+
+    template<typename CollectorType>
+    void intersectBatch(IntervalIndex<Sourced<Bed>> const& index,
+            CollectorType& c, bool adjacentInsertions,
+            vector<Bed> const& batch, vector<uint32_t>* hitsB)
+    {
+        IntersectIndexed<Sourced<Bed>, CollectorType> intersector(
+            index, c, adjacentInsertions);
+        for (auto i = batch.begin(); i != batch.end(); ++i)
+            intersector.intersect(*i, hitsB);
+    }
+}
+
 IntersectCommand::IntersectCommand()
     : _outputFile("-")
     , _formatString("A")
@@ -31,6 +68,7 @@ IntersectCommand::IntersectCommand()
     , _iubMatch(false)
     , _dbsnpMatch(false)
     , _adjacentInsertions(false)
+    , _indexB(false)
 {
 }
 
@@ -41,8 +79,9 @@ void IntersectCommand::configureOptions() {
             "input .bed file a (required, - for stdin)")
 
         ("file-b,b",
-            po::value<string>(&_fileB)->required(),
-            "input .bed file b (required, - for stdin)")
+            po::value<vector<string>>(&_filesB)->required(),
+            "input .bed file b (required, - for stdin). may be given more "
+            "than once to intersect a with several files in one pass.")
 
         ("output-file,o",
             po::value<string>(&_outputFile)->default_value("-"),
@@ -54,7 +93,8 @@ void IntersectCommand::configureOptions() {
 
         ("format-string,F",
             po::value<string>(&_formatString),
-            "specify the output format explicity (see man page).")
+            "specify the output format explicity (see man page). defaults "
+            "to 'A C' when there is more than one file b.")
 
         ("full", "'full' output format, equivalent to -F 'I A B'")
 
@@ -79,10 +119,18 @@ void IntersectCommand::configureOptions() {
         ("adjacent-insertions",
             po::bool_switch(&_adjacentInsertions),
             "count insertions adjacent to other regions as intersecting")
+
+        ("index-b",
+            po::bool_switch(&_indexB),
+            "load file b into an in-memory index rather than streaming it. "
+            "file a then need not be sorted, and is processed by --threads "
+            "threads. output is in the order of file a.")
         ;
 
+    addRegionOptions();
+
     _posOpts.add("file-a", 1);
-    _posOpts.add("file-b", 1);
+    _posOpts.add("file-b", -1);
 }
 
 void IntersectCommand::finalizeOptions() {
@@ -107,6 +155,9 @@ void IntersectCommand::finalizeOptions() {
         );
     }
 
+    if (formattingOpts.empty() && _filesB.size() > 1)
+        _formatString = "A C";
+
     if (_varMap.count("output-both")) {
         _formatString = "A B";
         _outputBoth = true;
@@ -131,7 +182,7 @@ void IntersectCommand::finalizeOptions() {
 }
 
 void IntersectCommand::exec() {
-    if (_fileA == _fileB)
+    if (find(_filesB.begin(), _filesB.end(), _fileA) != _filesB.end())
         throw runtime_error("Input files have the same name, '" + _fileA + "', not good.");
 
     ostream* outHit = _streams.get<ostream>(_outputFile);
@@ -142,13 +193,14 @@ void IntersectCommand::exec() {
     // the outputFormatter!
     unsigned extraFieldsA = max(1u, outputFormatter.extraFields(0));
     unsigned extraFieldsB = max(1u, outputFormatter.extraFields(1));
-    InputStream::ptr inStreamA(_streams.openForReading(_fileA));
+    InputStream::ptr inStreamA(_streams.openForReading(_fileA, regions()));
     BedReader::ptr readerPtrA = openBed(*inStreamA, extraFieldsA);
     auto& fa = *readerPtrA;
 
-    InputStream::ptr inStreamB(_streams.openForReading(_fileB));
-    BedReader::ptr readerPtrB = openBed(*inStreamB, extraFieldsB);
-    auto& fb = *readerPtrB;
+    vector<InputStream::ptr> inStreamsB(_streams.openForReading(_filesB, regions()));
+    vector<BedReader::ptr> readersB;
+    for (auto i = inStreamsB.begin(); i != inStreamsB.end(); ++i)
+        readersB.push_back(openBed(**i, extraFieldsB));
 
     // don't try to read cin more than once or you will have a bad day
     if (_streams.cinReferences() > 1)
@@ -160,7 +212,119 @@ void IntersectCommand::exec() {
     if (!_missFileA.empty()) outMissA = _streams.get<ostream>(_missFileA);
     if (!_missFileB.empty()) outMissB = _streams.get<ostream>(_missFileB);
 
+    if (_indexB) {
+        execIndexed(fa, readersB, *outHit, outMissA, outMissB);
+        return;
+    }
+
     IntersectCollector c(_outputBoth, _exactPos, _exactAllele, _iubMatch, _dbsnpMatch, outputFormatter, outMissA, outMissB);
-    IntersectFull<BedReader, BedReader, IntersectCollector> intersector(fa, fb, c, _adjacentInsertions);
-    intersector.execute();
+    if (readersB.size() == 1 && !outputFormatter.hitCounts()) {
+        IntersectFull<BedReader, BedReader, IntersectCollector> intersector(fa, *readersB[0], c, _adjacentInsertions);
+        intersector.execute();
+        return;
+    }
+
+    // several b files are merged into one stream, remembering which file
+    // each record came from
+    typedef SourcedMerge<BedReader> MergedB;
+    MergedB fb(readersB);
+    if (outputFormatter.hitCounts()) {
+        IntersectMatcher match(_exactPos, _exactAllele, _iubMatch, _dbsnpMatch);
+        IntersectCountCollector cc(match, readersB.size(), outputFormatter, outMissA, outMissB);
+        IntersectFull<BedReader, MergedB, IntersectCountCollector> intersector(fa, fb, cc, _adjacentInsertions);
+        intersector.execute();
+    }
+    else {
+        IntersectFull<BedReader, MergedB, IntersectCollector> intersector(fa, fb, c, _adjacentInsertions);
+        intersector.execute();
+    }
+}
+
+void IntersectCommand::execIndexed(BedReader& fa, vector<BedReader::ptr>& fb,
+        ostream& outHit, ostream* outMissA, ostream* outMissB)
+{
+    typedef IntervalIndex<Sourced<Bed>> IndexType;
+    IndexType index;
+    Sourced<Bed> b;
+    for (size_t i = 0; i < fb.size(); ++i) {
+        while (fb[i]->next(b)) {
+            b.sourceIndex(i);
+            index.add(std::move(b));
+        }
+    }
+    index.build();
+
+    // each batch is written to strings, which are then written out in the
+    // order the batches were read
+    auto pool = _streams.threadPool();
+    size_t maxPending = 2 * pool->size() + 1;
+    deque<future<BatchResult::ptr>> pending;
+    vector<bool> hitB(index.size());
+
+    auto writeResult = [&]() {
+        BatchResult::ptr r = pending.front().get();
+        pending.pop_front();
+        outHit << r->hits;
+        if (outMissA)
+            *outMissA << r->missesA;
+        for (auto i = r->hitsB.begin(); i != r->hitsB.end(); ++i)
+            hitB[*i] = true;
+    };
+
+    for (;;) {
+        auto batch = std::make_shared<vector<Bed>>();
+        size_t n = fa.nextBatch(*batch, BATCH_SIZE);
+        if (n == 0)
+            break;
+        batch->resize(n);
+
+        // IntersectCollector prints a record only once when it is repeated
+        // on consecutive lines, so don't split such runs between batches
+        Bed* next(0);
+        while (!fa.eof() && fa.peek(&next) && sameVariant(batch->back(), *next)) {
+            batch->emplace_back();
+            fa.next(batch->back());
+        }
+
+        bool wantMissA = outMissA;
+        bool wantMissB = outMissB;
+        size_t numSources = fb.size();
+        pending.push_back(pool->submit([=, &index]() {
+            auto rv = std::make_shared<BatchResult>();
+            stringstream hits;
+            stringstream missesA;
+            IntersectionOutput::Formatter formatter(_formatString, hits);
+            vector<uint32_t>* hitsB = wantMissB ? &rv->hitsB : 0;
+            if (formatter.hitCounts()) {
+                IntersectMatcher match(_exactPos, _exactAllele, _iubMatch,
+                    _dbsnpMatch);
+                IntersectCountCollector c(match, numSources, formatter,
+                    wantMissA ? &missesA : 0);
+                intersectBatch(index, c, _adjacentInsertions, *batch, hitsB);
+            }
+            else {
+                IntersectCollector c(_outputBoth, _exactPos, _exactAllele,
+                    _iubMatch, _dbsnpMatch, formatter,
+                    wantMissA ? &missesA : 0);
+                intersectBatch(index, c, _adjacentInsertions, *batch, hitsB);
+            }
+
+            rv->hits = hits.str();
+            rv->missesA = missesA.str();
+            return rv;
+        }));
+
+        while (pending.size() > maxPending)
+            writeResult();
+    }
+
+    while (!pending.empty())
+        writeResult();
+
+    if (outMissB) {
+        for (size_t i = 0; i < hitB.size(); ++i) {
+            if (!hitB[i])
+                *outMissB << index[i] << "\n";
+        }
+    }
 }
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "fileformats/BedReader.hpp"
 #include "ui/CommandBase.hpp"
 
+#include <ostream>
 #include <string>
+#include <vector>
 
 class IntersectCommand : public CommandBase {
 public:
@@ -17,9 +20,15 @@ public:
     void finalizeOptions();
     void exec();
 
+protected:
+    // Load the b files into an IntervalIndex and intersect a against it in
+    // batches on the thread pool
+    void execIndexed(BedReader& fa, std::vector<BedReader::ptr>& fb,
+        std::ostream& outHit, std::ostream* outMissA, std::ostream* outMissB);
+
 protected:
     std::string _fileA;
-    std::string _fileB;
+    std::vector<std::string> _filesB;
     std::string _missFileA;
     std::string _missFileB;
     std::string _outputFile;
@@ -31,4 +40,5 @@ protected:
     bool _iubMatch;
     bool _dbsnpMatch;
     bool _adjacentInsertions;
+    bool _indexB;
 };
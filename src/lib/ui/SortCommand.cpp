@@ -14,8 +14,11 @@
 
 #include <boost/format.hpp>
 #include <boost/program_options.hpp>
+#include <cctype>
 #include <functional>
+#include <limits>
 #include <stdexcept>
+#include <string>
 
 namespace po = boost::program_options;
 using boost::format;
@@ -24,6 +27,7 @@ using namespace std;
 SortCommand::SortCommand()
     : _outputFile("-")
     , _maxInMem(1000000)
+    , _maxOpenFiles(0)
     , _mergeOnly(false)
     , _stable(false)
     , _unique(false)
@@ -50,19 +54,32 @@ void SortCommand::configureOptions() {
             po::value<uint64_t>(&_maxInMem)->default_value(_maxInMem),
             "maximum number of lines to hold in memory at once")
 
+        ("max-mem",
+            po::value<string>(&_maxMemString)->default_value(""),
+            "approximate maximum amount of memory to use for records held in "
+            "memory, in bytes, optionally suffixed with K, M, or G "
+            "(e.g., 512M). default=no limit")
+
+        ("max-open-files",
+            po::value<size_t>(&_maxOpenFiles)->default_value(_maxOpenFiles, "no limit"),
+            "maximum number of tmp files to merge at once. when more are "
+            "written, they are merged in multiple passes")
+
         ("stable,s",
             po::bool_switch(&_stable),
             "perform a 'stable' sort (default=false)")
 
         ("compression,C",
             po::value<string>(&_compressionString)->default_value(""),
-            "type of compression to use for temp files, n=none, g=gzip. default=n")
+            "type of compression to use for temp files, n=none, g=gzip, b=bgzf. default=n")
 
         ("unique,u",
             po::bool_switch(&_unique),
             "print only unique entries (bed format only)")
         ;
 
+    addIndexOptions();
+
     _posOpts.add("input-file", -1);
 }
 
@@ -100,14 +117,61 @@ namespace {
 
         return type;
     }
+
+    uint64_t parseMemorySize(string const& s) {
+        if (s.empty())
+            return 0;
+
+        // stoull would also take leading whitespace and a sign
+        size_t end = 0;
+        uint64_t rv = 0;
+        if (isdigit(static_cast<unsigned char>(s[0]))) {
+            try {
+                rv = stoull(s, &end);
+            }
+            catch (exception const&) {
+                end = 0;
+            }
+        }
+
+        if (end > 0 && end + 1 == s.size()) {
+            unsigned shift = 0;
+            switch (toupper(s[end])) {
+                case 'K': shift = 10; break;
+                case 'M': shift = 20; break;
+                case 'G': shift = 30; break;
+                default: break;
+            }
+            if (shift > 0 && rv <= (numeric_limits<uint64_t>::max() >> shift))
+                return rv << shift;
+        }
+        else if (end > 0 && end == s.size()) {
+            return rv;
+        }
+
+        throw runtime_error(str(format("Invalid memory size '%1%'") % s));
+    }
+
+    TabixIndex::Config indexConfig(FileType type) {
+        switch (type) {
+            case VCF: return TabixIndex::Config::vcf();
+            case CHROMPOS: return TabixIndex::Config::chromPos();
+            default: return TabixIndex::Config::bed();
+        }
+    }
 }
 
 void SortCommand::exec() {
     CompressionType compression = compressionTypeFromString(_compressionString);
+    uint64_t maxBytes = parseMemorySize(_maxMemString);
+    if (_maxOpenFiles == 1)
+        throw runtime_error("--max-open-files must be at least 2");
+
+    ThreadPool::ptr pool = _streams.threadPool();
 
     vector<InputStream::ptr> inputStreams = _streams.openForReading(_filenames);
     FileType type = detectFormat(inputStreams);
-    ostream* out = _streams.get<ostream>(_outputFile);
+    ostream* out = openOutput(_outputFile, indexConfig(type));
     if (_streams.cinReferences() > 1)
         throw IOError("stdin listed more than once!");
 
@@ -122,7 +186,9 @@ void SortCommand::exec() {
         ChromPosHeader hdr;
 
         auto sorter = makeSort(
-            readers, readerFactory, writer, hdr, _maxInMem, _stable, compression);
+            readers, readerFactory, writer, hdr, _maxInMem, _stable, compression, pool);
+        sorter->maxBytes(maxBytes);
+        sorter->maxOpenFiles(_maxOpenFiles);
         sorter->execute();
     } else if (type == BED) {
         int extraFields = _unique ? 1 : 0;
@@ -132,14 +198,18 @@ void SortCommand::exec() {
         if (_unique) {
             auto output = BedDeduplicator<DefaultPrinter>(writer);
             auto sorter = makeSort(
-                readers, readerFactory, output, hdr, _maxInMem, _stable, compression
+                readers, readerFactory, output, hdr, _maxInMem, _stable, compression, pool
                 );
+            sorter->maxBytes(maxBytes);
+            sorter->maxOpenFiles(_maxOpenFiles);
             sorter->execute();
         }
         else {
             auto sorter = makeSort(
-                readers, readerFactory, writer, hdr, _maxInMem, _stable, compression
+                readers, readerFactory, writer, hdr, _maxInMem, _stable, compression, pool
                 );
+            sorter->maxBytes(maxBytes);
+            sorter->maxOpenFiles(_maxOpenFiles);
             sorter->execute();
         }
 
@@ -155,7 +225,9 @@ void SortCommand::exec() {
         *out << hdr;
 
         auto sorter = makeSort(
-              readers, readerFactory, writer, hdr, _maxInMem, _stable, compression);
+              readers, readerFactory, writer, hdr, _maxInMem, _stable, compression, pool);
+        sorter->maxBytes(maxBytes);
+        sorter->maxOpenFiles(_maxOpenFiles);
         sorter->execute();
     } else {
         throw runtime_error("Unknown file type!");
@@ -2,6 +2,7 @@
 
 #include "ui/CommandBase.hpp"
 
+#include <cstddef>
 #include <fstream>
 #include <string>
 #include <vector>
@@ -22,6 +23,8 @@ protected:
     std::string _outputFile;
     std::vector<std::string> _filenames;
     uint64_t _maxInMem;
+    std::string _maxMemString;
+    std::size_t _maxOpenFiles;
     bool _mergeOnly;
     bool _stable;
     bool _unique;
@@ -55,6 +55,8 @@ void VcfAnnotateCommand::configureOptions() {
             "do not copy identifiers from the annotation file")
         ;
 
+    addRegionOptions();
+
     _posOpts.add("input-file", 1);
     _posOpts.add("annotation-file", 1);
 }
@@ -121,7 +123,7 @@ void VcfAnnotateCommand::postProcessArguments(Vcf::Header& header, Vcf::Header c
 
 void VcfAnnotateCommand::exec() {
     std::vector<std::string> filenames{_vcfFile, _annoFile};
-    vector<InputStream::ptr> inputStreams = _streams.openForReading(filenames);
+    vector<InputStream::ptr> inputStreams = _streams.openForReading(filenames, regions());
     auto readers = openStreams<Vcf::Entry>(inputStreams);
 
 
@@ -142,7 +144,9 @@ void VcfAnnotateCommand::exec() {
     postProcessArguments(header, annoHeader);
 
     GroupSortingWriter writer(*out);
-    auto annotator = makeSimpleVcfAnnotator(writer, !_noIdents, _infoMap, header);
+    // entries are read into the ones the annotator is done with
+    ValuePool<Vcf::Entry> pool;
+    auto annotator = makeSimpleVcfAnnotator(writer, !_noIdents, _infoMap, header, &pool);
 
     *out << vcfReader.header();
 
@@ -154,7 +158,7 @@ void VcfAnnotateCommand::exec() {
             , std::bind(&GroupSortingWriter::endGroup, std::ref(writer))
             );
     auto merger = makeMergeSorted(readers);
-    auto pump = makePointerStreamPump(merger, initialGrouper);
+    auto pump = makePointerStreamPump(merger, initialGrouper, &pool);
 
     pump.execute();
     initialGrouper.flush();
@@ -103,6 +103,8 @@ void VcfCompareCommand::configureOptions() {
             "Include reference alleles in counts")
         ;
 
+    addRegionOptions();
+
     _posOpts.add("input-file", -1);
 }
 
@@ -147,7 +149,7 @@ void VcfCompareCommand::exec() {
         throw std::runtime_error("At least two input files are required");
     }
 
-    std::vector<InputStream::ptr> inputStreams = _streams.openForReading(filenames_);
+    std::vector<InputStream::ptr> inputStreams = _streams.openForReading(filenames_, regions());
     ostream* out = _streams.get<std::ostream>(outputFile_);
 
     if (streamNames_.empty()) {
@@ -235,6 +237,8 @@ void VcfCompareCommand::exec() {
     }
 
     auto merger = makeMergeSorted(readers);
+    // entries are read into the ones the matcher is done with
+    ValuePool<Vcf::Entry> pool;
     VcfGenotypeMatcher matcher(
           streamNames_
         , sampleNames_
@@ -243,10 +247,11 @@ void VcfCompareCommand::exec() {
         , filterTypes_
         , entryCb
         , includeRefAlleles_
+        , &pool
         );
 
     auto overlap = makeGroupOverlapping<Vcf::Entry>(matcher);
-    auto pump = makePointerStreamPump(merger, overlap);
+    auto pump = makePointerStreamPump(merger, overlap, &pool);
     pump.execute();
     matcher.reportCounts(*out);
 }
@@ -1,7 +1,7 @@
 #include "VcfFilterCommand.hpp"
 
 #include "fileformats/DefaultPrinter.hpp"
-#include "fileformats/TypedStream.hpp"
+#include "fileformats/ParallelTypedStream.hpp"
 #include "fileformats/vcf/Entry.hpp"
 #include "fileformats/vcf/Header.hpp"
 #include "io/InputStream.hpp"
@@ -43,7 +43,8 @@ void VcfFilterCommand::exec() {
         throw runtime_error("stdin listed more than once!");
 
     DefaultPrinter writer(*out);
-    auto reader = openStream<Vcf::Entry>(instream);
+    auto reader = openParallelStream<Vcf::Entry>(*instream,
+        _streams.threadPool(), Vcf::SampleFieldDecoder({"DP"}));
     Vcf::Entry e;
     *out << reader->header();
     while (reader->next(e)) {
@@ -1,5 +1,7 @@
 #include "VcfMergeCommand.hpp"
 
+#include "common/SequenceDictionary.hpp"
+#include "common/ThreadPool.hpp"
 #include "common/Tokenizer.hpp"
 #include "fileformats/Fasta.hpp"
 #include "fileformats/StreamPump.hpp"
@@ -10,8 +12,12 @@
 #include "fileformats/vcf/Entry.hpp"
 #include "fileformats/vcf/Header.hpp"
 #include "fileformats/vcf/SampleTag.hpp"
+#include "io/BgzfLineSource.hpp"
 #include "io/InputStream.hpp"
+#include "io/TabixIndex.hpp"
+#include "io/TempFile.hpp"
 #include "processors/Deref.hpp"
+#include "processors/MergePlan.hpp"
 #include "processors/MergeSorted.hpp"
 #include "processors/VcfEntryMerger.hpp"
 #include "processors/VcfFilterer.hpp"
@@ -24,11 +30,17 @@
 #include "processors/grouping/GroupStats.hpp"
 
 #include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/format.hpp>
 #include <boost/function.hpp>
 #include <boost/program_options.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <future>
 #include <memory>
+#include <set>
 #include <stdexcept>
 
 namespace po = boost::program_options;
@@ -44,6 +56,8 @@ VcfMergeCommand::VcfMergeCommand()
     , _samplePriority(Vcf::MergeStrategy::eORDER)
     , _exactPos(false)
     , _allowSameFile(false)
+    , _parallel(false)
+    , _maxOpenFiles(0)
 {
 }
 
@@ -102,11 +116,26 @@ void VcfMergeCommand::configureOptions() {
             po::value<string>(&_rejectFilter)->default_value("MERGE_REJECT"),
             "The name of the filter to apply to entries rejected by the merger")
 
+        ("parallel",
+            po::bool_switch(&_parallel)->default_value(false),
+            "Merge each sequence separately, --threads at a time. Requires "
+            "bgzip compressed input files with tabix or CSI indexes")
+
+        ("max-open-files",
+            po::value<size_t>(&_maxOpenFiles)->default_value(_maxOpenFiles, "no limit"),
+            "Merge at most this many input files at once. With more inputs "
+            "than this, they are merged in several passes through "
+            "intermediate files. Can not be used with --parallel, "
+            "--require-consensus or stdin")
+
         ("print-stats",
             po::bool_switch(&_printStats)->default_value(false),
             "Print statistics about the size of each bundle of entries being merged")
         ;
 
+    addRegionOptions();
+    addIndexOptions();
+
     _posOpts.add("input-file", -1);
 }
 
@@ -136,6 +165,16 @@ void VcfMergeCommand::finalizeOptions() {
                 % _consensusOpts));
     }
 
+    if (_maxOpenFiles == 1)
+        throw runtime_error("--max-open-files must be at least 2");
+
+    if (_maxOpenFiles > 0 && _parallel)
+        throw runtime_error("--max-open-files can not be used with --parallel");
+
+    // the consensus needs to see every copy of each sample at once
+    if (_maxOpenFiles > 0 && !_consensusOpts.empty())
+        throw runtime_error("--max-open-files can not be used with --require-consensus");
+
     // FIXME: make program_options do this for us
     if (!_samplePrioStr.empty()) {
         if (_samplePrioStr == "o") {
@@ -187,6 +226,9 @@ void VcfMergeCommand::finalizeOptions() {
 }
 
 namespace {
+    char const* REJECT_FILTER_DESC =
+        "Rejected by vcf-merge (duplicate locus in same source file)";
+
     template<typename PrinterType, typename NormalizerType, typename EntryType>
     void writeNormalized(PrinterType& writer, NormalizerType& normalizer, EntryType& entry) {
         normalizer->normalize(entry);
@@ -194,48 +236,43 @@ namespace {
     }
 }
 
-void VcfMergeCommand::exec() {
-    std::unique_ptr<Vcf::AltNormalizer> normalizer;
-    std::unique_ptr<Fasta> ref;
-    if (!_fastaFile.empty()) {
-        ref = std::make_unique<Fasta>(_fastaFile);
-        normalizer = std::make_unique<Vcf::AltNormalizer>(*ref);
-    }
-
-    vector<InputStream::ptr> inputStreams = _streams.openForReading(_filenames);
-
-    ostream* out = _streams.get<ostream>(_outputFile);
-    if (_streams.cinReferences() > 1)
-        throw runtime_error("stdin listed more than once!");
-
-    auto readers = openStreams<Vcf::Entry>(inputStreams);
-
-    Vcf::Header mergedHeader;
-    for (size_t i = 0; i < inputStreams.size(); ++i) {
-        // if sample duplication is enabled for this file
-        auto dupIter = _dupSampleMap.find(inputStreams[i]->name());
-        if (dupIter != _dupSampleMap.end()) {
-            auto& header = readers[i]->header();
-            vector<string> sampleNames = header.sampleNames();
-            size_t nSamples = sampleNames.size();
-            for (size_t sampleIdx = 0; sampleIdx < nSamples; ++sampleIdx) {
-                string const& oldName = sampleNames[sampleIdx];
-                string newName = oldName + dupIter->second;
-                header.mirrorSample(oldName, newName);
-                Vcf::SampleTag const* oldTag = header.sampleTag(oldName);
-                if (oldTag) {
-                    Vcf::SampleTag newTag(*oldTag);
-                    newTag.set("ID", newName);
-                    header.addSampleTag(newTag);
-                }
+void VcfMergeCommand::prepareHeader(Vcf::Header& header,
+        std::string const& name) const
+{
+    // if sample duplication is enabled for this file
+    auto dupIter = _dupSampleMap.find(name);
+    if (dupIter != _dupSampleMap.end()) {
+        vector<string> sampleNames = header.sampleNames();
+        size_t nSamples = sampleNames.size();
+        for (size_t sampleIdx = 0; sampleIdx < nSamples; ++sampleIdx) {
+            string const& oldName = sampleNames[sampleIdx];
+            string newName = oldName + dupIter->second;
+            header.mirrorSample(oldName, newName);
+            Vcf::SampleTag const* oldTag = header.sampleTag(oldName);
+            if (oldTag) {
+                Vcf::SampleTag newTag(*oldTag);
+                newTag.set("ID", newName);
+                header.addSampleTag(newTag);
             }
         }
+    }
+}
 
-        mergedHeader.merge(readers[i]->header(), _mergeSamples);
-        readers[i]->header().sourceIndex(_fileOrder[inputStreams[i]->name()]);
+void VcfMergeCommand::merge(
+        vector<VcfReaderPtr> const& readers,
+        Vcf::Header& mergedHeader,
+        Vcf::MergeStrategy const& mergeStrategy,
+        Fasta const* ref,
+        ostream& out,
+        MergeStats& stats
+        ) const
+{
+    std::unique_ptr<Vcf::AltNormalizer> normalizer;
+    if (ref) {
+        normalizer = std::make_unique<Vcf::AltNormalizer>(*ref);
     }
 
-    GroupSortingWriter printer_raw(*out);
+    GroupSortingWriter printer_raw(out);
     auto printer = std::ref(printer_raw);
 
     boost::function<void(Vcf::Entry&)> writer;
@@ -251,8 +288,296 @@ void VcfMergeCommand::exec() {
         writer = printer;
     }
 
+    // entries are read into the ones the merger is done with
+    ValuePool<Vcf::Entry> pool;
+    auto entryMerger = makeVcfEntryMerger(writer, &mergedHeader, mergeStrategy, &pool);
+
+    // Rejection chain
+    auto deref = makeDeref(writer);
+    auto splitter = makeGroupForEach(deref);
+    auto reheader = makeVcfReheaderer(splitter, &mergedHeader);
+    auto filterer = makeVcfFilterer(reheader, _rejectFilter);
+    // End rejection chain
+
+    // Dedup will branch between the rejection chain (filterer) and the entryMerger
+    auto dedup = makeVcfSourceIndexDeduplicator(entryMerger, filterer, !_allowSameFile);
+
+    auto smallStats = makeGroupStats(dedup, "shared allele bundle size");
+    auto regionGrouper = makeGroupBySharedRegions(smallStats);
+    auto bigStats = makeGroupStats(regionGrouper, "overlapping bundle size");
+
+    auto initialGrouper = makeGroupOverlapping<Vcf::Entry>(
+              bigStats
+            , DefaultCoordinateView{}
+            , nothing
+            , std::bind(&GroupSortingWriter::endGroup, printer)
+            );
+    auto merger = makeMergeSorted(readers);
+    auto pump = makePointerStreamPump(merger, initialGrouper, &pool);
+
+    pump.execute();
+    initialGrouper.flush();
+
+    stats.overlapping = bigStats.sizeCounts();
+    stats.sharedAllele = smallStats.sizeCounts();
+}
+
+namespace {
+    struct IgnoreGroups {
+        template<typename T>
+        void operator()(T const&) {}
+    };
+
+    void addCounts(GroupSizeCounts& x, GroupSizeCounts const& y) {
+        for (auto i = y.begin(); i != y.end(); ++i)
+            x[i->first] += i->second;
+    }
+}
+
+VcfMergeCommand::MergeStats&
+VcfMergeCommand::MergeStats::operator+=(MergeStats const& rhs) {
+    addCounts(overlapping, rhs.overlapping);
+    addCounts(sharedAllele, rhs.sharedAllele);
+    return *this;
+}
+
+void VcfMergeCommand::printStats(ostream& os, MergeStats const& stats) const {
+    IgnoreGroups ignore;
+    auto bigStats = makeGroupStats(ignore, "overlapping bundle size");
+    auto smallStats = makeGroupStats(ignore, "shared allele bundle size");
+    bigStats.add(stats.overlapping);
+    smallStats.add(stats.sharedAllele);
+    os << bigStats << smallStats << "\n";
+}
+
+// Run the merge for each sequence separately on a thread pool. Each
+// sequence is written to a temp file, and these are copied to the output in
+// sequence order as they finish. Entries on different sequences never
+// overlap, so this gives the same result as merging everything at once.
+void VcfMergeCommand::mergeBySequence(
+        Vcf::Header& mergedHeader,
+        Vcf::MergeStrategy const& mergeStrategy,
+        Fasta const* ref,
+        ostream& out
+        )
+{
+    set<string> names;
+    for (auto i = _filenames.begin(); i != _filenames.end(); ++i) {
+        TabixIndex::ptr index;
+        if (*i != "-" && BgzfLineSource::isBgzf(*i))
+            index = TabixIndex::forDataFile(*i);
+
+        if (!index) {
+            throw IOError(str(format(
+                "--parallel requires bgzip compressed, indexed input files. "
+                "No tabix or CSI index found for %1%") % *i));
+        }
+        auto const& seqs = index->sequenceNames();
+        names.insert(seqs.begin(), seqs.end());
+    }
+
+    // the order in which MergeSorted would have produced them
+    vector<string> sequences(names.begin(), names.end());
+    SequenceDictionary& dict = SequenceDictionary::instance();
+    sort(sequences.begin(), sequences.end(),
+        [&dict](string const& x, string const& y) {
+            return dict.less(dict.id(x), dict.id(y));
+        });
+
+    auto dir = TempDir::create(TempDir::CLEANUP);
+    auto pool = _streams.threadPool();
+    vector<string> paths;
+    vector<std::future<MergeStats>> results;
+
+    for (size_t i = 0; i < sequences.size(); ++i) {
+        vector<GenomicRegion> seqRegions;
+        if (regions().empty()) {
+            seqRegions.emplace_back(sequences[i], 0, GenomicRegion::MAX_POSITION);
+        }
+        else {
+            for (auto r = regions().begin(); r != regions().end(); ++r) {
+                if (r->chrom == sequences[i])
+                    seqRegions.push_back(*r);
+            }
+            if (seqRegions.empty())
+                continue;
+        }
+
+        string path = str(format("%1%/%2%.vcf") % dir->path() % i);
+        results.push_back(pool->submit(
+            [this, seqRegions, path, &mergedHeader, &mergeStrategy, ref]() {
+                StreamHandler streams;
+                streams.threads(0);
+                auto inputStreams = streams.openForReading(_filenames, seqRegions);
+                auto readers = openStreams<Vcf::Entry>(inputStreams);
+                for (size_t j = 0; j < inputStreams.size(); ++j) {
+                    prepareHeader(readers[j]->header(), inputStreams[j]->name());
+                    readers[j]->header().sourceIndex(
+                        _fileOrder.find(inputStreams[j]->name())->second);
+                }
+
+                std::ofstream seqOut(path.c_str());
+                MergeStats stats;
+                merge(readers, mergedHeader, mergeStrategy, ref, seqOut, stats);
+                if (!seqOut) {
+                    throw IOError(str(format("Failed to write to %1%") % path));
+                }
+                return stats;
+            }));
+        paths.push_back(path);
+    }
+
+    // the stats are added up to match those of a single merge
+    MergeStats stats;
+    for (size_t i = 0; i < results.size(); ++i) {
+        stats += results[i].get();
+        {
+            std::ifstream in(paths[i].c_str());
+            out << in.rdbuf();
+        }
+        boost::filesystem::remove(paths[i]);
+    }
+
+    if (_printStats)
+        printStats(std::cerr, stats);
+}
+
+// Open the inputs to a merge pass. Only the original input files are
+// restricted to --region.
+vector<VcfMergeCommand::VcfReaderPtr> VcfMergeCommand::openPassInputs(
+        vector<PassInput> const& inputs,
+        vector<InputStream::ptr>& streams
+        )
+{
+    bool readAhead = inputs.size() <= StreamHandler::MAX_READ_AHEAD_INPUTS;
+    for (auto i = inputs.begin(); i != inputs.end(); ++i) {
+        auto const& r = i->original ? regions() : vector<GenomicRegion>();
+        if (readAhead)
+            streams.push_back(_streams.openForReading(i->path, r));
+        else
+            streams.push_back(_streams.openWithoutReadAhead(i->path, r));
+    }
+
+    auto readers = openStreams<Vcf::Entry>(streams);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (inputs[i].original)
+            prepareHeader(readers[i]->header(), streams[i]->name());
+        readers[i]->header().sourceIndex(inputs[i].sourceIndex);
+    }
+    return readers;
+}
+
+// Merge the input files in passes of at most --max-open-files at a time, as
+// planned by planMerge, writing the output of each pass to a file in dir.
+// Returns the inputs left for the final merge. Each pass merges files that
+// are adjacent in command line order and its output takes the place (and
+// source index) of the first of them, so sample priority is unchanged.
+// Indels are only normalized by the final merge.
+vector<VcfMergeCommand::PassInput> VcfMergeCommand::mergeInPasses(
+        Vcf::MergeStrategy const& mergeStrategy,
+        TempDir const& dir
+        )
+{
+    vector<PassInput> inputs;
+    for (auto i = _filenames.begin(); i != _filenames.end(); ++i) {
+        PassInput input = {*i, _fileOrder[*i], true};
+        inputs.push_back(input);
+    }
+    stable_sort(inputs.begin(), inputs.end(),
+        [](PassInput const& x, PassInput const& y) {
+            return x.sourceIndex < y.sourceIndex;
+        });
+
+    vector<uint64_t> sizes;
+    for (auto i = inputs.begin(); i != inputs.end(); ++i)
+        sizes.push_back(boost::filesystem::file_size(i->path));
+
+    vector<MergeStep> steps = planMerge(sizes, _maxOpenFiles);
+    for (size_t s = 0; s < steps.size(); ++s) {
+        auto first = inputs.begin() + steps[s].first;
+        auto last = first + steps[s].count;
+        PassInput merged = {
+              str(format("%1%/pass%2%.vcf") % dir.path() % s)
+            , first->sourceIndex
+            , false
+        };
+
+        {
+            vector<InputStream::ptr> streams;
+            auto readers = openPassInputs(vector<PassInput>(first, last), streams);
+
+            Vcf::Header header;
+            for (auto r = readers.begin(); r != readers.end(); ++r)
+                header.merge((*r)->header(), _mergeSamples);
+            header.addFilter(_rejectFilter, REJECT_FILTER_DESC);
+
+            Vcf::MergeStrategy passStrategy = mergeStrategy.forHeader(&header);
+            std::ofstream passOut(merged.path.c_str());
+            passOut << header;
+            MergeStats stats;
+            merge(readers, header, passStrategy, 0, passOut, stats);
+            if (!passOut) {
+                throw IOError(str(format("Failed to write to %1%") % merged.path));
+            }
+        }
+
+        for (auto i = first; i != last; ++i) {
+            if (!i->original)
+                boost::filesystem::remove(i->path);
+        }
+        *first = merged;
+        inputs.erase(first + 1, last);
+    }
+
+    return inputs;
+}
+
+void VcfMergeCommand::exec() {
+    std::unique_ptr<Fasta> ref;
+    if (!_fastaFile.empty()) {
+        ref = std::make_unique<Fasta>(_fastaFile);
+    }
+
+    bool inPasses = _maxOpenFiles > 0 && _filenames.size() > _maxOpenFiles;
+    vector<InputStream::ptr> inputStreams;
+    if (_parallel) {
+        // only the headers are read from these, see below
+        for (auto i = _filenames.begin(); i != _filenames.end(); ++i)
+            inputStreams.push_back(_streams.openWithoutReadAhead(*i, regions()));
+    }
+    else if (!inPasses)
+        inputStreams = _streams.openForReading(_filenames, regions());
+
+    ostream* out = openOutput(_outputFile, TabixIndex::Config::vcf());
+    if (_streams.cinReferences() > 1)
+        throw runtime_error("stdin listed more than once!");
+
+    vector<VcfReaderPtr> readers;
+    Vcf::Header mergedHeader;
+    if (inPasses) {
+        if (find(_filenames.begin(), _filenames.end(), "-") != _filenames.end())
+            throw runtime_error("--max-open-files can not be used with stdin");
+
+        // only the headers are needed for now, so read them one at a time
+        for (auto i = _filenames.begin(); i != _filenames.end(); ++i) {
+            vector<InputStream::ptr> in;
+            in.push_back(_streams.openWithoutReadAhead(*i));
+            auto r = openStreams<Vcf::Entry>(in);
+            prepareHeader(r[0]->header(), in[0]->name());
+            mergedHeader.merge(r[0]->header(), _mergeSamples);
+        }
+    }
+    else {
+        readers = openStreams<Vcf::Entry>(inputStreams);
+        for (size_t i = 0; i < inputStreams.size(); ++i) {
+            prepareHeader(readers[i]->header(), inputStreams[i]->name());
+            mergedHeader.merge(readers[i]->header(), _mergeSamples);
+            readers[i]->header().sourceIndex(_fileOrder[inputStreams[i]->name()]);
+        }
+    }
+
     std::unique_ptr<Vcf::ConsensusFilter> cnsFilt;
-    mergedHeader.addFilter(_rejectFilter, "Rejected by vcf-merge (duplicate locus in same source file)");
+    mergedHeader.addFilter(_rejectFilter, REJECT_FILTER_DESC);
     if (_consensusRatio > 0) {
         mergedHeader.addFilter(_consensusFilter, _consensusFilterDesc);
         if (mergedHeader.formatType("FT") == NULL) {
@@ -280,35 +605,25 @@ void VcfMergeCommand::exec() {
 
     *out << mergedHeader;
 
-    auto entryMerger = makeVcfEntryMerger(writer, &mergedHeader, mergeStrategy);
-
-    // Rejection chain
-    auto deref = makeDeref(writer);
-    auto splitter = makeGroupForEach(deref);
-    auto reheader = makeVcfReheaderer(splitter, &mergedHeader);
-    auto filterer = makeVcfFilterer(reheader, _rejectFilter);
-    // End rejection chain
-
-    // Dedup will branch between the rejection chain (filterer) and the entryMerger
-    auto dedup = makeVcfSourceIndexDeduplicator(entryMerger, filterer, !_allowSameFile);
-
-    auto smallStats = makeGroupStats(dedup, "shared allele bundle size");
-    auto regionGrouper = makeGroupBySharedRegions(smallStats);
-    auto bigStats = makeGroupStats(regionGrouper, "overlapping bundle size");
-
-    auto initialGrouper = makeGroupOverlapping<Vcf::Entry>(
-              bigStats
-            , DefaultCoordinateView{}
-            , nothing
-            , std::bind(&GroupSortingWriter::endGroup, printer)
-            );
-    auto merger = makeMergeSorted(readers);
-    auto pump = makePointerStreamPump(merger, initialGrouper);
-
-    pump.execute();
-    initialGrouper.flush();
-
-    if (_printStats) {
-        std::cerr << bigStats << smallStats << "\n";
+    if (_parallel) {
+        // the inputs opened above were only needed for their headers
+        readers.clear();
+        inputStreams.clear();
+        mergeBySequence(mergedHeader, mergeStrategy, ref.get(), *out);
+    }
+    else if (inPasses) {
+        auto dir = TempDir::create(TempDir::CLEANUP);
+        vector<PassInput> inputs = mergeInPasses(mergeStrategy, *dir);
+        readers = openPassInputs(inputs, inputStreams);
+        MergeStats stats;
+        merge(readers, mergedHeader, mergeStrategy, ref.get(), *out, stats);
+        if (_printStats)
+            printStats(std::cerr, stats);
+    }
+    else {
+        MergeStats stats;
+        merge(readers, mergedHeader, mergeStrategy, ref.get(), *out, stats);
+        if (_printStats)
+            printStats(std::cerr, stats);
     }
 }
@@ -1,10 +1,20 @@
 #pragma once
 
 #include "ui/CommandBase.hpp"
+#include "fileformats/TypedStream.hpp"
+#include "fileformats/vcf/Entry.hpp"
 #include "fileformats/vcf/MergeStrategy.hpp"
+#include "io/InputStream.hpp"
+#include "processors/grouping/GroupStats.hpp"
 
+#include <cstddef>
 #include <map>
+#include <ostream>
 #include <string>
+#include <vector>
+
+class Fasta;
+class TempDir;
 
 class VcfMergeCommand : public CommandBase {
 public:
@@ -19,6 +29,50 @@ public:
     void finalizeOptions();
     void exec();
 
+protected:
+    typedef TypedStream<DefaultParser<Vcf::Entry>>::ptr VcfReaderPtr;
+
+    // An input to a merge pass: either one of the input files, or the
+    // output of an earlier pass
+    struct PassInput {
+        std::string path;
+        std::size_t sourceIndex;
+        bool original;
+    };
+
+    // Sizes of the bundles of entries merged, for --print-stats
+    struct MergeStats {
+        GroupSizeCounts overlapping;
+        GroupSizeCounts sharedAllele;
+
+        MergeStats& operator+=(MergeStats const& rhs);
+    };
+
+    void prepareHeader(Vcf::Header& header, std::string const& name) const;
+    void merge(
+        std::vector<VcfReaderPtr> const& readers,
+        Vcf::Header& mergedHeader,
+        Vcf::MergeStrategy const& mergeStrategy,
+        Fasta const* ref,
+        std::ostream& out,
+        MergeStats& stats
+        ) const;
+    void printStats(std::ostream& os, MergeStats const& stats) const;
+    void mergeBySequence(
+        Vcf::Header& mergedHeader,
+        Vcf::MergeStrategy const& mergeStrategy,
+        Fasta const* ref,
+        std::ostream& out
+        );
+    std::vector<PassInput> mergeInPasses(
+        Vcf::MergeStrategy const& mergeStrategy,
+        TempDir const& dir
+        );
+    std::vector<VcfReaderPtr> openPassInputs(
+        std::vector<PassInput> const& inputs,
+        std::vector<InputStream::ptr>& streams
+        );
+
 protected:
     std::vector<std::string> _filenames;
     std::vector<std::string> _dupSampleFilenames;
@@ -40,4 +94,6 @@ protected:
     bool _exactPos;
     bool _printStats;
     bool _allowSameFile;
+    bool _parallel;
+    std::size_t _maxOpenFiles;
 };
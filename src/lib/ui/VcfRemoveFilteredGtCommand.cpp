@@ -1,6 +1,6 @@
 #include "VcfRemoveFilteredGtCommand.hpp"
 
-#include "fileformats/TypedStream.hpp"
+#include "fileformats/ParallelTypedStream.hpp"
 #include "fileformats/vcf/Entry.hpp"
 #include "io/InputStream.hpp"
 
@@ -46,7 +46,8 @@ void VcfRemoveFilteredGtCommand::exec() {
     InputStream::ptr inStream = _streams.openForReading(inputFile_);
     std::ostream* out = _streams.get<std::ostream>(outputFile_);
 
-    auto reader = openStream<Vcf::Entry>(inStream);
+    auto reader = openParallelStream<Vcf::Entry>(*inStream,
+        _streams.threadPool(), Vcf::SampleFieldDecoder({"FT"}));
     Vcf::Entry entry;
     *out << reader->header();
     while (reader->next(entry)) {
@@ -3,7 +3,7 @@
 #include "common/Exceptions.hpp"
 #include "common/MutationSpectrum.hpp"
 #include "common/compat.hpp"
-#include "fileformats/TypedStream.hpp"
+#include "fileformats/ParallelTypedStream.hpp"
 #include "fileformats/vcf/CustomType.hpp"
 #include "fileformats/vcf/CustomValue.hpp"
 #include "fileformats/vcf/Entry.hpp"
@@ -62,7 +62,8 @@ void VcfReportCommand::exec() {
     if (_streams.cinReferences() > 1)
         throw runtime_error("stdin listed more than once!");
     uint32_t totalSites = 0;
-    auto reader = openStream<Vcf::Entry>(*instream);
+    auto reader = openParallelStream<Vcf::Entry>(*instream,
+        _streams.threadPool(), Vcf::SampleFieldDecoder({"GT", "FT"}));
     Vcf::Entry entry;
     Metrics::SampleMetrics sampleMetrics(reader->header().sampleCount());
 
@@ -0,0 +1,41 @@
+#include "common/Arena.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+
+TEST(TestArena, allocate) {
+    Arena arena(64);
+    EXPECT_EQ(0u, arena.capacity());
+
+    char* a = static_cast<char*>(arena.allocate(10, 1));
+    char* b = static_cast<char*>(arena.allocate(10, 1));
+    EXPECT_EQ(a + 10, b);
+    EXPECT_EQ(64u, arena.capacity());
+
+    double* d = static_cast<double*>(arena.allocate(sizeof(double), alignof(double)));
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(d) % alignof(double));
+
+    // doesn't fit in what's left of the first block
+    arena.allocate(40, 1);
+    EXPECT_EQ(128u, arena.capacity());
+
+    // too big for any block
+    arena.allocate(1000, 1);
+    EXPECT_EQ(1128u, arena.capacity());
+
+    arena.reset();
+    EXPECT_EQ(0u, arena.capacity());
+}
+
+TEST(TestArena, create) {
+    Arena arena;
+    std::string* s = arena.create<std::string>("hello");
+    EXPECT_EQ("hello", *s);
+
+    int* x = arena.create<int>(42);
+    EXPECT_EQ(42, *x);
+
+    s->~basic_string();
+}
@@ -0,0 +1,48 @@
+#include "common/GenomicRegion.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <stdexcept>
+
+TEST(TestGenomicRegion, fromString) {
+    EXPECT_EQ(GenomicRegion("1", 99, 200), GenomicRegion::fromString("1:100-200"));
+    EXPECT_EQ(GenomicRegion("chrX", 999999, 2000000),
+        GenomicRegion::fromString("chrX:1,000,000-2,000,000"));
+}
+
+TEST(TestGenomicRegion, fromStringOpenEnded) {
+    EXPECT_EQ(GenomicRegion("1", 0, GenomicRegion::MAX_POSITION),
+        GenomicRegion::fromString("1"));
+    EXPECT_EQ(GenomicRegion("1", 99, GenomicRegion::MAX_POSITION),
+        GenomicRegion::fromString("1:100"));
+}
+
+TEST(TestGenomicRegion, fromStringColonInName) {
+    EXPECT_EQ(GenomicRegion("HLA-A*01:01:01:01", 0, 10),
+        GenomicRegion::fromString("HLA-A*01:01:01:01:1-10"));
+    EXPECT_EQ(GenomicRegion("HLA-A*01:01:01:0x", 0, GenomicRegion::MAX_POSITION),
+        GenomicRegion::fromString("HLA-A*01:01:01:0x"));
+}
+
+TEST(TestGenomicRegion, fromStringInvalid) {
+    EXPECT_THROW(GenomicRegion::fromString(""), std::runtime_error);
+    EXPECT_THROW(GenomicRegion::fromString("1:0-10"), std::runtime_error);
+    EXPECT_THROW(GenomicRegion::fromString("1:20-10"), std::runtime_error);
+}
+
+TEST(TestGenomicRegion, overlaps) {
+    GenomicRegion r("1", 10, 20);
+    EXPECT_TRUE(r.overlaps("1", 19, 30));
+    EXPECT_TRUE(r.overlaps("1", 0, 11));
+    EXPECT_FALSE(r.overlaps("1", 20, 30));
+    EXPECT_FALSE(r.overlaps("1", 0, 10));
+    EXPECT_FALSE(r.overlaps("2", 10, 20));
+}
+
+TEST(TestGenomicRegion, toStream) {
+    std::stringstream ss;
+    ss << GenomicRegion::fromString("1:100-200") << " "
+        << GenomicRegion::fromString("2");
+    EXPECT_EQ("1:100-200 2:1", ss.str());
+}
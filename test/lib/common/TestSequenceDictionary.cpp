@@ -0,0 +1,112 @@
+#include "common/SequenceDictionary.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    bool namesInOrder(SequenceDictionary& dict, vector<string> const& names) {
+        for (size_t i = 1; i < names.size(); ++i) {
+            if (!dict.less(dict.id(names[i - 1]), dict.id(names[i])))
+                return false;
+            if (dict.less(dict.id(names[i]), dict.id(names[i - 1])))
+                return false;
+        }
+        return true;
+    }
+}
+
+TEST(TestSequenceDictionary, ids) {
+    SequenceDictionary dict;
+    EXPECT_EQ(1u, dict.size());
+    EXPECT_EQ("", dict.name(SequenceDictionary::EMPTY));
+
+    uint32_t x = dict.id(string("X"));
+    uint32_t one = dict.id(string("1"));
+    EXPECT_NE(x, one);
+    EXPECT_EQ(x, dict.id(string("X")));
+    EXPECT_EQ(one, dict.id(StringView("1")));
+    EXPECT_EQ("X", dict.name(x));
+    EXPECT_EQ("1", dict.name(one));
+    EXPECT_EQ(3u, dict.size());
+    EXPECT_EQ(0, dict.compare(x, x));
+}
+
+TEST(TestSequenceDictionary, strverscmpOrder) {
+    SequenceDictionary dict;
+    vector<string> names{"X", "10", "GL000192.1", "2", "MT", "1", "chr10",
+        "chr9", "chr1_random", "chr1"};
+    for (auto i = names.begin(); i != names.end(); ++i)
+        dict.id(*i);
+
+    sort(names.begin(), names.end(), [](string const& x, string const& y) {
+        return strverscmp(x.c_str(), y.c_str()) < 0;
+    });
+    EXPECT_TRUE(namesInOrder(dict, names));
+}
+
+TEST(TestSequenceDictionary, relabel) {
+    SequenceDictionary dict;
+    dict.id(string("a"));
+    dict.id(string("b"));
+
+    // each of these goes between "a" and the one before it, halving the
+    // gap between their keys every time
+    vector<string> names{"a"};
+    for (size_t len = 100; len > 1; --len) {
+        dict.id(string(len, 'a'));
+        names.push_back(string(102 - len, 'a'));
+    }
+    names.push_back("b");
+
+    EXPECT_TRUE(namesInOrder(dict, names));
+}
+
+TEST(TestSequenceDictionary, setOrder) {
+    SequenceDictionary dict;
+    uint32_t chr1 = dict.id(string("chr1"));
+    uint32_t chr2 = dict.id(string("chr2"));
+    uint32_t chr10 = dict.id(string("chr10"));
+    EXPECT_TRUE(dict.less(chr2, chr10));
+
+    dict.setOrder(vector<string>{"chr10", "chr1", "chrM"});
+    EXPECT_TRUE(dict.less(chr10, chr1));
+    // names not listed come last
+    EXPECT_TRUE(dict.less(chr1, chr2));
+    EXPECT_TRUE(dict.less(dict.id(string("chrM")), chr2));
+    EXPECT_TRUE(namesInOrder(dict,
+        vector<string>{"chr10", "chr1", "chrM", "", "chr2", "chr3", "chrX"}));
+
+    EXPECT_THROW(dict.setOrder(vector<string>{"chr1", "chr2", "chr1"}),
+        runtime_error);
+}
+
+TEST(TestSequenceDictionary, threads) {
+    SequenceDictionary dict;
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&dict, t]() {
+            for (int i = 1000; i > 0; --i) {
+                string name = "s" + to_string(i * 4 + t);
+                uint32_t id = dict.id(name);
+                ASSERT_EQ(name, dict.name(id));
+                ASSERT_TRUE(dict.less(SequenceDictionary::EMPTY, id));
+            }
+        });
+    }
+    for (auto i = threads.begin(); i != threads.end(); ++i)
+        i->join();
+
+    EXPECT_EQ(4001u, dict.size());
+    vector<string> names;
+    for (int i = 4; i < 4004; ++i)
+        names.push_back("s" + to_string(i));
+    EXPECT_TRUE(namesInOrder(dict, names));
+}
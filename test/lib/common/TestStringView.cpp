@@ -48,3 +48,13 @@ TEST(TestStringView, equal) {
     ASSERT_FALSE(data == "tesf");
     ASSERT_FALSE(data == "tes");
 }
+
+TEST(TestStringView, equalNotNullTerminated) {
+    string _data("testtest");
+    StringView first(_data.data(), _data.data() + 4);
+    StringView second(_data.data() + 4, _data.data() + 8);
+    ASSERT_TRUE(first == second);
+    ASSERT_TRUE(first == string("test"));
+    ASSERT_FALSE(first == string("tes"));
+    ASSERT_FALSE(first == string("testt"));
+}
@@ -0,0 +1,39 @@
+#include "common/ThreadPool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <future>
+#include <vector>
+
+TEST(TestThreadPool, submit) {
+    auto pool = ThreadPool::create(3);
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 100; ++i)
+        results.push_back(pool->submit([i]() { return i * i; }));
+
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(i * i, results[i].get());
+    EXPECT_FALSE(pool->inWorker());
+}
+
+TEST(TestThreadPool, noThreads) {
+    auto pool = ThreadPool::create(0);
+    EXPECT_EQ(0u, pool->size());
+    EXPECT_EQ(7, pool->submit([]() { return 7; }).get());
+}
+
+TEST(TestThreadPool, nestedSubmit) {
+    // every worker waits on a job it submits; those must run inline
+    auto pool = ThreadPool::create(2);
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 4; ++i) {
+        ThreadPool* p = pool.get();
+        results.push_back(pool->submit([p, i]() {
+            EXPECT_TRUE(p->inWorker());
+            return p->submit([i]() { return i + 1; }).get();
+        }));
+    }
+
+    for (int i = 0; i < 4; ++i)
+        EXPECT_EQ(i + 1, results[i].get());
+}
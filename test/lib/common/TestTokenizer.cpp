@@ -239,6 +239,23 @@ TEST(Tokenizer, extractPointers) {
     ASSERT_EQ("33", string(b, e));
 }
 
+TEST(TestTokenizer, notNullTerminated) {
+    string text = "a,b,c\td,e";
+    Tokenizer<char> t(text.data(), text.data() + 5, ',');
+    string tok;
+    ASSERT_TRUE(t.extract(tok));
+    ASSERT_EQ("a", tok);
+    ASSERT_TRUE(t.extract(tok));
+    ASSERT_EQ("b", tok);
+    ASSERT_EQ(',', t.lastDelim());
+    t.remaining(tok);
+    ASSERT_EQ("c", tok);
+    ASSERT_TRUE(t.extract(tok));
+    ASSERT_EQ("c", tok);
+    ASSERT_EQ('\0', t.lastDelim());
+    ASSERT_FALSE(t.extract(tok));
+}
+
 TEST(TestTokenizer, testStringView) {
     string fromDbsnp(
         "1\t13302\trs180734498\tC\tT\t.\t.\tRSPOS=13302;dbSNPBuildID=135;SSR=0;SAO=0;VP=050000000000000010000100;WGT=0;VC=SNV;KGPilot123\n"
@@ -1,6 +1,9 @@
 #include "fileformats/Bed.hpp"
+#include "fileformats/BedReader.hpp"
 #include "common/LocusCompare.hpp"
+#include "io/InputStream.hpp"
 
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <gtest/gtest.h>
@@ -13,7 +16,6 @@ namespace {
 
 class TestableBed : public Bed {
 public:
-    using Bed::_chrom;
     using Bed::_start;
     using Bed::_stop;
 };
@@ -35,6 +37,28 @@ TEST(Bed, parse) {
     ASSERT_EQ(Bed::INDEL, snv.type());
 }
 
+TEST(Bed, parseStringView) {
+    // the view is not null terminated and is followed by more data
+    string text = "1\t2\t3\ta/0\t44\n2\t5\t6\tC/T\t1\t2";
+    StringView line(text.data(), text.data() + text.find('\n'));
+    Bed bed;
+    Bed::parseLine(&hdr, line, bed, 2);
+    ASSERT_EQ("1", bed.chrom());
+    ASSERT_EQ(2, bed.start());
+    ASSERT_EQ(3, bed.stop());
+    ASSERT_EQ(2u, bed.extraFields().size());
+    ASSERT_EQ("A/*", bed.extraFields()[0]);
+    ASSERT_EQ("44", bed.extraFields()[1]);
+    ASSERT_EQ("1\t2\t3\ta/0\t44", bed.toString());
+
+    // reuse the same object with fewer extra fields
+    line.assign(text.data() + text.find('\n') + 1, text.data() + text.size());
+    Bed::parseLine(&hdr, line, bed, 1);
+    ASSERT_EQ("2", bed.chrom());
+    ASSERT_EQ(1u, bed.extraFields().size());
+    ASSERT_EQ("C/T", bed.extraFields()[0]);
+}
+
 TEST(Bed, length) {
     Bed snv("1", 2, 3);
     Bed del2bp("1", 2, 4);
@@ -100,14 +124,47 @@ TEST(Bed, cmp) {
     ASSERT_LT(0, cmp(b, a));
 
     b = a;
-    b._chrom = "2";
+    b.chrom("2");
     ASSERT_GT(0, cmp(a, b));
     ASSERT_LT(0, cmp(b, a));
 
-    a._chrom = "22";
+    a.chrom("22");
     b = a;
-    b._chrom = "X";
+    b.chrom("X");
     ASSERT_GT(0, cmp(a, b)) << "bed chromosome sort: 22 < X";
     ASSERT_LT(0, cmp(b, a)) << "bed chromosome sort: X > 22";
 }
 
+
+TEST(Bed, nextBatch) {
+    stringstream ss;
+    for (int i = 0; i < 10; ++i)
+        ss << "1\t" << i << "\t" << i + 1 << "\tNAME" << i << "\n";
+    InputStream in("test", ss);
+    auto reader = openBed(in, 1);
+
+    // the peeked value is returned first
+    Bed* peeked;
+    ASSERT_TRUE(reader->peek(&peeked));
+    EXPECT_EQ(0, peeked->start());
+
+    vector<Bed> batch;
+    EXPECT_EQ(4u, reader->nextBatch(batch, 4));
+    ASSERT_EQ(4u, batch.size());
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(i, batch[i].start());
+        EXPECT_EQ("NAME" + to_string(i), batch[i].extraFields()[0]);
+    }
+
+    EXPECT_EQ(4u, reader->nextBatch(batch, 4));
+    EXPECT_EQ(4, batch[0].start());
+
+    // values past the count are left in place
+    EXPECT_EQ(2u, reader->nextBatch(batch, 4));
+    EXPECT_EQ(4u, batch.size());
+    EXPECT_EQ(8, batch[0].start());
+    EXPECT_EQ(9, batch[1].start());
+
+    EXPECT_EQ(0u, reader->nextBatch(batch, 4));
+    EXPECT_TRUE(reader->eof());
+}
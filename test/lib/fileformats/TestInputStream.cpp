@@ -80,3 +80,28 @@ TEST(InputStream, gzipNoNewline) {
     EXPECT_TRUE(in.getline(line));
     EXPECT_EQ("no newline", line);
 }
+
+TEST(InputStream, stringView) {
+    auto tmpFile = TempFile::create(TempFile::CLEANUP);
+    ofstream out(tmpFile->path());
+    out << "one\n\ntwo\nthree";
+    out.close();
+
+    GZipLineSource::ptr gzin(new GZipLineSource(tmpFile->path()));
+    InputStream in("test", gzin);
+    in.caching(true);
+
+    StringView line;
+    EXPECT_TRUE(in.getline(line));
+    EXPECT_EQ("one", line);
+    EXPECT_TRUE(in.getline(line));
+    EXPECT_EQ("two", line);
+    EXPECT_TRUE(in.getline(line));
+    EXPECT_EQ("three", line);
+    EXPECT_FALSE(in.getline(line));
+    EXPECT_TRUE(line.empty());
+
+    in.rewind();
+    EXPECT_TRUE(in.getline(line));
+    EXPECT_EQ("one", line);
+}
@@ -0,0 +1,119 @@
+#include "fileformats/ParallelTypedStream.hpp"
+
+#include "fileformats/Bed.hpp"
+#include "fileformats/vcf/Entry.hpp"
+#include "io/InputStream.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    string vcfHeader =
+        "##fileformat=VCFv4.1\n"
+        "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n"
+        "##FORMAT=<ID=DP,Number=1,Type=Integer,Description=\"Depth\">\n"
+        "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tS1\tS2\n"
+        ;
+}
+
+class TestParallelTypedStream : public ::testing::TestWithParam<size_t> {
+};
+
+TEST_P(TestParallelTypedStream, bedInOrder) {
+    stringstream data;
+    data << "# comment\n";
+    for (int i = 0; i < 5000; ++i) {
+        data << "1\t" << i << "\t" << i + 1 << "\n";
+        if (i % 1000 == 0)
+            data << "\n";
+    }
+
+    InputStream in("test", data);
+    DefaultParser<Bed> parser;
+    ParallelTypedStream<DefaultParser<Bed>> stream(parser, in,
+        ThreadPool::create(GetParam()), ParallelTypedStream<DefaultParser<Bed>>::Prepare(), 7);
+
+    Bed* peeked;
+    ASSERT_TRUE(stream.peek(&peeked));
+    EXPECT_EQ(0, peeked->start());
+
+    Bed b;
+    for (int i = 0; i < 5000; ++i) {
+        ASSERT_TRUE(stream.next(b));
+        EXPECT_EQ(i, b.start());
+    }
+    EXPECT_FALSE(stream.next(b));
+    EXPECT_TRUE(stream.eof());
+    EXPECT_EQ(5000u, stream.valueCount());
+}
+
+TEST_P(TestParallelTypedStream, vcfSampleData) {
+    stringstream data;
+    data << vcfHeader;
+    for (int i = 1; i <= 1000; ++i) {
+        data << "1\t" << i << "\t.\tA\tC\t.\t.\t.\tGT:DP\t0/1:" << i
+            << "\t1/1:" << 2 * i << "\n";
+    }
+
+    InputStream in("test", data);
+    auto stream = openParallelStream<Vcf::Entry>(in,
+        ThreadPool::create(GetParam()), Vcf::SampleFieldDecoder({"DP"}));
+    EXPECT_EQ(2u, stream->header().sampleCount());
+
+    Vcf::Entry e;
+    for (int i = 1; i <= 1000; ++i) {
+        ASSERT_TRUE(stream->next(e));
+        EXPECT_EQ(uint64_t(i), e.pos());
+        EXPECT_EQ(uint64_t(i + 4), stream->lineNum());
+        EXPECT_EQ(2u, e.sampleData().samplesWithData());
+        EXPECT_EQ(int64_t(2 * i), *e.sampleData().get(1, "DP")->get<int64_t>(0));
+        EXPECT_EQ(&stream->header(), &e.header());
+    }
+    EXPECT_FALSE(stream->next(e));
+}
+
+TEST_P(TestParallelTypedStream, parseError) {
+    stringstream data;
+    data << vcfHeader;
+    for (int i = 1; i <= 100; ++i) {
+        data << "1\t" << i << "\t.\tA\tC\t.\t.\t.\n";
+    }
+    data << "1\tx\n";
+    for (int i = 101; i <= 200; ++i) {
+        data << "1\t" << i << "\t.\tA\tC\t.\t.\t.\n";
+    }
+
+    // small chunks, so that there are chunks past the error still pending
+    InputStream in("test", data);
+    DefaultParser<Vcf::Entry> parser;
+    ParallelTypedStream<DefaultParser<Vcf::Entry>> stream(parser, in,
+        ThreadPool::create(GetParam()),
+        ParallelTypedStream<DefaultParser<Vcf::Entry>>::Prepare(), 7);
+
+    Vcf::Entry e;
+    for (int i = 1; i <= 100; ++i) {
+        ASSERT_TRUE(stream.next(e));
+        EXPECT_EQ(uint64_t(i), e.pos());
+    }
+    try {
+        stream.next(e);
+        FAIL() << "expected a parse error";
+    }
+    catch (runtime_error const& err) {
+        EXPECT_NE(string::npos, string(err.what()).find("Error at test:105:"))
+            << err.what();
+    }
+
+    // the stream ends at the error
+    EXPECT_FALSE(stream.next(e));
+    EXPECT_TRUE(stream.eof());
+}
+
+INSTANTIATE_TEST_CASE_P(Threads, TestParallelTypedStream,
+    ::testing::Values(0u, 1u, 4u));
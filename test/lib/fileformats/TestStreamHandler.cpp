@@ -1,6 +1,7 @@
 #include "io/StreamHandler.hpp"
 #include "io/InputStream.hpp"
 
+#include "io/Bgzf.hpp"
 #include "io/TempFile.hpp"
 
 #include <gtest/gtest.h>
@@ -101,3 +102,26 @@ TEST_F(TestStreamHandler, readFromStdin) {
     line += "\n";
     EXPECT_EQ(messages[0], line);
 }
+
+TEST_F(TestStreamHandler, readBgzf) {
+    auto tmp = TempFile::create(TempFile::CLEANUP);
+    std::string block;
+    for (size_t i = 0; i < messages.size(); ++i) {
+        Bgzf::deflateBlock(messages[i].data(), messages[i].size(), block);
+        tmp->stream().write(block.data(), block.size());
+    }
+    tmp->stream().write(Bgzf::EOF_BLOCK, sizeof(Bgzf::EOF_BLOCK));
+    tmp->stream().close();
+
+    streams.threads(2);
+    InputStream::ptr in = streams.openForReading(tmp->path());
+    for (size_t i = 0; i < messages.size(); ++i) {
+        std::string line;
+        EXPECT_TRUE(in->getline(line));
+        line += "\n";
+        EXPECT_EQ(messages[i], line);
+    }
+    std::string line;
+    EXPECT_FALSE(in->getline(line));
+    EXPECT_TRUE(in->eof());
+}
@@ -238,3 +238,72 @@ TEST(VcfCustomValue, perAltRefList) {
     ASSERT_FALSE(value.get<int64_t>(3));
     ASSERT_FALSE(value.get<int64_t>(4));
 }
+
+TEST(VcfCustomValue, missingElements) {
+    CustomType varInt("X", CustomType::VARIABLE_SIZE, 0, CustomType::INTEGER, "numbers");
+    CustomValue ints(&varInt, "1,.,3");
+    ASSERT_EQ(3u, ints.size());
+    EXPECT_FALSE(ints.get<int64_t>(1));
+    EXPECT_EQ(0, ints.getAny(1).which());
+    EXPECT_EQ(".", ints.getString(1));
+    EXPECT_EQ("1,.,3", ints.toString());
+
+    CustomType varFloat("Y", CustomType::VARIABLE_SIZE, 0, CustomType::FLOAT, "numbers");
+    CustomValue floats(&varFloat, ".,0.5");
+    EXPECT_FALSE(floats.get<double>(0));
+    EXPECT_EQ(".,0.5", floats.toString());
+
+    CustomType varString("Z", CustomType::VARIABLE_SIZE, 0, CustomType::STRING, "words");
+    CustomValue strings(&varString, "a,.");
+    EXPECT_FALSE(strings.get<string>(1));
+    EXPECT_EQ("a,.", strings.toString());
+
+    // an empty string is a value, not a missing element
+    CustomValue empties(&varString);
+    empties.setRaw({string("a"), string(""), CustomValue::ValueType(), string("b")});
+    ASSERT_TRUE(empties.get<string>(1) != 0);
+    EXPECT_EQ("", *empties.get<string>(1));
+    EXPECT_FALSE(empties.get<string>(2));
+    EXPECT_EQ("a,,.,b", empties.toString());
+    empties.set<string>(2, "");
+    EXPECT_EQ("a,,,b", empties.toString());
+
+    vector<CustomValue::ValueType> raw = ints.getRaw();
+    ASSERT_EQ(3u, raw.size());
+    EXPECT_EQ(int64_t(1), boost::get<int64_t>(raw[0]));
+    EXPECT_EQ(0, raw[1].which());
+
+    CustomValue copy(&varInt);
+    copy.setRaw(raw);
+    EXPECT_EQ(ints, copy);
+}
+
+TEST(VcfCustomValue, equality) {
+    CustomType varFloat("Y", CustomType::VARIABLE_SIZE, 0, CustomType::FLOAT, "numbers");
+    CustomType otherFloat("Q", CustomType::VARIABLE_SIZE, 0, CustomType::FLOAT, "numbers");
+    EXPECT_EQ(CustomValue(&varFloat, "1,.,2"), CustomValue(&varFloat, "1,.,2"));
+    EXPECT_NE(CustomValue(&varFloat, "1,.,2"), CustomValue(&varFloat, "1,2,."));
+    EXPECT_NE(CustomValue(&varFloat, "1,2"), CustomValue(&varFloat, "1,2,3"));
+    EXPECT_NE(CustomValue(&varFloat, "1"), CustomValue(&otherFloat, "1"));
+    // values that print the same compare equal
+    EXPECT_EQ(CustomValue(&varFloat, "0.1234567"), CustomValue(&varFloat, "0.1234568"));
+    // as do empty values and values of only missing elements
+    CustomValue missing(&varFloat);
+    missing.setRaw(vector<CustomValue::ValueType>(1));
+    EXPECT_EQ(CustomValue(&varFloat, "."), missing);
+}
+
+TEST(VcfCustomValue, appendAndSum) {
+    CustomType varString("Z", CustomType::VARIABLE_SIZE, 0, CustomType::STRING, "words");
+    CustomValue strings(&varString, "a,b");
+    strings.append(CustomValue(&varString, "c,."));
+    strings.append(CustomValue(&varString));
+    EXPECT_EQ("a,b,c,.", strings.toString());
+
+    CustomType fixedInt("DP", CustomType::FIXED_SIZE, 2, CustomType::INTEGER, "depth");
+    CustomValue sum(&fixedInt);
+    sum += CustomValue(&fixedInt, "1,.");
+    sum += CustomValue(&fixedInt, "2,3");
+    EXPECT_EQ("3,3", sum.toString());
+    EXPECT_THROW(strings += strings, runtime_error);
+}
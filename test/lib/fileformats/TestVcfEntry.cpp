@@ -414,7 +414,7 @@ TEST_F(TestVcfEntry, sampleDataPrintCertainSample) {
 TEST_F(TestVcfEntry, multipleFilters) {
     stringstream vcfss(filteredTwiceLine);
     string line;
-    ASSERT_TRUE(getline(vcfss, line));
+    ASSERT_FALSE(getline(vcfss, line).fail());
     Entry e(&_header, line);
 
     EXPECT_EQ(2u, e.failedFilters().size());
@@ -424,7 +424,7 @@ TEST_F(TestVcfEntry, multipleFilters) {
 TEST_F(TestVcfEntry, multipleFiltersWhitelist) {
     stringstream vcfss(filteredTwiceLine);
     string line;
-    ASSERT_TRUE(getline(vcfss, line));
+    ASSERT_FALSE(getline(vcfss, line).fail());
     Entry e(&_header, line);
 
     EXPECT_EQ(2u, e.failedFilters().size());
@@ -443,3 +443,68 @@ TEST_F(TestVcfEntry, multipleFiltersWhitelist) {
     whitelist.insert("q10");
     EXPECT_FALSE(e.isFilteredByAnythingExcept(whitelist));
 }
+
+TEST_F(TestVcfEntry, unmodifiedColumnsPassThrough) {
+    string line =
+        "20\t14370\trs2;rs1\tG\tA\t29.0\tq10;PASS\tNS=3;DP=14\t"
+        "GT:GQ\t0|0:048\t1|0:48\t.";
+
+    Entry e(&_header, line);
+    // reading doesn't count as changing
+    EXPECT_EQ(14, *e.info("DP")->get<int64_t>(0));
+    EXPECT_EQ(48, *e.sampleData().get(0, "GQ")->get<int64_t>(0));
+    EXPECT_EQ(line, e.toString());
+    // the sample text moved into SampleData goes with it
+    Entry copy(e);
+    EXPECT_EQ(line, copy.toString());
+    Entry other;
+    other.swap(copy);
+    EXPECT_EQ(line, other.toString());
+
+    // only the columns that changed are formatted again
+    e.addFilter("s50");
+    e.sampleData().removeLowDepthGenotypes(1);
+    EXPECT_EQ(
+        "20\t14370\trs2;rs1\tG\tA\t29.0\tq10;s50\tNS=3;DP=14\t"
+        "GT:GQ\t0|0:048\t1|0:48\t.",
+        e.toString());
+
+    e.sampleData().addFilter(1, "bad");
+    EXPECT_EQ(
+        "20\t14370\trs2;rs1\tG\tA\t29.0\tq10;s50\tNS=3;DP=14\t"
+        "GT:GQ:FT\t0|0:48\t1|0:48:bad\t.",
+        e.toString());
+}
+
+TEST_F(TestVcfEntry, identifiersAndFilters) {
+    Entry e(&_header, "20\t14370\trs2;rs1;rs2\tG\tA\t29\ts50;PASS;q10\t.");
+    EXPECT_EQ(vector<string>({"rs1", "rs2"}), e.identifiers());
+    EXPECT_EQ(vector<string>({"q10", "s50"}),
+        vector<string>(e.failedFilters().begin(), e.failedFilters().end()));
+    // the line is still written back as it was read
+    stringstream ss;
+    e.allButSamplesToStream(ss);
+    EXPECT_EQ("20\t14370\trs2;rs1;rs2\tG\tA\t29\ts50;PASS;q10\t.", ss.str());
+
+    e.addIdentifier("rs10");
+    e.addIdentifier("rs1");
+    EXPECT_EQ(vector<string>({"rs1", "rs10", "rs2"}), e.identifiers());
+    ss.str("");
+    e.allButSamplesToStream(ss);
+    EXPECT_EQ("20\t14370\trs1;rs10;rs2\tG\tA\t29\ts50;PASS;q10\t.", ss.str());
+
+    string line("20\t14370\t.\tG\tA\t29\t.\t.");
+    Entry::parseLine(&_header, line, e);
+    EXPECT_TRUE(e.identifiers().empty());
+    EXPECT_TRUE(e.failedFilters().empty());
+
+    // FILTER is split on ';' as is, "." only means missing on its own
+    line = "20\t14370\t.\tG\tA\t29\tq10;.;s50\t.";
+    Entry::parseLine(&_header, line, e);
+    EXPECT_EQ(vector<string>({".", "q10", "s50"}),
+        vector<string>(e.failedFilters().begin(), e.failedFilters().end()));
+
+    line = "20\t14370\t.\tG\tA\t29\t\t.";
+    Entry::parseLine(&_header, line, e);
+    EXPECT_TRUE(e.failedFilters().empty());
+}
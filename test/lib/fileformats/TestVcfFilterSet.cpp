@@ -0,0 +1,100 @@
+#include "fileformats/vcf/FilterSet.hpp"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Vcf;
+
+namespace {
+    vector<string> names(FilterSet const& s) {
+        return vector<string>(s.begin(), s.end());
+    }
+}
+
+TEST(VcfFilterSet, intern) {
+    string a("q10");
+    string b("q10");
+    EXPECT_EQ(FilterSet::intern(StringView(a.data(), a.data() + a.size())),
+        FilterSet::intern(StringView(b.data(), b.data() + b.size())));
+    EXPECT_NE(FilterSet::intern("q10"), FilterSet::intern("s50"));
+    EXPECT_EQ("s50", *FilterSet::intern("s50"));
+}
+
+TEST(VcfFilterSet, orderedLikeSet) {
+    vector<string> input{"s50", "PASS", "q10", "s50", "a", "Z", "q1", "q100"};
+    set<string> expected(input.begin(), input.end());
+
+    FilterSet s;
+    for (auto i = input.begin(); i != input.end(); ++i)
+        s.insert(*i);
+
+    EXPECT_EQ(vector<string>(expected.begin(), expected.end()), names(s));
+    EXPECT_EQ(expected.size(), s.size());
+    EXPECT_FALSE(s.insert("q10"));
+    EXPECT_EQ(1u, s.count("q10"));
+    EXPECT_EQ(0u, s.count("q"));
+    EXPECT_TRUE(s.find("q") == s.end());
+    EXPECT_EQ("s50", *s.find(string("s50")));
+}
+
+TEST(VcfFilterSet, eraseAcrossInlineSize) {
+    FilterSet s;
+    set<string> expected;
+    for (int i = 0; i < FilterSet::INLINE_SIZE + 2; ++i) {
+        string name = "f" + to_string(i);
+        s.insert(name);
+        expected.insert(name);
+    }
+    EXPECT_EQ(vector<string>(expected.begin(), expected.end()), names(s));
+
+    while (!expected.empty()) {
+        string name = *expected.rbegin();
+        EXPECT_TRUE(s.erase(name));
+        EXPECT_FALSE(s.erase(name));
+        expected.erase(name);
+        EXPECT_EQ(vector<string>(expected.begin(), expected.end()), names(s));
+    }
+    EXPECT_TRUE(s.empty());
+}
+
+TEST(VcfFilterSet, copyMoveSwap) {
+    FilterSet small;
+    small.insert("a");
+    FilterSet big;
+    for (int i = 0; i < FilterSet::INLINE_SIZE + 1; ++i)
+        big.insert("b" + to_string(i));
+
+    FilterSet smallCopy(small);
+    FilterSet bigCopy(big);
+    EXPECT_EQ(names(small), names(smallCopy));
+    EXPECT_EQ(names(big), names(bigCopy));
+
+    string const* first = &*big.begin();
+    FilterSet moved(std::move(big));
+    EXPECT_TRUE(big.empty());
+    EXPECT_EQ(first, &*moved.begin());
+    EXPECT_EQ(names(bigCopy), names(moved));
+
+    moved.swap(smallCopy);
+    EXPECT_EQ(names(small), names(moved));
+    EXPECT_EQ(names(bigCopy), names(smallCopy));
+
+    smallCopy = small;
+    EXPECT_EQ(names(small), names(smallCopy));
+    moved = std::move(bigCopy);
+    EXPECT_EQ(FilterSet::size_type(FilterSet::INLINE_SIZE + 1), moved.size());
+    EXPECT_TRUE(bigCopy.empty());
+}
+
+TEST(VcfFilterSet, swapSmall) {
+    FilterSet a;
+    FilterSet b;
+    a.insert("q10");
+    a.swap(b);
+    EXPECT_TRUE(a.empty());
+    EXPECT_EQ(vector<string>{"q10"}, names(b));
+}
@@ -0,0 +1,127 @@
+#include "fileformats/vcf/SampleColumn.hpp"
+
+#include "fileformats/vcf/CustomType.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Vcf;
+
+namespace {
+    // one field per sample, an empty string meaning the sample has none
+    struct Column {
+        Column(CustomType const& type, vector<string> const& text)
+            : text(text)
+        {
+            for (auto i = this->text.begin(); i != this->text.end(); ++i) {
+                fields.push_back(StringView(i->data(), i->data() + i->size()));
+                counts.push_back(i->empty() ? 0 : 1);
+            }
+            column = SampleColumn(&type, fields, 1, 0, counts);
+        }
+
+        string str(uint32_t idx) const {
+            stringstream ss;
+            column.toStream(ss, idx);
+            return ss.str();
+        }
+
+        vector<string> text;
+        vector<StringView> fields;
+        vector<int16_t> counts;
+        SampleColumn column;
+    };
+}
+
+class TestVcfSampleColumn : public ::testing::Test {
+protected:
+    TestVcfSampleColumn()
+        : gt("GT", CustomType::FIXED_SIZE, 1, CustomType::STRING, "Genotype")
+        , dp("DP", CustomType::FIXED_SIZE, 1, CustomType::INTEGER, "Depth")
+        , ad("AD", CustomType::VARIABLE_SIZE, 0, CustomType::INTEGER, "Allele depths")
+    {}
+
+    CustomType gt;
+    CustomType dp;
+    CustomType ad;
+};
+
+TEST_F(TestVcfSampleColumn, genotypes) {
+    Column c(gt, {"0/1", "", "1|1", ".", "./1", "10/127"});
+    ASSERT_EQ(SampleColumn::GENOTYPE, c.column.storage());
+
+    EXPECT_EQ(2u, c.column.count(0));
+    EXPECT_EQ(0, c.column.allele(0, 0));
+    EXPECT_EQ(1, c.column.allele(0, 1));
+    EXPECT_FALSE(c.column.phased(0));
+    EXPECT_TRUE(c.column.phased(2));
+    EXPECT_EQ(0u, c.column.count(3));
+    EXPECT_EQ(SampleColumn::MISSING, c.column.allele(4, 0));
+
+    vector<string> expected{"0/1", ".", "1|1", ".", "./1", "10/127"};
+    for (uint32_t i = 0; i < expected.size(); ++i)
+        EXPECT_EQ(expected[i], c.str(i)) << "sample " << i;
+
+    string s;
+    c.column.genotypeString(5, s);
+    EXPECT_EQ("10/127", s);
+
+    EXPECT_EQ("1|1", *c.column.value(2).get<string>(0));
+    EXPECT_TRUE(c.column.value(3).empty());
+}
+
+TEST_F(TestVcfSampleColumn, genotypeFallback) {
+    // mixed delimiters and big or non-canonical alleles aren't packed
+    vector<vector<string>> cases{
+        {"0/1", "0|1/1"},
+        {"0/1", "128/1"},
+        {"0/1", "01/1"},
+        {"0/1", "x"}
+    };
+
+    for (auto i = cases.begin(); i != cases.end(); ++i) {
+        Column c(gt, *i);
+        EXPECT_EQ(SampleColumn::VALUES, c.column.storage());
+        EXPECT_EQ((*i)[1], c.str(1));
+    }
+}
+
+TEST_F(TestVcfSampleColumn, integers) {
+    Column c(ad, {"1,2,3", "", ".", "-4,.", "0"});
+    ASSERT_EQ(SampleColumn::INTEGER, c.column.storage());
+
+    EXPECT_EQ(3u, c.column.count(0));
+    EXPECT_EQ(3, c.column.integer(0, 2));
+    EXPECT_EQ(0u, c.column.count(2));
+    EXPECT_EQ(-4, c.column.integer(3, 0));
+    EXPECT_EQ(SampleColumn::MISSING, c.column.integer(3, 1));
+
+    vector<string> expected{"1,2,3", ".", ".", "-4,.", "0"};
+    for (uint32_t i = 0; i < expected.size(); ++i)
+        EXPECT_EQ(expected[i], c.str(i)) << "sample " << i;
+
+    CustomValue const& v = c.column.value(3);
+    ASSERT_EQ(2u, v.size());
+    EXPECT_EQ(-4, *v.get<int64_t>(0));
+    EXPECT_TRUE(v.get<int64_t>(1) == 0);
+
+    CustomValue released = c.column.release(0);
+    EXPECT_EQ("1,2,3", released.toString());
+}
+
+TEST_F(TestVcfSampleColumn, integerFallback) {
+    Column c(dp, {"7", "007"});
+    EXPECT_EQ(SampleColumn::VALUES, c.column.storage());
+    EXPECT_EQ("7", c.str(1));
+
+    Column big(dp, {"1", "12345678901"});
+    EXPECT_EQ(SampleColumn::VALUES, big.column.storage());
+    EXPECT_EQ("12345678901", big.str(1));
+
+    EXPECT_THROW(Column(dp, {"1", "x"}), runtime_error);
+    EXPECT_THROW(Column(dp, {"1,2"}), runtime_error);
+}
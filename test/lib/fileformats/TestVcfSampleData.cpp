@@ -138,6 +138,19 @@ TEST_F(TestVcfSampleData, removeFilteredWhitelist) {
     EXPECT_TRUE(0 != sd.get(4) && !sd.get(4)->empty());
 }
 
+TEST_F(TestVcfSampleData, removeFilteredWhitelistUnmaterialized) {
+    std::set<std::string> keep{"OK"};
+    std::string text = "GT:FT\t0/1:.\t0/1:BAD\t0/1:OK\t0/1";
+
+    Vcf::SampleData sd(&header, text);
+    sd.removeFilteredWhitelist(keep);
+    EXPECT_EQ(3u, sd.samplesWithData());
+
+    std::stringstream ss;
+    ss << sd;
+    EXPECT_EQ("GT:FT\t0/1:.\t.\t0/1:OK\t0/1\t.", ss.str());
+}
+
 TEST_F(TestVcfSampleData, parse) {
     std::string txt = format + "\t" + oneSample;
     Vcf::SampleData sd(&header, txt);
@@ -253,3 +266,88 @@ TEST_F(TestVcfSampleData, addFilterReflectingSamples) {
     EXPECT_EQ("HATE", filterName);
     EXPECT_FALSE(sd.isSampleFiltered(mainIdx));
 }
+
+TEST_F(TestVcfSampleData, roundTrip) {
+    std::vector<std::string> samples{
+        "0/1:34:120:31,2:1e-06:A,B,C",
+        ".",
+        "1|1:.:7",
+        "0/1:007:3",
+        ".:5"
+        };
+
+    std::stringstream in;
+    in << format << "\t" << streamJoin(samples).delimiter("\t");
+    Vcf::SampleData sd(&header, in.str());
+
+    EXPECT_EQ(4u, sd.size());
+    EXPECT_EQ(0u, sd.count(1));
+    EXPECT_EQ(4u, sd.samplesWithData());
+    EXPECT_EQ("1|1", sd.genotype(2).string());
+    EXPECT_TRUE(sd.genotype(4).empty());
+    EXPECT_EQ(7, *sd.get(3, "GQ")->get<int64_t>(0));
+    EXPECT_FALSE(sd.get(2, "HQ"));
+
+    std::stringstream out;
+    out << sd;
+    EXPECT_EQ(format + "\t0/1:34:120:31,2:1e-06:A,B,C\t.\t1|1:.:7\t0/1:7:3\t.:5", out.str());
+
+    out.str("");
+    sd.sampleToStream(out, 4);
+    EXPECT_EQ(".:5", out.str());
+
+    // building the per-sample values doesn't change anything
+    EXPECT_EQ(4, std::distance(sd.begin(), sd.end()));
+    std::stringstream after;
+    after << sd;
+    EXPECT_EQ(format + "\t0/1:34:120:31,2:1e-06:A,B,C\t.\t1|1:.:7\t0/1:7:3\t.:5", after.str());
+}
+
+TEST_F(TestVcfSampleData, removeLowDepthGenotypes) {
+    std::string text =
+        "GT:DP"
+        "\t0/1:10"
+        "\t0/1:9"
+        "\t0/1:."
+        "\t0/1"
+        "\t."
+        ;
+
+    Vcf::SampleData sd(&header, text);
+    sd.removeLowDepthGenotypes(10);
+    EXPECT_EQ(1u, sd.samplesWithData());
+    EXPECT_FALSE(sd.genotype(0).empty());
+    EXPECT_TRUE(sd.genotype(1).empty());
+
+    std::stringstream ss;
+    ss << sd;
+    EXPECT_EQ("GT:DP\t0/1:10\t.\t.\t.\t.", ss.str());
+}
+
+TEST_F(TestVcfSampleData, lazyFields) {
+    std::string text = "GT:GQ:DP\t0/1:007:x\t1/1::3";
+    Vcf::SampleData sd(&header, text);
+
+    // nothing was decoded, so nothing changes (or fails to parse)
+    std::stringstream ss;
+    ss << sd;
+    EXPECT_EQ(text + "\t.\t.\t.", ss.str());
+
+    // decoded fields are written from their values
+    EXPECT_EQ(7, *sd.get(0, "GQ")->get<int64_t>(0));
+    ss.str("");
+    ss << sd;
+    EXPECT_EQ("GT:GQ:DP\t0/1:7:x\t1/1:.:3\t.\t.\t.", ss.str());
+
+    EXPECT_THROW(sd.get(0, "DP"), std::runtime_error);
+}
+
+TEST_F(TestVcfSampleData, decode) {
+    std::string text = "GT:GQ:DP\t0/1:007:3";
+    Vcf::SampleData sd(&header, text);
+    sd.decode({"GQ", "HQ"});
+
+    std::stringstream ss;
+    ss << sd;
+    EXPECT_EQ("GT:GQ:DP\t0/1:7:3\t.\t.\t.\t.", ss.str());
+}
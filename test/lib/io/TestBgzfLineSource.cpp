@@ -0,0 +1,149 @@
+#include "io/BgzfLineSource.hpp"
+
+#include "common/Exceptions.hpp"
+#include "io/Bgzf.hpp"
+#include "io/TempFile.hpp"
+
+#include <gtest/gtest.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    // Write data as a BGZF file, using blocks holding at most blockSize
+    // bytes of uncompressed data.
+    void writeBgzf(std::string const& path, std::string const& data, std::size_t blockSize) {
+        std::ofstream out(path.c_str(), std::ios::binary);
+        std::string block;
+        for (std::size_t pos = 0; pos < data.size(); pos += blockSize) {
+            std::size_t n = std::min(blockSize, data.size() - pos);
+            Bgzf::deflateBlock(data.data() + pos, n, block);
+            out.write(block.data(), block.size());
+        }
+        out.write(Bgzf::EOF_BLOCK, sizeof(Bgzf::EOF_BLOCK));
+    }
+
+    std::string makeData(std::size_t numLines) {
+        std::stringstream ss;
+        for (std::size_t i = 0; i < numLines; ++i) {
+            ss << "line " << i << "\t" << std::string(i % 37, 'x') << "\n";
+        }
+        return ss.str();
+    }
+
+    std::string readAll(BgzfLineSource& in) {
+        std::string line;
+        std::stringstream ss;
+        while (in.getline(line)) {
+            ss << line << "\n";
+        }
+        return ss.str();
+    }
+}
+
+class TestBgzfLineSource : public ::testing::Test {
+public:
+    void SetUp() {
+        _data = makeData(5000);
+        _tmp = TempFile::create(TempFile::CLEANUP);
+        _tmp->stream().close();
+    }
+
+protected:
+    std::string _data;
+    TempFile::ptr _tmp;
+};
+
+TEST_F(TestBgzfLineSource, isBgzf) {
+    writeBgzf(_tmp->path(), _data, Bgzf::MAX_INPUT_SIZE);
+    EXPECT_TRUE(BgzfLineSource::isBgzf(_tmp->path()));
+
+    auto plainGzip = TempFile::create(TempFile::CLEANUP);
+    plainGzip->stream().close();
+    auto fp = gzopen(plainGzip->path().c_str(), "wb");
+    gzwrite(fp, _data.data(), _data.size());
+    gzclose(fp);
+    EXPECT_FALSE(BgzfLineSource::isBgzf(plainGzip->path()));
+
+    auto plainText = TempFile::create(TempFile::CLEANUP);
+    plainText->stream() << _data;
+    plainText->stream().close();
+    EXPECT_FALSE(BgzfLineSource::isBgzf(plainText->path()));
+}
+
+TEST_F(TestBgzfLineSource, singleThreaded) {
+    writeBgzf(_tmp->path(), _data, Bgzf::MAX_INPUT_SIZE);
+    BgzfLineSource in(_tmp->path());
+    EXPECT_TRUE(in);
+    EXPECT_EQ(_data, readAll(in));
+    EXPECT_TRUE(in.eof());
+}
+
+TEST_F(TestBgzfLineSource, linesSpanningBlocks) {
+    // small blocks force most lines to cross block boundaries
+    writeBgzf(_tmp->path(), _data, 17);
+    auto pool = ThreadPool::create(3);
+    BgzfLineSource in(_tmp->path(), pool);
+    EXPECT_EQ(_data, readAll(in));
+}
+
+TEST_F(TestBgzfLineSource, noTrailingNewline) {
+    std::string data = _data + "last line";
+    writeBgzf(_tmp->path(), data, 1000);
+    BgzfLineSource in(_tmp->path(), ThreadPool::create(2));
+    EXPECT_EQ(data + "\n", readAll(in));
+}
+
+TEST_F(TestBgzfLineSource, peek) {
+    writeBgzf(_tmp->path(), "a\nb\n", 2);
+    BgzfLineSource in(_tmp->path(), ThreadPool::create(1));
+    std::string line;
+
+    EXPECT_EQ('a', in.peek());
+    EXPECT_TRUE(in.getline(line));
+    EXPECT_EQ("a", line);
+    EXPECT_EQ('b', in.peek());
+    EXPECT_TRUE(in.getline(line));
+    EXPECT_EQ("b", line);
+    EXPECT_FALSE(in.eof());
+    EXPECT_EQ(EOF, in.peek());
+    EXPECT_FALSE(in.getline(line));
+    EXPECT_TRUE(in.eof());
+}
+
+TEST_F(TestBgzfLineSource, corruptBlock) {
+    writeBgzf(_tmp->path(), _data, Bgzf::MAX_INPUT_SIZE);
+    {
+        std::fstream f(_tmp->path().c_str(), std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(Bgzf::HEADER_SIZE + 10);
+        f.put('\x42');
+        f.put('\x42');
+    }
+
+    BgzfLineSource in(_tmp->path(), ThreadPool::create(2));
+    std::string line;
+    EXPECT_THROW(in.getline(line), IOError);
+}
+
+TEST_F(TestBgzfLineSource, invalidPath) {
+    BgzfLineSource in("/this/path/does/not/exist.gz");
+    EXPECT_FALSE(in);
+}
+
+TEST_F(TestBgzfLineSource, stringView) {
+    writeBgzf(_tmp->path(), _data, 17);
+    BgzfLineSource in(_tmp->path(), ThreadPool::create(2));
+    StringView line;
+    std::stringstream ss;
+    while (in.getline(line)) {
+        ss << line << "\n";
+    }
+    EXPECT_EQ(_data, ss.str());
+    EXPECT_TRUE(in.eof());
+}
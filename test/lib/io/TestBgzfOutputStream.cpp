@@ -0,0 +1,193 @@
+#include "io/BgzfOutputStream.hpp"
+
+#include "common/UnsortedDataError.hpp"
+#include "common/compat.hpp"
+#include "io/BgzfLineSource.hpp"
+#include "io/StreamHandler.hpp"
+#include "io/TabixIndex.hpp"
+#include "io/TempFile.hpp"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Record {
+        std::string chrom;
+        int64_t begin;
+        int64_t end;
+    };
+
+    std::string readAll(InputStream& in) {
+        std::string line;
+        std::stringstream ss;
+        while (in.getline(line)) {
+            ss << line << "\n";
+        }
+        return ss.str();
+    }
+
+    std::string readFile(std::string const& path) {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    }
+}
+
+class TestBgzfOutputStream : public ::testing::Test {
+public:
+    void SetUp() {
+        _dir = TempDir::create(TempDir::CLEANUP);
+        _path = _dir->path() + "/out.bed.gz";
+
+        char const* chroms[] = {"1", "10", "2"};
+        for (int c = 0; c < 3; ++c) {
+            for (int64_t pos = c * 1000; pos < 2000000; pos += 997) {
+                _records.push_back(Record{chroms[c], pos, pos + 1 + pos % 70000});
+            }
+        }
+    }
+
+    std::string data() const {
+        std::stringstream ss;
+        ss << "#header\n";
+        for (auto r = _records.begin(); r != _records.end(); ++r) {
+            ss << r->chrom << "\t" << r->begin << "\t" << r->end << "\tsome text\n";
+        }
+        return ss.str();
+    }
+
+    std::string expected(std::vector<GenomicRegion> const& regions) const {
+        std::stringstream ss;
+        ss << "#header\n";
+        for (auto r = _records.begin(); r != _records.end(); ++r) {
+            for (auto g = regions.begin(); g != regions.end(); ++g) {
+                if (g->overlaps(r->chrom, r->begin, r->end)) {
+                    ss << r->chrom << "\t" << r->begin << "\t" << r->end
+                        << "\tsome text\n";
+                    break;
+                }
+            }
+        }
+        return ss.str();
+    }
+
+    void write(TabixIndexBuilder::IndexType type) {
+        BgzfOutputStream out(_path, std::make_unique<TabixIndexBuilder>(
+            type, TabixIndex::Config::bed()));
+        out << data();
+        out.close();
+    }
+
+protected:
+    TempDir::ptr _dir;
+    std::string _path;
+    std::vector<Record> _records;
+};
+
+TEST_F(TestBgzfOutputStream, compress) {
+    {
+        BgzfOutputStream out(_path);
+        out << data();
+    }
+
+    EXPECT_TRUE(BgzfLineSource::isBgzf(_path));
+    StreamHandler streams;
+    auto in = streams.openForReading(_path);
+    EXPECT_EQ(data(), readAll(*in));
+    EXPECT_TRUE(TabixIndex::forDataFile(_path).get() == 0);
+}
+
+TEST_F(TestBgzfOutputStream, parallelCompress) {
+    std::string serialPath = _dir->path() + "/serial.bed.gz";
+    {
+        BgzfOutputStream out(serialPath, std::make_unique<TabixIndexBuilder>(
+            TabixIndexBuilder::TBI, TabixIndex::Config::bed()));
+        out << data();
+    }
+    {
+        BgzfOutputStream out(_path, std::make_unique<TabixIndexBuilder>(
+            TabixIndexBuilder::TBI, TabixIndex::Config::bed()),
+            ThreadPool::create(3));
+        out << data();
+    }
+
+    // blocks are written in order, so the files are identical
+    EXPECT_EQ(readFile(serialPath), readFile(_path));
+    EXPECT_EQ(readFile(serialPath + ".tbi"), readFile(_path + ".tbi"));
+
+    StreamHandler streams;
+    std::vector<GenomicRegion> regions{GenomicRegion("10", 400000, 900000)};
+    auto in = streams.openForReading(_path, regions);
+    EXPECT_EQ(expected(regions), readAll(*in));
+}
+
+TEST_F(TestBgzfOutputStream, streamHandlerOutputCompression) {
+    StreamHandler streams;
+    streams.threads(2);
+    streams.outputCompression(BGZF);
+    std::ostream* out = streams.get<std::ostream>(_path);
+    EXPECT_EQ(out, streams.get<std::ostream>(_path));
+    *out << data();
+    streams.close();
+
+    EXPECT_TRUE(BgzfLineSource::isBgzf(_path));
+    auto in = streams.openForReading(_path);
+    EXPECT_EQ(data(), readAll(*in));
+}
+
+TEST_F(TestBgzfOutputStream, tabixIndex) {
+    write(TabixIndexBuilder::TBI);
+
+    auto index = TabixIndex::forDataFile(_path);
+    ASSERT_TRUE(index.get() != 0);
+    EXPECT_EQ(3u, index->sequenceNames().size());
+    EXPECT_EQ(1, index->sequenceId("10"));
+    EXPECT_TRUE(index->zeroBased());
+
+    std::vector<std::vector<GenomicRegion>> queries{
+        {GenomicRegion("1", 500000, 500001)},
+        {GenomicRegion("10", 0, 100), GenomicRegion("2", 1999000, 3000000)},
+        {GenomicRegion("2", 100000, 400000), GenomicRegion("2", 300000, 350000)},
+        {GenomicRegion::fromString("10")},
+        };
+
+    StreamHandler streams;
+    for (auto q = queries.begin(); q != queries.end(); ++q) {
+        auto in = streams.openForReading(_path, *q);
+        EXPECT_EQ(expected(*q), readAll(*in));
+    }
+}
+
+TEST_F(TestBgzfOutputStream, csiIndex) {
+    write(TabixIndexBuilder::CSI);
+
+    auto index = TabixIndex::forDataFile(_path);
+    ASSERT_TRUE(index.get() != 0);
+
+    std::vector<GenomicRegion> regions{
+        GenomicRegion("1", 123456, 654321),
+        GenomicRegion("2", 1000000, 1000100),
+        };
+    StreamHandler streams;
+    auto in = streams.openForReading(_path, regions);
+    EXPECT_EQ(expected(regions), readAll(*in));
+}
+
+TEST_F(TestBgzfOutputStream, unsorted) {
+    BgzfOutputStream out(_path, std::make_unique<TabixIndexBuilder>(
+        TabixIndexBuilder::TBI, TabixIndex::Config::bed()));
+    out << "1\t10\t20\n1\t5\t6\n";
+    EXPECT_THROW(out.close(), UnsortedDataError);
+}
+
+TEST_F(TestBgzfOutputStream, noncontiguousSequences) {
+    BgzfOutputStream out(_path, std::make_unique<TabixIndexBuilder>(
+        TabixIndexBuilder::TBI, TabixIndex::Config::bed()));
+    out << "1\t10\t20\n2\t5\t6\n1\t30\t31\n";
+    EXPECT_THROW(out.close(), UnsortedDataError);
+}
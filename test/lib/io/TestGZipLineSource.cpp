@@ -148,3 +148,32 @@ TEST(TestGZLineSource, invalidPath) {
     GZipLineSource input(tmp->path());
     EXPECT_FALSE(input);
 }
+
+TEST(TestGZLineSource, stringViewLongLines) {
+    // lines longer than the buffer force it to grow, short lines after
+    // them exercise moving partial lines to the front of the buffer
+    TempFile::ptr tmp = TempFile::create(TempFile::CLEANUP);
+    size_t sz = GZipLineSource::bufferSize();
+    std::vector<std::string> lines;
+    lines.push_back(std::string(3 * sz + 7, 'a'));
+    for (size_t i = 0; i < 2 * sz / 10; ++i) {
+        lines.push_back(std::string(9, 'b' + i % 20));
+    }
+    lines.push_back(std::string(sz, 'c'));
+
+    std::stringstream data;
+    for (auto i = lines.begin(); i != lines.end(); ++i) {
+        data << *i << "\n";
+    }
+    writeCompressed(tmp->path(), data.str());
+
+    GZipLineSource input(tmp->path());
+    StringView line;
+    for (auto i = lines.begin(); i != lines.end(); ++i) {
+        ASSERT_TRUE(input.getline(line));
+        ASSERT_EQ(i->size(), line.size()) << "line " << i - lines.begin();
+        ASSERT_EQ(*i, line);
+    }
+    EXPECT_FALSE(input.getline(line));
+    EXPECT_TRUE(input.eof());
+}
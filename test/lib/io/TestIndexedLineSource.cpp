@@ -0,0 +1,279 @@
+#include "io/IndexedLineSource.hpp"
+
+#include "common/Exceptions.hpp"
+#include "common/compat.hpp"
+#include "io/Bgzf.hpp"
+#include "io/StreamHandler.hpp"
+#include "io/TempFile.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Record {
+        std::string chrom;
+        int64_t begin;
+        int64_t end;
+    };
+
+    // bin holding [beg, end) in the tabix binning scheme
+    uint32_t reg2bin(int64_t beg, int64_t end) {
+        --end;
+        if (beg >> 14 == end >> 14) return ((1 << 15) - 1) / 7 + (beg >> 14);
+        if (beg >> 17 == end >> 17) return ((1 << 12) - 1) / 7 + (beg >> 17);
+        if (beg >> 20 == end >> 20) return ((1 << 9) - 1) / 7 + (beg >> 20);
+        if (beg >> 23 == end >> 23) return ((1 << 6) - 1) / 7 + (beg >> 23);
+        if (beg >> 26 == end >> 26) return ((1 << 3) - 1) / 7 + (beg >> 26);
+        return 0;
+    }
+
+    void put32(std::ostream& out, uint32_t x) {
+        for (int i = 0; i < 4; ++i) {
+            out.put(char((x >> (8 * i)) & 0xff));
+        }
+    }
+
+    void put64(std::ostream& out, uint64_t x) {
+        for (int i = 0; i < 8; ++i) {
+            out.put(char((x >> (8 * i)) & 0xff));
+        }
+    }
+
+    struct RefIndex {
+        std::map<uint32_t, std::vector<std::pair<uint64_t, uint64_t>>> bins;
+        std::vector<uint64_t> linear;
+    };
+
+    // Write a bed file with each line in its own BGZF block, and a tabix
+    // index (uncompressed, which zlib reads transparently) for it.
+    void writeIndexedBed(std::string const& path,
+            std::vector<Record> const& records)
+    {
+        std::ofstream out(path.c_str(), std::ios::binary);
+        std::string block;
+        uint64_t offset = 0;
+
+        std::string header = "#header\n";
+        Bgzf::deflateBlock(header.data(), header.size(), block);
+        out.write(block.data(), block.size());
+        offset += block.size();
+
+        std::vector<std::string> names;
+        std::map<std::string, RefIndex> refs;
+        for (auto r = records.begin(); r != records.end(); ++r) {
+            if (names.empty() || names.back() != r->chrom) {
+                names.push_back(r->chrom);
+            }
+
+            std::stringstream ss;
+            ss << r->chrom << "\t" << r->begin << "\t" << r->end << "\n";
+            std::string line = ss.str();
+            Bgzf::deflateBlock(line.data(), line.size(), block);
+            out.write(block.data(), block.size());
+
+            uint64_t beg = Bgzf::makeVirtualOffset(offset, 0);
+            offset += block.size();
+            uint64_t end = Bgzf::makeVirtualOffset(offset, 0);
+
+            RefIndex& ref = refs[r->chrom];
+            int64_t e = std::max(r->end, r->begin + 1);
+            ref.bins[reg2bin(r->begin, e)].push_back(std::make_pair(beg, end));
+            std::size_t lastWindow = (e - 1) >> 14;
+            if (ref.linear.size() <= lastWindow) {
+                ref.linear.resize(lastWindow + 1, 0);
+            }
+            for (std::size_t w = r->begin >> 14; w <= lastWindow; ++w) {
+                if (ref.linear[w] == 0) {
+                    ref.linear[w] = beg;
+                }
+            }
+        }
+        out.write(Bgzf::EOF_BLOCK, sizeof(Bgzf::EOF_BLOCK));
+
+        std::ofstream idx((path + ".tbi").c_str(), std::ios::binary);
+        idx.write("TBI\1", 4);
+        put32(idx, names.size());
+        put32(idx, 0x10000); // generic, 0-based
+        put32(idx, 1);
+        put32(idx, 2);
+        put32(idx, 3);
+        put32(idx, '#');
+        put32(idx, 0);
+        std::string packedNames;
+        for (auto n = names.begin(); n != names.end(); ++n) {
+            packedNames += *n;
+            packedNames += '\0';
+        }
+        put32(idx, packedNames.size());
+        idx.write(packedNames.data(), packedNames.size());
+
+        for (auto n = names.begin(); n != names.end(); ++n) {
+            RefIndex& ref = refs[*n];
+            put32(idx, ref.bins.size());
+            for (auto b = ref.bins.begin(); b != ref.bins.end(); ++b) {
+                put32(idx, b->first);
+                put32(idx, b->second.size());
+                for (auto c = b->second.begin(); c != b->second.end(); ++c) {
+                    put64(idx, c->first);
+                    put64(idx, c->second);
+                }
+            }
+
+            for (std::size_t w = 1; w < ref.linear.size(); ++w) {
+                if (ref.linear[w] == 0) {
+                    ref.linear[w] = ref.linear[w - 1];
+                }
+            }
+            put32(idx, ref.linear.size());
+            for (auto l = ref.linear.begin(); l != ref.linear.end(); ++l) {
+                put64(idx, *l);
+            }
+        }
+    }
+
+    std::string readAll(ILineSource& in) {
+        std::string line;
+        std::stringstream ss;
+        while (in.getline(line)) {
+            ss << line << "\n";
+        }
+        return ss.str();
+    }
+}
+
+class TestIndexedLineSource : public ::testing::Test {
+public:
+    void SetUp() {
+        _dir = TempDir::create(TempDir::CLEANUP);
+        _path = _dir->path() + "/data.bed.gz";
+
+        for (int64_t pos = 0; pos < 300000; pos += 7919) {
+            _records.push_back(Record{"1", pos, pos + 1 + pos % 50000});
+        }
+        for (int64_t pos = 100; pos < 1000; pos += 100) {
+            _records.push_back(Record{"2", pos, pos});
+        }
+        writeIndexedBed(_path, _records);
+    }
+
+    // The expected output, found by checking every record
+    std::string expected(std::vector<GenomicRegion> const& regions) const {
+        std::stringstream ss;
+        ss << "#header\n";
+        for (auto r = _records.begin(); r != _records.end(); ++r) {
+            int64_t end = std::max(r->end, r->begin + 1);
+            for (auto g = regions.begin(); g != regions.end(); ++g) {
+                if (g->overlaps(r->chrom, r->begin, end)) {
+                    ss << r->chrom << "\t" << r->begin << "\t" << r->end << "\n";
+                    break;
+                }
+            }
+        }
+        return ss.str();
+    }
+
+    std::string query(std::vector<GenomicRegion> const& regions) const {
+        IndexedLineSource in(
+            std::make_unique<BgzfLineSource>(_path, ThreadPool::create(2)),
+            TabixIndex::fromFile(_path + ".tbi"),
+            regions);
+        return readAll(in);
+    }
+
+protected:
+    TempDir::ptr _dir;
+    std::string _path;
+    std::vector<Record> _records;
+};
+
+TEST_F(TestIndexedLineSource, index) {
+    auto index = TabixIndex::forDataFile(_path);
+    ASSERT_TRUE(index.get() != 0);
+    EXPECT_TRUE(index->zeroBased());
+    EXPECT_EQ(TabixIndex::GENERIC, index->format());
+    EXPECT_EQ(2u, index->sequenceNames().size());
+    EXPECT_EQ(1, index->sequenceId("2"));
+    EXPECT_EQ(-1, index->sequenceId("3"));
+    EXPECT_TRUE(index->query(1, 20000, 30000).empty());
+    EXPECT_FALSE(index->query(1, 100, 101).empty());
+
+    EXPECT_TRUE(TabixIndex::forDataFile(_path + ".nope").get() == 0);
+}
+
+TEST_F(TestIndexedLineSource, singleRegion) {
+    std::vector<GenomicRegion> regions{GenomicRegion("1", 100000, 120000)};
+    std::string result = query(regions);
+    EXPECT_EQ(expected(regions), result);
+    EXPECT_NE("#header\n", result);
+}
+
+TEST_F(TestIndexedLineSource, overlappingRegions) {
+    std::vector<GenomicRegion> regions{
+        GenomicRegion("2", 250, 650),
+        GenomicRegion("1", 200000, 250000),
+        GenomicRegion("1", 10000, 210000),
+        GenomicRegion("2", 0, 300),
+        };
+    EXPECT_EQ(expected(regions), query(regions));
+}
+
+TEST_F(TestIndexedLineSource, wholeSequence) {
+    std::vector<GenomicRegion> regions{GenomicRegion::fromString("1")};
+    EXPECT_EQ(expected(regions), query(regions));
+}
+
+TEST_F(TestIndexedLineSource, noHits) {
+    std::vector<GenomicRegion> regions{
+        GenomicRegion("3", 0, 1000),
+        GenomicRegion("2", 2000, 3000)
+        };
+    EXPECT_EQ("#header\n", query(regions));
+}
+
+TEST_F(TestIndexedLineSource, streamHandler) {
+    StreamHandler streams;
+    std::vector<GenomicRegion> regions{GenomicRegion("2", 0, 500)};
+    auto in = streams.openForReading(_path, regions);
+    std::string line;
+    std::stringstream ss;
+    while (in->getline(line)) {
+        ss << line << "\n";
+    }
+    EXPECT_EQ(expected(regions), ss.str());
+
+    auto plain = TempFile::create(TempFile::CLEANUP);
+    plain->stream() << "1\t2\t3\n";
+    plain->stream().close();
+    EXPECT_THROW(streams.openForReading(plain->path(), regions), IOError);
+}
+
+TEST(TabixIndexConfig, parseRecord) {
+    StringView seq;
+    int64_t beg;
+    int64_t end;
+
+    auto vcf = TabixIndex::Config::vcf();
+    vcf.parseRecord("1\t100\t.\tACG\tA\t.\t.\tDP=3", seq, beg, end);
+    EXPECT_EQ("1", seq);
+    EXPECT_EQ(99, beg);
+    EXPECT_EQ(102, end);
+
+    vcf.parseRecord("2\t100\t.\tA\t<DEL>\t.\t.\tSVTYPE=DEL;END=500", seq, beg, end);
+    EXPECT_EQ("2", seq);
+    EXPECT_EQ(99, beg);
+    EXPECT_EQ(500, end);
+
+    auto bed = TabixIndex::Config::bed();
+    bed.parseRecord("3\t10\t10\tx", seq, beg, end);
+    EXPECT_EQ("3", seq);
+    EXPECT_EQ(10, beg);
+    EXPECT_EQ(11, end);
+
+    EXPECT_THROW(bed.parseRecord("3\tx\t10", seq, beg, end), IOError);
+}
@@ -0,0 +1,103 @@
+#include "io/MmapLineSource.hpp"
+
+#include "io/TempFile.hpp"
+
+#include <gtest/gtest.h>
+
+#include <zlib.h>
+
+#include <boost/filesystem.hpp>
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+namespace bfs = boost::filesystem;
+
+namespace {
+    TempFile::ptr writeTemp(std::string const& data) {
+        TempFile::ptr tmp = TempFile::create(TempFile::CLEANUP);
+        tmp->stream() << data;
+        tmp->stream().close();
+        return tmp;
+    }
+}
+
+TEST(TestMmapLineSource, isMappable) {
+    TempFile::ptr plain = writeTemp("1\t2\t3\n");
+    EXPECT_TRUE(MmapLineSource::isMappable(plain->path()));
+
+    TempFile::ptr empty = writeTemp("");
+    EXPECT_TRUE(MmapLineSource::isMappable(empty->path()));
+
+    TempFile::ptr compressed = writeTemp("");
+    auto fp = gzopen(compressed->path().c_str(), "wb");
+    gzwrite(fp, "1\t2\t3\n", 6);
+    gzclose(fp);
+    EXPECT_FALSE(MmapLineSource::isMappable(compressed->path()));
+
+    EXPECT_FALSE(MmapLineSource::isMappable("/this/path/does/not/exist"));
+    EXPECT_FALSE(MmapLineSource::isMappable(
+        bfs::temp_directory_path().string()));
+}
+
+TEST(TestMmapLineSource, getline) {
+    std::string data = "first\n\nthird\tline\nlast";
+    TempFile::ptr tmp = writeTemp(data);
+    MmapLineSource in(tmp->path());
+    EXPECT_TRUE(in);
+
+    std::string line;
+    EXPECT_TRUE(in.getline(line));
+    EXPECT_EQ("first", line);
+
+    StringView view;
+    EXPECT_TRUE(in.getline(view));
+    EXPECT_TRUE(view.empty());
+    EXPECT_TRUE(in.getline(view));
+    EXPECT_EQ("third\tline", view);
+
+    EXPECT_EQ('l', in.peek());
+    EXPECT_TRUE(in.getline(view));
+    EXPECT_EQ("last", view);
+    EXPECT_FALSE(in.eof());
+
+    EXPECT_EQ(EOF, in.peek());
+    EXPECT_FALSE(in.getline(line));
+    EXPECT_TRUE(line.empty());
+    EXPECT_TRUE(in.eof());
+    EXPECT_FALSE(in);
+}
+
+TEST(TestMmapLineSource, trailingNewline) {
+    std::stringstream ss;
+    for (int i = 0; i < 1000; ++i) {
+        ss << "chr" << i % 22 << "\t" << i << "\t" << i + 1 << "\n";
+    }
+    TempFile::ptr tmp = writeTemp(ss.str());
+    MmapLineSource in(tmp->path());
+
+    StringView line;
+    std::stringstream result;
+    while (in.getline(line)) {
+        result << line << "\n";
+    }
+    EXPECT_EQ(ss.str(), result.str());
+    EXPECT_TRUE(in.eof());
+}
+
+TEST(TestMmapLineSource, emptyFile) {
+    TempFile::ptr tmp = writeTemp("");
+    MmapLineSource in(tmp->path());
+    EXPECT_TRUE(in);
+    EXPECT_EQ(EOF, in.peek());
+
+    std::string line;
+    EXPECT_FALSE(in.getline(line));
+    EXPECT_TRUE(in.eof());
+}
+
+TEST(TestMmapLineSource, invalidPath) {
+    MmapLineSource in("/this/path/does/not/exist");
+    EXPECT_FALSE(in);
+}
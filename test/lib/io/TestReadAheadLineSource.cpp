@@ -0,0 +1,144 @@
+#include "io/ReadAheadLineSource.hpp"
+
+#include "common/compat.hpp"
+#include "fileformats/InferFileType.hpp"
+#include "io/InputStream.hpp"
+#include "io/MmapLineSource.hpp"
+#include "io/TempFile.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    TempFile::ptr writeTemp(std::string const& data) {
+        TempFile::ptr tmp = TempFile::create(TempFile::CLEANUP);
+        tmp->stream() << data;
+        tmp->stream().close();
+        return tmp;
+    }
+
+    // Returns a few lines, then throws
+    class FailingLineSource : public ILineSource {
+    public:
+        FailingLineSource() : _count(0) {}
+
+        operator bool() const { return true; }
+        char peek() { return 'x'; }
+        bool eof() const { return false; }
+        bool good() const { return true; }
+        bool getline(std::string& line) {
+            if (++_count > 3) {
+                throw std::runtime_error("read failed");
+            }
+            line = "x";
+            return true;
+        }
+
+    private:
+        int _count;
+    };
+}
+
+TEST(TestReadAheadLineSource, getline) {
+    std::string data = "first\n\nthird\tline\nlast";
+    TempFile::ptr tmp = writeTemp(data);
+    ReadAheadLineSource in(std::make_unique<MmapLineSource>(tmp->path()));
+    EXPECT_TRUE(in);
+
+    std::string line;
+    EXPECT_TRUE(in.getline(line));
+    EXPECT_EQ("first", line);
+
+    StringView view;
+    EXPECT_EQ('\n', in.peek());
+    EXPECT_TRUE(in.getline(view));
+    EXPECT_TRUE(view.empty());
+    EXPECT_TRUE(in.getline(view));
+    EXPECT_EQ("third\tline", view);
+
+    EXPECT_EQ('l', in.peek());
+    EXPECT_TRUE(in.getline(view));
+    EXPECT_EQ("last", view);
+    EXPECT_FALSE(in.eof());
+
+    EXPECT_EQ(EOF, in.peek());
+    EXPECT_FALSE(in.getline(line));
+    EXPECT_TRUE(line.empty());
+    EXPECT_TRUE(in.eof());
+    EXPECT_FALSE(in);
+}
+
+TEST(TestReadAheadLineSource, manyBatches) {
+    std::stringstream ss;
+    for (int i = 0; i < 10000; ++i) {
+        ss << "chr" << i % 22 << "\t" << i << "\t" << i + 1 << "\n";
+    }
+    TempFile::ptr tmp = writeTemp(ss.str());
+
+    // tiny batches so that the reader has to wait on the consumer
+    ReadAheadLineSource in(std::make_unique<MmapLineSource>(tmp->path()), 100, 2);
+    StringView line;
+    std::stringstream result;
+    while (in.getline(line)) {
+        result << line << "\n";
+    }
+    EXPECT_EQ(ss.str(), result.str());
+    EXPECT_TRUE(in.eof());
+}
+
+TEST(TestReadAheadLineSource, emptyFile) {
+    TempFile::ptr tmp = writeTemp("");
+    ReadAheadLineSource in(std::make_unique<MmapLineSource>(tmp->path()));
+    EXPECT_TRUE(in);
+    EXPECT_EQ(EOF, in.peek());
+
+    std::string line;
+    EXPECT_FALSE(in.getline(line));
+    EXPECT_TRUE(in.eof());
+}
+
+TEST(TestReadAheadLineSource, invalidPath) {
+    ReadAheadLineSource in(std::make_unique<MmapLineSource>(
+        "/this/path/does/not/exist"));
+    EXPECT_FALSE(in);
+    std::string line;
+    EXPECT_FALSE(in.getline(line));
+}
+
+TEST(TestReadAheadLineSource, error) {
+    ReadAheadLineSource in(std::make_unique<FailingLineSource>(), 2, 1);
+    std::string line;
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(in.getline(line));
+        EXPECT_EQ("x", line);
+    }
+    EXPECT_THROW(in.getline(line), std::runtime_error);
+    EXPECT_FALSE(in.getline(line));
+    EXPECT_FALSE(in);
+}
+
+TEST(TestReadAheadLineSource, inputStreamRewind) {
+    std::string data = "#header\n1\t2\t3\n1\t4\t5\n";
+    TempFile::ptr tmp = writeTemp(data);
+    ILineSource::ptr src = std::make_unique<ReadAheadLineSource>(
+        std::make_unique<MmapLineSource>(tmp->path()));
+    InputStream::ptr in = InputStream::create("test", src);
+
+    EXPECT_EQ(BED, inferFileType(*in));
+    EXPECT_EQ(0u, in->lineNum());
+
+    std::string line;
+    std::stringstream result;
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(in->getline(line));
+        result << line << "\n";
+    }
+    EXPECT_EQ(data, result.str());
+    EXPECT_EQ(3u, in->lineNum());
+    EXPECT_FALSE(in->getline(line));
+    EXPECT_TRUE(in->eof());
+}
@@ -9,6 +9,7 @@
 #include <deque>
 #include <utility>
 #include <iostream>
+#include <set>
 
 namespace {
     struct MockEntry {
@@ -63,6 +64,25 @@ namespace {
 
         std::vector<EntryList> entries;
     };
+
+    // Copies each group and releases its entries back to the pool
+    struct RecyclingCollector {
+        typedef std::vector<std::unique_ptr<MockEntry>> EntryList;
+
+        void operator()(EntryList&& ents) {
+            std::vector<MockEntry> group;
+            for (auto i = ents.begin(); i != ents.end(); ++i) {
+                group.push_back(**i);
+                addresses.insert(i->get());
+            }
+            entries.push_back(group);
+            pool.release(ents);
+        }
+
+        ValuePool<MockEntry>& pool;
+        std::vector<std::vector<MockEntry>> entries;
+        std::set<MockEntry const*> addresses;
+    };
 }
 
 class TestGroupOverlapping : public ::testing::Test {
@@ -199,3 +219,27 @@ TEST_F(TestGroupOverlapping, sort) {
     EXPECT_EQ(entries[6], *xs[3][0]);
     EXPECT_EQ(entries[5], *xs[3][1]);
 }
+
+TEST_F(TestGroupOverlapping, pool) {
+    MockReader reader{entries};
+
+    ValuePool<MockEntry> pool;
+    RecyclingCollector collector{pool};
+
+    auto oer = makeGroupOverlapping<MockEntry>(collector);
+    auto pump = makePointerStreamPump(reader, oer, &pool);
+    pump.execute();
+
+    auto const& xs = collector.entries;
+    ASSERT_EQ(4u, xs.size());
+    ASSERT_EQ(3u, xs[0].size());
+    EXPECT_EQ(entries[2], xs[0][2]);
+    ASSERT_EQ(2u, xs[3].size());
+    EXPECT_EQ(entries[5], xs[3][0]);
+    EXPECT_EQ(entries[6], xs[3][1]);
+
+    // at most the largest group (plus the entry read past its end) is live
+    // at once, so the 7 entries are read into just 4 values
+    EXPECT_EQ(4u, collector.addresses.size());
+    EXPECT_EQ(4u, pool.size());
+}
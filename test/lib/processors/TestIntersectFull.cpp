@@ -109,3 +109,39 @@ TEST(TestIntersectFull, cacheCrash) {
     ASSERT_EQ(1u, rc.missesA.size());
     ASSERT_EQ(1u, rc.missesB.size());
 }
+
+TEST(TestIntersectFull, longInterval) {
+    // one long interval in b, followed by more short ones than fit in the
+    // cache at first. a hits every other short one, and the long one.
+    stringstream a;
+    stringstream b;
+    b << "1\t0\t1000\tA/T\n";
+    for (int i = 0; i < 100; ++i) {
+        b << "1\t" << 10 * i << "\t" << 10 * i + 5 << "\tA/T\n";
+        if (i % 2 == 0)
+            a << "1\t" << 10 * i + 1 << "\t" << 10 * i + 2 << "\tA/T\n";
+    }
+    a << "2\t1\t2\tA/T\n";
+
+    MockCollector rc;
+    InputStream streamA("A", a);
+    InputStream streamB("B", b);
+    auto s1 = openBed(streamA);
+    auto s2 = openBed(streamB);
+    auto intersector = makeFullIntersector(*s1, *s2, rc);
+    intersector.execute();
+
+    ASSERT_EQ(100u, rc.hitsA.size());
+    for (size_t i = 0; i < rc.hitsA.size(); i += 2) {
+        EXPECT_EQ(1000, rc.hitsA[i].second.stop());
+        EXPECT_EQ(rc.hitsA[i].first.start() - 1, rc.hitsA[i + 1].second.start());
+    }
+
+    ASSERT_EQ(1u, rc.missesA.size());
+    EXPECT_EQ("2", rc.missesA[0].chrom());
+
+    // misses in b are reported in order
+    ASSERT_EQ(50u, rc.missesB.size());
+    for (size_t i = 0; i < rc.missesB.size(); ++i)
+        EXPECT_EQ(int64_t(20 * i + 10), rc.missesB[i].start());
+}
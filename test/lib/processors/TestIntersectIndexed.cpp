@@ -0,0 +1,117 @@
+#include "processors/IntersectIndexed.hpp"
+#include "io/InputStream.hpp"
+#include "fileformats/BedReader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    const string BEDA =
+        "1\t2\t2\t*/CC\t30\t30\n"
+        "1\t2\t2\t*/CCC\t30\t30\n"
+        "1\t5\t8\tTTT/*\t30\t30\n"
+        "1\t5\t8\tCCC/*\t30\t30";
+
+    const string BEDB =
+        "1\t2\t2\t*/CC\t30\t30\n"
+        "1\t2\t2\t*/CCC\t30\t30\n"
+        "1\t5\t8\tTTT/*\t30\t30\n"
+        "2\t1\t2\tA/T\t30\t30";
+
+    // out of order
+    const string BEDC =
+        "17\t7993250\t7993257\tAAAAACA/0\t-\t-\n"
+        "17\t7985785\t7985786\tT/0\t-\t-\n"
+        "17\t7985753\t7985754\tT/0\t-\t-\n"
+        "17\t8000100\t8000200\tA/0\t-\t-"
+        ;
+
+    const string BEDD =
+        "17\t7985753\t7985754\tT/0\t-\t-\n"
+        "17\t7985753\t7985786\tTTTTTTCTCCCCCTTGAACTTGAGCTCAATTCT/0\t-\t-\n"
+        "17\t7985754\t7985754\t0/TTTTTCTCCCCCTTGAACTTGAGCTCAATTC\t-\t-\n"
+        "17\t7985785\t7985786\tT/0\t-\t-\n"
+        // a long interval, spanning all but the last line of A
+        "17\t1\t8000000\tA/0\t-\t-"
+        ;
+
+    struct MockCollector {
+        bool hit(const Bed& a, const Bed& b) {
+            hits.push_back(make_pair(a,b));
+            return true;
+        }
+        bool wantMissA() const { return true; }
+        bool wantMissB() const { return true; }
+        void missA(const Bed& a) { missesA.push_back(a); }
+        void missB(const Bed& b) { missesB.push_back(b); }
+
+        vector<pair<Bed,Bed> > hits;
+        vector<Bed> missesA;
+        vector<Bed> missesB;
+    };
+
+    void intersect(string const& a, string const& b, MockCollector& rc) {
+        stringstream ssA(a);
+        stringstream ssB(b);
+        InputStream streamA("A", ssA);
+        InputStream streamB("B", ssB);
+        auto s1 = openBed(streamA);
+        auto s2 = openBed(streamB);
+
+        IntervalIndex<Bed> index;
+        Bed bed;
+        while (s2->next(bed))
+            index.add(bed);
+        index.build();
+
+        IntersectIndexed<Bed, MockCollector> intersector(index, rc);
+        intersector.execute(*s1);
+    }
+}
+
+TEST(TestIntersectIndexed, intersectSelf) {
+    MockCollector rc;
+    intersect(BEDA, BEDA, rc);
+
+    // each line hits twice each generating 8 total matches
+    ASSERT_EQ(8u, rc.hits.size());
+    ASSERT_EQ(0u, rc.missesA.size());
+    ASSERT_EQ(0u, rc.missesB.size());
+}
+
+TEST(TestIntersectIndexed, misses) {
+    MockCollector rc;
+    intersect(BEDA, BEDB, rc);
+
+    // first 2 lines hit twice each, last 2 lines once each, total of 6 hits
+    ASSERT_EQ(6u, rc.hits.size());
+    ASSERT_EQ(0u, rc.missesA.size());
+    ASSERT_EQ(1u, rc.missesB.size());
+    EXPECT_EQ("2", rc.missesB[0].chrom());
+}
+
+TEST(TestIntersectIndexed, unsortedA) {
+    MockCollector rc;
+    intersect(BEDC, BEDD, rc);
+
+    // as IntersectFull's cacheCrash test, plus the long interval in B
+    // hitting everything but the last line of A
+    ASSERT_EQ(7u, rc.hits.size());
+    ASSERT_EQ(1u, rc.missesA.size());
+    EXPECT_EQ(8000100, rc.missesA[0].start());
+    ASSERT_EQ(1u, rc.missesB.size());
+    EXPECT_EQ(7985754, rc.missesB[0].start());
+
+    // hits for each line of A are reported in the order of B
+    EXPECT_EQ(7985785, rc.hits[1].first.start());
+    EXPECT_EQ(7985753, rc.hits[1].second.start());
+    EXPECT_EQ(7985786, rc.hits[1].second.stop());
+    EXPECT_EQ(7985785, rc.hits[2].second.start());
+    EXPECT_EQ(1, rc.hits[3].second.start());
+}
@@ -0,0 +1,81 @@
+#include "processors/IntervalIndex.hpp"
+#include "fileformats/Bed.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    // the numbers of the values in beds overlapping [start, stop], found
+    // the slow way
+    vector<uint32_t> bruteForce(vector<Bed> const& beds, string const& chrom,
+            int64_t start, int64_t stop)
+    {
+        vector<uint32_t> rv;
+        for (size_t i = 0; i < beds.size(); ++i) {
+            Bed const& b = beds[i];
+            if (b.chrom() == chrom && b.start() <= stop && b.stop() >= start)
+                rv.push_back(i);
+        }
+        return rv;
+    }
+}
+
+TEST(TestIntervalIndex, find) {
+    IntervalIndex<Bed> index;
+    index.add(Bed("1", 10, 20));
+    index.add(Bed("1", 5, 1000));
+    index.add(Bed("2", 15, 16));
+    index.add(Bed("1", 30, 30));
+    index.build();
+
+    ASSERT_EQ(4u, index.size());
+    EXPECT_EQ(Bed("2", 15, 16), index[2]);
+
+    vector<uint32_t> found;
+    index.find(index[0].chromId(), 15, 15, found);
+    EXPECT_EQ((vector<uint32_t>{0, 1}), found);
+
+    // touching counts
+    found.clear();
+    index.find(index[0].chromId(), 20, 30, found);
+    EXPECT_EQ((vector<uint32_t>{0, 1, 3}), found);
+
+    found.clear();
+    index.find(index[0].chromId(), 1001, 2000, found);
+    EXPECT_TRUE(found.empty());
+
+    found.clear();
+    index.find(SequenceDictionary::instance().id(string("3")), 0, 100, found);
+    EXPECT_TRUE(found.empty());
+}
+
+TEST(TestIntervalIndex, random) {
+    srand(42);
+    vector<string> chroms{"1", "2", "10"};
+    vector<Bed> beds;
+    IntervalIndex<Bed> index;
+    for (size_t n = 0; n < 3000; ++n) {
+        int64_t start = rand() % 10000;
+        // mostly short intervals, with a few very long ones
+        int64_t length = rand() % 50 == 0 ? rand() % 5000 : rand() % 20;
+        beds.push_back(Bed(chroms[rand() % chroms.size()], start, start + length));
+        index.add(beds.back());
+    }
+    index.build();
+
+    for (size_t n = 0; n < 500; ++n) {
+        string const& chrom = chroms[rand() % chroms.size()];
+        int64_t start = rand() % 11000 - 500;
+        int64_t stop = start + rand() % 100;
+
+        vector<uint32_t> found;
+        index.find(SequenceDictionary::instance().id(chrom), start, stop, found);
+        ASSERT_EQ(bruteForce(beds, chrom, start, stop), found)
+            << chrom << ":" << start << "-" << stop;
+    }
+}
@@ -0,0 +1,71 @@
+#include "processors/MergePlan.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    // Carry out the plan on runs numbered 0..n-1, returning for each run
+    // left for the final merge the original runs that ended up in it.
+    vector<vector<size_t>> apply(size_t n, vector<MergeStep> const& steps) {
+        vector<vector<size_t>> runs;
+        for (size_t i = 0; i < n; ++i)
+            runs.push_back(vector<size_t>(1, i));
+
+        for (auto s = steps.begin(); s != steps.end(); ++s) {
+            EXPECT_LE(s->first + s->count, runs.size());
+            vector<size_t>& merged = runs[s->first];
+            for (size_t i = s->first + 1; i < s->first + s->count; ++i)
+                merged.insert(merged.end(), runs[i].begin(), runs[i].end());
+            runs.erase(runs.begin() + s->first + 1,
+                runs.begin() + s->first + s->count);
+        }
+        return runs;
+    }
+}
+
+TEST(TestMergePlan, fewRuns) {
+    EXPECT_TRUE(planMerge(vector<uint64_t>(4, 1), 4).empty());
+    EXPECT_TRUE(planMerge(vector<uint64_t>(), 2).empty());
+    EXPECT_THROW(planMerge(vector<uint64_t>(4, 1), 1), runtime_error);
+}
+
+TEST(TestMergePlan, fanIn) {
+    for (size_t fanIn = 2; fanIn < 7; ++fanIn) {
+        for (size_t n = fanIn + 1; n < 60; ++n) {
+            auto steps = planMerge(vector<uint64_t>(n, 10), fanIn);
+            auto runs = apply(n, steps);
+
+            // the final merge is full, as are all passes but the first
+            EXPECT_EQ(fanIn, runs.size());
+            for (size_t i = 1; i < steps.size(); ++i)
+                EXPECT_EQ(fanIn, steps[i].count);
+
+            // the original runs keep their order
+            size_t next = 0;
+            for (auto r = runs.begin(); r != runs.end(); ++r)
+                for (auto i = r->begin(); i != r->end(); ++i)
+                    EXPECT_EQ(next++, *i);
+            EXPECT_EQ(n, next);
+        }
+    }
+}
+
+TEST(TestMergePlan, smallestFirst) {
+    uint64_t sizes[] = {100, 100, 3, 2, 1, 100, 50};
+    auto steps = planMerge(vector<uint64_t>(sizes, sizes + 7), 3);
+
+    // 7 runs take two passes to get down to 3: the first merges 3 so that
+    // the second can merge 3 as well
+    ASSERT_EQ(2u, steps.size());
+    EXPECT_EQ(2u, steps[0].first);
+    EXPECT_EQ(3u, steps[0].count);
+
+    // leaving {100, 100, 6, 100, 50}
+    EXPECT_EQ(2u, steps[1].first);
+    EXPECT_EQ(3u, steps[1].count);
+}
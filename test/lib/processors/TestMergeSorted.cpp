@@ -85,3 +85,74 @@ TEST_F(TestMergeSorted, execute) {
         ASSERT_EQ(_expectedBeds[i], c.beds[i]);
 }
 
+
+TEST_F(TestMergeSorted, nextBatch) {
+    const int nStreams = 3;
+    stringstream streams[nStreams];
+    for (size_t i = 0; i < _expectedBeds.size(); ++i)
+        streams[i % nStreams] << _expectedBeds[i] << "\n";
+
+    vector<InputStream::ptr> inputStreams;
+    vector<BedReader::ptr> bedStreams;
+    for (int i = 0; i < nStreams; ++i) {
+        inputStreams.push_back(std::make_unique<InputStream>("test", streams[i]));
+        bedStreams.push_back(openBed(*inputStreams.back()));
+    }
+
+    auto merger = makeMergeSorted(bedStreams);
+    vector<Bed> batch;
+    vector<Bed> result;
+    size_t n;
+    while ((n = merger.nextBatch(batch, 64)) > 0) {
+        EXPECT_EQ(64u, batch.size());
+        result.insert(result.end(), batch.begin(), batch.begin() + n);
+    }
+    EXPECT_EQ(_expectedBeds, result);
+}
+
+TEST_F(TestMergeSorted, manyStreams) {
+    // enough streams that the tree is not a power of two deep
+    const int nStreams = 37;
+    stringstream streams[nStreams];
+    for (size_t i = 0; i < _expectedBeds.size(); ++i)
+        streams[(i * 7) % nStreams] << _expectedBeds[i] << "\n";
+
+    vector<InputStream::ptr> inputStreams;
+    vector<BedReader::ptr> bedStreams;
+    for (int i = 0; i < nStreams; ++i) {
+        inputStreams.push_back(std::make_unique<InputStream>("test", streams[i]));
+        bedStreams.push_back(openBed(*inputStreams.back()));
+    }
+
+    Collector c;
+    auto merger = makeMergeSorted(bedStreams);
+    auto pump = makeStreamPump(merger, c);
+    pump.execute();
+    EXPECT_EQ(_expectedBeds, c.beds);
+}
+
+TEST_F(TestMergeSorted, stable) {
+    // equal loci come out in the order of the streams they came from
+    stringstream streams[3];
+    streams[0] << "1\t10\t20\ta0\n" << "2\t10\t20\ta1\n";
+    streams[1] << "1\t10\t20\tb0\n" << "1\t10\t20\tb1\n" << "2\t10\t20\tb2\n";
+    streams[2] << "1\t5\t20\tc0\n" << "1\t10\t20\tc1\n" << "10\t1\t2\tc2\n";
+
+    vector<InputStream::ptr> inputStreams;
+    vector<BedReader::ptr> bedStreams;
+    for (int i = 2; i >= 0; --i) {
+        inputStreams.push_back(std::make_unique<InputStream>("test", streams[i]));
+        bedStreams.push_back(openBed(*inputStreams.back(), 1));
+    }
+
+    Collector c;
+    auto merger = makeMergeSorted(bedStreams);
+    auto pump = makeStreamPump(merger, c);
+    pump.execute();
+
+    stringstream result;
+    for (auto i = c.beds.begin(); i != c.beds.end(); ++i)
+        result << i->extraFields()[0] << " ";
+
+    EXPECT_EQ("C0 C1 B0 B1 A0 B2 A1 C2 ", result.str());
+}
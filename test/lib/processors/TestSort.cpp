@@ -2,6 +2,7 @@
 #include "fileformats/Bed.hpp"
 #include "io/InputStream.hpp"
 #include "fileformats/BedReader.hpp"
+#include "common/StringView.hpp"
 
 #include <boost/ptr_container/ptr_vector.hpp>
 
@@ -30,6 +31,23 @@ namespace {
         stringstream out;
     };
 
+    // Also accepts formatted lines, so sort runs are used
+    template<typename T>
+    struct LineCollector : Collector<T> {
+        LineCollector()
+            : lines(0)
+        {}
+
+        using Collector<T>::operator();
+
+        void operator()(StringView const& line) {
+            this->out << line << "\n";
+            ++lines;
+        }
+
+        int lines;
+    };
+
     BedHeader hdr;
     TypedStreamFactory<BedParser> readerFactory;
 }
@@ -110,6 +128,14 @@ TEST_F(TestSort, gzip) {
     ASSERT_EQ(_expectedStr.str(), out.out.str());
 }
 
+TEST_F(TestSort, bgzf) {
+    Collector<Bed> out;
+    auto sorter = makeSort<BedReader>(_bedReaders, readerFactory, out, hdr,
+        _expectedBeds.size()/10, false, BGZF, ThreadPool::create(2));
+    sorter->execute();
+    ASSERT_EQ(_expectedStr.str(), out.out.str());
+}
+
 TEST_F(TestSort, stable) {
     Collector<Bed> out;
     auto sorter = makeSort<BedReader>(_bedReaders, readerFactory, out, hdr, _expectedBeds.size()/10, true);
@@ -117,3 +143,103 @@ TEST_F(TestSort, stable) {
     ASSERT_EQ(_expectedStr.str(), out.out.str());
 }
 
+
+TEST_F(TestSort, maxBytes) {
+    Collector<Bed> out;
+    // the line limit is never reached, so only the byte budget causes spills
+    auto sorter = makeSort<BedReader>(_bedReaders, readerFactory, out, hdr,
+        _expectedBeds.size() * 2, false);
+    sorter->maxBytes(1 << 10);
+    sorter->execute();
+    ASSERT_EQ(_expectedStr.str(), out.out.str());
+}
+
+TEST_F(TestSort, keySort) {
+    // buffers big enough to be radix sorted
+    Collector<Bed> out;
+    auto sorter = makeSort<BedReader>(_bedReaders, readerFactory, out, hdr,
+        _expectedBeds.size() / 2, true);
+    sorter->execute();
+    ASSERT_EQ(_expectedStr.str(), out.out.str());
+}
+
+TEST_F(TestSort, parallel) {
+    Collector<Bed> out;
+    auto sorter = makeSort<BedReader>(_bedReaders, readerFactory, out, hdr,
+        _expectedBeds.size() / 10, true, BGZF, ThreadPool::create(4));
+    sorter->execute();
+    ASSERT_EQ(_expectedStr.str(), out.out.str());
+}
+
+TEST_F(TestSort, runs) {
+    LineCollector<Bed> out;
+    std::size_t const bufferSize = 60;
+    auto sorter = makeSort<BedReader>(_bedReaders, readerFactory, out, hdr,
+        bufferSize, false, GZIP);
+    sorter->execute();
+    ASSERT_EQ(_expectedStr.str(), out.out.str());
+    // records in full buffers were spilled and passed through as lines, the
+    // rest were merged from memory
+    std::size_t spilled = _expectedBeds.size() / bufferSize * bufferSize;
+    ASSERT_LT(spilled, _expectedBeds.size());
+    EXPECT_EQ(int(spilled), out.lines);
+}
+
+TEST_F(TestSort, runsBgzfParallel) {
+    LineCollector<Bed> out;
+    // the line limit is shared by 4 buffers, each holding a tenth of the
+    // input, so the last one is full and everything is spilled
+    auto sorter = makeSort<BedReader>(_bedReaders, readerFactory, out, hdr,
+        _expectedBeds.size() / 10 * 4, false, BGZF, ThreadPool::create(3));
+    sorter->execute();
+    ASSERT_EQ(_expectedStr.str(), out.out.str());
+    EXPECT_EQ(int(_expectedBeds.size()), out.lines);
+}
+
+TEST_F(TestSort, lineLimitShared) {
+    LineCollector<Bed> out;
+    std::size_t const maxInMem = 60;
+    auto sorter = makeSort<BedReader>(_bedReaders, readerFactory, out, hdr,
+        maxInMem, false, GZIP, ThreadPool::create(3));
+    sorter->execute();
+    ASSERT_EQ(_expectedStr.str(), out.out.str());
+    // the limit is split between the buffer being filled and the 3 that may
+    // be spilling, so buffers are spilled at 15 lines
+    std::size_t const bufferSize = maxInMem / 4;
+    std::size_t spilled = _expectedBeds.size() / bufferSize * bufferSize;
+    EXPECT_EQ(int(spilled), out.lines);
+}
+
+TEST_F(TestSort, maxOpenFiles) {
+    Collector<Bed> out;
+    auto sorter = makeSort<BedReader>(_bedReaders, readerFactory, out, hdr,
+        20, true, BGZF);
+    // 27 temp files are merged 3 at a time
+    sorter->maxOpenFiles(3);
+    sorter->execute();
+    ASSERT_EQ(_expectedStr.str(), out.out.str());
+}
+
+TEST_F(TestSort, runsMaxOpenFiles) {
+    LineCollector<Bed> out;
+    std::size_t const bufferSize = 60;
+    auto sorter = makeSort<BedReader>(_bedReaders, readerFactory, out, hdr,
+        bufferSize, false, GZIP);
+    sorter->maxOpenFiles(2);
+    sorter->execute();
+    ASSERT_EQ(_expectedStr.str(), out.out.str());
+    std::size_t spilled = _expectedBeds.size() / bufferSize * bufferSize;
+    EXPECT_EQ(int(spilled), out.lines);
+}
+
+TEST_F(TestSort, parseError) {
+    stringstream data;
+    data << "1\t1\t2\n1\tx\t3\n1\t3\t4\n";
+    InputStream in("bad", data);
+    vector<BedReader::ptr> readers;
+    readers.push_back(openBed(in, 0));
+
+    Collector<Bed> out;
+    auto sorter = makeSort<BedReader>(readers, readerFactory, out, hdr, 10, false);
+    EXPECT_THROW(sorter->execute(), runtime_error);
+}
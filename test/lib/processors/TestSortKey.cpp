@@ -0,0 +1,94 @@
+#include "processors/SortKey.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    SortKey makeKey(uint32_t chrom, int64_t start, int64_t stop, uint32_t index) {
+        SortKey key = {chrom, index, SortKey::bias(start), SortKey::bias(stop)};
+        return key;
+    }
+
+    vector<SortKey> randomKeys(uint32_t n) {
+        srand(42);
+        vector<SortKey> keys;
+        for (uint32_t i = 0; i < n; ++i) {
+            int64_t start = rand() % 1000 - 10;
+            int64_t stop = start + rand() % 3;
+            if (i % 100 == 0)
+                start = int64_t(rand()) << 20;
+            keys.push_back(makeKey(rand() % 300, start, stop, i));
+        }
+        return keys;
+    }
+
+    void expectStableSorted(vector<SortKey> const& original,
+            vector<SortKey> const& keys)
+    {
+        vector<SortKey> expected(original);
+        stable_sort(expected.begin(), expected.end());
+
+        ASSERT_EQ(expected.size(), keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            // comparing indices checks that the sort is stable
+            ASSERT_EQ(expected[i].index, keys[i].index) << "at " << i;
+        }
+    }
+}
+
+TEST(TestSortKey, chromRanker) {
+    ChromRanker chroms;
+    vector<string> names{"X", "10", "2", "1", "GL000192.1", "2", "MT"};
+    vector<uint32_t> ids;
+    for (auto i = names.begin(); i != names.end(); ++i)
+        ids.push_back(chroms.id(*i));
+
+    EXPECT_EQ(ids[2], ids[5]);
+    EXPECT_EQ(ids[0], chroms.id("X"));
+
+    vector<uint32_t> ranks = chroms.ranks();
+    ASSERT_EQ(6u, ranks.size());
+    EXPECT_EQ(0u, ranks[chroms.id("1")]);
+    EXPECT_EQ(1u, ranks[chroms.id("2")]);
+    EXPECT_EQ(2u, ranks[chroms.id("10")]);
+    EXPECT_EQ(3u, ranks[chroms.id("GL000192.1")]);
+    EXPECT_EQ(4u, ranks[chroms.id("MT")]);
+    EXPECT_EQ(5u, ranks[chroms.id("X")]);
+}
+
+TEST(TestSortKey, radixSort) {
+    vector<SortKey> original = randomKeys(10000);
+    vector<SortKey> keys(original);
+    radixSort(keys);
+    expectStableSorted(original, keys);
+}
+
+TEST(TestSortKey, parallelSort) {
+    // enough for an odd number of pieces to merge
+    vector<SortKey> original = randomKeys(300000);
+    vector<SortKey> keys(original);
+    auto pool = ThreadPool::create(3);
+    parallelSort(keys, *pool);
+    expectStableSorted(original, keys);
+}
+
+TEST(TestSortKey, radixSortNegative) {
+    vector<SortKey> keys{
+          makeKey(0, 5, 6, 0)
+        , makeKey(0, -1, 6, 1)
+        , makeKey(0, 5, -3, 2)
+        , makeKey(0, 0, 0, 3)
+        };
+
+    radixSort(keys);
+    EXPECT_EQ(1u, keys[0].index);
+    EXPECT_EQ(3u, keys[1].index);
+    EXPECT_EQ(2u, keys[2].index);
+    EXPECT_EQ(0u, keys[3].index);
+}
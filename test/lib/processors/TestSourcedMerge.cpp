@@ -0,0 +1,94 @@
+#include "processors/SourcedMerge.hpp"
+#include "processors/IntersectFull.hpp"
+#include "fileformats/BedReader.hpp"
+#include "fileformats/TypedStream.hpp"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    struct Inputs {
+        Inputs(vector<string> const& data) {
+            for (auto i = data.begin(); i != data.end(); ++i) {
+                streams.push_back(std::make_unique<stringstream>(*i));
+                inputStreams.push_back(
+                    std::make_unique<InputStream>("test", *streams.back()));
+                bedStreams.push_back(openBed(*inputStreams.back(), 1));
+            }
+        }
+
+        vector<unique_ptr<stringstream>> streams;
+        vector<InputStream::ptr> inputStreams;
+        vector<BedReader::ptr> bedStreams;
+    };
+
+    // counts the hits in each source, reporting them when each a is done
+    struct CountCollector {
+        CountCollector() : counts(3) {}
+
+        bool hit(const Bed&, const Sourced<Bed>& b) {
+            ++counts[b.sourceIndex()];
+            return true;
+        }
+        bool wantMissA() const { return false; }
+        bool wantMissB() const { return false; }
+        void missA(const Bed&) {}
+        void missB(const Bed&) {}
+
+        vector<uint32_t> counts;
+        vector<vector<uint32_t>> results;
+    };
+
+    void finishA(CountCollector& c, const Bed&) {
+        c.results.push_back(c.counts);
+        c.counts.assign(c.counts.size(), 0);
+    }
+}
+
+TEST(TestSourcedMerge, sources) {
+    Inputs in(vector<string>{
+        "1\t10\t20\ta0\n2\t10\t20\ta1\n",
+        "1\t10\t20\tb0\n1\t15\t20\tb1\n",
+        "1\t5\t20\tc0\n10\t1\t2\tc1\n"
+    });
+
+    SourcedMerge<BedReader> merger(in.bedStreams);
+    EXPECT_EQ("test, test, test", merger.name());
+
+    stringstream result;
+    Sourced<Bed>* peek(0);
+    Sourced<Bed> value;
+    while (!merger.eof()) {
+        ASSERT_TRUE(merger.peek(&peek));
+        string name = peek->extraFields()[0];
+        ASSERT_TRUE(merger.next(value));
+        EXPECT_EQ(name, value.extraFields()[0]);
+        result << value.extraFields()[0] << ":" << value.sourceIndex() << " ";
+    }
+    EXPECT_FALSE(merger.next(value));
+    EXPECT_EQ("C0:2 A0:0 B0:1 B1:1 A1:0 C1:2 ", result.str());
+}
+
+TEST(TestSourcedMerge, intersectCounts) {
+    Inputs a(vector<string>{
+        "1\t10\t20\ta0\n1\t30\t40\ta1\n2\t10\t20\ta2\n"
+    });
+    Inputs b(vector<string>{
+        "1\t5\t12\tx0\n1\t15\t35\tx1\n",
+        "1\t0\t100\ty0\n",
+        "1\t18\t19\tz0\n1\t19\t20\tz1\n2\t19\t20\tz2\n"
+    });
+
+    SourcedMerge<BedReader> merger(b.bedStreams);
+    CountCollector c;
+    auto intersector = makeFullIntersector(*a.bedStreams[0], merger, c);
+    intersector.execute();
+
+    vector<vector<uint32_t>> expected{{2, 1, 2}, {1, 1, 0}, {0, 0, 1}};
+    EXPECT_EQ(expected, c.results);
+}